@@ -0,0 +1,19 @@
+/* Tileable void and cluster blue noise generated by source/noise/blue_noise.cpp */
+
+/* Golden ratio conjugate, offsetting blue noise by it every frame keeps the sequence of
+   values each pixel goes through well distributed while every frame stays blue noise */
+const float goldenRatioConjugate = 0.61803398875;
+
+/**
+ * @param blueNoise - blue noise texture with power of two dimensions
+ * @param pixel - coordinates of the pixel, wrapped around the texture
+ * @param frameIndex - index of the frame used to animate the noise
+ * @return blue noise value in [0, 1)
+ */
+float getAnimatedBlueNoise(sampler2D blueNoise, ivec2 pixel, int frameIndex)
+{
+    ivec2 noiseSize = textureSize(blueNoise, 0);
+    float noise = texelFetch(blueNoise, pixel & (noiseSize - 1), 0).r;
+    /* Frame index is wrapped to keep the precision of the offset */
+    return fract(noise + float(frameIndex % 256) * goldenRatioConjugate);
+}
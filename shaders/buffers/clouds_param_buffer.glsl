@@ -16,4 +16,32 @@ layout (set = 2, binding = 0) uniform CloudsParametersBuffer
     float darknessThreshold;
     int debug;
     vec4 phaseParams;
+    int resolutionDivisor;
+    int reprojectionBlockSize;
+    float shadowMapExtent;
+    float coverageScale;
+    float coverageThreshold;
+    float noiseLodBias;
+    float lightConeSpread;
+    float fineStepLength;
+    float coarseStepMultiplier;
+    float stepDistanceScale;
+    int emptyStepsToCoarse;
+    int sampleHeatmap;
+    float panoramaDistance;
+    float panoramaRefreshDistance;
+    int panoramaSliceCount;
+    int panoramaSampleCount;
+    float farFadeStart;
+    float farFadeLength;
+    float lodStartDistance;
+    float lodEndDistance;
+    float lodStepMultiplier;
+    float lodNoiseBias;
+    float lodDensityOffset;
+    float detailCutoffDistance;
+    float tileBudgetMinScale;
+    float tileBudgetMaxScale;
+    float tileContrastThreshold;
+    int densityBakeDivisor;
 } cloudsParameters;
\ No newline at end of file
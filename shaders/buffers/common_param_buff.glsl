@@ -5,4 +5,10 @@ layout(set = 0, binding = 0) uniform CommonParamBufferObject
     mat4 proj;
     float time;
 	mat4 lHviewProj;
+	mat4 prevViewProj;
+	int frameIndex;
+	mat4 cloudsShadowMatrix;
+	mat4 invViewProj;
+	vec4 cloudsPanoramaCenter;
+	vec4 cameraPosition;
 } commonParameters;
\ No newline at end of file
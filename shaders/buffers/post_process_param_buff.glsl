@@ -25,4 +25,6 @@ layout (set = 2, binding = 0) uniform PostProcessBufferObject
 
     int tonemapCurve;
     vec2 texDimensions;
+    /* Non zero weighs the centre of the screen more when metering the exposure */
+    int meteringMask;
 } postProcessParameters;
\ No newline at end of file
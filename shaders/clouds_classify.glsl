@@ -0,0 +1,100 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+/* Classify 8x8 tiles of the clouds trace targets before the clouds are traced. Each pixel
+   tests its camera ray against the scene depth and the cloud layer shell, tiles where no
+   ray reaches the clouds are resolved here and the rest is appended to the tile list
+   which clouds_trace is dispatched over indirectly */
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+#include "shaders/common_func.glsl"
+
+/* layout (set = 0, binding = 0) */ #include "shaders/buffers/common_param_buff.glsl"
+/* layout (set = 1, binding = 0) */ #include "shaders/buffers/atmosphere_param_buff.glsl"
+/* layout (set = 2, binding = 0  */ #include "shaders/buffers/clouds_param_buffer.glsl"
+layout (set = 3, binding = 0) uniform sampler2D sceneDepthSampler;
+layout (set = 4, binding = 0, rgba16f) uniform writeonly image2D cloudsTrace;
+/* r - scene depth the ray was traced against, g - clouds depth */
+layout (set = 4, binding = 1, rg32f) uniform writeonly image2D cloudsTraceDepth;
+/* See clouds_trace, one texel per tile */
+layout (set = 4, binding = 2, rgba16f) uniform writeonly image2D cloudsTileStats;
+/* Starts with VkDispatchIndirectCommand of the trace pass, x is reset to 0 each frame */
+layout (set = 5, binding = 0) buffer CloudsTileList
+{
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+    /* number of tiles of each class, for inspection in a frame debugger */
+    uint emptyTileCount;
+    uint visibleTileCount;
+    uint occludedTileCount;
+    /* x | y << 16 tile coordinates, bit 15 marks partially occluded tiles */
+    uint tiles[];
+} cloudsTiles;
+
+#include "shaders/clouds_layer.glsl"
+#include "shaders/clouds_reprojection.glsl"
+
+const uint TILE_HAS_CLOUDS = 1u;
+const uint TILE_HAS_NO_CLOUDS = 2u;
+const uint TILE_OCCLUDED_BIT = 1u << 15;
+
+shared uint tileClasses;
+
+void main()
+{
+    if(gl_LocalInvocationIndex == 0) { tileClasses = 0u; }
+    barrier();
+
+    ivec2 traceCoords = ivec2(gl_GlobalInvocationID.xy);
+    bool inside = all(lessThan(traceCoords, imageSize(cloudsTrace)));
+
+    int blockSize = cloudsParameters.reprojectionBlockSize;
+    ivec2 sceneExtent = textureSize(sceneDepthSampler, 0);
+    ivec2 cloudsExtent = (sceneExtent + cloudsParameters.resolutionDivisor - 1) /
+        cloudsParameters.resolutionDivisor;
+
+    /* Same pixel as clouds_trace picks this frame */
+    ivec2 cloudsCoords = traceCoords * blockSize +
+        getTracedPixelOffset(commonParameters.frameIndex, blockSize);
+    cloudsCoords = min(cloudsCoords, cloudsExtent - 1);
+
+    float sceneDepth = texelFetch(sceneDepthSampler,
+        getCloudsPixelSceneCoords(cloudsCoords, sceneExtent), 0).r;
+
+    if(inside)
+    {
+        vec3 rayDirection;
+        vec3 raySegment = getCloudsRaySegment(getCloudsPixelUV(cloudsCoords, sceneExtent),
+            sceneDepth, rayDirection);
+        atomicOr(tileClasses, raySegment.y > 0.0 ? TILE_HAS_CLOUDS : TILE_HAS_NO_CLOUDS);
+    }
+    barrier();
+    uint classes = tileClasses;
+
+    if(classes == TILE_HAS_NO_CLOUDS)
+    {
+        /* Same output as raymarchClouds gives rays which never reach the clouds */
+        if(inside)
+        {
+            imageStore(cloudsTrace, traceCoords, vec4(0.0, 0.0, 0.0, 1.0));
+            imageStore(cloudsTraceDepth, traceCoords, vec4(sceneDepth, sceneDepth, 0.0, 0.0));
+        }
+        if(gl_LocalInvocationIndex == 0)
+        {
+            atomicAdd(cloudsTiles.emptyTileCount, 1u);
+            /* Clouds entering the tile later start from the default budget */
+            imageStore(cloudsTileStats, ivec2(gl_WorkGroupID.xy), vec4(-1.0, 0.0, 0.0, 0.0));
+        }
+        return;
+    }
+
+    if(gl_LocalInvocationIndex == 0)
+    {
+        bool occluded = (classes & TILE_HAS_NO_CLOUDS) != 0u;
+        uint tile = gl_WorkGroupID.x | (gl_WorkGroupID.y << 16) | (occluded ? TILE_OCCLUDED_BIT : 0u);
+        cloudsTiles.tiles[atomicAdd(cloudsTiles.dispatchX, 1u)] = tile;
+        if(occluded) { atomicAdd(cloudsTiles.occludedTileCount, 1u); }
+        else         { atomicAdd(cloudsTiles.visibleTileCount, 1u); }
+    }
+}
@@ -0,0 +1,36 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+/* Bake one mip of the clouds shape density volume -> the shape noise weighting of
+   sampleDensity evaluated once per texel so that the raymarch does a single channel
+   fetch instead of a four channel one and a normalization per sample. Beyond
+   detailCutoffDistance it is the only 3D fetch of a sample, see getCloudsDetailWeight,
+   the light march and the shadow map samples follow the view sample. The volume covers
+   one tile of the shape noise, mip i is baked from mip i of the noise at the same texel
+   centres so the filtered result matches sampling the noise directly. Density offset,
+   coverage and detail erosion depend on per sample state and stay in sampleDensity */
+layout (local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+layout (set = 0, binding = 0) uniform sampler3D worleyNoiseSampler;
+/* r - weighted shape noise before density offset, coverage and erosion */
+layout (set = 1, binding = 0, r16f) uniform writeonly image3D cloudsDensity;
+/* layout (set = 2, binding = 0) */ #include "shaders/buffers/clouds_param_buffer.glsl"
+
+void main()
+{
+    ivec3 coords = ivec3(gl_GlobalInvocationID.xyz);
+    ivec3 densitySize = imageSize(cloudsDensity);
+    if(any(greaterThanEqual(coords, densitySize)))
+    {
+        return;
+    }
+
+    vec3 uvw = (vec3(coords) + 0.5) / vec3(densitySize);
+    /* Noise mip whose texels have the footprint of the texels of this mip, a reduced
+       bake resolution (densityBakeDivisor) starts further down the noise chain */
+    float shapeLod = max(log2(float(textureSize(worleyNoiseSampler, 0).x) / float(densitySize.x)), 0.0);
+
+    vec4 shapeNoise = textureLod(worleyNoiseSampler, uvw, shapeLod);
+    float shapeFBM = dot(shapeNoise, normalize(cloudsParameters.shapeNoiseWeights));
+    imageStore(cloudsDensity, coords, vec4(shapeFBM, 0.0, 0.0, 0.0));
+}
@@ -0,0 +1,113 @@
+/* Cloud layer geometry shared by the clouds passes. The including shader has to declare
+   commonParameters, atmosphereParameters and cloudsParameters and include
+   common_func.glsl before including this file */
+
+/* One unit in global space should be 100 meters in camera coords */
+const float cameraScale = 0.1;
+
+vec2 getRayCloudLayerInfo(float cloudAltMin, float cloudAltMax, vec3 position, vec3 rayDirection)
+{
+    /* Get position offset by the radius of the planet */
+    vec3 planetPosition = position + vec3(0.0, 0.0, atmosphereParameters.bottom_radius);
+    vec2 cloudLayerBoundaries = vec2(cloudAltMin, cloudAltMax) + vec2(atmosphereParameters.bottom_radius);
+
+    /* vec4(distToCloudLayer0, distThroughCloudLayer0, distToCloudLayer1, distThroughCloudLayer1) */
+    vec2 result = vec2(-1.0, -1.0);
+    vec3 planet0 = vec3(0.0, 0.0, 0.0);
+    float bottomCID = raySphereIntersectNearest(
+        planetPosition, rayDirection, planet0, cloudLayerBoundaries.x);
+    float topCID = raySphereIntersectNearest(
+        planetPosition, rayDirection, planet0, cloudLayerBoundaries.y);
+    float groundCID = raySphereIntersectNearest(
+        planetPosition, rayDirection, planet0, atmosphereParameters.bottom_radius);
+
+    /* Above clouds */
+    if(length(planetPosition) >= cloudLayerBoundaries.y)
+    {
+        if(topCID == -1.0) {return result;}
+        if(bottomCID == -1.0)
+        {
+            vec3 newPosition = planetPosition + (topCID.x + 0.001) * rayDirection;
+            float topCID2 = raySphereIntersectNearest(newPosition, rayDirection, planet0, cloudLayerBoundaries.y);
+            if(topCID2 == -1.0) {return result;}
+            result.x = topCID;
+            result.y = topCID2 - topCID;
+            return result;
+        }else{
+            result.x = topCID;
+            result.y = bottomCID - topCID;
+            return result;
+        }
+    }
+    /* In clouds */
+    else if ( length(planetPosition) < cloudLayerBoundaries.y && 
+              length(planetPosition) > cloudLayerBoundaries.x )
+    {
+        result.x = 0.0;
+        if (topCID < 0.0)         { result.y = bottomCID; }
+        else if (bottomCID < 0.0) { result.y = topCID; } 
+        else                      { result.y = min(topCID, bottomCID);}
+        return result;
+    }
+    /* Under clouds */
+    else if (length(planetPosition) <= cloudLayerBoundaries.x)
+    {
+        if(groundCID == -1.0)
+        {
+           result.x = bottomCID;
+           result.y = topCID - bottomCID;
+        } 
+        return result;
+    }
+}
+
+/**
+ * Part of the camera ray going through uv which lies inside of the cloud layer and
+ * in front of the scene
+ * @param uv - screen position in [0, 1]
+ * @param depth - depth of the scene, the ray segment ends at it
+ * @param rayDirection - unit direction of the camera ray in world space
+ * @return x - distance from the camera to the cloud layer, y - length of the ray inside
+ *      of the cloud layer, zero or negative when there is nothing to raymarch,
+ *      z - length of the ray inside of the cloud layer ignoring the scene
+ */
+vec3 getCloudsRaySegment(vec2 uv, float depth, out vec3 rayDirection)
+{
+    /* Camera position in world space */
+    vec3 cameraPosition = atmosphereParameters.camera_position;
+    /* Vulkans clip space range [-1, -1] - (1, 1) -> z is depth [0, 1] */
+    vec3 clipSpace = vec3(uv * vec2(2.0) - vec2(1.0), depth);
+    vec4 hPos = commonParameters.invViewProj * vec4(clipSpace, 1.0);
+    /* Get unit lenght ray from camera origin to processed fragment in world space */
+    rayDirection = normalize(hPos.xyz/hPos.w - cameraPosition);
+
+    /* Get depth in world space */
+    float realDepth = length(hPos.xyz/hPos.w - cameraPosition);
+
+    vec2 rayToCloudLayerInfo = getRayCloudLayerInfo(cloudsParameters.minBounds,
+        cloudsParameters.maxBounds, cameraPosition * cameraScale, rayDirection);
+    float distanceToCloudBB = rayToCloudLayerInfo.x * 1.0/cameraScale;
+    float distanceInsideCloudBB = rayToCloudLayerInfo.y * 1.0/cameraScale;
+
+    /* Make sure to only integrate the visible part of clouds -> if there is f.e.
+       a hill obstructing part of (hidden inside) the cloud BB
+       raymarch only towards the start of that hill */
+    return vec3(distanceToCloudBB, min(realDepth - distanceToCloudBB, distanceInsideCloudBB),
+        distanceInsideCloudBB);
+}
+
+/* Camera centred lat-long parametrization of the distant clouds panorama, u is the
+   azimuth around the world up axis and v the angle from it */
+vec2 getCloudsPanoramaUV(vec3 direction)
+{
+    float azimuth = atan(direction.y, direction.x);
+    float zenith = acos(clamp(direction.z, -1.0, 1.0));
+    return vec2(azimuth / (2.0 * PI) + 0.5, zenith / PI);
+}
+
+vec3 getCloudsPanoramaDirection(vec2 uv)
+{
+    float azimuth = (uv.x - 0.5) * 2.0 * PI;
+    float zenith = uv.y * PI;
+    return vec3(sin(zenith) * cos(azimuth), sin(zenith) * sin(azimuth), cos(zenith));
+}
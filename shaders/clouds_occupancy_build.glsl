@@ -0,0 +1,52 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+/* Build level 0 of the clouds occupancy volume -> conservative maximum of the baked shape
+   density over one brick. sampleDensity reads the baked volume at any mip the sample
+   footprint selects, so the maximum is taken over the texels of every mip a filtered
+   lookup inside of the brick can touch. The density offset is applied when the volume
+   is read, see getEmptySpaceLength */
+layout (local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+layout (set = 0, binding = 0, r32f) uniform writeonly image3D cloudsOccupancy;
+/* r - weighted shape noise, see clouds_density_bake */
+layout (set = 0, binding = 1) uniform sampler3D cloudsDensitySampler;
+
+void main()
+{
+    ivec3 brickCoords = ivec3(gl_GlobalInvocationID.xyz);
+    ivec3 occupancySize = imageSize(cloudsOccupancy);
+    if(any(greaterThanEqual(brickCoords, occupancySize)))
+    {
+        return;
+    }
+
+    vec3 brickMin = vec3(brickCoords) / vec3(occupancySize);
+    vec3 brickMax = vec3(brickCoords + 1) / vec3(occupancySize);
+
+    float maxShapeFBM = -1.0e20;
+    int mipCount = textureQueryLevels(cloudsDensitySampler);
+    for(int mip = 0; mip < mipCount; mip++)
+    {
+        ivec3 mipSize = textureSize(cloudsDensitySampler, mip);
+        /* Trilinear lookups at uvw read texels floor(uvw * size - 0.5) and the next one */
+        ivec3 texelStart = ivec3(floor(brickMin * vec3(mipSize) - 0.5));
+        ivec3 texelEnd = ivec3(floor(brickMax * vec3(mipSize) - 0.5)) + 1;
+        /* Coarse mips wrap around onto texels already visited, no need to go further */
+        texelEnd = min(texelEnd, texelStart + mipSize - 1);
+        for(int z = texelStart.z; z <= texelEnd.z; z++)
+        {
+            for(int y = texelStart.y; y <= texelEnd.y; y++)
+            {
+                for(int x = texelStart.x; x <= texelEnd.x; x++)
+                {
+                    /* Density volume is sampled with repeat addressing */
+                    ivec3 texel = (ivec3(x, y, z) + mipSize) % mipSize;
+                    maxShapeFBM = max(maxShapeFBM, texelFetch(cloudsDensitySampler, texel, mip).r);
+                }
+            }
+        }
+    }
+    /* Small bias covers the reduced precision of the hardware filtering weights */
+    imageStore(cloudsOccupancy, brickCoords, vec4(maxShapeFBM + 0.001, 0.0, 0.0, 0.0));
+}
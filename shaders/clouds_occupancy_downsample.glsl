@@ -0,0 +1,26 @@
+#version 450
+
+/* Build one mip of the clouds occupancy volume as the maximum of the 2x2x2 texels
+   of the previous mip it covers */
+layout (local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+layout (set = 0, binding = 0, r32f) uniform readonly image3D srcOccupancy;
+layout (set = 0, binding = 1, r32f) uniform writeonly image3D dstOccupancy;
+
+void main()
+{
+    ivec3 coords = ivec3(gl_GlobalInvocationID.xyz);
+    if(any(greaterThanEqual(coords, imageSize(dstOccupancy))))
+    {
+        return;
+    }
+
+    ivec3 srcSize = imageSize(srcOccupancy);
+    float maxDensity = -1.0e20;
+    for(int i = 0; i < 8; i++)
+    {
+        ivec3 srcCoords = min(coords * 2 + ivec3(i & 1, (i >> 1) & 1, i >> 2), srcSize - 1);
+        maxDensity = max(maxDensity, imageLoad(srcOccupancy, srcCoords).r);
+    }
+    imageStore(dstOccupancy, coords, vec4(maxDensity, 0.0, 0.0, 0.0));
+}
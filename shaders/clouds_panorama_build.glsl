@@ -0,0 +1,65 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+/* March the distant clouds panorama, a lat-long map of the part of the cloud layer
+   further than panoramaDistance from cloudsPanoramaCenter. Only one column out of
+   every panoramaSliceCount is marched each frame, all of them when the renderer moved
+   the centre of the panorama (w of cloudsPanoramaCenter is 1). The dispatch is indirect
+   and sized by the renderer to the columns marched this frame */
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+#include "shaders/common_func.glsl"
+
+/* layout (set = 0, binding = 0) */ #include "shaders/buffers/common_param_buff.glsl"
+/* layout (set = 1, binding = 0) */ #include "shaders/buffers/atmosphere_param_buff.glsl"
+/* layout (set = 2, binding = 0  */ #include "shaders/buffers/clouds_param_buffer.glsl"
+layout (set = 3, binding = 0) uniform sampler3D worleyNoiseSampler;
+layout (set = 3, binding = 1) uniform sampler3D worleyNoiseDetailSampler;
+layout (set = 3, binding = 2) uniform sampler3D cloudsOccupancySampler;
+layout (set = 3, binding = 3) uniform sampler3D cloudsShadowSampler;
+layout (set = 3, binding = 4) uniform sampler2D cloudsCoverageSampler;
+layout (set = 3, binding = 5) uniform sampler3D cloudsDensitySampler;
+layout (set = 4, binding = 0, rgba16f) uniform readonly image2D transmittanceLUT;
+/* rgb - light scattered towards the centre, a - transmittance */
+layout (set = 5, binding = 0, rgba16f) uniform writeonly image2D cloudsPanorama;
+
+#include "shaders/clouds_raymarch.glsl"
+
+void main()
+{
+    ivec2 coords = ivec2(gl_GlobalInvocationID.xy);
+    /* Invocation x is the index of the column within this frames slice */
+    int sliceCount = max(cloudsParameters.panoramaSliceCount, 1);
+    bool fullRefresh = commonParameters.cloudsPanoramaCenter.w > 0.0;
+    if(!fullRefresh)
+    {
+        coords.x = coords.x * sliceCount + commonParameters.frameIndex % sliceCount;
+    }
+    ivec2 panoramaSize = imageSize(cloudsPanorama);
+    if(any(greaterThanEqual(coords, panoramaSize)))
+    {
+        return;
+    }
+
+    vec3 origin = commonParameters.cloudsPanoramaCenter.xyz;
+    vec3 rayDirection = getCloudsPanoramaDirection((vec2(coords) + 0.5) / vec2(panoramaSize));
+    vec2 layerInfo = getRayCloudLayerInfo(cloudsParameters.minBounds, cloudsParameters.maxBounds,
+        origin * cameraScale, rayDirection) / cameraScale;
+
+    float segmentStart = max(layerInfo.x, cloudsParameters.panoramaDistance);
+    float segmentEnd = layerInfo.x + layerInfo.y;
+
+    vec4 farClouds = vec4(0.0, 0.0, 0.0, 1.0);
+    if(layerInfo.y > 0.0 && segmentEnd > segmentStart)
+    {
+        /* Texels are marched once every few frames -> per texel hash instead of the
+           animated blue noise, the neighbouring columns come from other frames anyway */
+        float jitter = fract(52.9829189 * fract(dot(vec2(coords), vec2(0.06711056, 0.00583715))));
+        float texelAngle = PI / float(panoramaSize.y);
+        vec2 depthAccum = vec2(0.0);
+        int sampleCount = 0;
+        farClouds = marchCloudsSegment(origin, rayDirection, segmentStart, segmentEnd - segmentStart,
+            jitter, texelAngle, cloudsParameters.panoramaSampleCount, depthAccum, sampleCount);
+    }
+    imageStore(cloudsPanorama, coords, farClouds);
+}
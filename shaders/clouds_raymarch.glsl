@@ -0,0 +1,588 @@
+/* Cloud raymarching shared by the clouds passes. The including shader has to declare
+   commonParameters, atmosphereParameters, cloudsParameters, worleyNoiseSampler,
+   worleyNoiseDetailSampler, cloudsOccupancySampler, cloudsShadowSampler,
+   cloudsCoverageSampler, cloudsDensitySampler and transmittanceLUT before including this file */
+
+#include "shaders/clouds_layer.glsl"
+
+// Henyey-Greenstein
+float hg(float a, float g) {
+    float g2 = g*g;
+    return (1-g2) / (4*3.1415*pow(1+g2-2*g*(a), 1.5));
+}
+
+float phase(float a) {
+    vec4 phaseParams = cloudsParameters.phaseParams;
+    float blend = phaseParams.w;
+    float hgBlend = hg(a,phaseParams.x) * (1-blend) + hg(a,-phaseParams.y) * blend;
+    return phaseParams.z + hgBlend;
+}
+
+float remap(float v, float minOld, float maxOld, float minNew, float maxNew) {
+    return minNew + (v - minOld) * (maxNew - minNew) / (maxOld - minOld);
+}
+
+float saturate(float x) { return clamp(x, 0.0, 1.0); }
+
+/* Cloud coverage in [0, 1] at the horizontal position of samplePos, zero is clear sky */
+float getCloudsCoverage(vec3 samplePos)
+{
+    const float baseScale = 1.0/1000.0;
+    vec2 uv = samplePos.xy * baseScale * cloudsParameters.coverageScale;
+    /* Explicit lod -> the coarser mips hold maximums used by getClearCoverageLength */
+    float coverage = textureLod(cloudsCoverageSampler, uv, 0.0).r;
+    float threshold = cloudsParameters.coverageThreshold;
+    return saturate((coverage - threshold) / max(1.0 - threshold, 0.001));
+}
+
+/**
+ * Mip of a noise volume whose texels match the size of the sample footprint
+ * @param footprint - diameter of the area the sample represents in world units
+ * @param uvwScale - world space to uvw scale the volume is sampled with
+ * @param noiseSize - size of mip 0 of the volume along one axis
+ */
+float getNoiseLod(float footprint, float uvwScale, float noiseSize)
+{
+    float footprintInTexels = footprint * uvwScale * noiseSize;
+    return max(log2(max(footprintInTexels, 1.0)) + cloudsParameters.noiseLodBias, 0.0);
+}
+
+/**
+ * @param samplePos - position in world space
+ * @param distFactor - raises the density offset, thinning out the clouds
+ * @param footprint - diameter of the area the sample represents in world units, selects
+ *      the mips of the noise volumes, zero samples the full resolution noise
+ * @param detailWeight - scales the detail erosion, at zero the detail noise is not
+ *      fetched at all, see getCloudsDetailWeight
+ */
+float sampleDensity(vec3 samplePos, float distFactor, float footprint, float detailWeight)
+{
+    /* Coverage is a single 2D fetch, clear sky never touches the 3D noise */
+    float coverage = getCloudsCoverage(samplePos);
+    if(coverage <= 0.0)
+    {
+        return 0.0;
+    }
+
+    const float baseScale = 1.0/1000.0;
+    vec3 uvw = samplePos * baseScale * cloudsParameters.cloudsScale * vec3(1.0, 1.0, 1.0);
+
+    float heightGradient = 1.0;
+    float cloudLayerThickness = cloudsParameters.maxBounds - cloudsParameters.minBounds;
+    float heightAboveGround = length((samplePos * cameraScale) + 
+        vec3(0.0, 0.0, atmosphereParameters.bottom_radius)) - atmosphereParameters.bottom_radius;
+    float percentInCloudLayer = max((heightAboveGround - cloudsParameters.minBounds), 0.0) / cloudLayerThickness; 
+
+    if(cloudsParameters.debug == 1)
+    {
+        // if(percentInCloudLayer < 0.2) { heightGradient = mix(0.0, 1.0, percentInCloudLayer * 5.0); } 
+        // else if (percentInCloudLayer > 0.8) { heightGradient = 1.0 - smoothstep(0.7, 1.0, percentInCloudLayer); }
+        const float a = cloudsParameters.minBounds;
+        const float h = cloudsParameters.maxBounds;
+        heightGradient = (heightAboveGround - a) * (heightAboveGround - h - a) * (-4/(h * h));
+    }
+
+    /* Weighted shape noise is baked into one channel, see clouds_density_bake */
+    float shapeUVWScale = baseScale * cloudsParameters.cloudsScale;
+    float shapeLod = getNoiseLod(footprint, shapeUVWScale, float(textureSize(cloudsDensitySampler, 0).x));
+    float shapeFBM = textureLod(cloudsDensitySampler, uvw, shapeLod).r;
+    float baseShapeDensity = (shapeFBM - min(cloudsParameters.densityOffset + distFactor, 1.0)) * coverage;
+    if(baseShapeDensity <= 0.0)
+    {
+        return 0.0;
+    }
+    /* Far samples only read the baked shape volume */
+    if(detailWeight <= 0.0)
+    {
+        return baseShapeDensity * cloudsParameters.densityMultiplier * 4.9 * heightGradient;
+    }
+
+    /* Detail is sampled at its own mip -> erosion keeps the full detail resolution */
+    vec3 detailSamplePos = uvw * cloudsParameters.detailScale;
+    float detailLod = getNoiseLod(footprint, shapeUVWScale * cloudsParameters.detailScale,
+        float(textureSize(worleyNoiseDetailSampler, 0).x));
+    vec4 detailNoise = textureLod(worleyNoiseDetailSampler, detailSamplePos, detailLod);
+    float detailFBM = dot(detailNoise, normalize(cloudsParameters.detailNoiseWeights));
+
+    float oneMinusShape = 1.0 - baseShapeDensity;
+    float detailErodeWeight = oneMinusShape * oneMinusShape * oneMinusShape;
+
+    float cloudDensity = baseShapeDensity - (1.0 - detailFBM) * detailErodeWeight *
+        cloudsParameters.detailNoiseMultiplier * detailWeight;
+    return cloudDensity * cloudsParameters.densityMultiplier * 4.9 * heightGradient;
+}
+
+/* Coarsest occupancy mip the empty space skipping starts from, one texel of it covers
+   (2^level * brick size)^3 texels of the shape noise */
+const int occupancyStartLevel = 2;
+
+/**
+ * Walk the occupancy mip chain from occupancyStartLevel down to the finest level
+ * and find the first brick containing samplePos which is guaranteed to be empty
+ * @param samplePos - position in world space, same as the one passed to sampleDensity
+ * @param rayDirection - normalized direction of the ray in world space
+ * @return distance along the ray to the exit of the empty brick, zero when the
+ *      finest brick containing samplePos might contain clouds
+ */
+float getEmptySpaceLength(vec3 samplePos, vec3 rayDirection)
+{
+    const float baseScale = 1.0/1000.0;
+    float noiseScale = baseScale * cloudsParameters.cloudsScale;
+    vec3 uvw = fract(samplePos * noiseScale);
+
+    int startLevel = min(occupancyStartLevel, textureQueryLevels(cloudsOccupancySampler) - 1);
+    for(int level = startLevel; level >= 0; level--)
+    {
+        ivec3 levelSize = textureSize(cloudsOccupancySampler, level);
+        vec3 texelPosition = uvw * vec3(levelSize);
+        ivec3 brick = min(ivec3(texelPosition), levelSize - 1);
+        /* Occupancy holds the maximum shape noise, the brick is empty when even that
+           does not reach the density offset */
+        if(texelFetch(cloudsOccupancySampler, brick, level).r > min(cloudsParameters.densityOffset, 1.0))
+        {
+            continue;
+        }
+
+        /* Slab test against the brick the position is in, done in texel units */
+        vec3 texelDirection = rayDirection * noiseScale * vec3(levelSize);
+        vec3 exitPlane = vec3(brick) + step(vec3(0.0), texelDirection);
+        vec3 exitLength = vec3(1.0e20);
+        for(int axis = 0; axis < 3; axis++)
+        {
+            if(abs(texelDirection[axis]) > 1.0e-8)
+            {
+                exitLength[axis] = (exitPlane[axis] - texelPosition[axis]) / texelDirection[axis];
+            }
+        }
+        return max(min(exitLength.x, min(exitLength.y, exitLength.z)), 0.0);
+    }
+    return 0.0;
+}
+
+/* Coverage mip the clear sky skipping is done on, one texel of it covers
+   2^level x 2^level texels of the coverage map */
+const int coverageSkipLevel = 4;
+
+/**
+ * Find out whether samplePos lies above a clear region of the coverage map
+ * @return distance along the ray to the horizontal exit of the clear coverage texel,
+ *      zero when the texel might contain clouds
+ */
+float getClearCoverageLength(vec3 samplePos, vec3 rayDirection)
+{
+    const float baseScale = 1.0/1000.0;
+    float coverageScale = baseScale * cloudsParameters.coverageScale;
+    vec2 uv = fract(samplePos.xy * coverageScale);
+
+    int level = min(coverageSkipLevel, textureQueryLevels(cloudsCoverageSampler) - 1);
+    ivec2 levelSize = textureSize(cloudsCoverageSampler, level);
+    vec2 texelPosition = uv * vec2(levelSize);
+    ivec2 texel = min(ivec2(texelPosition), levelSize - 1);
+    /* Mips store the maximum of the dilated map -> at or below the threshold the
+       whole texel is clear */
+    if(texelFetch(cloudsCoverageSampler, texel, level).r > cloudsParameters.coverageThreshold)
+    {
+        return 0.0;
+    }
+
+    vec2 texelDirection = rayDirection.xy * coverageScale * vec2(levelSize);
+    vec2 exitPlane = vec2(texel) + step(vec2(0.0), texelDirection);
+    vec2 exitLength = vec2(1.0e20);
+    for(int axis = 0; axis < 2; axis++)
+    {
+        if(abs(texelDirection[axis]) > 1.0e-8)
+        {
+            exitLength[axis] = (exitPlane[axis] - texelPosition[axis]) / texelDirection[axis];
+        }
+    }
+    return max(min(exitLength.x, exitLength.y), 0.0);
+}
+
+/**
+ * March the light ray towards the sun, the noise is sampled with the footprint of a cone
+ * which starts at the footprint of the view sample and widens by lightConeSpread
+ * per unit of distance -> the far samples only need the coarse mips
+ * @param startPos - position in world space
+ * @param footprint - footprint of the sample at startPos, see sampleDensity
+ * @param detailWeight - detail weight of the sample at startPos, see sampleDensity
+ */
+float getCloudTransAlongRay(vec3 startPos, float footprint, float detailWeight)
+{
+    vec3 dirToLight = atmosphereParameters.sun_direction;
+    float integrationLength = getRayCloudLayerInfo(cloudsParameters.minBounds,
+        cloudsParameters.maxBounds, startPos * cameraScale, dirToLight).y * 1/cameraScale;
+    
+    integrationLength = min(integrationLength, 20.0);
+
+    float totalDensity = 0.0;
+    for(int i = 0; i < cloudsParameters.sampleCountToSun; i++)
+    {
+        float step_0 = float(i) / cloudsParameters.sampleCountToSun;
+        float step_1 = float(i + 1) / cloudsParameters.sampleCountToSun;
+
+        step_0 *= step_0;
+        step_1 *= step_1;
+
+        step_0 = step_0 * integrationLength;
+        step_1 = step_1 > 1.0 ? integrationLength : step_1 * integrationLength;
+
+        float newRayShift = step_0 + (step_1 - step_0) * 0.3;
+        float integrationStep = step_1 - step_0;
+        vec3 newPos = startPos + newRayShift * dirToLight;
+        float coneFootprint = footprint + newRayShift * cloudsParameters.lightConeSpread;
+        totalDensity += max(0.0, sampleDensity(newPos, 0.0, coneFootprint, detailWeight) * integrationStep);
+    }
+
+    float transmittance = exp(-totalDensity * cloudsParameters.lightAbsTowardsSun);
+    return cloudsParameters.darknessThreshold + transmittance * (1.0 - cloudsParameters.darknessThreshold);
+}
+
+/* Length of the light ray integrated by getCloudTransAlongRay, the shadow map lookup
+   integrates the same window so that the look of the clouds does not change */
+const float cloudsShadowLightWindow = 20.0;
+/* Upper bound of the slab the shadow map slices are spread over, in world units */
+const float cloudsShadowMaxDepth = 200.0;
+
+/* Length of the part of the sun ray column stored in the shadow map, the column starts
+   at the top of the cloud layer */
+float getCloudsShadowDepthRange()
+{
+    float cloudLayerThickness = (cloudsParameters.maxBounds - cloudsParameters.minBounds) / cameraScale;
+    return min(cloudLayerThickness / max(atmosphereParameters.sun_direction.z, 0.1), cloudsShadowMaxDepth);
+}
+
+/* Distance along direction to the point where it leaves the top of the cloud layer in
+   world units, -1.0 when it never does */
+float getDistanceToCloudsTop(vec3 position, vec3 direction)
+{
+    vec3 planetPosition = position * cameraScale + vec3(0.0, 0.0, atmosphereParameters.bottom_radius);
+    float topRadius = atmosphereParameters.bottom_radius + cloudsParameters.maxBounds;
+    float b = dot(direction, planetPosition);
+    float c = dot(planetPosition, planetPosition) - topRadius * topRadius;
+    float delta = b * b - c;
+    if(delta < 0.0) { return -1.0; }
+    float farthest = -b + sqrt(delta);
+    return farthest < 0.0 ? -1.0 : farthest / cameraScale;
+}
+
+/**
+ * Transmittance towards the sun looked up from the clouds shadow map built by
+ * clouds_shadow_build, falls back to getCloudTransAlongRay outside of the area
+ * covered by the map
+ * @param position - position in world space
+ * @param footprint - footprint of the sample at position, see getCloudTransAlongRay
+ * @param detailWeight - detail weight of the sample at position, see getCloudTransAlongRay
+ */
+float getCloudsShadowTransmittance(vec3 position, float footprint, float detailWeight)
+{
+    vec2 shadowUV = (commonParameters.cloudsShadowMatrix * vec4(position, 1.0)).xy;
+    float depth = getDistanceToCloudsTop(position, atmosphereParameters.sun_direction);
+    float depthRange = getCloudsShadowDepthRange();
+    if(any(lessThan(shadowUV, vec2(0.0))) || any(greaterThan(shadowUV, vec2(1.0))) ||
+       depth < 0.0 || depth > depthRange)
+    {
+        return getCloudTransAlongRay(position, footprint, detailWeight);
+    }
+
+    /* Map stores optical depth accumulated from the top of the layer, the difference
+       of two lookups is the optical depth of the window just above the position */
+    float opticalDepth = texture(cloudsShadowSampler, vec3(shadowUV, depth / depthRange)).r;
+    float windowStart = max(depth - cloudsShadowLightWindow, 0.0);
+    opticalDepth -= texture(cloudsShadowSampler, vec3(shadowUV, windowStart / depthRange)).r;
+
+    float transmittance = exp(-max(opticalDepth, 0.0));
+    return cloudsParameters.darknessThreshold + transmittance * (1.0 - cloudsParameters.darknessThreshold);
+}
+
+/**
+ * Distance level of detail of a sample, 0 up to lodStartDistance from the ray origin
+ * and 1 from lodEndDistance on. Far samples take longer steps, coarser noise mips and
+ * a raised density offset which removes the thin edges the coarse mips smear out
+ */
+float getCloudsDistanceLod(float distance)
+{
+    float lodRange = max(cloudsParameters.lodEndDistance - cloudsParameters.lodStartDistance, 0.001);
+    return saturate((distance - cloudsParameters.lodStartDistance) / lodRange);
+}
+
+/**
+ * Weight of the detail erosion of a sample, fades from 1 at lodStartDistance from the
+ * ray origin to 0 at detailCutoffDistance -> the samples beyond the cutoff skip the
+ * detail noise fetch without a visible seam
+ */
+float getCloudsDetailWeight(float distance)
+{
+    float fadeLength = max(cloudsParameters.detailCutoffDistance - cloudsParameters.lodStartDistance, 0.001);
+    return saturate((cloudsParameters.detailCutoffDistance - distance) / fadeLength);
+}
+
+/* Samples spent on the part of a segment the march did not reach within its budget */
+const int cloudsTailSampleCount = 4;
+
+/**
+ * Add the light scattered by one density sample and its extinction to the ray
+ * @param position - position of the sample in world space
+ * @param density - density at position, has to be above zero
+ * @param integrationStep - length of the ray the sample stands for
+ * @param footprint - footprint of the sample, see getCloudTransAlongRay
+ * @param detailWeight - detail weight of the sample, see getCloudTransAlongRay
+ * @param phaseValue - phase function of the angle between the ray and the sun
+ */
+void integrateCloudSample(vec3 position, float density, float integrationStep, float footprint,
+    float detailWeight, float phaseValue, inout float transmittance, inout vec3 lightEnergy, inout vec2 depthAccum)
+{
+    if(transmittance < 1.0) {
+        vec4 projPos = commonParameters.proj * commonParameters.view * vec4(position, 1.0);
+        float linearDepthSample = projPos.z / projPos.w;
+        depthAccum += vec2(transmittance * linearDepthSample, transmittance);
+    }
+    float transmittanceToSun = getCloudsShadowTransmittance(position, footprint, detailWeight);
+
+    float transIncreseOverInegrationStep = exp(-density * integrationStep * cloudsParameters.lightAbsThroughCloud);
+    float powderTransmittanceIncOverIntStep= exp(-density * integrationStep * cloudsParameters.lightAbsThroughCloud * 2.0);
+    float sunLight = transmittanceToSun * phaseValue * density;
+    float sunLightInt = (sunLight - sunLight * transIncreseOverInegrationStep * powderTransmittanceIncOverIntStep) / density;
+
+    vec3 realWorldPos = position * cameraScale + vec3(0.0, 0.0, atmosphereParameters.bottom_radius);
+    float height = length(realWorldPos);
+    vec3 upVector = realWorldPos/height;
+    float viewZenithCosAngle = dot(atmosphereParameters.sun_direction, upVector);
+    vec2 transLUTParams = vec2( height, viewZenithCosAngle);
+    vec2 atmosphereBoundaries = vec2(atmosphereParameters.bottom_radius, atmosphereParameters.top_radius);
+    vec2 transUV = TransmittanceLUTParamsToUv(transLUTParams, atmosphereBoundaries); 
+    ivec2 transImageCoords = ivec2(transUV * atmosphereParameters.TransmittanceTexDimensions);
+    vec3 transmittanceToSunAtmo = vec3(imageLoad(transmittanceLUT, transImageCoords).rgb);
+
+    lightEnergy += sunLightInt * transmittance * transmittanceToSunAtmo;
+    
+    transmittance *= transIncreseOverInegrationStep * powderTransmittanceIncOverIntStep;
+}
+
+/**
+ * March the clouds along one segment of a ray
+ * @param origin - origin of the ray in world space
+ * @param rayDirection - unit direction of the ray in world space
+ * @param segmentStart - distance from origin where the segment starts
+ * @param segmentLength - length of the segment
+ * @param jitter - [0, 1) offset of the start in fractions of one coarse step, see blue_noise.glsl
+ * @param pixelAngle - angle in radians covered by one pixel, the noise mips are
+ *      selected from the footprint of the pixel at the sample distance
+ * @param sampleBudget - density samples the adaptive march takes along the segment, when
+ *      it runs out before the end cloudsTailSampleCount more samples cover the rest
+ * @param depthAccum - x accumulates the transmittance weighted clip space depth of the
+ *      samples, y the transmittance weights
+ * @param sampleCount - incremented by the number of density samples taken
+ * @return rgb is the light scattered towards the origin, a is the transmittance
+ */
+vec4 marchCloudsSegment(vec3 origin, vec3 rayDirection, float segmentStart, float segmentLength,
+    float jitter, float pixelAngle, int sampleBudget, inout vec2 depthAccum, inout int sampleCount)
+{
+    float sunRayCosAngle = dot(rayDirection, atmosphereParameters.sun_direction);
+    float phaseValue = phase(sunRayCosAngle);
+    vec3 startPosition = origin + segmentStart * rayDirection;
+
+    float transmittance = 1.0;
+    vec3 lightEnergy = vec3(0.0);
+    int segmentSamples = 0;
+
+    /* Coarse steps until a sample hits a cloud, then step back to the last empty sample
+       and continue with fine steps until emptyStepsToCoarse fine samples in a row miss.
+       Both step lengths grow with the distance from the origin, sampleBudget is the
+       budget of density samples, skipping empty space is not counted towards it */
+    float fineStepBase = max(cloudsParameters.fineStepLength, 0.01);
+    float coarseMultiplier = max(cloudsParameters.coarseStepMultiplier, 1.0);
+    bool fineStepping = false;
+    int emptyFineSteps = 0;
+    /* Position of the coarse sample which hit the cloud, fine samples in front of it
+       do not count as misses -> the ray does not go back to coarse steps before
+       reaching the cloud it stepped back for */
+    float coarseHitShift = 0.0;
+
+    /* Jitter the start by up to one coarse step, the banding this removes turns into blue
+       noise which the temporal reprojection of the clouds passes averages out */
+    float rayShift = jitter * fineStepBase * coarseMultiplier *
+        (1.0 + segmentStart * cloudsParameters.stepDistanceScale);
+    float previousRayShift = rayShift;
+    /* Guards against loops which never sample, f.e. a ray grazing the top of empty bricks */
+    int maxIterations = 4 * sampleBudget;
+    for(int i = 0; i < maxIterations; i++)
+    {
+        if(transmittance < 0.01 || rayShift >= segmentLength || segmentSamples >= sampleBudget)
+        {
+            break;
+        }
+        float distanceFromOrigin = segmentStart + rayShift;
+        float distanceLod = getCloudsDistanceLod(distanceFromOrigin);
+        float fineStep = fineStepBase * (1.0 + distanceFromOrigin * cloudsParameters.stepDistanceScale) *
+            mix(1.0, max(cloudsParameters.lodStepMultiplier, 1.0), distanceLod);
+        float stepLength = fineStepping ? fineStep : fineStep * coarseMultiplier;
+        vec3 newPos = startPosition + rayShift * rayDirection;
+
+        /* Skip all the space inside of an empty brick of the occupancy volume or above
+           clear sky of the coverage map, the ray continues with coarse steps behind it */
+        float emptySpaceLength = max(getEmptySpaceLength(newPos, rayDirection),
+            getClearCoverageLength(newPos, rayDirection));
+        if(emptySpaceLength > 0.0)
+        {
+            fineStepping = false;
+            rayShift += max(emptySpaceLength, fineStep);
+            /* Everything before the exit is empty -> a hit on the next coarse sample
+               steps back no further than the exit */
+            previousRayShift = rayShift;
+            continue;
+        }
+
+        /* Scaling the footprint by 2^bias moves the noise lookups bias mips down */
+        float footprint = distanceFromOrigin * pixelAngle * exp2(distanceLod * cloudsParameters.lodNoiseBias);
+        float detailWeight = getCloudsDetailWeight(distanceFromOrigin);
+        float density = sampleDensity(newPos, distanceLod * cloudsParameters.lodDensityOffset, footprint,
+            detailWeight);
+        segmentSamples++;
+
+        if(!fineStepping)
+        {
+            if(density <= 0.0)
+            {
+                previousRayShift = rayShift;
+                rayShift += stepLength;
+                continue;
+            }
+            /* The cloud starts somewhere within the last coarse step -> step back, the
+               first march sample of the ray has nothing to step back to */
+            fineStepping = true;
+            emptyFineSteps = 0;
+            coarseHitShift = rayShift;
+            if(previousRayShift + fineStep < rayShift)
+            {
+                rayShift = previousRayShift + fineStep;
+                continue;
+            }
+            stepLength = fineStep;
+        }
+        float integrationStep = min(stepLength, segmentLength - rayShift);
+        previousRayShift = rayShift;
+        rayShift += stepLength;
+
+        if(density <= 0.0)
+        {
+            emptyFineSteps += previousRayShift >= coarseHitShift ? 1 : 0;
+            fineStepping = emptyFineSteps < cloudsParameters.emptyStepsToCoarse;
+        } else {
+            emptyFineSteps = 0;
+        }
+
+        if(density > 0)
+        {
+            integrateCloudSample(newPos, density, integrationStep, footprint, detailWeight, phaseValue,
+                transmittance, lightEnergy, depthAccum);
+        }
+    }
+
+    /* Budget or iteration cap ran out before the end of the segment -> integrate the rest
+       with a few long steps on coarse mips instead of dropping the clouds behind it */
+    float remainingLength = segmentLength - rayShift;
+    if(transmittance >= 0.01 && remainingLength > 0.0)
+    {
+        float tailStep = remainingLength / float(cloudsTailSampleCount);
+        for(int i = 0; i < cloudsTailSampleCount && transmittance >= 0.01; i++)
+        {
+            float tailShift = rayShift + (float(i) + 0.5) * tailStep;
+            float distanceFromOrigin = segmentStart + tailShift;
+            float distanceLod = getCloudsDistanceLod(distanceFromOrigin);
+            vec3 newPos = startPosition + tailShift * rayDirection;
+            /* Footprint of the whole step -> the lookups match the length they stand for */
+            float footprint = max(distanceFromOrigin * pixelAngle, tailStep) *
+                exp2(distanceLod * cloudsParameters.lodNoiseBias);
+            float detailWeight = getCloudsDetailWeight(distanceFromOrigin);
+            float density = sampleDensity(newPos, distanceLod * cloudsParameters.lodDensityOffset, footprint,
+                detailWeight);
+            segmentSamples++;
+            if(density > 0)
+            {
+                integrateCloudSample(newPos, density, tailStep, footprint, detailWeight, phaseValue,
+                    transmittance, lightEnergy, depthAccum);
+            }
+        }
+    }
+    sampleCount += segmentSamples;
+    return vec4(lightEnergy, transmittance);
+}
+
+/**
+ * Raymarch the cloud layer along the camera ray going through uv. When the including
+ * shader defines CLOUDS_FAR_FIELD_PANORAMA and declares cloudsPanoramaSampler only the
+ * part of the ray closer than panoramaDistance is marched, the rest is looked up from
+ * the panorama built by clouds_panorama_build
+ * @param uv - screen position in [0, 1]
+ * @param depth - depth of the scene behind the clouds, the ray is not integrated past it
+ * @param jitter - [0, 1) offset of the ray start in fractions of one coarse step, see blue_noise.glsl
+ * @param pixelAngle - angle in radians covered by one pixel, the noise mips are
+ *      selected from the footprint of the pixel at the sample distance
+ * @param sampleBudget - maximum number of density samples taken along the ray
+ * @param outDepth - depth to be written into the depth buffer, blends between the
+ *      transmittance weighted depth of the clouds and depth based on the cloud opacity
+ * @param sampleCount - number of density samples taken along the ray
+ * @return rgb is the cloud color, a is the transmittance
+ */
+vec4 raymarchClouds(vec2 uv, float depth, float jitter, float pixelAngle, int sampleBudget,
+    out float outDepth, out int sampleCount)
+{
+    outDepth = depth;
+    sampleCount = 0;
+    vec3 cameraRayWorld;
+    vec3 raySegment = getCloudsRaySegment(uv, depth, cameraRayWorld);
+    float distanceToCloudBB = raySegment.x;
+    float integrationLength = raySegment.y;
+
+    if(integrationLength <= 0 )
+    {
+        return vec4(0.0, 0.0, 0.0, 1.0);
+    }
+
+    float nearLength = integrationLength;
+#ifdef CLOUDS_FAR_FIELD_PANORAMA
+    nearLength = min(integrationLength, max(cloudsParameters.panoramaDistance - distanceToCloudBB, 0.0));
+#endif
+
+    vec4 clouds = vec4(0.0, 0.0, 0.0, 1.0);
+    vec2 depthAccum = vec2(0.0);
+    if(nearLength > 0.0)
+    {
+        clouds = marchCloudsSegment(atmosphereParameters.camera_position, cameraRayWorld,
+            distanceToCloudBB, nearLength, jitter, pixelAngle, sampleBudget,
+            depthAccum, sampleCount);
+    }
+
+#ifdef CLOUDS_FAR_FIELD_PANORAMA
+    /* Panorama holds the part of the cloud layer behind panoramaDistance, when the
+       scene ends the ray before the layer does only the fraction of the far segment in
+       front of it is added, the clouds in it are treated as homogeneous */
+    float farStart = distanceToCloudBB + nearLength;
+    float farLength = integrationLength - nearLength;
+    float farLayerLength = raySegment.z - nearLength;
+    if(farLength > 0.0 && clouds.a >= 0.01)
+    {
+        vec4 farClouds = textureLod(cloudsPanoramaSampler, getCloudsPanoramaUV(cameraRayWorld), 0.0);
+        float farFraction = clamp(farLength / max(farLayerLength, 0.001), 0.0, 1.0);
+        float farTransmittance = pow(max(farClouds.a, 0.0), farFraction);
+        float farScale = farClouds.a < 0.999 ?
+            (1.0 - farTransmittance) / (1.0 - farClouds.a) : farFraction;
+        clouds.rgb += clouds.a * farClouds.rgb * farScale;
+        clouds.a *= farTransmittance;
+    }
+#endif
+
+    if(depthAccum.y > 0.0)
+    {
+        float cloudDepth = depthAccum.x / depthAccum.y;
+        outDepth = mix(cloudDepth, depth, pow(clouds.a, 2));
+    }
+
+    vec3 cloudCol = clouds.rgb * vec3(1.0, 1.0, 1.0) * 0.05;
+    float transmittanceDistIncr = clamp((distanceToCloudBB - cloudsParameters.farFadeStart) /
+        max(cloudsParameters.farFadeLength, 1.0), 0.0, 1.0);
+    float transmittance = clamp(clouds.a + transmittanceDistIncr, 0.0, 1.0);
+    cloudCol *= float(1.0 - transmittanceDistIncr);
+
+    return vec4(cloudCol, transmittance);
+}
@@ -0,0 +1,82 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+/* Build the reduced resolution clouds image from the pixels traced this frame
+   and the previous frame reprojected using the clouds depth */
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+/* layout (set = 0, binding = 0) */ #include "shaders/buffers/common_param_buff.glsl"
+layout (set = 1, binding = 0) uniform sampler2D sceneDepthSampler;
+/* layout (set = 2, binding = 0) */ #include "shaders/buffers/clouds_param_buffer.glsl"
+layout (set = 3, binding = 0, rgba16f) uniform readonly image2D cloudsTrace;
+layout (set = 3, binding = 1, rg32f) uniform readonly image2D cloudsTraceDepth;
+/* Negative alpha in history marks texels which were never written */
+layout (set = 4, binding = 0) uniform sampler2D cloudsHistory;
+layout (set = 4, binding = 1, rgba16f) uniform writeonly image2D cloudsColor;
+/* r - scene depth under the clouds pixel, g - clouds depth */
+layout (set = 4, binding = 2, rg32f) uniform writeonly image2D cloudsDepth;
+
+#include "shaders/clouds_reprojection.glsl"
+
+void main()
+{
+    ivec2 cloudsCoords = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 cloudsExtent = imageSize(cloudsColor);
+    if(any(greaterThanEqual(cloudsCoords, cloudsExtent)))
+    {
+        return;
+    }
+
+    int blockSize = cloudsParameters.reprojectionBlockSize;
+    ivec2 sceneExtent = textureSize(sceneDepthSampler, 0);
+    ivec2 traceExtent = imageSize(cloudsTrace);
+    ivec2 block = cloudsCoords / blockSize;
+    ivec2 tracedCoords = min(block * blockSize +
+        getTracedPixelOffset(commonParameters.frameIndex, blockSize), cloudsExtent - 1);
+
+    float sceneDepth = texelFetch(sceneDepthSampler,
+        getCloudsPixelSceneCoords(cloudsCoords, sceneExtent), 0).r;
+    vec4 fresh = imageLoad(cloudsTrace, block);
+    float freshCloudsDepth = imageLoad(cloudsTraceDepth, block).g;
+    /* Never place clouds behind the geometry of this pixel */
+    float reprojectionDepth = min(freshCloudsDepth, sceneDepth);
+    imageStore(cloudsDepth, cloudsCoords, vec4(sceneDepth, reprojectionDepth, 0.0, 0.0));
+
+    if(cloudsCoords == tracedCoords)
+    {
+        imageStore(cloudsColor, cloudsCoords, fresh);
+        return;
+    }
+
+    /* Neighbourhood of the freshly traced samples used to clamp the history
+       -> removes ghosting when the reprojected history is no longer valid */
+    vec4 minColor = vec4(1e20);
+    vec4 maxColor = vec4(-1e20);
+    for(int y = -1; y <= 1; y++)
+    {
+        for(int x = -1; x <= 1; x++)
+        {
+            ivec2 neighbour = clamp(block + ivec2(x, y), ivec2(0), traceExtent - 1);
+            vec4 neighbourColor = imageLoad(cloudsTrace, neighbour);
+            minColor = min(minColor, neighbourColor);
+            maxColor = max(maxColor, neighbourColor);
+        }
+    }
+
+    /* Vulkans clip space range [-1, -1] - (1, 1) -> z is depth [0, 1] */
+    vec2 uv = getCloudsPixelUV(cloudsCoords, sceneExtent);
+    vec3 clipSpace = vec3(uv * vec2(2.0) - vec2(1.0), reprojectionDepth);
+    mat4 invViewProjMat = commonParameters.invViewProj;
+    vec4 hPos = invViewProjMat * vec4(clipSpace, 1.0);
+    vec4 prevClipSpace = commonParameters.prevViewProj * vec4(hPos.xyz / hPos.w, 1.0);
+    vec2 prevUV = (prevClipSpace.xy / prevClipSpace.w) * 0.5 + 0.5;
+
+    vec4 history = textureLod(cloudsHistory, prevUV, 0.0);
+    bool historyValid = prevClipSpace.w > 0.0 &&
+        all(greaterThanEqual(prevUV, vec2(0.0))) &&
+        all(lessThanEqual(prevUV, vec2(1.0))) &&
+        history.a >= 0.0;
+
+    vec4 color = historyValid ? clamp(history, minColor, maxColor) : fresh;
+    imageStore(cloudsColor, cloudsCoords, color);
+}
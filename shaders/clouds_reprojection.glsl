@@ -0,0 +1,39 @@
+/* Helpers shared by the reduced resolution clouds passes. The including shader has
+   to declare cloudsParameters before including this file */
+
+/**
+ * Get offset of the pixel inside reprojection block which is raymarched this frame,
+ * pixels are visited in the Bayer matrix order so that consecutive frames update
+ * pixels far from each other and every pixel is refreshed once per blockSize^2 frames
+ * @param frameIndex - index of the current frame
+ * @param blockSize - reprojection block size, 1, 2 and 4 are supported
+ */
+ivec2 getTracedPixelOffset(int frameIndex, int blockSize)
+{
+    const ivec2 bayer2x2[4] = ivec2[](
+        ivec2(0, 0), ivec2(1, 1), ivec2(1, 0), ivec2(0, 1));
+    const ivec2 bayer4x4[16] = ivec2[](
+        ivec2(0, 0), ivec2(2, 2), ivec2(2, 0), ivec2(0, 2),
+        ivec2(1, 1), ivec2(3, 3), ivec2(3, 1), ivec2(1, 3),
+        ivec2(1, 0), ivec2(3, 2), ivec2(3, 0), ivec2(1, 2),
+        ivec2(0, 1), ivec2(2, 3), ivec2(2, 1), ivec2(0, 3));
+
+    if(blockSize == 2) { return bayer2x2[frameIndex % 4]; }
+    if(blockSize == 4) { return bayer4x4[frameIndex % 16]; }
+    return ivec2(0, 0);
+}
+
+/* Screen uv of the center of the clouds pixel, one clouds pixel covers
+   resolutionDivisor x resolutionDivisor pixels of the scene */
+vec2 getCloudsPixelUV(ivec2 cloudsCoords, ivec2 sceneExtent)
+{
+    float divisor = float(cloudsParameters.resolutionDivisor);
+    return (vec2(cloudsCoords) + 0.5) * divisor / vec2(sceneExtent);
+}
+
+/* Scene pixel lying under the center of the clouds pixel */
+ivec2 getCloudsPixelSceneCoords(ivec2 cloudsCoords, ivec2 sceneExtent)
+{
+    int divisor = cloudsParameters.resolutionDivisor;
+    return min(cloudsCoords * divisor + divisor / 2, sceneExtent - 1);
+}
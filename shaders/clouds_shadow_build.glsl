@@ -0,0 +1,64 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+/* Build the clouds shadow map -> for every texel march the sun ray column from the top
+   of the cloud layer downwards and store the optical depth accumulated up to each
+   slice, see getCloudsShadowTransmittance in clouds_raymarch */
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+#include "shaders/common_func.glsl"
+
+/* layout (set = 0, binding = 0) */ #include "shaders/buffers/common_param_buff.glsl"
+/* layout (set = 1, binding = 0) */ #include "shaders/buffers/atmosphere_param_buff.glsl"
+/* layout (set = 2, binding = 0  */ #include "shaders/buffers/clouds_param_buffer.glsl"
+layout (set = 3, binding = 0) uniform sampler3D worleyNoiseSampler;
+layout (set = 3, binding = 1) uniform sampler3D worleyNoiseDetailSampler;
+layout (set = 3, binding = 2) uniform sampler3D cloudsOccupancySampler;
+layout (set = 3, binding = 3) uniform sampler3D cloudsShadowSampler;
+layout (set = 3, binding = 4) uniform sampler2D cloudsCoverageSampler;
+layout (set = 3, binding = 5) uniform sampler3D cloudsDensitySampler;
+layout (set = 4, binding = 0, rgba16f) uniform readonly image2D transmittanceLUT;
+/* r - optical depth towards the sun */
+layout (set = 5, binding = 0, r16f) uniform writeonly image3D cloudsShadow;
+
+#include "shaders/clouds_raymarch.glsl"
+
+void main()
+{
+    ivec3 shadowSize = imageSize(cloudsShadow);
+    ivec2 texelCoords = ivec2(gl_GlobalInvocationID.xy);
+    if(any(greaterThanEqual(texelCoords, shadowSize.xy)))
+    {
+        return;
+    }
+
+    vec3 sunDirection = atmosphereParameters.sun_direction;
+    vec2 shadowUV = (vec2(texelCoords) + vec2(0.5)) / vec2(shadowSize.xy);
+    /* Point of the column lying in the plane going through the world origin */
+    vec4 columnOrigin = inverse(commonParameters.cloudsShadowMatrix) * vec4(shadowUV, 0.0, 1.0);
+    float distanceToTop = getDistanceToCloudsTop(columnOrigin.xyz, sunDirection);
+    vec3 columnTop = columnOrigin.xyz + max(distanceToTop, 0.0) * sunDirection;
+
+    float sliceLength = getCloudsShadowDepthRange() / float(shadowSize.z);
+    /* Every column stands for one shadow map texel */
+    float footprint = 2.0 * cloudsParameters.shadowMapExtent / float(shadowSize.x);
+    /* Map is centred on the camera -> columns beyond the detail cutoff only read the
+       baked shape density, the same as the view samples they shadow */
+    float detailWeight = getCloudsDetailWeight(length(shadowUV * 2.0 - 1.0) * cloudsParameters.shadowMapExtent);
+    float opticalDepth = 0.0;
+    float lastDepth = 0.0;
+    for(int slice = 0; slice < shadowSize.z; slice++)
+    {
+        /* Slices are stored at texel centers -> first step is half of the slice */
+        float sliceDepth = (float(slice) + 0.5) * sliceLength;
+        float integrationStep = sliceDepth - lastDepth;
+        vec3 samplePos = columnTop - (lastDepth + 0.5 * integrationStep) * sunDirection;
+        if(distanceToTop >= 0.0 && getEmptySpaceLength(samplePos, -sunDirection) == 0.0)
+        {
+            opticalDepth += max(0.0, sampleDensity(samplePos, 0.0, footprint, detailWeight) * integrationStep);
+        }
+        lastDepth = sliceDepth;
+        imageStore(cloudsShadow, ivec3(texelCoords, slice),
+            vec4(opticalDepth * cloudsParameters.lightAbsTowardsSun, 0.0, 0.0, 0.0));
+    }
+}
@@ -0,0 +1,174 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+/* Raymarch one pixel out of each reprojection block of the reduced resolution
+   clouds target, the rest of the block is reprojected in clouds_reconstruct. Dispatched
+   indirectly with one workgroup per tile which clouds_classify found to contain clouds */
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+#include "shaders/common_func.glsl"
+
+/* layout (set = 0, binding = 0) */ #include "shaders/buffers/common_param_buff.glsl"
+/* layout (set = 1, binding = 0) */ #include "shaders/buffers/atmosphere_param_buff.glsl"
+/* layout (set = 2, binding = 0  */ #include "shaders/buffers/clouds_param_buffer.glsl"
+layout (set = 3, binding = 0) uniform sampler2D sceneDepthSampler;
+layout (set = 4, binding = 0) uniform sampler3D worleyNoiseSampler;
+layout (set = 4, binding = 1) uniform sampler3D worleyNoiseDetailSampler;
+/* r - maximum base shape density of the brick, see clouds_occupancy_build */
+layout (set = 4, binding = 2) uniform sampler3D cloudsOccupancySampler;
+/* r - optical depth towards the sun, see clouds_shadow_build */
+layout (set = 4, binding = 3) uniform sampler3D cloudsShadowSampler;
+/* r - clouds coverage, mips hold maximums, see buildCoverageMaxMips */
+layout (set = 4, binding = 4) uniform sampler2D cloudsCoverageSampler;
+/* r - weighted shape noise, see clouds_density_bake */
+layout (set = 4, binding = 5) uniform sampler3D cloudsDensitySampler;
+/* rgb - light scattered by the clouds behind panoramaDistance, a - their transmittance,
+   see clouds_panorama_build */
+layout (set = 4, binding = 6) uniform sampler2D cloudsPanoramaSampler;
+layout (set = 5, binding = 0, rgba16f) uniform readonly image2D transmittanceLUT;
+layout (set = 6, binding = 0, rgba16f) uniform writeonly image2D cloudsTrace;
+/* r - scene depth the ray was traced against, g - clouds depth */
+layout (set = 6, binding = 1, rg32f) uniform writeonly image2D cloudsTraceDepth;
+/* Statistics of the rays of each tile from the last frame it was traced in: r - minimum
+   transmittance, negative when there is no history, g - maximum transmittance,
+   b - mean number of samples taken per ray in units of sampleCount, a - fraction of rays
+   which became opaque */
+layout (set = 6, binding = 2, rgba16f) uniform image2D cloudsTileStats;
+layout (set = 7, binding = 0) uniform sampler2D blueNoiseSampler;
+/* See clouds_classify */
+layout (set = 8, binding = 0) readonly buffer CloudsTileList
+{
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+    uint emptyTileCount;
+    uint visibleTileCount;
+    uint occludedTileCount;
+    uint tiles[];
+} cloudsTiles;
+
+#define CLOUDS_FAR_FIELD_PANORAMA
+#include "shaders/clouds_raymarch.glsl"
+#include "shaders/clouds_reprojection.glsl"
+#include "shaders/blue_noise.glsl"
+
+/* Blue -> green -> red ramp of the used fraction of the sample budget */
+vec3 getSampleHeatmapColor(float fraction)
+{
+    fraction = clamp(fraction, 0.0, 1.0);
+    return fraction < 0.5 ? mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), fraction * 2.0) :
+                            mix(vec3(0.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), fraction * 2.0 - 1.0);
+}
+
+/* Budget of the remaining tiles is this many times the samples their rays took last
+   frame -> a tile whose rays end early sheds budget, one limited by it grows back */
+const float tileBudgetHeadroom = 1.5;
+
+/**
+ * Scale of the sample budget of a tile derived from its statistics of the last frame.
+ * Tiles mixing clear and opaque rays hold cloud edges and get the most samples, tiles
+ * which were fully clear or where every ray became opaque get the least, the rest get
+ * what their rays used with some headroom
+ */
+float getTileBudgetScale(vec4 tileStats)
+{
+    if(tileStats.r < 0.0)
+    {
+        return 1.0;
+    }
+    if(tileStats.g - tileStats.r > cloudsParameters.tileContrastThreshold)
+    {
+        return cloudsParameters.tileBudgetMaxScale;
+    }
+    if(tileStats.r > 0.99 || tileStats.a > 0.99)
+    {
+        return cloudsParameters.tileBudgetMinScale;
+    }
+    return clamp(tileStats.b * tileBudgetHeadroom, cloudsParameters.tileBudgetMinScale, 1.0);
+}
+
+shared uint tileMinTransmittance;
+shared uint tileMaxTransmittance;
+shared uint tileSampleFraction;
+shared uint tileOpaqueRays;
+shared uint tileRays;
+
+const float tileStatsPrecision = 65535.0;
+
+void main()
+{
+    uint tile = cloudsTiles.tiles[gl_WorkGroupID.x];
+    ivec2 tileCoords = ivec2(tile & 0x7FFFu, tile >> 16);
+    ivec2 traceCoords = tileCoords * 8 + ivec2(gl_LocalInvocationID.xy);
+    bool inside = all(lessThan(traceCoords, imageSize(cloudsTrace)));
+
+    if(gl_LocalInvocationIndex == 0)
+    {
+        tileMinTransmittance = uint(tileStatsPrecision);
+        tileMaxTransmittance = 0u;
+        tileSampleFraction = 0u;
+        tileOpaqueRays = 0u;
+        tileRays = 0u;
+    }
+    /* Statistics of the tile are written by invocation 0 at the end -> read them before */
+    vec4 tileStats = imageLoad(cloudsTileStats, tileCoords);
+    barrier();
+
+    float budgetScale = getTileBudgetScale(tileStats);
+    int sampleBudget = max(int(float(cloudsParameters.sampleCount) * budgetScale + 0.5), 1);
+
+    if(inside)
+    {
+        int blockSize = cloudsParameters.reprojectionBlockSize;
+        ivec2 sceneExtent = textureSize(sceneDepthSampler, 0);
+        ivec2 cloudsExtent = (sceneExtent + cloudsParameters.resolutionDivisor - 1) /
+            cloudsParameters.resolutionDivisor;
+
+        ivec2 cloudsCoords = traceCoords * blockSize +
+            getTracedPixelOffset(commonParameters.frameIndex, blockSize);
+        cloudsCoords = min(cloudsCoords, cloudsExtent - 1);
+
+        float sceneDepth = texelFetch(sceneDepthSampler,
+            getCloudsPixelSceneCoords(cloudsCoords, sceneExtent), 0).r;
+
+        float jitter = getAnimatedBlueNoise(blueNoiseSampler, cloudsCoords, commonParameters.frameIndex);
+        /* proj[1][1] is 1 / tan(fov / 2) */
+        float pixelAngle = 2.0 / (abs(commonParameters.proj[1][1]) * float(cloudsExtent.y));
+        float cloudsDepth;
+        int sampleCount;
+        vec4 clouds = raymarchClouds(getCloudsPixelUV(cloudsCoords, sceneExtent), sceneDepth,
+            jitter, pixelAngle, sampleBudget, cloudsDepth, sampleCount);
+
+        uint transmittance = uint(clamp(clouds.a, 0.0, 1.0) * tileStatsPrecision);
+        atomicMin(tileMinTransmittance, transmittance);
+        atomicMax(tileMaxTransmittance, transmittance);
+        atomicAdd(tileSampleFraction, uint(float(sampleCount) / float(max(cloudsParameters.sampleCount, 1)) * 255.0));
+        atomicAdd(tileOpaqueRays, clouds.a < 0.01 ? 1u : 0u);
+        atomicAdd(tileRays, 1u);
+
+        if(cloudsParameters.sampleHeatmap == 1)
+        {
+            clouds = vec4(getSampleHeatmapColor(float(sampleCount) / float(cloudsParameters.sampleCount)), 0.0);
+        }
+        /* Debug mode 2 shows the budget scale of the tiles */
+        if(cloudsParameters.debug == 2)
+        {
+            float scaleRange = max(cloudsParameters.tileBudgetMaxScale - cloudsParameters.tileBudgetMinScale, 0.001);
+            clouds = vec4(getSampleHeatmapColor((budgetScale - cloudsParameters.tileBudgetMinScale) / scaleRange), 0.0);
+        }
+
+        imageStore(cloudsTrace, traceCoords, clouds);
+        imageStore(cloudsTraceDepth, traceCoords, vec4(sceneDepth, cloudsDepth, 0.0, 0.0));
+    }
+    barrier();
+
+    if(gl_LocalInvocationIndex == 0)
+    {
+        float rays = float(max(tileRays, 1u));
+        imageStore(cloudsTileStats, tileCoords, vec4(
+            float(tileMinTransmittance) / tileStatsPrecision,
+            float(tileMaxTransmittance) / tileStatsPrecision,
+            float(tileSampleFraction) / (255.0 * rays),
+            float(tileOpaqueRays) / rays));
+    }
+}
@@ -10,6 +10,9 @@ layout (location = 0) in vec2 inUV;
 /* layout (set = 1, binding = 0) */ #include "shaders/buffers/atmosphere_param_buff.glsl"
 layout (input_attachment_index = 0, set = 2, binding = 0) uniform subpassInput depthInput; 
 layout (set = 3, binding = 0) uniform sampler3D AEPerspectiveSampler;
+layout (set = 4, binding = 0) uniform sampler2D blueNoiseSampler;
+
+#include "shaders/blue_noise.glsl"
 
 /* One unit in global space should be 100 meters in camera coords */
 const float cameraScale = 0.1;
@@ -27,7 +30,7 @@ void main()
     /* Vulkans clip space range [-1, -1] - (1, 1) -> z is depth [0, 1] */
     vec3 clipSpace = vec3(inUV * vec2(2.0) - vec2(1.0), depth);
     /* inverse view projection matrix which gets us from clip space to world space */
-    mat4 invViewProjMat = inverse(commonParameters.proj * commonParameters.view);
+    mat4 invViewProjMat = commonParameters.invViewProj;
     vec4 hPos = invViewProjMat * vec4(clipSpace, 1.0);
     /* Get unit lenght ray from camera origin to processed fragment in world space */
     vec3 cameraRayWorld = normalize(hPos.xyz/hPos.w - cameraPosition);
@@ -42,6 +45,12 @@ void main()
     {
         Weight = clamp(Slice * 2.0, 0.0, 1.0);
         Slice = 0.5;
+    } else {
+        /* Dither the slice lookup by up to half a slice to hide the banding of the low
+           depth resolution of the AE LUT */
+        float jitter = getAnimatedBlueNoise(blueNoiseSampler, ivec2(gl_FragCoord.xy),
+            commonParameters.frameIndex);
+        Slice = max(Slice + jitter - 0.5, 0.5);
     }
     float w = sqrt(Slice / atmosphereParameters.AEPerspectiveTexDimensions.z);
     vec4 APVal = Weight * texture(AEPerspectiveSampler, vec3(inUV, w));
@@ -35,7 +35,7 @@ void main()
         atmosphereParameters.bottom_radius, 
         atmosphereParameters.top_radius);
 
-    mat4 invViewProjMat = inverse(commonParameters.proj * commonParameters.view);
+    mat4 invViewProjMat = commonParameters.invViewProj;
     vec2 pixPos = inUV;
     vec3 ClipSpace = vec3(pixPos*vec2(2.0) - vec2(1.0), 1.0);
     
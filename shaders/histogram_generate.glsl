@@ -1,5 +1,7 @@
 #version 450
 #extension GL_GOOGLE_include_directive : require
+#extension GL_KHR_shader_subgroup_ballot : require
+#extension GL_KHR_shader_subgroup_arithmetic : require
 
 layout (local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
 
@@ -8,6 +10,11 @@ layout (std430, set = 1, binding = 0) buffer histogram { uint bins[256]; };
 /* layout (set = 2, binding = 0) */ #include "shaders/buffers/post_process_param_buff.glsl"
 
 #define EPSILON 0.005
+/* Has to match HISTOGRAM_DOWNSAMPLE, every invocation meters one downsample x downsample
+   block of the HDR target */
+const uint downsample = 4u;
+/* Weight of the centre of the screen with the centre weighted mask, corners weigh 1 */
+const float centreWeight = 8.0;
 float log2minLum = log2(postProcessParameters.minimumLuminance);
 float invLog2lumRange = 1.0/log2(postProcessParameters.maximumLuminance);
 shared uint HistogramShared[256];
@@ -30,26 +37,60 @@ uint HDRToHistogramBin(vec3 hdrColor)
     return uint(logLum * 254.0 + 1.0);
 }
 
-void main()
+/* Integer weights keep the bins exact, histogram_sum divides by the total weight */
+uint getMeteringWeight(vec2 uv)
 {
-    if(gl_GlobalInvocationID.x > postProcessParameters.texDimensions.x ||
-       gl_GlobalInvocationID.y > postProcessParameters.texDimensions.y)
-       {
-           return;
-       }
-    vec2 uv = vec2(gl_GlobalInvocationID.xy) / postProcessParameters.texDimensions;
+    if(postProcessParameters.meteringMask == 0)
+    {
+        return 1u;
+    }
+    float falloff = clamp(length(uv - 0.5) * sqrt(2.0), 0.0, 1.0);
+    return uint(mix(centreWeight, 1.0, falloff * falloff) + 0.5);
+}
 
+void main()
+{
     HistogramShared[gl_LocalInvocationIndex] = 0;
-    groupMemoryBarrier();
     barrier();
 
-    /* Multiply by sun luminance */
-    vec3 hdrCol = texture(texSampler, uv).rgb * 120000.0;
-    uint binIndex = HDRToHistogramBin(hdrCol);
-    atomicAdd(HistogramShared[binIndex], 1);
+    uvec2 meteringDimensions = (uvec2(postProcessParameters.texDimensions) + downsample - 1u) / downsample;
+    if(all(lessThan(gl_GlobalInvocationID.xy, meteringDimensions)))
+    {
+        /* Each bilinear tap averages 2x2 texels -> four taps give the mean of the block */
+        vec2 texelSize = 1.0 / postProcessParameters.texDimensions;
+        vec2 blockCenter = (vec2(gl_GlobalInvocationID.xy) + 0.5) * float(downsample);
+        vec3 blockColor = vec3(0.0);
+        for(int tap = 0; tap < 4; tap++)
+        {
+            vec2 offset = vec2(tap % 2 == 0 ? -1.0 : 1.0, tap / 2 == 0 ? -1.0 : 1.0);
+            blockColor += textureLod(texSampler, (blockCenter + offset) * texelSize, 0.0).rgb;
+        }
+        /* Multiply by sun luminance */
+        vec3 hdrCol = blockColor * 0.25 * 120000.0;
+        uint binIndex = HDRToHistogramBin(hdrCol);
+        uint weight = getMeteringWeight(blockCenter * texelSize);
 
-    groupMemoryBarrier();
+        /* Invocations of the subgroup sharing the bin of the first active one add their
+           weights together and leave, one shared atomic per distinct bin of the subgroup */
+        while(true)
+        {
+            uint leaderBin = subgroupBroadcastFirst(binIndex);
+            if(binIndex == leaderBin)
+            {
+                uint binWeight = subgroupAdd(weight);
+                if(subgroupElect())
+                {
+                    atomicAdd(HistogramShared[binIndex], binWeight);
+                }
+                break;
+            }
+        }
+    }
     barrier();
 
-    atomicAdd(bins[gl_LocalInvocationIndex], HistogramShared[gl_LocalInvocationIndex]);
-}
\ No newline at end of file
+    uint binCount = HistogramShared[gl_LocalInvocationIndex];
+    if(binCount != 0)
+    {
+        atomicAdd(bins[gl_LocalInvocationIndex], binCount);
+    }
+}
@@ -1,5 +1,6 @@
 #version 450
 #extension GL_GOOGLE_include_directive : require
+#extension GL_KHR_shader_subgroup_arithmetic : require
 
 layout (local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
 
@@ -10,71 +11,38 @@ layout (std430, set = 1, binding = 0) buffer histogram { uint bins[256]; };
 #define EPSILON 0.005
 float log2minLum = log2(postProcessParameters.minimumLuminance);
 float log2lumRange = log2(postProcessParameters.maximumLuminance);
-shared uint HistogramShared[256];
+/* One entry per subgroup, large enough for subgroups of a single invocation */
+shared float SubgroupWeightedSums[256];
+shared float SubgroupCounts[256];
 
 void main()
 {
     uint countForThisBin = bins[gl_LocalInvocationIndex];
-    HistogramShared[gl_LocalInvocationIndex] = countForThisBin * gl_LocalInvocationIndex;
-    
-    groupMemoryBarrier();
-    barrier();
-
     bins[gl_LocalInvocationIndex] = 0;
 
-    if(gl_LocalInvocationID.z < 128)
-    {
-        HistogramShared[gl_LocalInvocationIndex] += HistogramShared[gl_LocalInvocationIndex + 128];
-    }
-    groupMemoryBarrier();
-    barrier();
-    if(gl_LocalInvocationID.z < 64)
-    {
-        HistogramShared[gl_LocalInvocationIndex] += HistogramShared[gl_LocalInvocationIndex + 64];
-    }
-    groupMemoryBarrier();
-    barrier();
-    if(gl_LocalInvocationID.z < 32)
-    {
-        HistogramShared[gl_LocalInvocationIndex] += HistogramShared[gl_LocalInvocationIndex + 32];
-    }
-    groupMemoryBarrier();
-    barrier();
-    if(gl_LocalInvocationID.z < 16)
-    {
-        HistogramShared[gl_LocalInvocationIndex] += HistogramShared[gl_LocalInvocationIndex + 16];
-    }
-    groupMemoryBarrier();
-    barrier();
-    if(gl_LocalInvocationID.z < 8)
-    {
-        HistogramShared[gl_LocalInvocationIndex] += HistogramShared[gl_LocalInvocationIndex + 8];
-    }
-    groupMemoryBarrier();
-    barrier();
-    if(gl_LocalInvocationID.z < 4)
-    {
-        HistogramShared[gl_LocalInvocationIndex] += HistogramShared[gl_LocalInvocationIndex + 4];
-    }
-    groupMemoryBarrier();
-    barrier();
-    if(gl_LocalInvocationID.z < 2)
+    /* Sums are kept in floats -> weighted bins of large targets can't overflow */
+    float weightedSum = subgroupAdd(float(countForThisBin) * float(gl_LocalInvocationIndex));
+    float count = subgroupAdd(float(countForThisBin));
+    if(subgroupElect())
     {
-        HistogramShared[gl_LocalInvocationIndex] += HistogramShared[gl_LocalInvocationIndex + 2];
+        SubgroupWeightedSums[gl_SubgroupID] = weightedSum;
+        SubgroupCounts[gl_SubgroupID] = count;
     }
-    groupMemoryBarrier();
-    barrier();
-    if(gl_LocalInvocationID.z < 1)
-    {
-        HistogramShared[gl_LocalInvocationIndex] += HistogramShared[gl_LocalInvocationIndex + 1];
-    }
-    groupMemoryBarrier();
     barrier();
 
-    if(gl_GlobalInvocationID.x == 0)
+    if(gl_LocalInvocationIndex == 0)
     {
+        float histogramWeightedSum = 0.0;
+        float histogramCount = 0.0;
+        for(uint subgroup = 0; subgroup < gl_NumSubgroups; subgroup++)
+        {
+            histogramWeightedSum += SubgroupWeightedSums[subgroup];
+            histogramCount += SubgroupCounts[subgroup];
+        }
+
+        /* Bin 0 holds the pixels too dark to be metered, they are left out of the average */
         float weightedLogAverage = 
-            (HistogramShared[0] / max(postProcessParameters.texDimensions.x * postProcessParameters.texDimensions.y - float(countForThisBin), 1.0)) - 1.0;
+            (histogramWeightedSum / max(histogramCount - float(countForThisBin), 1.0)) - 1.0;
         
         float weightedAvgLum = exp2(((weightedLogAverage / 254.0) * log2lumRange) + log2minLum);
         float lumLastFrame = avgLum;
@@ -87,4 +55,4 @@ void main()
             avgLum = weightedAvgLum;
         }
     }
-}
\ No newline at end of file
+}
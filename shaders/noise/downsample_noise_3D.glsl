@@ -0,0 +1,26 @@
+#version 450
+
+/* Build one mip of the combined noise volume as the average of the 2x2x2 texels of
+   the previous mip it covers, the volume tiles -> odd sizes wrap around */
+layout (local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+layout (set = 0, binding = 0, rgba16f) uniform readonly image3D srcNoise;
+layout (set = 0, binding = 1, rgba16f) uniform writeonly image3D dstNoise;
+
+void main()
+{
+    ivec3 coords = ivec3(gl_GlobalInvocationID.xyz);
+    if(any(greaterThanEqual(coords, imageSize(dstNoise))))
+    {
+        return;
+    }
+
+    ivec3 srcSize = imageSize(srcNoise);
+    vec4 sum = vec4(0.0);
+    for(int i = 0; i < 8; i++)
+    {
+        ivec3 srcCoords = (coords * 2 + ivec3(i & 1, (i >> 1) & 1, i >> 2)) % srcSize;
+        sum += imageLoad(srcNoise, srcCoords);
+    }
+    imageStore(dstNoise, coords, sum * 0.125);
+}
@@ -1,27 +1,27 @@
 #version 450
 
-struct Vector{
-    float x, y, z;
-};
-
+/* Rescale the channels written by worley_noise_3D to the 0-1 range in place */
 layout (local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
 
-layout (std430, set = 0, binding = 0) buffer minMaxBuffer { int minVal; int maxVal; } minMax[4];
-layout (set = 0, binding = 1, r16f) uniform image3D perChannelNoise [4];
-layout (set = 0, binding = 2, rgba16f) uniform image3D resultNoise;
+layout (std430, set = 0, binding = 1) readonly buffer minMaxBuffer { uint minVal[4]; uint maxVal[4]; };
+layout (std140, set = 0, binding = 2) uniform worleyParamsBuffer
+{
+    ivec4 texDimensions;
+    ivec4 numDivisions[4];
+    ivec4 pointsOffsets[4];
+    vec4 persistence;
+    /* Non zero for the channels written by worley_noise_3D, the rest is already normalized */
+    ivec4 channelMask;
+};
+layout (set = 0, binding = 3, rgba16f) uniform image3D resultNoise;
 
-const float minMaxPrecision = 10000000.0;
 void main()
 {
-    float resultAsFloatArr [4];
-    for(int i = 0; i < 4; i++)
-    {
-        float val = imageLoad(perChannelNoise[i], ivec3(gl_GlobalInvocationID.xyz)).r;
-        float minValFloat = float(minMax[i].minVal) / float(minMaxPrecision);
-        float maxValFloat = float(minMax[i].maxVal) / float(minMaxPrecision);
-        float normalizedVal = (val - minValFloat) / (maxValFloat - minValFloat);
-        resultAsFloatArr[i] = normalizedVal;
-    }
-    vec4 result = vec4(resultAsFloatArr[0], resultAsFloatArr[1], resultAsFloatArr[2], resultAsFloatArr[3]); 
-    imageStore(resultNoise, ivec3(gl_GlobalInvocationID.xyz), result);
-}
\ No newline at end of file
+    ivec3 coords = ivec3(gl_GlobalInvocationID.xyz);
+    vec4 minValFloat = uintBitsToFloat(uvec4(minVal[0], minVal[1], minVal[2], minVal[3]));
+    vec4 maxValFloat = uintBitsToFloat(uvec4(maxVal[0], maxVal[1], maxVal[2], maxVal[3]));
+
+    vec4 val = imageLoad(resultNoise, coords);
+    vec4 normalized = (val - minValFloat) / max(maxValFloat - minValFloat, vec4(1e-6));
+    imageStore(resultNoise, coords, mix(val, normalized, notEqual(channelMask, ivec4(0))));
+}
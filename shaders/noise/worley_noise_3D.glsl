@@ -1,28 +1,32 @@
 /* Taken from here:
     https://github.com/SebLague/Clouds/blob/master/Assets/Scripts/Clouds/Noise/Compute/NoiseGenCompute.compute*/
 #version 450
+#extension GL_KHR_shader_subgroup_arithmetic : require
 
-#extension GL_EXT_scalar_block_layout : require
-struct Vector{
-    float x, y, z;
-};
-
+/* All channels of channelMask are evaluated per texel and written unnormalized into
+   mip 0 of the noise volume, normalize_noise_3D then rescales them in place with the
+   min/max reduced here. The other channels keep their normalized values */
 layout (local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
 
-layout (scalar, set = 0, binding = 0) buffer pointsABuffer { Vector pointsA []; };
-layout (scalar, set = 0, binding = 1) buffer pointsBBuffer { Vector pointsB []; };
-layout (scalar, set = 0, binding = 2) buffer pointsCBuffer { Vector pointsC []; };
-layout (std430, set = 0, binding = 3) buffer minMaxBuffer { int minVal; int maxVal; };
-layout (std140, set = 0, binding = 4) uniform worleyParamsBuffer
+/* Feature points of all 12 layers padded with one layer of periodic ghost cells each,
+   see padWorleyPoints, pointsOffsets locates the layers */
+layout (std430, set = 0, binding = 0) readonly buffer pointsBuffer { vec4 points []; };
+/* Bit patterns of the per channel extremes, see main */
+layout (std430, set = 0, binding = 1) buffer minMaxBuffer { uint minVal[4]; uint maxVal[4]; };
+layout (std140, set = 0, binding = 2) uniform worleyParamsBuffer
 {
-    ivec3 numDivisions;
-    ivec3 texDimensions;
-    vec4 targetChannels;
-    float persistence;
+    /* w - first z texel of the slab covered by the dispatch, the volume is generated in
+       slabs spread over several frames, see WorleyNoise3D::generateSlabs */
+    ivec4 texDimensions;
+    /* xyz - divisions of the three layers of each channel */
+    ivec4 numDivisions[4];
+    /* xyz - index of the first padded point of each layer in points */
+    ivec4 pointsOffsets[4];
+    vec4 persistence;
+    /* Non zero for the channels being regenerated */
+    ivec4 channelMask;
 };
-layout (set = 0, binding = 5, r16f) uniform image3D resultNoise;
-
-const float minMaxPrecision = 10000000.0;
+layout (set = 0, binding = 3, rgba16f) uniform image3D resultNoise;
 
 const ivec3 offsets[] =
 {
@@ -59,58 +63,59 @@ const ivec3 offsets[] =
     ivec3(1,-1,0)
 };
 
-int maxComponent(ivec3 vec) {
-    return max(vec.x, max(vec.y, vec.z));
-}
+/* Most cells along one axis the 27 cell neighbourhoods of the texels of one workgroup
+   can touch, holds as long as numDivisions is not larger than texDimensions */
+const int SHARED_CELLS = 7;
+shared vec3 sharedPoints[SHARED_CELLS * SHARED_CELLS * SHARED_CELLS];
 
-int minComponent(ivec3 vec) {
-    return min(vec.x, min(vec.y, vec.z));
+uvec3 getTexelCoords(uvec3 invocationID)
+{
+    return invocationID + uvec3(0, 0, texDimensions.w);
 }
 
-vec3 getPointOffset(uint bufferToOperateOn, int index)
+/**
+ * Copy the cells the texels of this workgroup search through from the layer starting
+ * at pointsOffset into sharedPoints
+ * @return cell stored at the origin of sharedPoints
+ */
+ivec3 stagePoints(int pointsOffset, int numCells)
 {
-    switch (bufferToOperateOn) 
+    uvec3 firstTexel = getTexelCoords(gl_WorkGroupID * gl_WorkGroupSize);
+    /* Same expressions main and worley use for the positions and cells of the texels */
+    ivec3 firstCell = ivec3(floor(vec3(firstTexel) / vec3(texDimensions.xyz) * numCells)) - 1;
+    ivec3 lastCell = ivec3(floor(vec3(firstTexel + gl_WorkGroupSize - 1u) / vec3(texDimensions.xyz) * numCells)) + 1;
+    ivec3 cellCount = lastCell - firstCell + 1;
+    int paddedCells = numCells + 2;
+
+    /* Previous layer has to be done reading the shared points */
+    barrier();
+    uint groupSize = gl_WorkGroupSize.x * gl_WorkGroupSize.y * gl_WorkGroupSize.z;
+    for(uint i = gl_LocalInvocationIndex; i < uint(cellCount.x * cellCount.y * cellCount.z); i += groupSize)
     {
-        case 0:
-            return vec3(pointsA[index].x, pointsA[index].y, pointsA[index].z);
-        case 1:
-            return vec3(pointsB[index].x, pointsB[index].y, pointsB[index].z);
-        case 2:
-            return vec3(pointsC[index].x, pointsC[index].y, pointsC[index].z);
+        ivec3 localCell = ivec3(int(i) % cellCount.x, (int(i) / cellCount.x) % cellCount.y,
+            int(i) / (cellCount.x * cellCount.y));
+        ivec3 paddedCell = firstCell + localCell + 1;
+        int index = paddedCell.x + paddedCells * (paddedCell.y + paddedCell.z * paddedCells);
+        sharedPoints[localCell.x + SHARED_CELLS * (localCell.y + localCell.z * SHARED_CELLS)] =
+            points[pointsOffset + index].xyz;
     }
+    barrier();
+    return firstCell;
 }
-/* Since it's possible (as far as I know at least) to pass variable length arrays or 
-   Buffers to function the bufferToOperateOn is needed -> 0 - pointsABuffer ... */
-float worley(uint bufferToOperateOn, int numCells, vec3 position)
+
+/* Ghost cells already hold the periodic copies of the points -> no wrapping, every texel
+   tests exactly the 27 cells around it */
+float worley(ivec3 firstCell, int numCells, vec3 position)
 {
     float minSqrDist = 1.0;
-    ivec3 cellID = ivec3(
-        floor(position.x * numCells), 
-        floor(position.y * numCells),
-        floor(position.z * numCells)
-    );
+    ivec3 cellID = ivec3(floor(position * numCells)) - firstCell;
 
     for (int cellOffsetIndex = 0; cellOffsetIndex < 27; cellOffsetIndex++)
     {
-        ivec3 adjCellID = cellID + offsets[cellOffsetIndex];
-        if(minComponent(adjCellID) == -1 || maxComponent(adjCellID) == numCells)
-        {
-            /* (adjCellID + numCells) % numCells*/
-            ivec3 wrappedID = ivec3(mod(ivec3(adjCellID) + ivec3(numCells), vec3(numCells)));
-            int adjCellIndex = wrappedID.x + numCells * (wrappedID.y + wrappedID.z * numCells);
-            vec3 wrappedPoint = getPointOffset(bufferToOperateOn, adjCellIndex);
-            for (int wrapOffsetIndex = 0; wrapOffsetIndex < 27; wrapOffsetIndex++)
-            {
-                vec3 sampleOffset = (position - (wrappedPoint + offsets[wrapOffsetIndex]));
-                minSqrDist = min(minSqrDist, dot(sampleOffset, sampleOffset));
-            }
-        } 
-        else 
-        {
-            int adjCellIndex = adjCellID.x + numCells * (adjCellID.y + adjCellID.z * numCells);
-            vec3 sampleOffset = position - getPointOffset(bufferToOperateOn, adjCellIndex);
-            minSqrDist = min(minSqrDist, dot(sampleOffset, sampleOffset));
-        }
+        ivec3 localCell = cellID + offsets[cellOffsetIndex];
+        vec3 sampleOffset = position -
+            sharedPoints[localCell.x + SHARED_CELLS * (localCell.y + localCell.z * SHARED_CELLS)];
+        minSqrDist = min(minSqrDist, dot(sampleOffset, sampleOffset));
     }
     return sqrt(minSqrDist);
 }
@@ -192,29 +197,81 @@ float perlinfbm(vec3 p, float freq, int octaves)
     return noise;
 }
 
-void main()
+shared uint sharedMin[4];
+shared uint sharedMax[4];
+
+float channelNoise(int channel, vec3 position)
 {
-    vec3 pixPos = vec3(gl_GlobalInvocationID.xyz) / vec3(texDimensions);
-    float layerA = worley(0, numDivisions.x, pixPos);
-    float layerB = worley(1, numDivisions.y, pixPos);
-    float layerC = worley(2, numDivisions.z, pixPos);
+    ivec3 divisions = numDivisions[channel].xyz;
+    ivec3 offsets = pointsOffsets[channel].xyz;
+    float channelPersistence = persistence[channel];
 
-    float noiseSum = layerA + (layerB * persistence) + (layerC * persistence * persistence);
-    float localMaxVal = 1 + (persistence) + (persistence * persistence);
+    float layerA = worley(stagePoints(offsets.x, divisions.x), divisions.x, position);
+    float layerB = worley(stagePoints(offsets.y, divisions.y), divisions.y, position);
+    float layerC = worley(stagePoints(offsets.z, divisions.z), divisions.z, position);
+
+    float noiseSum = layerA + (layerB * channelPersistence) +
+        (layerC * channelPersistence * channelPersistence);
+    float localMaxVal = 1 + (channelPersistence) + (channelPersistence * channelPersistence);
     noiseSum /= localMaxVal;
     noiseSum = 1 - noiseSum;
-    
-    if(numDivisions.x == 3.0)
+
+    if(divisions.x == 3)
     {
-        float pfbm = mix(1.0, perlinfbm(pixPos, 4, 7), 0.5);
+        float pfbm = mix(1.0, perlinfbm(position, 4, 7), 0.5);
         pfbm = abs(pfbm * 2.0 - 1.0);
         pfbm = remap(pfbm, 0.0, 1.0, noiseSum, 1.0);
         noiseSum = pfbm;
     }
+    return noiseSum;
+}
 
-    int valueAsInt = int(noiseSum * minMaxPrecision);
-    atomicMin(minVal, valueAsInt);
-    atomicMax(maxVal, valueAsInt);
+void main()
+{
+    if(gl_LocalInvocationIndex < 4)
+    {
+        sharedMin[gl_LocalInvocationIndex] = 0xFFFFFFFFu;
+        sharedMax[gl_LocalInvocationIndex] = 0u;
+    }
+    /* stagePoints synchronizes the workgroup before the first use of the shared arrays */
+
+    uvec3 texelCoords = getTexelCoords(gl_GlobalInvocationID);
+    vec3 pixPos = vec3(texelCoords) / vec3(texDimensions.xyz);
+    vec4 noise = vec4(0.0);
+    if(any(equal(channelMask, ivec4(0))))
+    {
+        noise = imageLoad(resultNoise, ivec3(texelCoords));
+    }
+    /* channelMask is uniform -> stagePoints is still reached by the whole workgroup */
+    for(int channel = 0; channel < 4; channel++)
+    {
+        if(channelMask[channel] != 0)
+        {
+            noise[channel] = channelNoise(channel, pixPos);
+        }
+    }
+    imageStore(resultNoise, ivec3(texelCoords), noise);
 
-    imageStore(resultNoise, ivec3(gl_GlobalInvocationID.xyz), vec4(noiseSum));
-}
\ No newline at end of file
+    /* Worley distances are clamped to 1 -> the noise is never negative and the bit
+       patterns of the values order the same way as the floats do. Reduced in the
+       subgroup first, then in the workgroup, one global atomic per workgroup and channel.
+       Extremes of the kept channels are reduced as well but never used */
+    uvec4 subgroupMinBits = floatBitsToUint(subgroupMin(max(noise, 0.0)));
+    uvec4 subgroupMaxBits = floatBitsToUint(subgroupMax(max(noise, 0.0)));
+    if(subgroupElect())
+    {
+        for(int channel = 0; channel < 4; channel++)
+        {
+            atomicMin(sharedMin[channel], subgroupMinBits[channel]);
+            atomicMax(sharedMax[channel], subgroupMaxBits[channel]);
+        }
+    }
+    barrier();
+
+    if(gl_LocalInvocationIndex < 4)
+    {
+        uint channel = gl_LocalInvocationIndex;
+        atomicMin(minVal[channel], sharedMin[channel]);
+        atomicMax(maxVal[channel], sharedMax[channel]);
+    }
+}
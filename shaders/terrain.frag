@@ -12,6 +12,8 @@ layout (location = 0) out vec4 outColor;
 layout(set = 2, binding = 1) uniform sampler2D diffuseMapSampler;
 layout(set = 2, binding = 2) uniform sampler2D normalMapSampler;
 layout(set = 3, binding = 0, rgba16f) uniform readonly image2D transmittanceLUT;
+/* r - optical depth towards the sun, see clouds_shadow_build */
+layout(set = 4, binding = 3) uniform sampler3D cloudsShadowSampler;
 
 /* One unit in global space should be 100 meters in camera coords */
 const float cameraScale = 0.1;
@@ -51,5 +53,11 @@ void main()
 
     vec3 ambient = vec3(0.1, 0.1, 0.1) * texColor;
     vec3 diffuse = diff * texColor;
+    /* Last slice holds the optical depth of the whole column above the terrain */
+    vec2 shadowUV = (commonParameters.cloudsShadowMatrix * vec4(worldPosition, 1.0)).xy;
+    if(all(greaterThanEqual(shadowUV, vec2(0.0))) && all(lessThanEqual(shadowUV, vec2(1.0))))
+    {
+        diffuse *= exp(-texture(cloudsShadowSampler, vec3(shadowUV, 1.0)).r);
+    }
     outColor = vec4((ambient + diffuse).xyz * 0.05 * transmittanceToSun, 1.0);
 }
\ No newline at end of file
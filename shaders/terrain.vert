@@ -1,22 +1,72 @@
 #version 450
 #extension GL_GOOGLE_include_directive : require
 
-layout (location = 0) in vec3 inPosition;
-layout (location = 1) in vec2 inTexCoord;
+/* Per instance, see TerrainNodeInstance. There are no per vertex inputs, the patch
+   vertex is derived from gl_VertexIndex, see generateTerrainPatchIndices */
+layout (location = 0) in vec3 inNode;
+layout (location = 1) in vec2 inMorphRange;
 
 layout (location = 0) out vec2 outTexCoord;
 layout (location = 1) out vec3 worldPosition;
 
 
 /* layout (set = 0, binding = 0) */ #include "shaders/buffers/common_param_buff.glsl"
-layout(set = 2, binding = 0) uniform sampler2D heightMapSampler;
+/* Resident heightmap tiles and the table of their layers, see TerrainTileCache */
+layout(set = 2, binding = 0) uniform sampler2DArray heightTilesSampler;
+layout(std430, set = 2, binding = 3) readonly buffer TerrainTileTable
+{
+    /* Has to match TERRAIN_TILE_TABLE_MIPS, x y - tiles along x and y, z - first entry */
+    uvec4 mips[16];
+    /* x - mip count, y - tile size, zw - heightmap extent */
+    uvec4 params;
+    /* Layer + 1 of every tile, 0 when the tile is not resident */
+    uint entries[];
+} tileTable;
+
+/* Quads along each side of the patch, has to match TERRAIN_PATCH_RES */
+const uint patchRes = 32u;
+/* Has to match TERRAIN_HEIGHT_SCALE */
+const float scale = 0.07;
+
+/* Height of the finest resident mip, the mips covered by a single tile are always resident.
+   Depends only on the position -> vertices shared by neighbouring nodes stay welded */
+float sampleHeight(vec2 planePosition)
+{
+    uint tileSize = tileTable.params.y;
+    for(uint mip = 0u; mip < tileTable.params.x; mip++)
+    {
+        uvec4 mipTiles = tileTable.mips[mip];
+        vec2 texel = clamp(planePosition, 0.0, 1.0) * vec2(max(tileTable.params.zw >> mip, uvec2(1u)));
+        uvec2 tile = min(uvec2(texel) / tileSize, mipTiles.xy - 1u);
+        uint layer = tileTable.entries[mipTiles.z + tile.y * mipTiles.x + tile.x];
+        if(layer != 0u)
+        {
+            /* Tiles are stored with a one texel border -> bilinear filter stays inside of the layer */
+            vec2 uv = (texel - vec2(tile * tileSize) + 1.0) / float(tileSize + 2u);
+            return textureLod(heightTilesSampler, vec3(uv, float(layer - 1u)), 0.0).r * scale;
+        }
+    }
+    return 0.0;
+}
 
 void main() 
 {
-    float scale = 0.07;
-    float height = texture(heightMapSampler, inTexCoord).r * scale; 
+    uint vertexRes = patchRes + 1u;
+    vec2 patchPosition = vec2(uint(gl_VertexIndex) / vertexRes, uint(gl_VertexIndex) % vertexRes) /
+        float(patchRes);
+    vec2 planePosition = inNode.xy + patchPosition * inNode.z;
+    vec3 unmorphedPosition = (commonParameters.model *
+        vec4(planePosition, sampleHeight(planePosition), 1.0)).xyz;
+    float morph = clamp((distance(unmorphedPosition, commonParameters.cameraPosition.xyz) -
+        inMorphRange.x) / (inMorphRange.y - inMorphRange.x), 0.0, 1.0);
+    /* Odd vertices slide onto their even neighbours, fully morphed node matches the grid
+       of the parent level -> no cracks or popping when the selection switches levels */
+    vec2 oddOffset = fract(patchPosition * float(patchRes) * 0.5) * 2.0 / float(patchRes);
+    planePosition -= oddOffset * inNode.z * morph;
+
+    float height = sampleHeight(planePosition);
     mat4 PVMmatrix = commonParameters.proj * commonParameters.view * commonParameters.model;
-    outTexCoord = vec2(inPosition.xy);
-    worldPosition = (commonParameters.model * vec4(inPosition.x, inPosition.y, height, 1.0)).rgb;
-    gl_Position = PVMmatrix * vec4(inPosition.x,inPosition.y,height, 1.0);
-}
\ No newline at end of file
+    outTexCoord = planePosition;
+    worldPosition = (commonParameters.model * vec4(planePosition, height, 1.0)).rgb;
+    gl_Position = PVMmatrix * vec4(planePosition, height, 1.0);
+}
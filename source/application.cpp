@@ -39,6 +39,8 @@ void processInput(GLFWwindow *window)
     data->lastFrame = currentFrame;
     data->flyModeToggleTimeout = data->flyModeToggleTimeout - data->deltaTime < 0.0f ? 
         0.0f : data->flyModeToggleTimeout - data->deltaTime;
+    data->referenceRenderTimeout = data->referenceRenderTimeout - data->deltaTime < 0.0f ? 
+        0.0f : data->referenceRenderTimeout - data->deltaTime;
 
     /* end program */
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
@@ -73,6 +75,16 @@ void processInput(GLFWwindow *window)
         }
         data->flyModeToggleTimeout = 0.2f;
     }
+    /* CPU reference clouds -> R renders golden image matching the GPU pass,
+       T renders the high sample count offline reference */
+    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS && data->referenceRenderTimeout == 0.0f) {
+        data->renderer->renderCloudsReference("clouds_reference.exr", false);
+        data->referenceRenderTimeout = 0.5f;
+    }
+    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS && data->referenceRenderTimeout == 0.0f) {
+        data->renderer->renderCloudsReference("clouds_reference_offline.exr", true);
+        data->referenceRenderTimeout = 0.5f;
+    }
 }
 
 
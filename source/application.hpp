@@ -21,6 +21,7 @@ struct GLFWUserData
     bool flyMode = false;
     bool firstInput = false;
     float flyModeToggleTimeout = 0.0f;
+    float referenceRenderTimeout = 0.0f;
     Renderer *renderer;
 };
 
@@ -0,0 +1,281 @@
+/* CPU side hot path benchmarks, none of the cases create a Vulkan instance or device
+   -> can be run on machines without a GPU. Run from the repository root so the
+   assets directory can be found, f.e.:
+        atmosphere_bench --benchmark_format=json --benchmark_out=bench_output.json */
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "benchmark.hpp"
+#include "camera.hpp"
+#include "model/sky_model.hpp"
+#include "model/terrain_quadtree.hpp"
+#include "noise/worley_points.hpp"
+#include "noise/worley_bake.hpp"
+#include "noise/bc7_volume.hpp"
+#include "noise/blue_noise.hpp"
+#include "noise/coverage_map.hpp"
+#include "vulkan/image_data.hpp"
+#include "vulkan/buffer_defines.hpp"
+#include "vulkan/buffer_packing.hpp"
+
+static void BM_GenerateWorleyPointsBuffer(BenchmarkState &state)
+{
+    std::mt19937 mt = std::mt19937(123);
+    std::uniform_real_distribution<float> distribution(0, 1);
+    std::vector<glm::vec3> points;
+    int numDivisions = static_cast<int>(state.range());
+
+    for(auto _ : state)
+    {
+        generateWorleyPoints(points, numDivisions, mt, distribution);
+        doNotOptimize(points.data());
+    }
+    state.setItemsProcessed(state.iterations() * numDivisions * numDivisions * numDivisions);
+}
+/* Division counts used by the shape and detail noise channels */
+BENCHMARK(BM_GenerateWorleyPointsBuffer)->arg(8)->arg(18)->arg(31)->arg(49);
+
+static void BM_PadWorleyPoints(BenchmarkState &state)
+{
+    std::mt19937 mt = std::mt19937(123);
+    std::uniform_real_distribution<float> distribution(0, 1);
+    std::vector<glm::vec3> points;
+    std::vector<glm::vec4> padded;
+    int numDivisions = static_cast<int>(state.range());
+    generateWorleyPoints(points, numDivisions, mt, distribution);
+
+    for(auto _ : state)
+    {
+        padWorleyPoints(points, numDivisions, padded);
+        doNotOptimize(padded.data());
+    }
+    state.setItemsProcessed(state.iterations() * static_cast<int64_t>(padded.size()));
+}
+BENCHMARK(BM_PadWorleyPoints)->arg(8)->arg(49);
+
+/* Detail noise divisions at reduced resolution, the full 128^3 and 256^3 volumes are
+   baked by atmosphere_noise_baker */
+static void BM_BakeWorleyNoise(BenchmarkState &state)
+{
+    WorleyNoiseDesc desc = getDetailNoiseDesc();
+    int size = static_cast<int>(state.range());
+    desc.texDimensions = glm::ivec3(size);
+    std::vector<uint16_t> buffer;
+    for(auto _ : state)
+    {
+        bakeWorleyNoise(buffer, desc);
+        doNotOptimize(buffer.data());
+    }
+    state.setItemsProcessed(state.iterations() * size * size * size);
+}
+BENCHMARK(BM_BakeWorleyNoise)->arg(64);
+
+/* Whole mip chain of a reduced detail volume, items are the mip 0 texels */
+static void BM_EncodeBC7Volume(BenchmarkState &state)
+{
+    WorleyNoiseDesc desc = getDetailNoiseDesc();
+    int size = static_cast<int>(state.range());
+    desc.texDimensions = glm::ivec3(size);
+    std::vector<uint16_t> texels;
+    bakeWorleyNoise(texels, desc);
+    BC7Volume volume;
+    for(auto _ : state)
+    {
+        encodeBC7Volume(texels, desc.texDimensions, volume);
+        doNotOptimize(volume.blocks.data());
+    }
+    state.setItemsProcessed(state.iterations() * size * size * size);
+}
+BENCHMARK(BM_EncodeBC7Volume)->arg(64);
+
+static void BM_GenerateBlueNoise(BenchmarkState &state)
+{
+    std::vector<uint8_t> buffer;
+    int size = static_cast<int>(state.range());
+    for(auto _ : state)
+    {
+        generateBlueNoise(buffer, size, 1234u);
+        doNotOptimize(buffer.data());
+    }
+    state.setItemsProcessed(state.iterations() * size * size);
+}
+/* 64 is the size used by Renderer::loadAssets */
+BENCHMARK(BM_GenerateBlueNoise)->arg(32)->arg(64);
+
+static void BM_GenerateCoverageMap(BenchmarkState &state)
+{
+    std::vector<uint8_t> buffer;
+    int size = static_cast<int>(state.range());
+    for(auto _ : state)
+    {
+        generateCoverageMap(buffer, size, 4321u);
+        buildCoverageMaxMips(buffer, size);
+        doNotOptimize(buffer.data());
+    }
+    state.setItemsProcessed(state.iterations() * size * size);
+}
+/* 512 is the size used by Renderer::loadAssets */
+BENCHMARK(BM_GenerateCoverageMap)->arg(256)->arg(512);
+
+/* Synthetic rolling heightmap, the quadtree only needs the height channel */
+static std::vector<float> generateBenchHeights(uint32_t size)
+{
+    std::vector<float> heights(size * size);
+    for(uint32_t y = 0; y < size; y++)
+    {
+        for(uint32_t x = 0; x < size; x++)
+        {
+            heights[y * size + x] = 0.5f + 0.25f * std::sin(x * 0.01f) * std::cos(y * 0.013f);
+        }
+    }
+    return heights;
+}
+
+/* Everything Renderer::loadAssets builds from the decoded heightmap */
+static void BM_BuildTerrainHeights(BenchmarkState &state)
+{
+    uint32_t size = static_cast<uint32_t>(state.range());
+    std::vector<float> heights = generateBenchHeights(size);
+    for(auto _ : state)
+    {
+        HeightPyramid pyramid(heights.data(), size, size);
+        TerrainQuadtree quadtree(pyramid, 0.07f, 8);
+        std::vector<float> mipChain = heights;
+        buildHeightMips(mipChain, size, size);
+        doNotOptimize(quadtree);
+        doNotOptimize(mipChain.data());
+    }
+    state.setItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_BuildTerrainHeights)->arg(2048)->arg(4096);
+
+/* Per frame node selection done in Renderer::updateTerrainNodes with the LOD settings
+   of the renderer, camera is just above the terrain looking along it */
+static void BM_SelectTerrainNodes(BenchmarkState &state)
+{
+    std::vector<float> heights = generateBenchHeights(2048);
+    TerrainQuadtree quadtree(HeightPyramid(heights.data(), 2048, 2048), 0.07f, 8);
+    Camera camera = Camera(glm::vec3(0.0f, 0.0f, 80.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 1.0f));
+    TerrainSelection selection;
+    float offset = 0.0f;
+    for(auto _ : state)
+    {
+        camera.updateFrontVec(offset, 0.0f);
+        offset = offset == 0.0f ? 1.0f : -offset;
+        UniformBufferObject ubo = packCommonParams(camera, 16.0f / 9.0f, 0.0f);
+        quadtree.select(ubo.model, ubo.proj * ubo.view, camera.getPos(), 20.0f, selection);
+        doNotOptimize(selection[0].data());
+    }
+}
+BENCHMARK(BM_SelectTerrainNodes);
+
+static void BM_SetupAtmosphereParametersBuffer(BenchmarkState &state)
+{
+    AtmosphereParametersBuffer buffer{};
+    for(auto _ : state)
+    {
+        SetupAtmosphereParametersBuffer(buffer);
+        doNotOptimize(buffer);
+    }
+}
+BENCHMARK(BM_SetupAtmosphereParametersBuffer);
+
+static void decodeImage(BenchmarkState &state, const std::string &path, bool isEXR)
+{
+    if(!std::ifstream(path).good())
+    {
+        state.skipWithError("Missing asset " + path + ", see Assets section of readme.md");
+        return;
+    }
+    size_t decodedSize = 0;
+    for(auto _ : state)
+    {
+        ImageData image(path, isEXR);
+        decodedSize = image.size;
+        doNotOptimize(image.pixels);
+    }
+    state.setBytesProcessed(state.iterations() * decodedSize);
+}
+
+static void BM_DecodeEXRHeightmap(BenchmarkState &state)
+{
+    decodeImage(state, "assets/textures/terrain_heightmap.exr", true);
+}
+BENCHMARK(BM_DecodeEXRHeightmap);
+
+static void BM_DecodePNGColormask(BenchmarkState &state)
+{
+    decodeImage(state, "assets/textures/terrain_colormask.png", false);
+}
+BENCHMARK(BM_DecodePNGColormask);
+
+static void BM_DecodePNGNormalmap(BenchmarkState &state)
+{
+    decodeImage(state, "assets/textures/terrain_normalmap.png", false);
+}
+BENCHMARK(BM_DecodePNGNormalmap);
+
+/* range 0 is right handed view matrix, 1 is left handed one used for lHviewProj */
+static void BM_CameraGetViewMatrix(BenchmarkState &state)
+{
+    Camera camera = Camera(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 1.0f));
+    bool LH = state.range() == 1;
+    float offset = 0.0f;
+    for(auto _ : state)
+    {
+        /* Keep the angles changing so the trigonometry can not be hoisted */
+        camera.updateFrontVec(offset, 0.0f);
+        offset = offset == 0.0f ? 1.0f : -offset;
+        glm::mat4 view = camera.getViewMatrix(LH);
+        doNotOptimize(view);
+    }
+}
+BENCHMARK(BM_CameraGetViewMatrix)->arg(0)->arg(1);
+
+/* Per frame packing done in Renderer::updateUniformBuffer, mapped memory is
+   substituted with host allocations */
+static void BM_UpdateUniformBufferPacking(BenchmarkState &state)
+{
+    Camera camera = Camera(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 1.0f));
+    AtmosphereParametersBuffer atmoParams{};
+    SetupAtmosphereParametersBuffer(atmoParams);
+    CloudsParametersBuffer cloudsParams{};
+    PostProcessParamsBuffer postProcessParams{};
+
+    std::vector<char> mappedCommon(sizeof(UniformBufferObject));
+    std::vector<char> mappedAtmo(sizeof(AtmosphereParametersBuffer));
+    std::vector<char> mappedClouds(sizeof(CloudsParametersBuffer));
+    std::vector<char> mappedPostProcess(sizeof(PostProcessParamsBuffer));
+
+    float time = 0.0f;
+    for(auto _ : state)
+    {
+        time += 0.016f;
+        UniformBufferObject ubo = packCommonParams(camera, 16.0f / 9.0f, time);
+        packAtmosphereFrameParams(atmoParams, camera.getPos());
+        ubo.cloudsShadowMatrix = packCloudsShadowMatrix(atmoParams.sunDirection, camera.getPos(),
+            cloudsParams.shadowMapExtent, 256);
+        memcpy(mappedCommon.data(), &ubo, sizeof(ubo));
+
+        memcpy(mappedAtmo.data(), &atmoParams, sizeof(AtmosphereParametersBuffer));
+        memcpy(mappedClouds.data(), &cloudsParams, sizeof(CloudsParametersBuffer));
+        memcpy(mappedPostProcess.data(), &postProcessParams, sizeof(PostProcessParamsBuffer));
+
+        doNotOptimize(mappedCommon.data());
+        doNotOptimize(mappedAtmo.data());
+    }
+    state.setBytesProcessed(state.iterations() * (sizeof(UniformBufferObject) +
+        sizeof(AtmosphereParametersBuffer) + sizeof(CloudsParametersBuffer) +
+        sizeof(PostProcessParamsBuffer)));
+}
+BENCHMARK(BM_UpdateUniformBufferPacking);
+
+int main(int argc, char **argv)
+{
+    return runBenchmarks(argc, argv);
+}
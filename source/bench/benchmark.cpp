@@ -0,0 +1,315 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <regex>
+#include <memory>
+#include <thread>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+
+#include "benchmark.hpp"
+
+#ifndef ATMOSPHERE_VERSION
+#define ATMOSPHERE_VERSION "unknown"
+#endif
+
+#pragma region benchmarkState
+BenchmarkState::BenchmarkState(int64_t maxIterations, int64_t arg) :
+    maxIterations{maxIterations}, arg{arg}, itemsProcessed{0}, bytesProcessed{0},
+    errorOccurred{false}, timerRunning{false}, cpuStart{0}, realSeconds{0.0}, cpuSeconds{0.0} {}
+
+bool BenchmarkState::Iterator::operator!=(const Iterator &other) const
+{
+    if(remaining != other.remaining) { return true; }
+    /* Loop is about to finish -> stop measuring before leaving the benchmark body */
+    state->stopTimer();
+    return false;
+}
+
+void BenchmarkState::Iterator::operator++() { remaining--; }
+
+BenchmarkState::Iterator BenchmarkState::begin()
+{
+    startTimer();
+    return Iterator{this, errorOccurred ? 0 : maxIterations};
+}
+
+BenchmarkState::Iterator BenchmarkState::end() { return Iterator{this, 0}; }
+
+void BenchmarkState::startTimer()
+{
+    if(timerRunning) { return; }
+    timerRunning = true;
+    realStart = std::chrono::high_resolution_clock::now();
+    cpuStart = std::clock();
+}
+
+void BenchmarkState::stopTimer()
+{
+    if(!timerRunning) { return; }
+    timerRunning = false;
+    realSeconds += std::chrono::duration<double, std::chrono::seconds::period>(
+        std::chrono::high_resolution_clock::now() - realStart).count();
+    cpuSeconds += double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+}
+
+void BenchmarkState::pauseTiming() { stopTimer(); }
+void BenchmarkState::resumeTiming() { startTimer(); }
+
+void BenchmarkState::skipWithError(const std::string &message)
+{
+    errorOccurred = true;
+    errorMessage = message;
+    maxIterations = 0;
+}
+
+void BenchmarkState::setItemsProcessed(int64_t items) { itemsProcessed = items; }
+void BenchmarkState::setBytesProcessed(int64_t bytes) { bytesProcessed = bytes; }
+int64_t BenchmarkState::range() const { return arg; }
+int64_t BenchmarkState::iterations() const { return maxIterations; }
+#pragma endregion benchmarkState
+
+#pragma region registration
+static std::vector<std::unique_ptr<Benchmark>> &getRegisteredBenchmarks()
+{
+    static std::vector<std::unique_ptr<Benchmark>> benchmarks;
+    return benchmarks;
+}
+
+Benchmark::Benchmark(const std::string &name, BenchmarkFunction function) :
+    name{name}, function{function} {}
+
+Benchmark *Benchmark::arg(int64_t value)
+{
+    args.push_back(value);
+    return this;
+}
+
+Benchmark *registerBenchmark(const std::string &name, BenchmarkFunction function)
+{
+    getRegisteredBenchmarks().push_back(std::make_unique<Benchmark>(name, function));
+    return getRegisteredBenchmarks().back().get();
+}
+#pragma endregion registration
+
+struct BenchmarkResult
+{
+    std::string name;
+    int64_t iterations;
+    double realTimeNs;
+    double cpuTimeNs;
+    double itemsPerSecond;
+    double bytesPerSecond;
+    bool errorOccurred;
+    std::string errorMessage;
+};
+
+class BenchmarkRunner
+{
+    public:
+        static BenchmarkResult run(const Benchmark &benchmark, const std::string &name,
+            int64_t arg, double minTime)
+        {
+            int64_t iterations = 1;
+            while(true)
+            {
+                BenchmarkState state(iterations, arg);
+                benchmark.function(state);
+
+                /* Scale iteration count until the run is long enough to be meaningful,
+                   same heuristic as Google Benchmark -> predict and overshoot by 40% */
+                bool finished = state.errorOccurred || state.realSeconds >= minTime ||
+                    iterations >= 1000000000;
+                if(finished)
+                {
+                    BenchmarkResult result{};
+                    result.name = name;
+                    result.iterations = iterations;
+                    result.errorOccurred = state.errorOccurred;
+                    result.errorMessage = state.errorMessage;
+                    if(!state.errorOccurred)
+                    {
+                        result.realTimeNs = state.realSeconds * 1e9 / iterations;
+                        result.cpuTimeNs = state.cpuSeconds * 1e9 / iterations;
+                        double seconds = std::max(state.realSeconds, 1e-12);
+                        result.itemsPerSecond = state.itemsProcessed / seconds;
+                        result.bytesPerSecond = state.bytesProcessed / seconds;
+                    }
+                    return result;
+                }
+
+                double multiplier = state.realSeconds <= minTime / 10.0 ? 10.0 :
+                    minTime * 1.4 / std::max(state.realSeconds, 1e-9);
+                iterations = std::max(iterations + 1, static_cast<int64_t>(iterations * multiplier));
+            }
+        }
+};
+
+static std::string escapeJSON(const std::string &value)
+{
+    std::string escaped;
+    for(char c : value)
+    {
+        if(c == '"' || c == '\\') { escaped += '\\'; }
+        escaped += c;
+    }
+    return escaped;
+}
+
+static void writeJSON(std::ostream &out, const std::vector<BenchmarkResult> &results,
+    const std::string &executable)
+{
+    std::time_t now = std::time(nullptr);
+    char date[64];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    out << "{\n";
+    out << "  \"context\": {\n";
+    out << "    \"date\": \"" << date << "\",\n";
+    out << "    \"executable\": \"" << escapeJSON(executable) << "\",\n";
+    out << "    \"project_version\": \"" << ATMOSPHERE_VERSION << "\",\n";
+    out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+    out << "    \"library_build_type\": \"release\"\n";
+#else
+    out << "    \"library_build_type\": \"debug\"\n";
+#endif
+    out << "  },\n";
+    out << "  \"benchmarks\": [\n";
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        const BenchmarkResult &result = results[i];
+        out << "    {\n";
+        out << "      \"name\": \"" << escapeJSON(result.name) << "\",\n";
+        out << "      \"run_name\": \"" << escapeJSON(result.name) << "\",\n";
+        out << "      \"run_type\": \"iteration\",\n";
+        if(result.errorOccurred)
+        {
+            out << "      \"error_occurred\": true,\n";
+            out << "      \"error_message\": \"" << escapeJSON(result.errorMessage) << "\"\n";
+        } else {
+            out << std::setprecision(10);
+            out << "      \"iterations\": " << result.iterations << ",\n";
+            out << "      \"real_time\": " << result.realTimeNs << ",\n";
+            out << "      \"cpu_time\": " << result.cpuTimeNs << ",\n";
+            out << "      \"time_unit\": \"ns\"";
+            if(result.itemsPerSecond > 0.0)
+            {
+                out << ",\n      \"items_per_second\": " << result.itemsPerSecond;
+            }
+            if(result.bytesPerSecond > 0.0)
+            {
+                out << ",\n      \"bytes_per_second\": " << result.bytesPerSecond;
+            }
+            out << "\n";
+        }
+        out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void writeConsole(std::ostream &out, const BenchmarkResult &result)
+{
+    out << std::left << std::setw(48) << result.name;
+    if(result.errorOccurred)
+    {
+        out << "ERROR OCCURRED: '" << result.errorMessage << "'" << std::endl;
+        return;
+    }
+    out << std::right << std::fixed << std::setprecision(0)
+        << std::setw(14) << result.realTimeNs << " ns"
+        << std::setw(14) << result.cpuTimeNs << " ns"
+        << std::setw(12) << result.iterations;
+    if(result.itemsPerSecond > 0.0)
+    {
+        out << std::setprecision(3) << "  items_per_second=" << result.itemsPerSecond / 1e6 << "M/s";
+    }
+    if(result.bytesPerSecond > 0.0)
+    {
+        out << std::setprecision(3) << "  bytes_per_second=" << result.bytesPerSecond / (1024.0 * 1024.0) << "MiB/s";
+    }
+    out << std::defaultfloat << std::endl;
+}
+
+int runBenchmarks(int argc, char **argv)
+{
+    std::string filter = ".*";
+    std::string format = "console";
+    std::string outPath;
+    double minTime = 0.5;
+
+    for(int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        auto value = [&](const std::string &flag) { return argument.substr(flag.size()); };
+        if(argument.rfind("--benchmark_filter=", 0) == 0) { filter = value("--benchmark_filter="); }
+        else if(argument.rfind("--benchmark_format=", 0) == 0) { format = value("--benchmark_format="); }
+        else if(argument.rfind("--benchmark_out=", 0) == 0) { outPath = value("--benchmark_out="); }
+        else if(argument.rfind("--benchmark_min_time=", 0) == 0) { minTime = std::stod(value("--benchmark_min_time=")); }
+        else
+        {
+            std::cerr << "BENCHMARK::RUN::Unknown argument " << argument << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if(format != "console" && format != "json")
+    {
+        std::cerr << "BENCHMARK::RUN::Unknown format " << format << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::regex filterRegex(filter);
+    std::vector<BenchmarkResult> results;
+    bool consoleOutput = format == "console";
+    if(consoleOutput)
+    {
+        std::cout << std::left << std::setw(48) << "Benchmark" << std::right
+                  << std::setw(17) << "Time" << std::setw(17) << "CPU"
+                  << std::setw(12) << "Iterations" << std::endl;
+        std::cout << std::string(94, '-') << std::endl;
+    }
+
+    for(const auto &benchmark : getRegisteredBenchmarks())
+    {
+        std::vector<int64_t> args = benchmark->args;
+        bool hasArgs = !args.empty();
+        if(!hasArgs) { args.push_back(0); }
+
+        for(int64_t arg : args)
+        {
+            std::string name = hasArgs ? benchmark->name + "/" + std::to_string(arg) : benchmark->name;
+            if(!std::regex_search(name, filterRegex)) { continue; }
+
+            BenchmarkResult result;
+            try
+            {
+                result = BenchmarkRunner::run(*benchmark, name, arg, minTime);
+            }
+            catch(const std::exception &e)
+            {
+                result = BenchmarkResult{};
+                result.name = name;
+                result.errorOccurred = true;
+                result.errorMessage = e.what();
+            }
+            if(consoleOutput) { writeConsole(std::cout, result); }
+            results.push_back(result);
+        }
+    }
+
+    if(!consoleOutput) { writeJSON(std::cout, results, argv[0]); }
+    if(!outPath.empty())
+    {
+        std::ofstream outFile(outPath);
+        if(!outFile)
+        {
+            std::cerr << "BENCHMARK::RUN::Failed to open " << outPath << std::endl;
+            return EXIT_FAILURE;
+        }
+        writeJSON(outFile, results, argv[0]);
+    }
+    return EXIT_SUCCESS;
+}
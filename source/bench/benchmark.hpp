@@ -0,0 +1,104 @@
+#pragma once
+
+/* Minimal Google Benchmark style harness -> cases are registered with BENCHMARK(func),
+   the body loops over "for(auto _ : state)" and the results can be written out in the
+   same JSON schema Google Benchmark uses (--benchmark_format=json, --benchmark_out=file)
+   so existing tooling for comparing runs can be used on the output */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <functional>
+
+class BenchmarkState
+{
+    public:
+        BenchmarkState(int64_t maxIterations, int64_t arg);
+
+        struct Iterator
+        {
+            BenchmarkState *state;
+            int64_t remaining;
+
+            bool operator!=(const Iterator &other) const;
+            void operator++();
+            int operator*() const { return 0; }
+        };
+
+        Iterator begin();
+        Iterator end();
+
+        /* Exclude per iteration setup from the measurement */
+        void pauseTiming();
+        void resumeTiming();
+        void skipWithError(const std::string &message);
+
+        void setItemsProcessed(int64_t items);
+        void setBytesProcessed(int64_t bytes);
+
+        int64_t range() const;
+        int64_t iterations() const;
+
+    private:
+        friend class BenchmarkRunner;
+
+        int64_t maxIterations;
+        int64_t arg;
+        int64_t itemsProcessed;
+        int64_t bytesProcessed;
+        bool errorOccurred;
+        std::string errorMessage;
+
+        bool timerRunning;
+        std::chrono::high_resolution_clock::time_point realStart;
+        std::clock_t cpuStart;
+        double realSeconds;
+        double cpuSeconds;
+
+        void startTimer();
+        void stopTimer();
+};
+
+using BenchmarkFunction = std::function<void(BenchmarkState &)>;
+
+class Benchmark
+{
+    public:
+        std::string name;
+        BenchmarkFunction function;
+        std::vector<int64_t> args;
+
+        Benchmark(const std::string &name, BenchmarkFunction function);
+        /* Register one more run of the benchmark with state.range() equal to value */
+        Benchmark *arg(int64_t value);
+};
+
+Benchmark *registerBenchmark(const std::string &name, BenchmarkFunction function);
+
+/**
+ * Parse command line and run all registered benchmarks
+ * supported flags: --benchmark_filter=<regex> --benchmark_min_time=<seconds>
+ *      --benchmark_format=<console|json> --benchmark_out=<file>
+ * @return process exit code
+ */
+int runBenchmarks(int argc, char **argv);
+
+/* Prevent the compiler from optimizing away computation of value */
+template <typename T>
+inline void doNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+#define BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_IMPL(a, b)
+#define BENCHMARK(func) \
+    static Benchmark *BENCHMARK_CONCAT(benchmark_registration_, __LINE__) = \
+        registerBenchmark(#func, func)
@@ -0,0 +1,470 @@
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+
+#include "cpu_cloud_raymarcher.hpp"
+#include "tinyexr.h"
+
+#include <glm/gtc/packing.hpp>
+
+/* One unit in global space should be 100 meters in camera coords */
+static const float cameraScale = 0.1f;
+
+#pragma region commonFunc
+/* Straight ports of shaders/common_func.glsl, kept in float to match the GPU */
+static float safeSqrt(float x)
+{
+    return std::sqrt(std::max(0.0f, x));
+}
+
+static float raySphereIntersectNearest(glm::vec3 r0, glm::vec3 rd, glm::vec3 s0, float sR)
+{
+    float a = glm::dot(rd, rd);
+    glm::vec3 s0_r0 = r0 - s0;
+    float b = 2.0f * glm::dot(rd, s0_r0);
+    float c = glm::dot(s0_r0, s0_r0) - (sR * sR);
+    float delta = b * b - 4.0f * a * c;
+    if (delta < 0.0f || a == 0.0f)
+    {
+        return -1.0f;
+    }
+    float sol0 = (-b - safeSqrt(delta)) / (2.0f * a);
+    float sol1 = (-b + safeSqrt(delta)) / (2.0f * a);
+    if (sol0 < 0.0f && sol1 < 0.0f)
+    {
+        return -1.0f;
+    }
+    if (sol0 < 0.0f)
+    {
+        return std::max(0.0f, sol1);
+    }
+    else if (sol1 < 0.0f)
+    {
+        return std::max(0.0f, sol0);
+    }
+    return std::max(0.0f, std::min(sol0, sol1));
+}
+
+static glm::vec2 transmittanceLUTParamsToUv(glm::vec2 parameters, glm::vec2 atmosphereBoundaries)
+{
+    float H = safeSqrt(
+          atmosphereBoundaries.y * atmosphereBoundaries.y
+        - atmosphereBoundaries.x * atmosphereBoundaries.x);
+
+    float rho = safeSqrt(parameters.x * parameters.x -
+        atmosphereBoundaries.x * atmosphereBoundaries.x);
+
+    float discriminant = parameters.x * parameters.x * (parameters.y * parameters.y - 1.0f) +
+        atmosphereBoundaries.y * atmosphereBoundaries.y;
+    /* Distance to top atmosphere boundary */
+    float d = std::max(0.0f, (-parameters.x * parameters.y + safeSqrt(discriminant)));
+
+    float d_min = atmosphereBoundaries.y - parameters.x;
+    float d_max = rho + H;
+    float mu = (d - d_min) / (d_max - d_min);
+    float r = rho / H;
+
+    return glm::vec2(mu, r);
+}
+
+// Henyey-Greenstein
+static float hg(float a, float g)
+{
+    float g2 = g * g;
+    return (1.0f - g2) / (4.0f * 3.1415f * std::pow(1.0f + g2 - 2.0f * g * a, 1.5f));
+}
+#pragma endregion commonFunc
+
+glm::vec4 CPUNoiseVolume::sample(glm::vec3 uvw) const
+{
+    /* Texel centers are at (i + 0.5) / dimension, same as with unnormalized
+       coordinates disabled on the GPU sampler */
+    glm::vec3 texelPos = uvw * glm::vec3(dimensions) - glm::vec3(0.5f);
+    glm::vec3 base = glm::floor(texelPos);
+    glm::vec3 t = texelPos - base;
+
+    glm::ivec3 c0 = glm::ivec3(base);
+    glm::ivec3 c1 = c0 + glm::ivec3(1);
+
+    auto wrap = [](int coord, int size) { int m = coord % size; return m < 0 ? m + size : m; };
+    c0 = glm::ivec3(wrap(c0.x, dimensions.x), wrap(c0.y, dimensions.y), wrap(c0.z, dimensions.z));
+    c1 = glm::ivec3(wrap(c1.x, dimensions.x), wrap(c1.y, dimensions.y), wrap(c1.z, dimensions.z));
+
+    auto fetch = [&](int x, int y, int z) -> const glm::vec4&
+    {
+        return texels[x + dimensions.x * (y + z * dimensions.y)];
+    };
+
+    glm::vec4 x00 = glm::mix(fetch(c0.x, c0.y, c0.z), fetch(c1.x, c0.y, c0.z), t.x);
+    glm::vec4 x10 = glm::mix(fetch(c0.x, c1.y, c0.z), fetch(c1.x, c1.y, c0.z), t.x);
+    glm::vec4 x01 = glm::mix(fetch(c0.x, c0.y, c1.z), fetch(c1.x, c0.y, c1.z), t.x);
+    glm::vec4 x11 = glm::mix(fetch(c0.x, c1.y, c1.z), fetch(c1.x, c1.y, c1.z), t.x);
+
+    glm::vec4 y0 = glm::mix(x00, x10, t.y);
+    glm::vec4 y1 = glm::mix(x01, x11, t.y);
+    return glm::mix(y0, y1, t.z);
+}
+
+CPUCloudRaymarcher::CPUCloudRaymarcher(CPUCloudRaymarcherSettings settings) :
+    settings{settings}, threadPool{settings.threadCount}
+{
+    if(settings.tileSize == 0 || settings.sampleCountMultiplier == 0 || settings.samplesPerPixel == 0)
+    {
+        throw std::runtime_error("CPU_CLOUD_RAYMARCHER::CONSTRUCTOR::Invalid settings");
+    }
+}
+
+std::vector<glm::vec4> CPUCloudRaymarcher::render(const CPUCloudRaymarcherInputs &inputs)
+{
+    if(!inputs.shapeNoise || !inputs.detailNoise)
+    {
+        throw std::runtime_error("CPU_CLOUD_RAYMARCHER::RENDER::Missing noise volumes");
+    }
+    if(!inputs.depth.empty() && inputs.depth.size() != inputs.extent.x * inputs.extent.y)
+    {
+        throw std::runtime_error("CPU_CLOUD_RAYMARCHER::RENDER::Depth buffer does not match extent");
+    }
+
+    CPUCloudRaymarcherInputs scaledInputs = inputs;
+    scaledInputs.cloudsParams.sampleCount *= settings.sampleCountMultiplier;
+    scaledInputs.cloudsParams.sampleCountToSun *= settings.sampleCountMultiplier;
+
+    glm::mat4 invViewProjMat = glm::inverse(inputs.proj * inputs.view);
+
+    std::vector<glm::vec4> image(inputs.extent.x * inputs.extent.y);
+    glm::uvec2 tileCount = (inputs.extent + glm::uvec2(settings.tileSize - 1)) / settings.tileSize;
+
+    threadPool.run(tileCount.x * tileCount.y, [&](uint32_t tile)
+    {
+        glm::uvec2 tileStart = glm::uvec2(tile % tileCount.x, tile / tileCount.x) * settings.tileSize;
+        glm::uvec2 tileEnd = glm::min(tileStart + glm::uvec2(settings.tileSize), inputs.extent);
+
+        for(uint32_t y = tileStart.y; y < tileEnd.y; y++)
+        {
+            for(uint32_t x = tileStart.x; x < tileEnd.x; x++)
+            {
+                uint32_t pixelIndex = x + y * inputs.extent.x;
+                float depth = inputs.depth.empty() ? 1.0f : inputs.depth[pixelIndex];
+
+                /* Stratified subpixel positions, single sample lands on the pixel center
+                   same as the fragment shader invocation */
+                uint32_t strata = static_cast<uint32_t>(std::ceil(std::sqrt(float(settings.samplesPerPixel))));
+                glm::vec4 accumColor = glm::vec4(0.0f);
+                for(uint32_t s = 0; s < settings.samplesPerPixel; s++)
+                {
+                    glm::vec2 subPixel = (glm::vec2(s % strata, s / strata) + glm::vec2(0.5f)) / float(strata);
+                    glm::vec2 uv = (glm::vec2(x, y) + subPixel) / glm::vec2(inputs.extent);
+                    /* Every subsample advances the jitter sequence as if it was the next frame */
+                    float jitter = getAnimatedBlueNoise(inputs, glm::uvec2(x, y), inputs.frameIndex + s);
+                    accumColor += shadePixel(scaledInputs, invViewProjMat, uv, depth, jitter);
+                }
+                image[pixelIndex] = accumColor / float(settings.samplesPerPixel);
+            }
+        }
+    });
+
+    return image;
+}
+
+float CPUCloudRaymarcher::phase(const CPUCloudRaymarcherInputs &inputs, float a) const
+{
+    glm::vec4 phaseParams = inputs.cloudsParams.phaseParams;
+    float blend = phaseParams.w;
+    float hgBlend = hg(a, phaseParams.x) * (1.0f - blend) + hg(a, -phaseParams.y) * blend;
+    return phaseParams.z + hgBlend;
+}
+
+float CPUCloudRaymarcher::getCloudsCoverage(const CPUCloudRaymarcherInputs &inputs,
+    glm::vec3 samplePos) const
+{
+    if(inputs.coverageMap.empty()) { return 1.0f; }
+
+    const CloudsParametersBuffer &params = inputs.cloudsParams;
+    const float baseScale = 1.0f / 1000.0f;
+    int size = inputs.coverageMapSize;
+    /* Bilinear filtering with repeat addressing, same as textureLod on level 0 */
+    glm::vec2 texelPos = glm::vec2(samplePos) * baseScale * params.coverageScale * float(size) -
+        glm::vec2(0.5f);
+    glm::vec2 base = glm::floor(texelPos);
+    glm::vec2 t = texelPos - base;
+
+    auto wrap = [size](int coord) { int m = coord % size; return m < 0 ? m + size : m; };
+    int x0 = wrap(int(base.x)), x1 = wrap(int(base.x) + 1);
+    int y0 = wrap(int(base.y)), y1 = wrap(int(base.y) + 1);
+    auto fetch = [&](int x, int y) { return inputs.coverageMap[x + y * size] / 255.0f; };
+
+    float coverage = glm::mix(glm::mix(fetch(x0, y0), fetch(x1, y0), t.x),
+        glm::mix(fetch(x0, y1), fetch(x1, y1), t.x), t.y);
+    float threshold = params.coverageThreshold;
+    return glm::clamp((coverage - threshold) / std::max(1.0f - threshold, 0.001f), 0.0f, 1.0f);
+}
+
+float CPUCloudRaymarcher::sampleDensity(const CPUCloudRaymarcherInputs &inputs,
+    glm::vec3 samplePos, float distFactor) const
+{
+    float coverage = getCloudsCoverage(inputs, samplePos);
+    if(coverage <= 0.0f) { return 0.0f; }
+
+    const CloudsParametersBuffer &params = inputs.cloudsParams;
+    const float bottomRadius = inputs.atmoParams.bottom_radius;
+
+    const float baseScale = 1.0f / 1000.0f;
+    glm::vec3 uvw = samplePos * baseScale * params.cloudsScale;
+
+    float heightGradient = 1.0f;
+    float heightAboveGround = glm::length((samplePos * cameraScale) +
+        glm::vec3(0.0f, 0.0f, bottomRadius)) - bottomRadius;
+
+    if(params.debug == 1)
+    {
+        const float a = params.minBounds;
+        const float h = params.maxBounds;
+        heightGradient = (heightAboveGround - a) * (heightAboveGround - h - a) * (-4.0f / (h * h));
+    }
+
+    glm::vec4 shapeNoise = inputs.shapeNoise->sample(uvw);
+    glm::vec4 normalizedShapeWeights = glm::normalize(params.shapeNoiseWeights);
+    float shapeFBM = glm::dot(shapeNoise, normalizedShapeWeights);
+    float baseShapeDensity = (shapeFBM - std::min(params.densityOffset + distFactor, 1.0f)) * coverage;
+    if(baseShapeDensity > 0.0f)
+    {
+        glm::vec3 detailSamplePos = uvw * params.detailScale;
+        glm::vec4 detailNoise = inputs.detailNoise->sample(detailSamplePos);
+        glm::vec4 normalizedDetailWeights = glm::normalize(params.detailNoiseWeights);
+        float detailFBM = glm::dot(detailNoise, normalizedDetailWeights);
+
+        float oneMinusShape = 1.0f - baseShapeDensity;
+        float detailErodeWeight = oneMinusShape * oneMinusShape * oneMinusShape;
+
+        float cloudDensity = baseShapeDensity - (1.0f - detailFBM) * detailErodeWeight * params.detailNoiseMultiplier;
+        return cloudDensity * params.densityMultiplier * 4.9f * heightGradient;
+    }
+    return 0.0f;
+}
+
+glm::vec2 CPUCloudRaymarcher::getRayCloudLayerInfo(const CPUCloudRaymarcherInputs &inputs,
+    float cloudAltMin, float cloudAltMax, glm::vec3 position, glm::vec3 rayDirection) const
+{
+    const float bottomRadius = inputs.atmoParams.bottom_radius;
+    /* Get position offset by the radius of the planet */
+    glm::vec3 planetPosition = position + glm::vec3(0.0f, 0.0f, bottomRadius);
+    glm::vec2 cloudLayerBoundaries = glm::vec2(cloudAltMin, cloudAltMax) + glm::vec2(bottomRadius);
+
+    glm::vec2 result = glm::vec2(-1.0f, -1.0f);
+    glm::vec3 planet0 = glm::vec3(0.0f, 0.0f, 0.0f);
+    float bottomCID = raySphereIntersectNearest(
+        planetPosition, rayDirection, planet0, cloudLayerBoundaries.x);
+    float topCID = raySphereIntersectNearest(
+        planetPosition, rayDirection, planet0, cloudLayerBoundaries.y);
+    float groundCID = raySphereIntersectNearest(
+        planetPosition, rayDirection, planet0, bottomRadius);
+
+    float planetDistance = glm::length(planetPosition);
+    /* Above clouds */
+    if(planetDistance >= cloudLayerBoundaries.y)
+    {
+        if(topCID == -1.0f) { return result; }
+        if(bottomCID == -1.0f)
+        {
+            glm::vec3 newPosition = planetPosition + (topCID + 0.001f) * rayDirection;
+            float topCID2 = raySphereIntersectNearest(newPosition, rayDirection, planet0, cloudLayerBoundaries.y);
+            if(topCID2 == -1.0f) { return result; }
+            result.x = topCID;
+            result.y = topCID2 - topCID;
+            return result;
+        }
+        result.x = topCID;
+        result.y = bottomCID - topCID;
+        return result;
+    }
+    /* In clouds */
+    else if(planetDistance > cloudLayerBoundaries.x)
+    {
+        result.x = 0.0f;
+        if (topCID < 0.0f)         { result.y = bottomCID; }
+        else if (bottomCID < 0.0f) { result.y = topCID; }
+        else                       { result.y = std::min(topCID, bottomCID); }
+        return result;
+    }
+    /* Under clouds */
+    if(groundCID == -1.0f)
+    {
+        result.x = bottomCID;
+        result.y = topCID - bottomCID;
+    }
+    return result;
+}
+
+float CPUCloudRaymarcher::getCloudTransAlongRay(const CPUCloudRaymarcherInputs &inputs,
+    glm::vec3 startPos) const
+{
+    const CloudsParametersBuffer &params = inputs.cloudsParams;
+    glm::vec3 dirToLight = inputs.atmoParams.sunDirection;
+    float integrationLength = getRayCloudLayerInfo(inputs, params.minBounds, params.maxBounds,
+        startPos * cameraScale, dirToLight).y * 1.0f / cameraScale;
+
+    integrationLength = std::min(integrationLength, 20.0f);
+
+    float totalDensity = 0.0f;
+    for(int i = 0; i < params.sampleCountToSun; i++)
+    {
+        float step_0 = float(i) / params.sampleCountToSun;
+        float step_1 = float(i + 1) / params.sampleCountToSun;
+
+        step_0 *= step_0;
+        step_1 *= step_1;
+
+        step_0 = step_0 * integrationLength;
+        step_1 = step_1 > 1.0f ? integrationLength : step_1 * integrationLength;
+
+        float newRayShift = step_0 + (step_1 - step_0) * 0.3f;
+        float integrationStep = step_1 - step_0;
+        glm::vec3 newPos = startPos + newRayShift * dirToLight;
+
+        totalDensity += std::max(0.0f, sampleDensity(inputs, newPos, 0.0f) * integrationStep);
+    }
+
+    float transmittance = std::exp(-totalDensity * params.lightAbsTowardsSun);
+    return params.darknessThreshold + transmittance * (1.0f - params.darknessThreshold);
+}
+
+glm::vec3 CPUCloudRaymarcher::loadTransmittanceLUT(const CPUCloudRaymarcherInputs &inputs,
+    glm::vec3 position) const
+{
+    if(inputs.transmittanceLUT.empty()) { return glm::vec3(1.0f); }
+
+    const AtmosphereParametersBuffer &atmo = inputs.atmoParams;
+    glm::vec3 realWorldPos = position * cameraScale + glm::vec3(0.0f, 0.0f, atmo.bottom_radius);
+    float height = glm::length(realWorldPos);
+    glm::vec3 upVector = realWorldPos / height;
+    float viewZenithCosAngle = glm::dot(atmo.sunDirection, upVector);
+    glm::vec2 transLUTParams = glm::vec2(height, viewZenithCosAngle);
+    glm::vec2 atmosphereBoundaries = glm::vec2(atmo.bottom_radius, atmo.top_radius);
+    glm::vec2 transUV = transmittanceLUTParamsToUv(transLUTParams, atmosphereBoundaries);
+    glm::ivec2 transImageCoords = glm::ivec2(transUV * atmo.TransmittanceTexDimensions);
+
+    /* imageLoad returns zero for out of bounds coordinates */
+    glm::ivec2 dimensions = glm::ivec2(atmo.TransmittanceTexDimensions);
+    if(transImageCoords.x < 0 || transImageCoords.y < 0 ||
+       transImageCoords.x >= dimensions.x || transImageCoords.y >= dimensions.y)
+    {
+        return glm::vec3(0.0f);
+    }
+    return glm::vec3(inputs.transmittanceLUT[transImageCoords.x + transImageCoords.y * dimensions.x]);
+}
+
+float CPUCloudRaymarcher::getAnimatedBlueNoise(const CPUCloudRaymarcherInputs &inputs,
+    glm::uvec2 pixel, uint32_t frameIndex) const
+{
+    if(inputs.blueNoise.empty()) { return 0.0f; }
+
+    uint32_t mask = static_cast<uint32_t>(inputs.blueNoiseSize - 1);
+    float noise = inputs.blueNoise[(pixel.x & mask) + (pixel.y & mask) * inputs.blueNoiseSize] / 255.0f;
+    float value = noise + float(frameIndex % 256) * 0.61803398875f;
+    return value - std::floor(value);
+}
+
+glm::vec4 CPUCloudRaymarcher::shadePixel(const CPUCloudRaymarcherInputs &inputs,
+    const glm::mat4 &invViewProjMat, glm::vec2 uv, float depth, float jitter) const
+{
+    const CloudsParametersBuffer &params = inputs.cloudsParams;
+    /* Camera position in world space */
+    glm::vec3 cameraPosition = inputs.atmoParams.cameraPosition;
+
+    /* Vulkans clip space range [-1, -1] - (1, 1) -> z is depth [0, 1] */
+    glm::vec3 clipSpace = glm::vec3(uv * 2.0f - glm::vec2(1.0f), depth);
+    glm::vec4 hPos = invViewProjMat * glm::vec4(clipSpace, 1.0f);
+    /* Get unit lenght ray from camera origin to processed fragment in world space */
+    glm::vec3 cameraRayWorld = glm::normalize(glm::vec3(hPos) / hPos.w - cameraPosition);
+
+    /* Get depth in world space */
+    float realDepth = glm::length(glm::vec3(hPos) / hPos.w - cameraPosition);
+
+    float sunRayCosAngle = glm::dot(cameraRayWorld, inputs.atmoParams.sunDirection);
+    float phaseValue = phase(inputs, sunRayCosAngle);
+
+    glm::vec2 rayToCloudLayerInfo = getRayCloudLayerInfo(inputs, params.minBounds,
+        params.maxBounds, cameraPosition * cameraScale, cameraRayWorld);
+    float distanceToCloudBB = rayToCloudLayerInfo.x * 1.0f / cameraScale;
+    float distanceInsideCloudBB = rayToCloudLayerInfo.y * 1.0f / cameraScale;
+
+    float integrationLength = std::min(realDepth - distanceToCloudBB, distanceInsideCloudBB);
+    if(integrationLength <= 0.0f)
+    {
+        return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    float offset = jitter * integrationLength / params.sampleCount;
+    /* Offset to start raymarch at the start of the cloud layer */
+    glm::vec3 startPosition = cameraPosition + (distanceToCloudBB + offset) * cameraRayWorld;
+    integrationLength -= glm::length(offset * cameraRayWorld);
+
+    float oldRayShift = 0.0f;
+    float transmittance = 1.0f;
+    glm::vec3 lightEnergy = glm::vec3(0.0f);
+    for(int i = 0; i < params.sampleCount; i++)
+    {
+        if(transmittance < 0.01f)
+        {
+            break;
+        }
+        float newRayShift = integrationLength * (float(i) + 0.3f) / params.sampleCount;
+        float integrationStep = newRayShift - oldRayShift;
+        glm::vec3 newPos = startPosition + newRayShift * cameraRayWorld;
+        oldRayShift = newRayShift;
+
+        float density = sampleDensity(inputs, newPos, 0.0f);
+        if(density > 0.0f)
+        {
+            float transmittanceToSun = getCloudTransAlongRay(inputs, newPos);
+
+            float transIncreseOverInegrationStep = std::exp(-density * integrationStep * params.lightAbsThroughCloud);
+            float powderTransmittanceIncOverIntStep = std::exp(-density * integrationStep * params.lightAbsThroughCloud * 2.0f);
+            float sunLight = transmittanceToSun * phaseValue * density;
+            float sunLightInt = (sunLight - sunLight * transIncreseOverInegrationStep * powderTransmittanceIncOverIntStep) / density;
+
+            lightEnergy += sunLightInt * transmittance * loadTransmittanceLUT(inputs, newPos);
+
+            transmittance *= transIncreseOverInegrationStep * powderTransmittanceIncOverIntStep;
+        }
+    }
+
+    glm::vec3 cloudCol = lightEnergy * 0.05f;
+    float transmittanceDistIncr = glm::clamp((distanceToCloudBB - params.farFadeStart) /
+        glm::max(params.farFadeLength, 1.0f), 0.0f, 1.0f);
+    transmittance = glm::clamp(transmittance + transmittanceDistIncr, 0.0f, 1.0f);
+    cloudCol *= 1.0f - transmittanceDistIncr;
+
+    return glm::vec4(cloudCol, transmittance);
+}
+
+void CPUCloudRaymarcher::saveEXR(const std::string &path, const std::vector<glm::vec4> &image,
+    glm::uvec2 extent)
+{
+    const char *err = nullptr;
+    int ret = SaveEXR(&image[0].x, extent.x, extent.y, 4, 0, path.c_str(), &err);
+    if(ret != TINYEXR_SUCCESS)
+    {
+        if(err)
+        {
+            std::cout << "err: " << std::string(err) << std::endl;
+            FreeEXRErrorMessage(err);
+        }
+        throw std::runtime_error("CPU_CLOUD_RAYMARCHER::SAVE_EXR::Failed to save exr image");
+    }
+}
+
+std::vector<glm::vec4> unpackHalfTexels(const uint16_t *data, size_t texelCount)
+{
+    std::vector<glm::vec4> texels(texelCount);
+    for(size_t i = 0; i < texelCount; i++)
+    {
+        texels[i] = glm::vec4(
+            glm::unpackHalf1x16(data[i * 4 + 0]),
+            glm::unpackHalf1x16(data[i * 4 + 1]),
+            glm::unpackHalf1x16(data[i * 4 + 2]),
+            glm::unpackHalf1x16(data[i * 4 + 3]));
+    }
+    return texels;
+}
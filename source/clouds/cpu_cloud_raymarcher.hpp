@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "vulkan/buffer_defines.hpp"
+#include "model/sky_model.hpp"
+#include "tile_thread_pool.hpp"
+
+/* CPU copy of one of the RGBA Worley noise volumes, sampled the same way the
+   cloudsSampler samples it on the GPU -> linear filtering with repeat addressing */
+struct CPUNoiseVolume
+{
+    glm::ivec3 dimensions;
+    std::vector<glm::vec4> texels;
+
+    glm::vec4 sample(glm::vec3 uvw) const;
+};
+
+/* Everything raymarchClouds in clouds_raymarch.glsl reads from its descriptor sets */
+struct CPUCloudRaymarcherInputs
+{
+    glm::uvec2 extent;
+    glm::mat4 view;
+    glm::mat4 proj;
+    CloudsParametersBuffer cloudsParams;
+    AtmosphereParametersBuffer atmoParams;
+
+    const CPUNoiseVolume *shapeNoise;
+    const CPUNoiseVolume *detailNoise;
+    /* Row major TransmittanceTexDimensions texels, when empty atmosphere
+       transmittance towards the sun is treated as 1.0 */
+    std::vector<glm::vec4> transmittanceLUT;
+    /* Row major extent sized depth buffer, when empty every pixel is at the far plane */
+    std::vector<float> depth;
+    /* Row major blueNoiseSize^2 UNORM8 texels jittering the ray start the same way
+       blue_noise.glsl does, when empty the rays are not jittered */
+    std::vector<uint8_t> blueNoise;
+    int blueNoiseSize;
+    uint32_t frameIndex;
+    /* Row major coverageMapSize^2 UNORM8 level 0 of the clouds coverage map, when
+       empty the coverage is 1.0 everywhere */
+    std::vector<uint8_t> coverageMap;
+    int coverageMapSize;
+};
+
+struct CPUCloudRaymarcherSettings
+{
+    uint32_t tileSize = 16;
+    /* 0 means hardware concurrency */
+    uint32_t threadCount = 0;
+    /* Offline reference mode -> both sampleCount and sampleCountToSun are multiplied
+       by sampleCountMultiplier and every pixel is supersampled samplesPerPixel times,
+       leaving both at 1 reproduces full resolution clouds_raymarch.glsl exactly */
+    uint32_t sampleCountMultiplier = 1;
+    uint32_t samplesPerPixel = 1;
+};
+
+/* Multithreaded C++ port of clouds_raymarch.glsl used to produce golden cloud images */
+class CPUCloudRaymarcher
+{
+    public:
+        CPUCloudRaymarcher(CPUCloudRaymarcherSettings settings);
+
+        /**
+         * Raymarch the clouds for every pixel of inputs.extent
+         * @return row major image, rgb is the cloud color, a is the transmittance
+         *      -> same as the result of raymarchClouds in clouds_raymarch.glsl
+         */
+        std::vector<glm::vec4> render(const CPUCloudRaymarcherInputs &inputs);
+
+        static void saveEXR(const std::string &path, const std::vector<glm::vec4> &image,
+            glm::uvec2 extent);
+
+    private:
+        CPUCloudRaymarcherSettings settings;
+        TileThreadPool threadPool;
+
+        glm::vec4 shadePixel(const CPUCloudRaymarcherInputs &inputs,
+            const glm::mat4 &invViewProjMat, glm::vec2 uv, float depth, float jitter) const;
+        float getAnimatedBlueNoise(const CPUCloudRaymarcherInputs &inputs, glm::uvec2 pixel,
+            uint32_t frameIndex) const;
+        float phase(const CPUCloudRaymarcherInputs &inputs, float a) const;
+        float getCloudsCoverage(const CPUCloudRaymarcherInputs &inputs, glm::vec3 samplePos) const;
+        float sampleDensity(const CPUCloudRaymarcherInputs &inputs, glm::vec3 samplePos,
+            float distFactor) const;
+        glm::vec2 getRayCloudLayerInfo(const CPUCloudRaymarcherInputs &inputs, float cloudAltMin,
+            float cloudAltMax, glm::vec3 position, glm::vec3 rayDirection) const;
+        float getCloudTransAlongRay(const CPUCloudRaymarcherInputs &inputs, glm::vec3 startPos) const;
+        glm::vec3 loadTransmittanceLUT(const CPUCloudRaymarcherInputs &inputs, glm::vec3 position) const;
+};
+
+/**
+ * Convert texels read back from a VK_FORMAT_R16G16B16A16_SFLOAT image
+ * @param data - packed half floats, four per texel
+ * @param texelCount - number of texels in data
+ */
+std::vector<glm::vec4> unpackHalfTexels(const uint16_t *data, size_t texelCount);
@@ -0,0 +1,91 @@
+#include <algorithm>
+
+#include "tile_thread_pool.hpp"
+
+TileThreadPool::TileThreadPool(uint32_t threadCount) : threadCount{threadCount}
+{
+    if(this->threadCount == 0)
+    {
+        this->threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    for(uint32_t i = 0; i < this->threadCount; i++)
+    {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+}
+
+void TileThreadPool::run(uint32_t tileCount, const std::function<void(uint32_t)> &job)
+{
+    for(uint32_t tile = 0; tile < tileCount; tile++)
+    {
+        queues[tile % threadCount]->tiles.push_back(tile);
+    }
+
+    std::mutex exceptionLock;
+    std::exception_ptr firstException = nullptr;
+
+    auto worker = [&](uint32_t workerIndex)
+    {
+        uint32_t tile;
+        /* No new tiles are ever produced while running -> when both our own queue
+           and all the other queues are empty the work is done */
+        while(popTile(workerIndex, tile) || stealTile(workerIndex, tile))
+        {
+            try
+            {
+                job(tile);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> guard(exceptionLock);
+                if(!firstException) { firstException = std::current_exception(); }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for(uint32_t i = 1; i < threadCount; i++)
+    {
+        workers.emplace_back(worker, i);
+    }
+    /* Calling thread takes part in the work as well */
+    worker(0);
+
+    for(auto &thread : workers)
+    {
+        thread.join();
+    }
+
+    if(firstException)
+    {
+        std::rethrow_exception(firstException);
+    }
+}
+
+bool TileThreadPool::popTile(uint32_t worker, uint32_t &tile)
+{
+    std::lock_guard<std::mutex> guard(queues[worker]->lock);
+    if(queues[worker]->tiles.empty()) { return false; }
+
+    tile = queues[worker]->tiles.back();
+    queues[worker]->tiles.pop_back();
+    return true;
+}
+
+bool TileThreadPool::stealTile(uint32_t thief, uint32_t &tile)
+{
+    for(uint32_t i = 1; i < threadCount; i++)
+    {
+        uint32_t victim = (thief + i) % threadCount;
+        std::lock_guard<std::mutex> guard(queues[victim]->lock);
+        if(queues[victim]->tiles.empty()) { continue; }
+
+        tile = queues[victim]->tiles.front();
+        queues[victim]->tiles.pop_front();
+        return true;
+    }
+    return false;
+}
+
+uint32_t TileThreadPool::getThreadCount() const { return threadCount; }
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <functional>
+#include <exception>
+
+/* Runs a fixed set of tiles on a group of worker threads. Tiles are dealt round robin
+   into per worker deques, each worker pops from the back of its own deque and once it
+   runs dry it steals from the front of the other workers deques -> a few expensive
+   tiles (f.e. dense clouds) don't leave the rest of the threads idle */
+class TileThreadPool
+{
+    public:
+        /**
+         * @param threadCount number of worker threads, 0 means hardware concurrency
+         */
+        TileThreadPool(uint32_t threadCount = 0);
+
+        /**
+         * Execute job for every tile in [0, tileCount) and block until all are finished
+         * -> first exception thrown by any of the jobs is rethrown here
+         */
+        void run(uint32_t tileCount, const std::function<void(uint32_t)> &job);
+
+        uint32_t getThreadCount() const;
+
+    private:
+        struct WorkerQueue
+        {
+            std::mutex lock;
+            std::deque<uint32_t> tiles;
+        };
+
+        uint32_t threadCount;
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+
+        bool popTile(uint32_t worker, uint32_t &tile);
+        bool stealTile(uint32_t thief, uint32_t &tile);
+};
@@ -0,0 +1,218 @@
+#include "height_pyramid.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+/* Range of texels of the finer level of extent childExtent covered by texel of the coarser level */
+static void getChildRange(uint32_t texel, uint32_t childExtent, uint32_t &begin, uint32_t &end)
+{
+    uint32_t extent = std::max(1u, childExtent / 2);
+    begin = 2 * texel;
+    end = texel == extent - 1 ? childExtent : 2 * texel + 2;
+}
+
+uint32_t getHeightMipCount(uint32_t width, uint32_t height)
+{
+    return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+void buildHeightMips(std::vector<float> &mipChain, uint32_t width, uint32_t height)
+{
+    if(width == 0 || height == 0 || mipChain.size() < size_t(width) * height)
+    {
+        throw std::runtime_error("HEIGHT_PYRAMID::BUILD_HEIGHT_MIPS::Invalid level 0");
+    }
+    mipChain.resize(size_t(width) * height);
+
+    uint32_t mipCount = getHeightMipCount(width, height);
+    size_t previousOffset = 0;
+    uint32_t previousWidth = width;
+    uint32_t previousHeight = height;
+    for(uint32_t mip = 1; mip < mipCount; mip++)
+    {
+        uint32_t mipWidth = std::max(1u, previousWidth / 2);
+        uint32_t mipHeight = std::max(1u, previousHeight / 2);
+        size_t offset = mipChain.size();
+        mipChain.resize(offset + size_t(mipWidth) * mipHeight);
+        for(uint32_t y = 0; y < mipHeight; y++)
+        {
+            uint32_t y0, y1;
+            getChildRange(y, previousHeight, y0, y1);
+            for(uint32_t x = 0; x < mipWidth; x++)
+            {
+                uint32_t x0, x1;
+                getChildRange(x, previousWidth, x0, x1);
+                float sum = 0.0f;
+                for(uint32_t childY = y0; childY < y1; childY++)
+                {
+                    for(uint32_t childX = x0; childX < x1; childX++)
+                    {
+                        sum += mipChain[previousOffset + size_t(childY) * previousWidth + childX];
+                    }
+                }
+                mipChain[offset + size_t(y) * mipWidth + x] = sum / float((y1 - y0) * (x1 - x0));
+            }
+        }
+        previousOffset = offset;
+        previousWidth = mipWidth;
+        previousHeight = mipHeight;
+    }
+}
+
+HeightPyramid::HeightPyramid(const float *heights, uint32_t width, uint32_t height) :
+    width{width}, height{height}
+{
+    if(width == 0 || height == 0)
+    {
+        throw std::runtime_error("HEIGHT_PYRAMID::HEIGHT_PYRAMID::Empty heightmap");
+    }
+
+    #pragma region firstLevel
+    glm::uvec2 extent = glm::uvec2(std::max(1u, width / 2), std::max(1u, height / 2));
+    extents.push_back(extent);
+    levels.emplace_back(size_t(extent.x) * extent.y);
+    for(uint32_t y = 0; y < extent.y; y++)
+    {
+        uint32_t y0, y1;
+        getChildRange(y, height, y0, y1);
+        for(uint32_t x = 0; x < extent.x; x++)
+        {
+            uint32_t x0, x1;
+            getChildRange(x, width, x0, x1);
+            glm::vec2 minMax = glm::vec2(INFINITY, -INFINITY);
+            for(uint32_t texelY = y0; texelY < y1; texelY++)
+            {
+                for(uint32_t texelX = x0; texelX < x1; texelX++)
+                {
+                    float texel = heights[size_t(texelY) * width + texelX];
+                    minMax.x = std::min(minMax.x, texel);
+                    minMax.y = std::max(minMax.y, texel);
+                }
+            }
+            levels[0][size_t(y) * extent.x + x] = minMax;
+        }
+    }
+    #pragma endregion firstLevel
+
+    #pragma region coarserLevels
+    while(extent.x > 1 || extent.y > 1)
+    {
+        glm::uvec2 childExtent = extent;
+        extent = glm::uvec2(std::max(1u, extent.x / 2), std::max(1u, extent.y / 2));
+        const std::vector<glm::vec2> &children = levels.back();
+        std::vector<glm::vec2> level(size_t(extent.x) * extent.y);
+        for(uint32_t y = 0; y < extent.y; y++)
+        {
+            uint32_t y0, y1;
+            getChildRange(y, childExtent.y, y0, y1);
+            for(uint32_t x = 0; x < extent.x; x++)
+            {
+                uint32_t x0, x1;
+                getChildRange(x, childExtent.x, x0, x1);
+                glm::vec2 minMax = glm::vec2(INFINITY, -INFINITY);
+                for(uint32_t childY = y0; childY < y1; childY++)
+                {
+                    for(uint32_t childX = x0; childX < x1; childX++)
+                    {
+                        glm::vec2 child = children[size_t(childY) * childExtent.x + childX];
+                        minMax.x = std::min(minMax.x, child.x);
+                        minMax.y = std::max(minMax.y, child.y);
+                    }
+                }
+                level[size_t(y) * extent.x + x] = minMax;
+            }
+        }
+        extents.push_back(extent);
+        levels.push_back(std::move(level));
+    }
+    #pragma endregion coarserLevels
+}
+
+HeightPyramid::HeightPyramid(uint32_t width, uint32_t height, uint32_t firstLevel,
+    std::vector<std::vector<glm::vec2>> levels) : width{width}, height{height}, firstLevel{firstLevel},
+    levels{std::move(levels)}
+{
+    glm::uvec2 extent = glm::uvec2(std::max(1u, width / 2), std::max(1u, height / 2));
+    extents.push_back(extent);
+    while(extent.x > 1 || extent.y > 1)
+    {
+        extent = glm::uvec2(std::max(1u, extent.x / 2), std::max(1u, extent.y / 2));
+        extents.push_back(extent);
+    }
+
+    if(width == 0 || height == 0 || firstLevel + this->levels.size() != extents.size())
+    {
+        throw std::runtime_error("HEIGHT_PYRAMID::HEIGHT_PYRAMID::Levels do not match the heightmap size");
+    }
+    for(uint32_t level = firstLevel; level < extents.size(); level++)
+    {
+        if(this->levels[level - firstLevel].size() != size_t(extents[level].x) * extents[level].y)
+        {
+            throw std::runtime_error("HEIGHT_PYRAMID::HEIGHT_PYRAMID::Levels do not match the heightmap size");
+        }
+    }
+}
+
+glm::vec2 HeightPyramid::getRange(glm::ivec2 texelMin, glm::ivec2 texelMax) const
+{
+    glm::ivec2 maxTexel = glm::ivec2(width - 1, height - 1);
+    glm::uvec2 rectMin = glm::uvec2(glm::clamp(glm::min(texelMin, texelMax), glm::ivec2(0), maxTexel));
+    glm::uvec2 rectMax = glm::uvec2(glm::clamp(glm::max(texelMin, texelMax), glm::ivec2(0), maxTexel));
+
+    /* Finest level where the rectangle spans at most 4x4 texels, the top level is a single texel */
+    for(uint32_t level = firstLevel; level < extents.size(); level++)
+    {
+        uint32_t shift = level + 1;
+        glm::uvec2 last = extents[level] - glm::uvec2(1);
+        glm::uvec2 begin = glm::min(rectMin >> shift, last);
+        glm::uvec2 end = glm::min(rectMax >> shift, last);
+        if(end.x - begin.x >= 4 || end.y - begin.y >= 4)
+        {
+            continue;
+        }
+
+        glm::vec2 minMax = glm::vec2(INFINITY, -INFINITY);
+        for(uint32_t y = begin.y; y <= end.y; y++)
+        {
+            for(uint32_t x = begin.x; x <= end.x; x++)
+            {
+                glm::vec2 texel = levels[level - firstLevel][size_t(y) * extents[level].x + x];
+                minMax.x = std::min(minMax.x, texel.x);
+                minMax.y = std::max(minMax.y, texel.y);
+            }
+        }
+        return minMax;
+    }
+    throw std::runtime_error("HEIGHT_PYRAMID::GET_RANGE::Pyramid is missing the top level");
+}
+
+uint32_t HeightPyramid::getWidth() const
+{
+    return width;
+}
+
+uint32_t HeightPyramid::getHeight() const
+{
+    return height;
+}
+
+uint32_t HeightPyramid::getFirstLevel() const
+{
+    return firstLevel;
+}
+
+uint32_t HeightPyramid::getLevelCount() const
+{
+    return static_cast<uint32_t>(extents.size());
+}
+
+glm::uvec2 HeightPyramid::getLevelExtent(uint32_t level) const
+{
+    return extents[level];
+}
+
+const std::vector<glm::vec2> &HeightPyramid::getLevel(uint32_t level) const
+{
+    return levels[level - firstLevel];
+}
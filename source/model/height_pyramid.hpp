@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+/**
+ * Append the box filtered mip chain of a single channel heightmap to mipChain which holds
+ * level 0 -> level i is max(1, width >> i) x max(1, height >> i) texels (the extents Vulkan
+ * expects), the last texel of a row or column of an odd level also averages the leftover one
+ * @param mipChain - row major level 0 of width * height texels, levels 1 to
+ *      getHeightMipCount - 1 are appended in order
+ */
+void buildHeightMips(std::vector<float> &mipChain, uint32_t width, uint32_t height);
+uint32_t getHeightMipCount(uint32_t width, uint32_t height);
+
+/**
+ * Min max height pyramid of a single channel heightmap, texel of level i holds the min and
+ * max of the 2^(i + 1) x 2^(i + 1) heightmap block it covers. Extents follow the Vulkan mip
+ * chain of a max(1, width / 2) x max(1, height / 2) image, the last texel of a row or column
+ * covers the leftover texels of odd extents as well -> every query is conservative
+ */
+class HeightPyramid
+{
+    public:
+        /* @param heights - row major heightmap texels, x is the fastest changing coordinate */
+        HeightPyramid(const float *heights, uint32_t width, uint32_t height);
+        /**
+         * Pyramid holding only the levels from firstLevel up, f.e. loaded from disk, queries
+         * start at firstLevel -> they are looser but still conservative
+         * @param levels - levels[i] holds level firstLevel + i
+         */
+        HeightPyramid(uint32_t width, uint32_t height, uint32_t firstLevel,
+            std::vector<std::vector<glm::vec2>> levels);
+
+        /**
+         * @return conservative min (x) and max (y) of the heightmap texels inside of the
+         *      inclusive texel rectangle, looks at no more than 4x4 pyramid texels
+         */
+        glm::vec2 getRange(glm::ivec2 texelMin, glm::ivec2 texelMax) const;
+
+        uint32_t getWidth() const;
+        uint32_t getHeight() const;
+        /* Finest level the pyramid holds */
+        uint32_t getFirstLevel() const;
+        uint32_t getLevelCount() const;
+        glm::uvec2 getLevelExtent(uint32_t level) const;
+        /* Row major min max texels of level, level has to be at least getFirstLevel */
+        const std::vector<glm::vec2> &getLevel(uint32_t level) const;
+
+    private:
+        uint32_t width;
+        uint32_t height;
+        uint32_t firstLevel = 0;
+        /* Extents of all levels including the ones finer than firstLevel */
+        std::vector<glm::uvec2> extents;
+        std::vector<std::vector<glm::vec2>> levels;
+};
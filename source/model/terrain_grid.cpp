@@ -0,0 +1,29 @@
+#include "terrain_grid.hpp"
+
+void generateTerrainPatchIndices(uint32_t patchRes, std::vector<uint16_t> &indices)
+{
+    uint32_t vertexRes = patchRes + 1;
+    indices.clear();
+    indices.reserve(patchRes * patchRes * 6);
+
+    /* Generate indices quadrant by quadrant, i runs along x and j along y */
+    uint32_t halfRes = patchRes / 2;
+    for (unsigned int quadrant = 0; quadrant < 4; quadrant++) {
+        unsigned int iStart = (quadrant % 2) * halfRes;
+        unsigned int jStart = (quadrant / 2) * halfRes;
+        for (unsigned int i = iStart; i < iStart + halfRes; i++) {
+            for (unsigned int j = jStart; j < jStart + halfRes; j++) {
+                uint16_t i0 = static_cast<uint16_t>(j + i * vertexRes);
+                uint16_t i1 = i0 + 1;
+                uint16_t i2 = i0 + vertexRes;
+                uint16_t i3 = i2 + 1;
+                indices.push_back(i0);
+                indices.push_back(i2);
+                indices.push_back(i1);
+                indices.push_back(i1);
+                indices.push_back(i2);
+                indices.push_back(i3);
+            }
+        }
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * Generate the indices of the unit patch every selected terrain quadtree node is drawn
+ * with. The patch has no vertex buffer, terrain.vert derives vertex (i, j) at position
+ * (i, j) / patchRes from its index j + i * (patchRes + 1). Triangles are ordered by the
+ * quadrant of the patch they lie in so that each quadrant can be drawn on its own,
+ * quadrant index is qx + 2 * qy
+ * @param patchRes - number of quads along each side of the patch, has to be even and
+ *      small enough for the indices to fit 16 bits
+ * @param indices - filled with patchRes^2 * 6 triangle list indices, patchRes^2 * 6 / 4
+ *      per quadrant
+ */
+void generateTerrainPatchIndices(uint32_t patchRes, std::vector<uint16_t> &indices);
@@ -0,0 +1,194 @@
+#include "terrain_quadtree.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+/* Fraction of the range of a level after which its vertices start morphing into the parent grid */
+const float morphStartRatio = 0.67f;
+
+TerrainQuadtree::TerrainQuadtree(const HeightPyramid &heights, float heightScale, uint32_t lodCount) :
+    lodCount{lodCount}, heightScale{heightScale}
+{
+    if(lodCount == 0 || lodCount > 16)
+    {
+        throw std::runtime_error("TERRAIN_QUADTREE::TERRAIN_QUADTREE::Unsupported number of levels");
+    }
+    nodeHeights.resize(lodCount);
+
+    #pragma region leafHeights
+    uint32_t leavesPerSide = 1u << (lodCount - 1);
+    float width = float(heights.getWidth());
+    float height = float(heights.getHeight());
+    nodeHeights[0].resize(leavesPerSide * leavesPerSide);
+    for(uint32_t y = 0; y < leavesPerSide; y++)
+    {
+        for(uint32_t x = 0; x < leavesPerSide; x++)
+        {
+            /* Texels the bilinear filter may touch anywhere inside of the leaf */
+            glm::ivec2 texelMin = glm::ivec2(
+                std::floor(float(x) / leavesPerSide * width - 0.5f),
+                std::floor(float(y) / leavesPerSide * height - 0.5f));
+            glm::ivec2 texelMax = glm::ivec2(
+                std::ceil(float(x + 1) / leavesPerSide * width - 0.5f),
+                std::ceil(float(y + 1) / leavesPerSide * height - 0.5f));
+            nodeHeights[0][y * leavesPerSide + x] = heights.getRange(texelMin, texelMax) * heightScale;
+        }
+    }
+    #pragma endregion leafHeights
+
+    #pragma region parentHeights
+    for(uint32_t level = 1; level < lodCount; level++)
+    {
+        uint32_t nodesPerSide = leavesPerSide >> level;
+        uint32_t childrenPerSide = nodesPerSide * 2;
+        const std::vector<glm::vec2> &children = nodeHeights[level - 1];
+        nodeHeights[level].resize(nodesPerSide * nodesPerSide);
+        for(uint32_t y = 0; y < nodesPerSide; y++)
+        {
+            for(uint32_t x = 0; x < nodesPerSide; x++)
+            {
+                glm::vec2 minMax = glm::vec2(INFINITY, -INFINITY);
+                for(uint32_t child = 0; child < 4; child++)
+                {
+                    glm::vec2 childMinMax = children[(2 * y + child / 2) * childrenPerSide +
+                        2 * x + child % 2];
+                    minMax.x = std::min(minMax.x, childMinMax.x);
+                    minMax.y = std::max(minMax.y, childMinMax.y);
+                }
+                nodeHeights[level][y * nodesPerSide + x] = minMax;
+            }
+        }
+    }
+    #pragma endregion parentHeights
+}
+
+uint32_t TerrainQuadtree::getMaxSelectedNodes() const
+{
+    return static_cast<uint32_t>(nodeHeights[0].size());
+}
+
+uint32_t TerrainQuadtree::getLodCount() const
+{
+    return lodCount;
+}
+
+void TerrainQuadtree::getNodeBounds(uint32_t level, uint32_t x, uint32_t y, glm::vec3 &boundsMin,
+    glm::vec3 &boundsMax) const
+{
+    uint32_t nodesPerSide = 1u << (lodCount - 1 - level);
+    float size = 1.0f / float(nodesPerSide);
+    glm::vec2 minMax = nodeHeights[level][y * nodesPerSide + x];
+    boundsMin = glm::vec3(x * size, y * size, minMax.x);
+    boundsMax = glm::vec3((x + 1) * size, (y + 1) * size, minMax.y);
+}
+
+/* Plane space frustum test, planes point inside of the frustum */
+static bool intersectsFrustum(const std::array<glm::vec4, 6> &planes, glm::vec3 boundsMin,
+    glm::vec3 boundsMax)
+{
+    for(const glm::vec4 &plane : planes)
+    {
+        /* Corner of the box furthest along the plane normal */
+        glm::vec3 corner = glm::vec3(
+            plane.x > 0.0f ? boundsMax.x : boundsMin.x,
+            plane.y > 0.0f ? boundsMax.y : boundsMin.y,
+            plane.z > 0.0f ? boundsMax.z : boundsMin.z);
+        if(glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Bounds are in plane space, the distance is measured in world space */
+static bool intersectsSphere(const glm::mat4 &model, glm::vec3 center, float radius,
+    glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    glm::vec3 worldMin = glm::vec3(model * glm::vec4(boundsMin, 1.0f));
+    glm::vec3 worldMax = glm::vec3(model * glm::vec4(boundsMax, 1.0f));
+    glm::vec3 closest = glm::clamp(center, glm::min(worldMin, worldMax), glm::max(worldMin, worldMax));
+    glm::vec3 offset = closest - center;
+    return glm::dot(offset, offset) <= radius * radius;
+}
+
+void TerrainQuadtree::addNode(uint32_t level, uint32_t x, uint32_t y, uint32_t quadrant,
+    const SelectionContext &context) const
+{
+    float size = 1.0f / float(1u << (lodCount - 1 - level));
+    float previousRange = level == 0 ? 0.0f : context.ranges[level - 1];
+    float range = context.ranges[level];
+
+    TerrainNodeInstance instance;
+    instance.node = glm::vec3(x * size, y * size, size);
+    instance.morphRange = glm::vec2(previousRange + (range - previousRange) * morphStartRatio, range);
+    (*context.selection)[quadrant].push_back(instance);
+}
+
+bool TerrainQuadtree::selectNode(uint32_t level, uint32_t x, uint32_t y,
+    const SelectionContext &context) const
+{
+    glm::vec3 boundsMin, boundsMax;
+    getNodeBounds(level, x, y, boundsMin, boundsMax);
+
+    /* Root is drawn no matter how far the camera is */
+    if(level != lodCount - 1 &&
+       !intersectsSphere(context.model, context.cameraPosition, context.ranges[level], boundsMin, boundsMax))
+    {
+        return false;
+    }
+    /* Area is handled, there is just nothing to draw */
+    if(!intersectsFrustum(context.frustumPlanes, boundsMin, boundsMax))
+    {
+        return true;
+    }
+
+    bool childrenInRange = level != 0 && intersectsSphere(context.model, context.cameraPosition,
+        context.ranges[level - 1], boundsMin, boundsMax);
+    for(uint32_t quadrant = 0; quadrant < 4; quadrant++)
+    {
+        if(!childrenInRange ||
+           !selectNode(level - 1, 2 * x + quadrant % 2, 2 * y + quadrant / 2, context))
+        {
+            addNode(level, x, y, quadrant, context);
+        }
+    }
+    return true;
+}
+
+void TerrainQuadtree::select(const glm::mat4 &model, const glm::mat4 &viewProj,
+    glm::vec3 cameraPosition, float baseRange, TerrainSelection &selection) const
+{
+    for(auto &quadrantNodes : selection)
+    {
+        quadrantNodes.clear();
+    }
+
+    SelectionContext context;
+    context.model = model;
+    context.cameraPosition = cameraPosition;
+    context.selection = &selection;
+    context.ranges.resize(lodCount);
+    for(uint32_t level = 0; level < lodCount; level++)
+    {
+        context.ranges[level] = baseRange * float(1u << level);
+    }
+
+    /* Gribb-Hartmann plane extraction, clip space depth is in [0, 1] -> near plane is row 2
+       glm matrices are column major -> matrix[column][row] */
+    glm::mat4 planeToClip = viewProj * model;
+    glm::vec4 rows[4];
+    for(int row = 0; row < 4; row++)
+    {
+        rows[row] = glm::vec4(planeToClip[0][row], planeToClip[1][row], planeToClip[2][row],
+            planeToClip[3][row]);
+    }
+    context.frustumPlanes = {
+        rows[3] + rows[0], rows[3] - rows[0],
+        rows[3] + rows[1], rows[3] - rows[1],
+        rows[2], rows[3] - rows[2]
+    };
+
+    selectNode(lodCount - 1, 0, 0, context);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include "height_pyramid.hpp"
+
+/* Per instance data of the terrain patch, one for each selected quadtree node */
+struct TerrainNodeInstance
+{
+    /* xy - corner of the node in the unit terrain plane, z - edge length of the node */
+    glm::vec3 node;
+    /* Distance from the camera in world units at which the vertices of the node start
+       and finish morphing into the grid of the parent level */
+    glm::vec2 morphRange;
+};
+
+/* Selected nodes split by the quadrant of the patch they are drawn with, a node
+   only partially covered by its children draws just the quadrants they left out */
+using TerrainSelection = std::array<std::vector<TerrainNodeInstance>, 4>;
+
+/**
+ * Continuous distance LOD quadtree over the unit terrain plane, the root covers the whole
+ * plane and each of the lodCount levels halves the node size. Every node is drawn with the
+ * same patch -> vertex density of a node halves with each level towards the root
+ */
+class TerrainQuadtree
+{
+    public:
+        /**
+         * Build the per node min max heights of every level
+         * @param heights - min max pyramid of the heightmap the terrain is displaced by
+         * @param heightScale - heightmap value to plane z scale, same as in terrain.vert
+         * @param lodCount - number of levels, leaves are 2^(lodCount - 1) times smaller than the root
+         */
+        TerrainQuadtree(const HeightPyramid &heights, float heightScale, uint32_t lodCount);
+
+        /**
+         * Select the nodes to draw this frame, nodes outside of the frustum are culled
+         * @param model - unit plane to world space matrix, may only scale and translate
+         * @param viewProj - world space to clip space matrix
+         * @param cameraPosition - camera position in world space
+         * @param baseRange - world space distance up to which the leaves are drawn, the
+         *      range doubles with each level
+         * @param selection - cleared and filled with the nodes of each patch quadrant
+         */
+        void select(const glm::mat4 &model, const glm::mat4 &viewProj, glm::vec3 cameraPosition,
+            float baseRange, TerrainSelection &selection) const;
+
+        /* Upper bound of the number of nodes in one quadrant of a selection */
+        uint32_t getMaxSelectedNodes() const;
+        uint32_t getLodCount() const;
+
+    private:
+        struct SelectionContext
+        {
+            std::array<glm::vec4, 6> frustumPlanes;
+            glm::mat4 model;
+            glm::vec3 cameraPosition;
+            /* Index is the level, leaves are level 0 */
+            std::vector<float> ranges;
+            TerrainSelection *selection;
+        };
+
+        uint32_t lodCount;
+        float heightScale;
+        /* Min and max plane z of every node, index is the level then y * nodes per side + x */
+        std::vector<std::vector<glm::vec2>> nodeHeights;
+
+        /**
+         * @return false if the node is outside of the range of its level -> its parent
+         *      has to draw its area instead
+         */
+        bool selectNode(uint32_t level, uint32_t x, uint32_t y, const SelectionContext &context) const;
+        void addNode(uint32_t level, uint32_t x, uint32_t y, uint32_t quadrant,
+            const SelectionContext &context) const;
+        /* Plane space bounds of the node */
+        void getNodeBounds(uint32_t level, uint32_t x, uint32_t y, glm::vec3 &boundsMin,
+            glm::vec3 &boundsMax) const;
+};
@@ -0,0 +1,282 @@
+#include "terrain_tiles.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* Bump when the layout of the file changes, older files are then rewritten */
+#define TERRAIN_TILES_MAGIC 0x4C495454u
+#define TERRAIN_TILES_VERSION 1u
+
+struct TerrainTilesHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipCount;
+    uint32_t tileSize;
+    uint32_t pyramidFirstLevel;
+    uint32_t pyramidLevelCount;
+};
+
+static glm::uvec2 getMipExtent(uint32_t width, uint32_t height, uint32_t mip)
+{
+    return glm::uvec2(std::max(1u, width >> mip), std::max(1u, height >> mip));
+}
+
+static glm::uvec2 getMipTileCount(uint32_t width, uint32_t height, uint32_t mip, uint32_t tileSize)
+{
+    glm::uvec2 extent = getMipExtent(width, height, mip);
+    return (extent + glm::uvec2(tileSize - 1)) / tileSize;
+}
+
+/* Offsets of the pyramid levels and of the first tile of every mip, returns the file size */
+static size_t getTerrainTilesLayout(const TerrainTilesHeader &header, size_t &pyramidOffset,
+    std::vector<size_t> &mipOffsets)
+{
+    size_t offset = sizeof(TerrainTilesHeader);
+    pyramidOffset = offset;
+    glm::uvec2 extent = glm::uvec2(std::max(1u, header.width / 2), std::max(1u, header.height / 2));
+    for(uint32_t level = 0; level < header.pyramidLevelCount; level++)
+    {
+        if(level >= header.pyramidFirstLevel)
+        {
+            offset += size_t(extent.x) * extent.y * sizeof(glm::vec2);
+        }
+        extent = glm::uvec2(std::max(1u, extent.x / 2), std::max(1u, extent.y / 2));
+    }
+
+    size_t storedTileSize = header.tileSize + 2;
+    mipOffsets.resize(header.mipCount);
+    for(uint32_t mip = 0; mip < header.mipCount; mip++)
+    {
+        mipOffsets[mip] = offset;
+        glm::uvec2 tileCount = getMipTileCount(header.width, header.height, mip, header.tileSize);
+        offset += size_t(tileCount.x) * tileCount.y * storedTileSize * storedTileSize * sizeof(float);
+    }
+    return offset;
+}
+
+void writeTerrainTiles(const std::string &path, const std::vector<float> &mipChain,
+    uint32_t width, uint32_t height, const HeightPyramid &pyramid, uint32_t tileSize)
+{
+    std::error_code error;
+    std::filesystem::path filePath(path);
+    if(filePath.has_parent_path()) { std::filesystem::create_directories(filePath.parent_path(), error); }
+    std::ofstream outFile(path, std::ios::binary);
+    if(!outFile)
+    {
+        std::cout << "TERRAIN_TILES::WRITE::Failed to write " << path << std::endl;
+        return;
+    }
+
+    /* Queries on the quadtree leaves rarely need blocks finer than a quarter of a tile */
+    uint32_t firstLevel = 0;
+    while((2u << firstLevel) < tileSize / 4 && firstLevel + 1 < pyramid.getLevelCount())
+    {
+        firstLevel++;
+    }
+    TerrainTilesHeader header{TERRAIN_TILES_MAGIC, TERRAIN_TILES_VERSION, width, height,
+        getHeightMipCount(width, height), tileSize, firstLevel, pyramid.getLevelCount()};
+    outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    for(uint32_t level = firstLevel; level < pyramid.getLevelCount(); level++)
+    {
+        const std::vector<glm::vec2> &texels = pyramid.getLevel(level);
+        outFile.write(reinterpret_cast<const char *>(texels.data()), texels.size() * sizeof(glm::vec2));
+    }
+
+    uint32_t storedTileSize = tileSize + 2;
+    std::vector<float> tile(storedTileSize * storedTileSize);
+    size_t mipOffset = 0;
+    for(uint32_t mip = 0; mip < header.mipCount; mip++)
+    {
+        glm::uvec2 extent = getMipExtent(width, height, mip);
+        glm::uvec2 tileCount = getMipTileCount(width, height, mip, tileSize);
+        const float *texels = mipChain.data() + mipOffset;
+        for(uint32_t tileY = 0; tileY < tileCount.y; tileY++)
+        {
+            for(uint32_t tileX = 0; tileX < tileCount.x; tileX++)
+            {
+                for(uint32_t y = 0; y < storedTileSize; y++)
+                {
+                    int sourceY = std::clamp(int(tileY * tileSize + y) - 1, 0, int(extent.y) - 1);
+                    for(uint32_t x = 0; x < storedTileSize; x++)
+                    {
+                        int sourceX = std::clamp(int(tileX * tileSize + x) - 1, 0, int(extent.x) - 1);
+                        tile[y * storedTileSize + x] = texels[size_t(sourceY) * extent.x + sourceX];
+                    }
+                }
+                outFile.write(reinterpret_cast<const char *>(tile.data()), tile.size() * sizeof(float));
+            }
+        }
+        mipOffset += size_t(extent.x) * extent.y;
+    }
+}
+
+bool checkTerrainTiles(const std::string &path, uint32_t tileSize)
+{
+    std::ifstream tilesFile(path, std::ios::binary);
+    if(!tilesFile) { return false; }
+
+    TerrainTilesHeader header{};
+    tilesFile.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if(!tilesFile || header.magic != TERRAIN_TILES_MAGIC || header.version != TERRAIN_TILES_VERSION ||
+       header.tileSize != tileSize)
+    {
+        return false;
+    }
+
+    size_t pyramidOffset;
+    std::vector<size_t> mipOffsets;
+    std::error_code error;
+    uintmax_t fileSize = std::filesystem::file_size(path, error);
+    return !error && fileSize >= getTerrainTilesLayout(header, pyramidOffset, mipOffsets);
+}
+
+TerrainTileFile::TerrainTileFile(const std::string &path)
+{
+    #pragma region mapFile
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER fileSize{};
+    if(file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize))
+    {
+        if(file != INVALID_HANDLE_VALUE) { CloseHandle(file); }
+        throw std::runtime_error("TERRAIN_TILES::TERRAIN_TILE_FILE::Failed to open " + path);
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    /* The view keeps the file mapped on its own */
+    if(mapping) { CloseHandle(mapping); }
+    CloseHandle(file);
+    if(!view)
+    {
+        throw std::runtime_error("TERRAIN_TILES::TERRAIN_TILE_FILE::Failed to map " + path);
+    }
+    data = static_cast<const uint8_t *>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    struct stat fileStat{};
+    if(file < 0 || fstat(file, &fileStat) != 0)
+    {
+        if(file >= 0) { close(file); }
+        throw std::runtime_error("TERRAIN_TILES::TERRAIN_TILE_FILE::Failed to open " + path);
+    }
+    size = static_cast<size_t>(fileStat.st_size);
+    void *view = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+    /* The mapping keeps the file open on its own */
+    close(file);
+    if(view == MAP_FAILED)
+    {
+        throw std::runtime_error("TERRAIN_TILES::TERRAIN_TILE_FILE::Failed to map " + path);
+    }
+    data = static_cast<const uint8_t *>(view);
+#endif
+    #pragma endregion mapFile
+
+    TerrainTilesHeader header{};
+    bool valid = size >= sizeof(header);
+    if(valid)
+    {
+        header = *reinterpret_cast<const TerrainTilesHeader *>(data);
+        valid = header.magic == TERRAIN_TILES_MAGIC && header.version == TERRAIN_TILES_VERSION &&
+            size >= getTerrainTilesLayout(header, pyramidOffset, mipOffsets);
+    }
+    if(!valid)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<uint8_t *>(data), size);
+#endif
+        throw std::runtime_error("TERRAIN_TILES::TERRAIN_TILE_FILE::Invalid terrain tiles " + path);
+    }
+    width = header.width;
+    height = header.height;
+    mipCount = header.mipCount;
+    tileSize = header.tileSize;
+    pyramidFirstLevel = header.pyramidFirstLevel;
+}
+
+TerrainTileFile::~TerrainTileFile()
+{
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<uint8_t *>(data), size);
+#endif
+}
+
+uint32_t TerrainTileFile::getWidth() const
+{
+    return width;
+}
+
+uint32_t TerrainTileFile::getHeight() const
+{
+    return height;
+}
+
+uint32_t TerrainTileFile::getMipCount() const
+{
+    return mipCount;
+}
+
+uint32_t TerrainTileFile::getTileSize() const
+{
+    return tileSize;
+}
+
+uint32_t TerrainTileFile::getStoredTileSize() const
+{
+    return tileSize + 2;
+}
+
+glm::uvec2 TerrainTileFile::getTileCount(uint32_t mip) const
+{
+    return getMipTileCount(width, height, mip, tileSize);
+}
+
+const float *TerrainTileFile::getTile(uint32_t mip, glm::uvec2 tile) const
+{
+    size_t storedTileSize = getStoredTileSize();
+    size_t tileIndex = size_t(tile.y) * getTileCount(mip).x + tile.x;
+    return reinterpret_cast<const float *>(data + mipOffsets[mip] +
+        tileIndex * storedTileSize * storedTileSize * sizeof(float));
+}
+
+HeightPyramid TerrainTileFile::loadPyramid() const
+{
+    std::vector<std::vector<glm::vec2>> levels;
+    const glm::vec2 *texels = reinterpret_cast<const glm::vec2 *>(data + pyramidOffset);
+    glm::uvec2 extent = glm::uvec2(std::max(1u, width / 2), std::max(1u, height / 2));
+    for(uint32_t level = 0; ; level++)
+    {
+        if(level >= pyramidFirstLevel)
+        {
+            size_t texelCount = size_t(extent.x) * extent.y;
+            levels.emplace_back(texels, texels + texelCount);
+            texels += texelCount;
+        }
+        if(extent.x == 1 && extent.y == 1) { break; }
+        extent = glm::uvec2(std::max(1u, extent.x / 2), std::max(1u, extent.y / 2));
+    }
+    return HeightPyramid(width, height, pyramidFirstLevel, std::move(levels));
+}
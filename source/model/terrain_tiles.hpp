@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include "height_pyramid.hpp"
+
+/**
+ * Write the mip chain of a single channel heightmap as a tiled terrain file. Every mip is
+ * cut into tileSize x tileSize tiles stored with a one texel border copied from their
+ * neighbours (clamped at the edges of the mip) -> (tileSize + 2)^2 floats per tile, so a
+ * tile can be sampled bilinearly on its own. The coarse levels of the min max pyramid
+ * (the ones covering blocks of at least tileSize / 4 texels) are stored as well
+ * @param mipChain - heightmap mips in the layout produced by buildHeightMips
+ */
+void writeTerrainTiles(const std::string &path, const std::vector<float> &mipChain,
+    uint32_t width, uint32_t height, const HeightPyramid &pyramid, uint32_t tileSize);
+
+/**
+ * @return true if path holds a terrain tile file of this version cut into tiles of tileSize
+ */
+bool checkTerrainTiles(const std::string &path, uint32_t tileSize);
+
+/**
+ * Read only memory mapping of a terrain tile file written by writeTerrainTiles, tiles are
+ * paged in by the OS when they are first read -> opening the file costs the same no
+ * matter how large the terrain is
+ */
+class TerrainTileFile
+{
+    public:
+        TerrainTileFile(const std::string &path);
+        ~TerrainTileFile();
+
+        TerrainTileFile(const TerrainTileFile &) = delete;
+        TerrainTileFile &operator=(const TerrainTileFile &) = delete;
+
+        uint32_t getWidth() const;
+        uint32_t getHeight() const;
+        uint32_t getMipCount() const;
+        /* Edge length of the tile without its border */
+        uint32_t getTileSize() const;
+        /* Edge length of the tile as stored, tileSize + 2 */
+        uint32_t getStoredTileSize() const;
+        /* Number of tiles along x and y of mip */
+        glm::uvec2 getTileCount(uint32_t mip) const;
+        /* Row major (tileSize + 2)^2 texels of the tile, x is the fastest changing coordinate */
+        const float *getTile(uint32_t mip, glm::uvec2 tile) const;
+        /* Copy of the coarse pyramid levels stored in the file */
+        HeightPyramid loadPyramid() const;
+
+    private:
+        const uint8_t *data;
+        size_t size;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipCount;
+        uint32_t tileSize;
+        uint32_t pyramidFirstLevel;
+        size_t pyramidOffset;
+        /* Offset in bytes of the first tile of every mip */
+        std::vector<size_t> mipOffsets;
+};
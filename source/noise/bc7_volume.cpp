@@ -0,0 +1,471 @@
+#include <cmath>
+#include <array>
+#include <limits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <filesystem>
+
+#include <glm/gtc/packing.hpp>
+
+#include "bc7_volume.hpp"
+#include "clouds/tile_thread_pool.hpp"
+
+/* Interpolation weights of 4 bit BC7 indices, out of 64 */
+static const int BC7_WEIGHTS_4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+static const uint32_t BC7_MODE_6 = 6;
+
+static const uint32_t BC7_VOLUME_CACHE_MAGIC = 0x37434241;
+/* Bump when the encoder output changes */
+static const uint32_t BC7_VOLUME_CACHE_VERSION = 2;
+
+struct BC7VolumeCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    glm::ivec3 dimensions;
+    uint32_t mipLevels;
+    uint64_t sourceHash;
+    glm::vec4 psnr;
+};
+
+static size_t getBlockCount(glm::ivec3 dimensions)
+{
+    return static_cast<size_t>((dimensions.x + 3) / 4) * ((dimensions.y + 3) / 4) * dimensions.z;
+}
+
+static glm::ivec3 getMipDimensions(glm::ivec3 dimensions, uint32_t mip)
+{
+    return glm::max(dimensions >> glm::ivec3(mip), glm::ivec3(1));
+}
+
+#pragma region blockEncoding
+class BlockBitWriter
+{
+    public:
+        BlockBitWriter(uint8_t *block) : block{block} { std::memset(block, 0, 16); }
+
+        void write(uint32_t value, int bitCount)
+        {
+            for(int i = 0; i < bitCount; i++, bit++)
+            {
+                if((value >> i) & 1u) { block[bit >> 3] |= static_cast<uint8_t>(1u << (bit & 7)); }
+            }
+        }
+
+    private:
+        uint8_t *block;
+        int bit = 0;
+};
+
+class BlockBitReader
+{
+    public:
+        BlockBitReader(const uint8_t *block) : block{block} {}
+
+        uint32_t read(int bitCount)
+        {
+            uint32_t value = 0;
+            for(int i = 0; i < bitCount; i++, bit++)
+            {
+                value |= static_cast<uint32_t>((block[bit >> 3] >> (bit & 7)) & 1u) << i;
+            }
+            return value;
+        }
+
+    private:
+        const uint8_t *block;
+        int bit = 0;
+};
+
+struct Mode6Candidate
+{
+    glm::ivec4 endpoints[2];
+    int pBits[2];
+    std::array<int, 16> indices;
+    float error = std::numeric_limits<float>::max();
+};
+
+/* Pick the closest palette entry for every texel, texels are the outer loop and the
+   16 entries the inner branch free one */
+static float assignIndices(const glm::vec4 texels[16], const glm::ivec4 endpoints[2],
+    std::array<int, 16> &indices)
+{
+    glm::vec4 palette[16];
+    for(int entry = 0; entry < 16; entry++)
+    {
+        palette[entry] = glm::vec4(((64 - BC7_WEIGHTS_4[entry]) * endpoints[0] +
+            BC7_WEIGHTS_4[entry] * endpoints[1] + 32) >> 6);
+    }
+
+    float totalError = 0.0f;
+    for(int texel = 0; texel < 16; texel++)
+    {
+        float errors[16];
+        for(int entry = 0; entry < 16; entry++)
+        {
+            glm::vec4 difference = texels[texel] - palette[entry];
+            errors[entry] = glm::dot(difference, difference);
+        }
+        int best = 0;
+        for(int entry = 1; entry < 16; entry++) { best = errors[entry] < errors[best] ? entry : best; }
+        indices[texel] = best;
+        totalError += errors[best];
+    }
+    return totalError;
+}
+
+/* 7 bit endpoint with the shared p-bit as the lowest bit of the 8 bit value */
+static glm::ivec4 quantizeEndpoint(glm::vec4 endpoint, int pBit)
+{
+    return glm::clamp(glm::ivec4(glm::round((endpoint - float(pBit)) * 0.5f)), glm::ivec4(0),
+        glm::ivec4(127)) * 2 + pBit;
+}
+
+/* Least squares endpoints of the texels for fixed indices, false if the indices don't
+   span a line (all texels use the same weight) */
+static bool refitEndpoints(const glm::vec4 texels[16], const std::array<int, 16> &indices,
+    glm::vec4 endpoints[2])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    glm::vec4 ax = glm::vec4(0.0f), bx = glm::vec4(0.0f);
+    for(int texel = 0; texel < 16; texel++)
+    {
+        float b = BC7_WEIGHTS_4[indices[texel]] / 64.0f;
+        float a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        ax += a * texels[texel];
+        bx += b * texels[texel];
+    }
+    float determinant = aa * bb - ab * ab;
+    if(std::abs(determinant) < 1e-6f) { return false; }
+    endpoints[0] = (ax * bb - bx * ab) / determinant;
+    endpoints[1] = (bx * aa - ax * ab) / determinant;
+    return true;
+}
+
+/**
+ * Mode 6 encoding of one block, endpoints start on the principal axis of the texels and
+ * are refined by least squares for all four p-bit combinations
+ * @param texels - in [0, 255]
+ */
+static void encodeBC7Mode6Block(const glm::vec4 texels[16], uint8_t *block)
+{
+    glm::vec4 mean = glm::vec4(0.0f);
+    glm::vec4 minTexel = texels[0], maxTexel = texels[0];
+    for(int texel = 0; texel < 16; texel++)
+    {
+        mean += texels[texel];
+        minTexel = glm::min(minTexel, texels[texel]);
+        maxTexel = glm::max(maxTexel, texels[texel]);
+    }
+    mean /= 16.0f;
+
+    glm::mat4 covariance = glm::mat4(0.0f);
+    for(int texel = 0; texel < 16; texel++)
+    {
+        glm::vec4 offset = texels[texel] - mean;
+        covariance += glm::outerProduct(offset, offset);
+    }
+    /* Power iteration from the bounding box diagonal */
+    glm::vec4 axis = maxTexel - minTexel;
+    for(int iteration = 0; iteration < 8; iteration++)
+    {
+        glm::vec4 nextAxis = covariance * axis;
+        float largest = std::max(std::max(std::abs(nextAxis.x), std::abs(nextAxis.y)),
+            std::max(std::abs(nextAxis.z), std::abs(nextAxis.w)));
+        /* Flat block, keep the diagonal */
+        if(largest < 1e-6f) { break; }
+        axis = nextAxis / largest;
+    }
+    float axisLength = glm::length(axis);
+    axis = axisLength > 1e-6f ? axis / axisLength : glm::vec4(0.0f);
+
+    float minProjection = 0.0f, maxProjection = 0.0f;
+    for(int texel = 0; texel < 16; texel++)
+    {
+        float projection = glm::dot(texels[texel] - mean, axis);
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+
+    Mode6Candidate best {};
+    for(int pBits = 0; pBits < 4; pBits++)
+    {
+        glm::vec4 endpoints[2] = {mean + axis * minProjection, mean + axis * maxProjection};
+        for(int refinement = 0; refinement < 3; refinement++)
+        {
+            Mode6Candidate candidate {};
+            candidate.pBits[0] = pBits & 1;
+            candidate.pBits[1] = pBits >> 1;
+            candidate.endpoints[0] = quantizeEndpoint(endpoints[0], candidate.pBits[0]);
+            candidate.endpoints[1] = quantizeEndpoint(endpoints[1], candidate.pBits[1]);
+            candidate.error = assignIndices(texels, candidate.endpoints, candidate.indices);
+            if(candidate.error < best.error) { best = candidate; }
+            if(!refitEndpoints(texels, candidate.indices, endpoints)) { break; }
+        }
+    }
+
+    /* Highest bit of the index of the first texel is implicit 0 -> swap the endpoints
+       when it would be set */
+    if(best.indices[0] >= 8)
+    {
+        std::swap(best.endpoints[0], best.endpoints[1]);
+        std::swap(best.pBits[0], best.pBits[1]);
+        for(int &index : best.indices) { index = 15 - index; }
+    }
+
+    BlockBitWriter writer(block);
+    writer.write(1u << BC7_MODE_6, BC7_MODE_6 + 1);
+    for(int channel = 0; channel < 4; channel++)
+    {
+        writer.write(static_cast<uint32_t>(best.endpoints[0][channel] >> 1), 7);
+        writer.write(static_cast<uint32_t>(best.endpoints[1][channel] >> 1), 7);
+    }
+    writer.write(static_cast<uint32_t>(best.pBits[0]), 1);
+    writer.write(static_cast<uint32_t>(best.pBits[1]), 1);
+    writer.write(static_cast<uint32_t>(best.indices[0]), 3);
+    for(int texel = 1; texel < 16; texel++) { writer.write(static_cast<uint32_t>(best.indices[texel]), 4); }
+}
+#pragma endregion blockEncoding
+
+void decodeBC7Block(const uint8_t *block, glm::vec4 texels[16])
+{
+    BlockBitReader reader(block);
+    if(reader.read(BC7_MODE_6 + 1) != (1u << BC7_MODE_6))
+    {
+        throw std::runtime_error("BC7_VOLUME::DECODE_BLOCK::Only mode 6 blocks are supported");
+    }
+
+    glm::ivec4 endpoints[2];
+    for(int channel = 0; channel < 4; channel++)
+    {
+        endpoints[0][channel] = static_cast<int>(reader.read(7)) << 1;
+        endpoints[1][channel] = static_cast<int>(reader.read(7)) << 1;
+    }
+    endpoints[0] |= static_cast<int>(reader.read(1));
+    endpoints[1] |= static_cast<int>(reader.read(1));
+
+    for(int texel = 0; texel < 16; texel++)
+    {
+        int weight = BC7_WEIGHTS_4[reader.read(texel == 0 ? 3 : 4)];
+        texels[texel] = glm::vec4(((64 - weight) * endpoints[0] + weight * endpoints[1] + 32) >> 6) / 255.0f;
+    }
+}
+
+/* Same box filter as downsample_noise_3D, fp16 in between the mips like on the GPU */
+static void downsampleRGBA16F(const std::vector<uint16_t> &src, glm::ivec3 srcDimensions,
+    std::vector<uint16_t> &dst, glm::ivec3 dstDimensions)
+{
+    dst.resize(static_cast<size_t>(dstDimensions.x) * dstDimensions.y * dstDimensions.z * 4);
+    for(int z = 0; z < dstDimensions.z; z++)
+    for(int y = 0; y < dstDimensions.y; y++)
+    for(int x = 0; x < dstDimensions.x; x++)
+    {
+        glm::vec4 sum = glm::vec4(0.0f);
+        for(int i = 0; i < 8; i++)
+        {
+            glm::ivec3 srcCoords = (glm::ivec3(x, y, z) * 2 + glm::ivec3(i & 1, (i >> 1) & 1, i >> 2)) %
+                srcDimensions;
+            size_t srcIndex = (static_cast<size_t>(srcCoords.z) * srcDimensions.y + srcCoords.y) *
+                srcDimensions.x + srcCoords.x;
+            for(int channel = 0; channel < 4; channel++)
+            {
+                sum[channel] += glm::unpackHalf1x16(src[srcIndex * 4 + channel]);
+            }
+        }
+        size_t dstIndex = (static_cast<size_t>(z) * dstDimensions.y + y) * dstDimensions.x + x;
+        for(int channel = 0; channel < 4; channel++)
+        {
+            dst[dstIndex * 4 + channel] = glm::packHalf1x16(sum[channel] * 0.125f);
+        }
+    }
+}
+
+/* Texels of block (blockX, blockY) of slice z scaled to [0, 255], texels past the edge
+   of mips smaller than a block repeat the last row / column */
+static void loadBlock(const std::vector<uint16_t> &texels, glm::ivec3 dimensions, int blockX,
+    int blockY, int z, glm::vec4 block[16])
+{
+    for(int texel = 0; texel < 16; texel++)
+    {
+        int x = std::min(blockX * 4 + (texel & 3), dimensions.x - 1);
+        int y = std::min(blockY * 4 + (texel >> 2), dimensions.y - 1);
+        size_t index = (static_cast<size_t>(z) * dimensions.y + y) * dimensions.x + x;
+        for(int channel = 0; channel < 4; channel++)
+        {
+            block[texel][channel] = glm::clamp(glm::unpackHalf1x16(texels[index * 4 + channel]),
+                0.0f, 1.0f) * 255.0f;
+        }
+    }
+}
+
+void encodeBC7Volume(const std::vector<uint16_t> &texels, glm::ivec3 dimensions,
+    BC7Volume &volume, uint32_t threadCount)
+{
+    uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(dimensions.x,
+        std::max(dimensions.y, dimensions.z))))) + 1;
+
+    volume.dimensions = dimensions;
+    volume.mipOffsets.resize(mipLevels);
+    size_t totalBlocks = 0;
+    for(uint32_t mip = 0; mip < mipLevels; mip++)
+    {
+        volume.mipOffsets[mip] = totalBlocks * 16;
+        totalBlocks += getBlockCount(getMipDimensions(dimensions, mip));
+    }
+    volume.blocks.resize(totalBlocks * 16);
+
+    /* Mips are cheap next to the encoding -> built up front, then every slice of every
+       mip is one tile of the thread pool */
+    std::vector<std::vector<uint16_t>> mips(mipLevels);
+    for(uint32_t mip = 1; mip < mipLevels; mip++)
+    {
+        downsampleRGBA16F(mip == 1 ? texels : mips[mip - 1], getMipDimensions(dimensions, mip - 1),
+            mips[mip], getMipDimensions(dimensions, mip));
+    }
+
+    std::vector<glm::uvec2> slices;
+    for(uint32_t mip = 0; mip < mipLevels; mip++)
+    {
+        for(int z = 0; z < getMipDimensions(dimensions, mip).z; z++) { slices.push_back(glm::uvec2(mip, z)); }
+    }
+
+    TileThreadPool threadPool(threadCount);
+    threadPool.run(static_cast<uint32_t>(slices.size()), [&](uint32_t slice)
+    {
+        uint32_t mip = slices[slice].x;
+        int z = static_cast<int>(slices[slice].y);
+        glm::ivec3 mipDimensions = getMipDimensions(dimensions, mip);
+        const std::vector<uint16_t> &mipTexels = mip == 0 ? texels : mips[mip];
+
+        glm::ivec2 blockCount = (glm::ivec2(mipDimensions) + 3) / 4;
+        uint8_t *sliceBlocks = volume.blocks.data() + volume.mipOffsets[mip] +
+            static_cast<size_t>(z) * blockCount.x * blockCount.y * 16;
+        glm::vec4 block[16];
+        for(int blockY = 0; blockY < blockCount.y; blockY++)
+        {
+            for(int blockX = 0; blockX < blockCount.x; blockX++)
+            {
+                loadBlock(mipTexels, mipDimensions, blockX, blockY, z, block);
+                encodeBC7Mode6Block(block, sliceBlocks + (blockY * blockCount.x + blockX) * 16);
+            }
+        }
+    });
+}
+
+glm::vec4 computeBC7VolumePSNR(const std::vector<uint16_t> &texels, const BC7Volume &volume,
+    uint32_t threadCount)
+{
+    glm::ivec3 dimensions = volume.dimensions;
+    glm::ivec2 blockCount = (glm::ivec2(dimensions) + 3) / 4;
+    std::vector<glm::dvec4> sliceErrors(dimensions.z, glm::dvec4(0.0));
+
+    TileThreadPool threadPool(threadCount);
+    threadPool.run(static_cast<uint32_t>(dimensions.z), [&](uint32_t z)
+    {
+        glm::vec4 source[16], decoded[16];
+        const uint8_t *sliceBlocks = volume.blocks.data() +
+            static_cast<size_t>(z) * blockCount.x * blockCount.y * 16;
+        for(int blockY = 0; blockY < blockCount.y; blockY++)
+        {
+            for(int blockX = 0; blockX < blockCount.x; blockX++)
+            {
+                loadBlock(texels, dimensions, blockX, blockY, z, source);
+                decodeBC7Block(sliceBlocks + (blockY * blockCount.x + blockX) * 16, decoded);
+                for(int texel = 0; texel < 16; texel++)
+                {
+                    /* Texels past the edge were only padding */
+                    if(blockX * 4 + (texel & 3) >= dimensions.x || blockY * 4 + (texel >> 2) >= dimensions.y)
+                    {
+                        continue;
+                    }
+                    glm::dvec4 difference = glm::dvec4(source[texel] / 255.0f - decoded[texel]);
+                    sliceErrors[z] += difference * difference;
+                }
+            }
+        }
+    });
+
+    glm::dvec4 squaredError = glm::dvec4(0.0);
+    for(const glm::dvec4 &sliceError : sliceErrors) { squaredError += sliceError; }
+    glm::dvec4 meanSquaredError = squaredError /
+        (static_cast<double>(dimensions.x) * dimensions.y * dimensions.z);
+
+    glm::vec4 psnr;
+    for(int channel = 0; channel < 4; channel++)
+    {
+        psnr[channel] = meanSquaredError[channel] > 0.0 ?
+            static_cast<float>(-10.0 * std::log10(meanSquaredError[channel])) :
+            std::numeric_limits<float>::infinity();
+    }
+    return psnr;
+}
+
+/* FNV-1a over 64 bit words, texel count is always a multiple of 4 */
+static uint64_t hashTexels(const std::vector<uint16_t> &texels)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for(size_t i = 0; i + 3 < texels.size(); i += 4)
+    {
+        uint64_t word;
+        std::memcpy(&word, &texels[i], sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool loadOrEncodeBC7Volume(const std::vector<uint16_t> &texels, glm::ivec3 dimensions,
+    BC7Volume &volume, const std::string &cachePath)
+{
+    uint64_t sourceHash = hashTexels(texels);
+
+    std::ifstream cacheFile(cachePath, std::ios::binary);
+    if(cacheFile)
+    {
+        BC7VolumeCacheHeader header{};
+        cacheFile.read(reinterpret_cast<char *>(&header), sizeof(header));
+        bool valid = cacheFile && header.magic == BC7_VOLUME_CACHE_MAGIC &&
+            header.version == BC7_VOLUME_CACHE_VERSION && header.dimensions == dimensions &&
+            header.sourceHash == sourceHash && header.mipLevels > 0;
+        if(valid)
+        {
+            volume.dimensions = dimensions;
+            volume.psnr = header.psnr;
+            volume.mipOffsets.resize(header.mipLevels);
+            size_t totalBlocks = 0;
+            for(uint32_t mip = 0; mip < header.mipLevels; mip++)
+            {
+                volume.mipOffsets[mip] = totalBlocks * 16;
+                totalBlocks += getBlockCount(getMipDimensions(dimensions, mip));
+            }
+            volume.blocks.resize(totalBlocks * 16);
+            cacheFile.read(reinterpret_cast<char *>(volume.blocks.data()), volume.blocks.size());
+            if(cacheFile) { return true; }
+        }
+    }
+    cacheFile.close();
+
+    encodeBC7Volume(texels, dimensions, volume);
+    volume.psnr = computeBC7VolumePSNR(texels, volume);
+
+    /* Failing to write the cache is not fatal, the volume just gets encoded again next run */
+    std::error_code error;
+    std::filesystem::path path(cachePath);
+    if(path.has_parent_path()) { std::filesystem::create_directories(path.parent_path(), error); }
+    std::ofstream outFile(cachePath, std::ios::binary);
+    if(!outFile)
+    {
+        std::cout << "BC7_VOLUME::LOAD_OR_ENCODE::Failed to write cache " << cachePath << std::endl;
+        return false;
+    }
+    BC7VolumeCacheHeader header{BC7_VOLUME_CACHE_MAGIC, BC7_VOLUME_CACHE_VERSION, dimensions,
+        static_cast<uint32_t>(volume.mipOffsets.size()), sourceHash, volume.psnr};
+    outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    outFile.write(reinterpret_cast<const char *>(volume.blocks.data()), volume.blocks.size());
+    return false;
+}
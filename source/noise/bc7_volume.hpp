@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+/* Full mip chain of a 3D texture stored as BC7 blocks, every mip is a stack of 2D slices
+   of 4x4 blocks (the layout vkCmdCopyBufferToImage expects with tightly packed rows) */
+struct BC7Volume
+{
+    glm::ivec3 dimensions;
+    std::vector<uint8_t> blocks;
+    /* Offset in bytes of the first block of each mip in blocks */
+    std::vector<size_t> mipOffsets;
+    /* Per channel PSNR of mip 0 against the source texels, only filled by
+       loadOrEncodeBC7Volume, see computeBC7VolumePSNR */
+    glm::vec4 psnr = glm::vec4(0.0f);
+};
+
+/**
+ * Encode RGBA16F volume (f.e. the output of bakeWorleyNoise) together with its box
+ * filtered mip chain into BC7. Every block uses mode 6 (single subset, 7 bit RGBA
+ * endpoints with a p-bit, 4 bit indices) -> the values are expected in [0, 1]
+ * @param texels - RGBA16F texels of mip 0, x is the fastest changing coordinate
+ * @param threadCount - number of worker threads the slices are spread over, 0 means
+ *      hardware concurrency
+ */
+void encodeBC7Volume(const std::vector<uint16_t> &texels, glm::ivec3 dimensions,
+    BC7Volume &volume, uint32_t threadCount = 0);
+
+/**
+ * Decode one mode 6 block produced by encodeBC7Volume, other modes are not supported
+ * @param texels - 4x4 texels of the block in [0, 1], row major
+ */
+void decodeBC7Block(const uint8_t *block, glm::vec4 texels[16]);
+
+/**
+ * @return per channel peak signal to noise ratio in dB of mip 0 of volume against the
+ *      RGBA16F texels it was encoded from, infinity for lossless channels
+ */
+glm::vec4 computeBC7VolumePSNR(const std::vector<uint16_t> &texels, const BC7Volume &volume,
+    uint32_t threadCount = 0);
+
+/**
+ * Load the BC7 volume encoded from texels from cachePath, the cache stores a hash of the
+ * source texels -> rebaking the noise invalidates it. Otherwise encode and write the cache.
+ * The PSNR of the encoding is stored in the cache as well -> it is only computed on a miss
+ * @return true if the volume was loaded from cache
+ */
+bool loadOrEncodeBC7Volume(const std::vector<uint16_t> &texels, glm::ivec3 dimensions,
+    BC7Volume &volume, const std::string &cachePath);
@@ -0,0 +1,198 @@
+#include <cmath>
+#include <random>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <filesystem>
+
+#include "blue_noise.hpp"
+
+/* Version of the cache file layout, bump when the generator output changes */
+static const uint32_t BLUE_NOISE_CACHE_MAGIC = 0x4E425341; // "ASBN"
+static const uint32_t BLUE_NOISE_CACHE_VERSION = 1;
+
+struct BlueNoiseCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t seed;
+};
+
+/* Binary pattern together with the gaussian energy of its set pixels evaluated
+   at every pixel, the energy is updated incrementally which makes finding the
+   tightest cluster and the largest void a single linear scan */
+class VoidAndClusterPattern
+{
+    public:
+        std::vector<uint8_t> pattern;
+        std::vector<float> energy;
+
+        VoidAndClusterPattern(int size) : size{size}
+        {
+            pattern.resize(size * size, 0);
+            energy.resize(size * size, 0.0f);
+
+            /* Precompute toroidally wrapped kernel so the texture tiles seamlessly,
+               sigma 1.5 is the value recommended in the original paper */
+            const float sigma = 1.5f;
+            kernel.resize(size * size);
+            for(int y = 0; y < size; y++)
+            {
+                for(int x = 0; x < size; x++)
+                {
+                    float dx = static_cast<float>(std::min(x, size - x));
+                    float dy = static_cast<float>(std::min(y, size - y));
+                    kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+                }
+            }
+        }
+
+        void set(int index, bool value)
+        {
+            if((pattern[index] != 0) == value) { return; }
+            pattern[index] = value ? 1 : 0;
+            float sign = value ? 1.0f : -1.0f;
+            int px = index % size;
+            int py = index / size;
+            for(int y = 0; y < size; y++)
+            {
+                int ky = ((y - py) & (size - 1)) * size;
+                for(int x = 0; x < size; x++)
+                {
+                    energy[y * size + x] += sign * kernel[ky + ((x - px) & (size - 1))];
+                }
+            }
+        }
+
+        /* Set pixel with the highest energy */
+        int tightestCluster() const
+        {
+            int best = -1;
+            for(int i = 0; i < size * size; i++)
+            {
+                if(pattern[i] && (best == -1 || energy[i] > energy[best])) { best = i; }
+            }
+            return best;
+        }
+
+        /* Unset pixel with the lowest energy */
+        int largestVoid() const
+        {
+            int best = -1;
+            for(int i = 0; i < size * size; i++)
+            {
+                if(!pattern[i] && (best == -1 || energy[i] < energy[best])) { best = i; }
+            }
+            return best;
+        }
+
+    private:
+        int size;
+        std::vector<float> kernel;
+};
+
+void generateBlueNoise(std::vector<uint8_t> &buffer, int size, uint32_t seed)
+{
+    if(size <= 0 || (size & (size - 1)) != 0)
+    {
+        throw std::runtime_error("BLUE_NOISE::GENERATE::Size has to be power of two");
+    }
+    int pixelCount = size * size;
+    std::vector<int> ranks(pixelCount, 0);
+
+    #pragma region initialPattern
+    /* Random pattern with ~10% of pixels set, redistributed by repeatedly moving
+       the tightest cluster into the largest void until the two coincide */
+    VoidAndClusterPattern initial(size);
+    std::mt19937 mt = std::mt19937(seed);
+    std::uniform_int_distribution<int> distribution(0, pixelCount - 1);
+    int initialCount = std::max(pixelCount / 10, 1);
+    for(int placed = 0; placed < initialCount;)
+    {
+        int index = distribution(mt);
+        if(initial.pattern[index]) { continue; }
+        initial.set(index, true);
+        placed++;
+    }
+
+    while(true)
+    {
+        int cluster = initial.tightestCluster();
+        initial.set(cluster, false);
+        int largestVoid = initial.largestVoid();
+        initial.set(largestVoid, true);
+        if(largestVoid == cluster) { break; }
+    }
+    #pragma endregion initialPattern
+
+    #pragma region phaseOne
+    /* Remove the tightest clusters one by one, ranking them from initialCount-1 down to 0 */
+    VoidAndClusterPattern working = initial;
+    for(int rank = initialCount - 1; rank >= 0; rank--)
+    {
+        int cluster = working.tightestCluster();
+        working.set(cluster, false);
+        ranks[cluster] = rank;
+    }
+    #pragma endregion phaseOne
+
+    #pragma region phaseTwoAndThree
+    /* Fill the largest voids until every pixel is ranked, the second half is
+       filled the same way instead of inverting the pattern -> the energy of
+       the set pixels is already what phase three would minimize */
+    working = std::move(initial);
+    for(int rank = initialCount; rank < pixelCount; rank++)
+    {
+        int largestVoid = working.largestVoid();
+        working.set(largestVoid, true);
+        ranks[largestVoid] = rank;
+    }
+    #pragma endregion phaseTwoAndThree
+
+    buffer.resize(pixelCount);
+    for(int i = 0; i < pixelCount; i++)
+    {
+        buffer[i] = static_cast<uint8_t>((static_cast<int64_t>(ranks[i]) * 256) / pixelCount);
+    }
+}
+
+bool loadOrGenerateBlueNoise(std::vector<uint8_t> &buffer, int size, uint32_t seed,
+    const std::string &cachePath)
+{
+    std::ifstream cacheFile(cachePath, std::ios::binary);
+    if(cacheFile)
+    {
+        BlueNoiseCacheHeader header{};
+        cacheFile.read(reinterpret_cast<char *>(&header), sizeof(header));
+        bool valid = cacheFile && header.magic == BLUE_NOISE_CACHE_MAGIC &&
+            header.version == BLUE_NOISE_CACHE_VERSION &&
+            header.size == static_cast<uint32_t>(size) && header.seed == seed;
+        if(valid)
+        {
+            buffer.resize(size * size);
+            cacheFile.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+            if(cacheFile) { return true; }
+        }
+    }
+    cacheFile.close();
+
+    generateBlueNoise(buffer, size, seed);
+
+    /* Failing to write the cache is not fatal, the texture just gets regenerated next run */
+    std::error_code error;
+    std::filesystem::path path(cachePath);
+    if(path.has_parent_path()) { std::filesystem::create_directories(path.parent_path(), error); }
+    std::ofstream outFile(cachePath, std::ios::binary);
+    if(!outFile)
+    {
+        std::cout << "BLUE_NOISE::LOAD_OR_GENERATE::Failed to write cache " << cachePath << std::endl;
+        return false;
+    }
+    BlueNoiseCacheHeader header{BLUE_NOISE_CACHE_MAGIC, BLUE_NOISE_CACHE_VERSION,
+        static_cast<uint32_t>(size), seed};
+    outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    outFile.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    return false;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/**
+ * Generate tileable size x size blue noise texture using the void and cluster method
+ *      -> Ulichney, "The void-and-cluster method for dither array generation" 1993
+ * @param buffer - resized to size^2 and filled with row major UNORM8 values, every
+ *      value is used (size^2 / 256) times
+ * @param size - width and height of the texture, has to be power of two
+ * @param seed - seed of the initial binary pattern, same seed gives the same texture
+ */
+void generateBlueNoise(std::vector<uint8_t> &buffer, int size, uint32_t seed);
+
+/**
+ * Load blue noise texture from cachePath, when the cache is missing or was generated
+ * with different size or seed the texture is generated and the cache is written
+ * @return true if the texture was loaded from cache
+ */
+bool loadOrGenerateBlueNoise(std::vector<uint8_t> &buffer, int size, uint32_t seed,
+    const std::string &cachePath);
@@ -0,0 +1,114 @@
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <algorithm>
+
+#include "coverage_map.hpp"
+
+/* Number of fractal octaves and lattice cells along the edge of the first one */
+static const int COVERAGE_OCTAVES = 5;
+static const int COVERAGE_BASE_PERIOD = 4;
+
+static float smootherStep(float t)
+{
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+void generateCoverageMap(std::vector<uint8_t> &buffer, int size, uint32_t seed)
+{
+    if(size <= 0 || (size & (size - 1)) != 0)
+    {
+        throw std::runtime_error("COVERAGE_MAP::GENERATE::Size has to be power of two");
+    }
+
+    std::mt19937 mt = std::mt19937(seed);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+    std::vector<float> values(size * size, 0.0f);
+
+    float amplitude = 1.0f;
+    for(int octave = 0; octave < COVERAGE_OCTAVES; octave++)
+    {
+        /* Lattice period divides the map size -> every octave tiles seamlessly */
+        int period = std::min(COVERAGE_BASE_PERIOD << octave, size);
+        std::vector<float> lattice(period * period);
+        for(float &value : lattice) { value = distribution(mt); }
+
+        float cellSize = float(size) / float(period);
+        for(int y = 0; y < size; y++)
+        {
+            float cellY = float(y) / cellSize;
+            int y0 = static_cast<int>(cellY);
+            float ty = smootherStep(cellY - float(y0));
+            int y1 = (y0 + 1) % period;
+            for(int x = 0; x < size; x++)
+            {
+                float cellX = float(x) / cellSize;
+                int x0 = static_cast<int>(cellX);
+                float tx = smootherStep(cellX - float(x0));
+                int x1 = (x0 + 1) % period;
+
+                float top = lattice[y0 * period + x0] * (1.0f - tx) + lattice[y0 * period + x1] * tx;
+                float bottom = lattice[y1 * period + x0] * (1.0f - tx) + lattice[y1 * period + x1] * tx;
+                values[y * size + x] += amplitude * (top * (1.0f - ty) + bottom * ty);
+            }
+        }
+        amplitude *= 0.5f;
+    }
+
+    auto range = std::minmax_element(values.begin(), values.end());
+    float minValue = *range.first;
+    float scale = *range.second > minValue ? 1.0f / (*range.second - minValue) : 0.0f;
+
+    buffer.resize(size * size);
+    for(int i = 0; i < size * size; i++)
+    {
+        buffer[i] = static_cast<uint8_t>(std::lround((values[i] - minValue) * scale * 255.0f));
+    }
+}
+
+void buildCoverageMaxMips(std::vector<uint8_t> &mipChain, int size)
+{
+    if(size <= 0 || (size & (size - 1)) != 0 || mipChain.size() < size_t(size * size))
+    {
+        throw std::runtime_error("COVERAGE_MAP::BUILD_MAX_MIPS::Invalid level 0");
+    }
+    mipChain.resize(size * size);
+
+    /* Dilate level 0 by one texel with wrapping, the map is sampled with repeat addressing */
+    std::vector<uint8_t> previous(size * size);
+    for(int y = 0; y < size; y++)
+    {
+        for(int x = 0; x < size; x++)
+        {
+            uint8_t maximum = 0;
+            for(int dy = -1; dy <= 1; dy++)
+            {
+                for(int dx = -1; dx <= 1; dx++)
+                {
+                    int sx = (x + dx + size) & (size - 1);
+                    int sy = (y + dy + size) & (size - 1);
+                    maximum = std::max(maximum, mipChain[sy * size + sx]);
+                }
+            }
+            previous[y * size + x] = maximum;
+        }
+    }
+
+    for(int levelSize = size / 2; levelSize >= 1; levelSize /= 2)
+    {
+        std::vector<uint8_t> level(levelSize * levelSize);
+        int previousSize = levelSize * 2;
+        for(int y = 0; y < levelSize; y++)
+        {
+            for(int x = 0; x < levelSize; x++)
+            {
+                const uint8_t *row0 = &previous[(2 * y) * previousSize + 2 * x];
+                const uint8_t *row1 = row0 + previousSize;
+                level[y * levelSize + x] = std::max(std::max(row0[0], row0[1]),
+                    std::max(row1[0], row1[1]));
+            }
+        }
+        mipChain.insert(mipChain.end(), level.begin(), level.end());
+        previous = std::move(level);
+    }
+}
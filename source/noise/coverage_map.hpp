@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * Generate tileable size x size clouds coverage (weather) map as fractal value noise
+ * @param buffer - resized to size^2 and filled with row major UNORM8 values
+ *      normalized to use the whole [0, 255] range
+ * @param size - width and height of the map, has to be power of two
+ * @param seed - seed of the noise lattice, same seed gives the same map
+ */
+void generateCoverageMap(std::vector<uint8_t> &buffer, int size, uint32_t seed);
+
+/**
+ * Append the max mip chain of the coverage map to mipChain which holds level 0
+ * -> texel of level i is the maximum over its 2^i x 2^i block of level 0 dilated
+ *    by one texel, so a zero texel guarantees that bilinear sampling of level 0
+ *    returns zero anywhere inside of it
+ * @param mipChain - row major level 0 of size^2 texels, levels 1 to log2(size) are
+ *      appended in order, level i is (size >> i)^2 texels
+ * @param size - width and height of level 0, has to be power of two
+ */
+void buildCoverageMaxMips(std::vector<uint8_t> &mipChain, int size);
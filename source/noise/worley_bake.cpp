@@ -0,0 +1,338 @@
+#include <cmath>
+#include <random>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+#include <glm/gtc/packing.hpp>
+
+#include "worley_bake.hpp"
+#include "worley_points.hpp"
+#include "clouds/tile_thread_pool.hpp"
+
+/* Version of the cache file layout, bump when the baker output changes */
+static const uint32_t WORLEY_NOISE_CACHE_MAGIC = 0x4E575341; // "ASWN"
+static const uint32_t WORLEY_NOISE_CACHE_VERSION = 2;
+
+struct WorleyNoiseCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seed;
+    glm::ivec3 texDimensions;
+    WorleyNoiseCreateParams params;
+};
+
+WorleyNoiseDesc getShapeNoiseDesc()
+{
+    WorleyNoiseDesc desc {};
+    desc.texDimensions = glm::ivec3(256, 256, 256);
+    desc.params.numDivisionsRChannel = glm::ivec3(3, 8, 18);
+    desc.params.numDivisionsGChannel = glm::ivec3(7, 15, 28);
+    desc.params.numDivisionsBChannel = glm::ivec3(9, 18, 31);
+    desc.params.numDivisionsAChannel = glm::ivec3(14, 22, 43);
+    desc.params.persistenceRChannel = 0.75f;
+    desc.params.persistenceGChannel = 0.95f;
+    desc.params.persistenceBChannel = 0.85f;
+    desc.params.persistenceAChannel = 0.85f;
+    desc.seed = 123u;
+    return desc;
+}
+
+WorleyNoiseDesc getDetailNoiseDesc()
+{
+    WorleyNoiseDesc desc {};
+    desc.texDimensions = glm::ivec3(128, 128, 128);
+    desc.params.numDivisionsRChannel = glm::ivec3(7, 15, 22);
+    desc.params.numDivisionsGChannel = glm::ivec3(14, 21, 34);
+    desc.params.numDivisionsBChannel = glm::ivec3(19, 29, 37);
+    desc.params.numDivisionsAChannel = glm::ivec3(33, 45, 49);
+    desc.params.persistenceRChannel = 0.82f;
+    desc.params.persistenceGChannel = 0.73f;
+    desc.params.persistenceBChannel = 0.82f;
+    desc.params.persistenceAChannel = 0.85f;
+    desc.seed = 123u;
+    return desc;
+}
+
+#pragma region perlin
+/* Same hash and gradient noise as worley_noise_3D, including the uint wrap arounds */
+static glm::vec3 hash33(glm::vec3 p)
+{
+    const glm::uvec3 UI3 = glm::uvec3(1597334673u, 3812015801u, 2798796415u);
+    const float UIF = 1.0f / float(0xffffffffu);
+    glm::uvec3 q = glm::uvec3(glm::ivec3(p)) * UI3;
+    q = glm::uvec3(q.x ^ q.y ^ q.z) * UI3;
+    return -1.0f + 2.0f * glm::vec3(q) * UIF;
+}
+
+static float gradientNoise(glm::vec3 x, float freq)
+{
+    glm::vec3 p = glm::floor(x);
+    glm::vec3 w = glm::fract(x);
+    glm::vec3 u = w * w * w * (w * (w * 6.0f - 15.0f) + 10.0f);
+
+    float values[8];
+    for(int corner = 0; corner < 8; corner++)
+    {
+        glm::vec3 offset = glm::vec3(corner & 1, (corner >> 1) & 1, corner >> 2);
+        values[corner] = glm::dot(hash33(glm::mod(p + offset, freq)), w - offset);
+    }
+    float va = values[0], vb = values[1], vc = values[2], vd = values[3];
+    float ve = values[4], vf = values[5], vg = values[6], vh = values[7];
+
+    return va +
+           u.x * (vb - va) +
+           u.y * (vc - va) +
+           u.z * (ve - va) +
+           u.x * u.y * (va - vb - vc + vd) +
+           u.y * u.z * (va - vc - ve + vg) +
+           u.z * u.x * (va - vb - ve + vf) +
+           u.x * u.y * u.z * (-va + vb + vc - vd + ve - vf - vg + vh);
+}
+
+static float perlinfbm(glm::vec3 p, float freq, int octaves)
+{
+    float G = std::exp2(-0.85f);
+    float amp = 1.0f;
+    float noise = 0.0f;
+    for(int i = 0; i < octaves; i++)
+    {
+        noise += amp * gradientNoise(p * freq, freq);
+        freq *= 2.0f;
+        amp *= G;
+    }
+    return noise;
+}
+#pragma endregion perlin
+
+/**
+ * Worley noise of one row of texels of a layer, texels sharing a cell share its 27
+ * candidate points -> the candidates are the outer loop and the run of texels inside
+ * of the cell the inner one, which is branch free and contiguous so it vectorizes
+ * @param rowDistances - filled with the distance to the closest point of every texel
+ */
+static void worleyRow(const std::vector<glm::vec4> &points, int numCells,
+    const std::vector<float> &rowX, float posY, float posZ, std::vector<float> &rowDistances)
+{
+    int width = static_cast<int>(rowX.size());
+    int paddedCells = numCells + 2;
+    int cellY = static_cast<int>(std::floor(posY * numCells));
+    int cellZ = static_cast<int>(std::floor(posZ * numCells));
+    std::fill(rowDistances.begin(), rowDistances.end(), 1.0f);
+
+    int runStart = 0;
+    while(runStart < width)
+    {
+        int cellX = static_cast<int>(std::floor(rowX[runStart] * numCells));
+        int runEnd = runStart + 1;
+        while(runEnd < width && static_cast<int>(std::floor(rowX[runEnd] * numCells)) == cellX) { runEnd++; }
+
+        float *distances = rowDistances.data();
+        const float *texelX = rowX.data();
+        for(int offset = 0; offset < 27; offset++)
+        {
+            glm::ivec3 cell = glm::ivec3(cellX, cellY, cellZ) +
+                glm::ivec3(offset % 3, (offset / 3) % 3, offset / 9);
+            const glm::vec4 &point = points[cell.x + paddedCells * (cell.y + cell.z * paddedCells)];
+            float offsetY = posY - point.y;
+            float offsetZ = posZ - point.z;
+            float sqrDistYZ = offsetY * offsetY + offsetZ * offsetZ;
+            for(int texel = runStart; texel < runEnd; texel++)
+            {
+                float offsetX = texelX[texel] - point.x;
+                distances[texel] = std::min(distances[texel], offsetX * offsetX + sqrDistYZ);
+            }
+        }
+        runStart = runEnd;
+    }
+    for(float &distance : rowDistances) { distance = std::sqrt(distance); }
+}
+
+void bakeWorleyNoise(std::vector<uint16_t> &buffer, const WorleyNoiseDesc &desc,
+    uint32_t threadCount)
+{
+    glm::ivec3 dims = desc.texDimensions;
+    std::array<glm::ivec3, 4> numDivisionsChannels = {
+        desc.params.numDivisionsRChannel,
+        desc.params.numDivisionsGChannel,
+        desc.params.numDivisionsBChannel,
+        desc.params.numDivisionsAChannel
+    };
+    std::array<float, 4> persistenceChannels = {
+        desc.params.persistenceRChannel,
+        desc.params.persistenceGChannel,
+        desc.params.persistenceBChannel,
+        desc.params.persistenceAChannel
+    };
+
+    /* Same per layer engines as WorleyNoise3D */
+    std::mt19937 mt;
+    std::uniform_real_distribution<float> distribution(0, 1);
+    std::array<std::array<std::vector<glm::vec4>, 3>, 4> points;
+    std::vector<glm::vec3> layerPoints;
+    for(int channel = 0; channel < 4; channel++)
+    {
+        for(int layer = 0; layer < 3; layer++)
+        {
+            mt.seed(getWorleyLayerSeed(desc.seed, channel, layer));
+            generateWorleyPoints(layerPoints, numDivisionsChannels[channel][layer], mt, distribution);
+            padWorleyPoints(layerPoints, numDivisionsChannels[channel][layer], points[channel][layer]);
+        }
+    }
+
+    size_t sliceTexels = static_cast<size_t>(dims.x) * dims.y;
+    buffer.resize(sliceTexels * dims.z * 4);
+    std::vector<glm::vec4> sliceMin(dims.z, glm::vec4(INFINITY));
+    std::vector<glm::vec4> sliceMax(dims.z, glm::vec4(-INFINITY));
+
+    std::vector<float> rowX(dims.x);
+    for(int x = 0; x < dims.x; x++) { rowX[x] = float(x) / float(dims.x); }
+
+    TileThreadPool threadPool(threadCount);
+    /* Raw values are stored as fp16 before normalization the same way the GPU stores
+       them into the noise volume, min max come from the fp32 values */
+    threadPool.run(static_cast<uint32_t>(dims.z), [&](uint32_t z)
+    {
+        std::array<std::vector<float>, 3> layers;
+        for(auto &layer : layers) { layer.resize(dims.x); }
+        std::vector<float> noiseSum(dims.x);
+        float posZ = float(z) / float(dims.z);
+        for(int y = 0; y < dims.y; y++)
+        {
+            float posY = float(y) / float(dims.y);
+            uint16_t *row = buffer.data() + (z * sliceTexels + y * dims.x) * 4;
+            for(int channel = 0; channel < 4; channel++)
+            {
+                for(int layer = 0; layer < 3; layer++)
+                {
+                    worleyRow(points[channel][layer], numDivisionsChannels[channel][layer], rowX,
+                        posY, posZ, layers[layer]);
+                }
+
+                /* Same expression order as the kernel -> same rounding */
+                float persistence = persistenceChannels[channel];
+                float localMaxVal = 1 + (persistence) + (persistence * persistence);
+                for(int x = 0; x < dims.x; x++)
+                {
+                    float sum = layers[0][x] + (layers[1][x] * persistence) +
+                        (layers[2][x] * persistence * persistence);
+                    noiseSum[x] = 1.0f - sum / localMaxVal;
+                }
+
+                if(numDivisionsChannels[channel].x == 3)
+                {
+                    for(int x = 0; x < dims.x; x++)
+                    {
+                        float pfbm = glm::mix(1.0f, perlinfbm(glm::vec3(rowX[x], posY, posZ), 4.0f, 7), 0.5f);
+                        pfbm = std::abs(pfbm * 2.0f - 1.0f);
+                        /* remap(pfbm, 0.0, 1.0, noiseSum, 1.0) */
+                        noiseSum[x] = pfbm * (1.0f - noiseSum[x]) + noiseSum[x];
+                    }
+                }
+
+                for(int x = 0; x < dims.x; x++)
+                {
+                    sliceMin[z][channel] = std::min(sliceMin[z][channel], noiseSum[x]);
+                    sliceMax[z][channel] = std::max(sliceMax[z][channel], noiseSum[x]);
+                    row[x * 4 + channel] = glm::packHalf1x16(noiseSum[x]);
+                }
+            }
+        }
+    });
+
+    glm::vec4 minVal = glm::vec4(INFINITY);
+    glm::vec4 maxVal = glm::vec4(-INFINITY);
+    for(int z = 0; z < dims.z; z++)
+    {
+        minVal = glm::min(minVal, sliceMin[z]);
+        maxVal = glm::max(maxVal, sliceMax[z]);
+    }
+    glm::vec4 range = glm::max(maxVal - minVal, glm::vec4(1e-6f));
+
+    threadPool.run(static_cast<uint32_t>(dims.z), [&](uint32_t z)
+    {
+        uint16_t *slice = buffer.data() + z * sliceTexels * 4;
+        for(size_t i = 0; i < sliceTexels * 4; i++)
+        {
+            int channel = static_cast<int>(i % 4);
+            slice[i] = glm::packHalf1x16((glm::unpackHalf1x16(slice[i]) - minVal[channel]) / range[channel]);
+        }
+    });
+}
+
+std::string getWorleyNoiseCachePath(const std::string &cacheDirectory, const WorleyNoiseDesc &desc)
+{
+    /* FNV-1a over the fields one by one -> struct padding does not end up in the hash */
+    uint64_t hash = 14695981039346656037ull;
+    auto hashBytes = [&hash](const void *data, size_t size)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        for(size_t i = 0; i < size; i++) { hash = (hash ^ bytes[i]) * 1099511628211ull; }
+    };
+    hashBytes(&WORLEY_NOISE_CACHE_VERSION, sizeof(uint32_t));
+    hashBytes(&desc.seed, sizeof(desc.seed));
+    hashBytes(&desc.texDimensions, sizeof(desc.texDimensions));
+    hashBytes(&desc.params, sizeof(desc.params));
+
+    std::ostringstream path;
+    path << cacheDirectory << "/worley_noise_" << desc.texDimensions.x << "_" << std::hex <<
+        std::setw(16) << std::setfill('0') << hash << ".bin";
+    return path.str();
+}
+
+bool loadWorleyNoiseCache(std::vector<uint16_t> &buffer, const WorleyNoiseDesc &desc,
+    const std::string &cachePath)
+{
+    size_t bufferSize = static_cast<size_t>(desc.texDimensions.x) * desc.texDimensions.y *
+        desc.texDimensions.z * 4;
+
+    std::ifstream cacheFile(cachePath, std::ios::binary);
+    if(!cacheFile) { return false; }
+
+    WorleyNoiseCacheHeader header{};
+    cacheFile.read(reinterpret_cast<char *>(&header), sizeof(header));
+    bool valid = cacheFile && header.magic == WORLEY_NOISE_CACHE_MAGIC &&
+        header.version == WORLEY_NOISE_CACHE_VERSION && header.seed == desc.seed &&
+        header.texDimensions == desc.texDimensions &&
+        std::memcmp(&header.params, &desc.params, sizeof(WorleyNoiseCreateParams)) == 0;
+    if(!valid) { return false; }
+
+    buffer.resize(bufferSize);
+    cacheFile.read(reinterpret_cast<char *>(buffer.data()), bufferSize * sizeof(uint16_t));
+    return static_cast<bool>(cacheFile);
+}
+
+void writeWorleyNoiseCache(const std::vector<uint16_t> &buffer, const WorleyNoiseDesc &desc,
+    const std::string &cachePath)
+{
+    /* Failing to write the cache is not fatal, the noise just gets baked again next run */
+    std::error_code error;
+    std::filesystem::path path(cachePath);
+    if(path.has_parent_path()) { std::filesystem::create_directories(path.parent_path(), error); }
+    std::ofstream outFile(cachePath, std::ios::binary);
+    if(!outFile)
+    {
+        std::cout << "WORLEY_BAKE::WRITE_CACHE::Failed to write cache " << cachePath << std::endl;
+        return;
+    }
+    WorleyNoiseCacheHeader header{WORLEY_NOISE_CACHE_MAGIC, WORLEY_NOISE_CACHE_VERSION, desc.seed,
+        desc.texDimensions, desc.params};
+    outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    outFile.write(reinterpret_cast<const char *>(buffer.data()), buffer.size() * sizeof(uint16_t));
+}
+
+bool loadOrBakeWorleyNoise(std::vector<uint16_t> &buffer, const WorleyNoiseDesc &desc,
+    const std::string &cachePath)
+{
+    if(loadWorleyNoiseCache(buffer, desc, cachePath)) { return true; }
+
+    bakeWorleyNoise(buffer, desc);
+    writeWorleyNoiseCache(buffer, desc, cachePath);
+    return false;
+}
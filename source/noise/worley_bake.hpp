@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+struct WorleyNoiseCreateParams
+{
+    glm::ivec3 numDivisionsRChannel;
+    glm::ivec3 numDivisionsGChannel;
+    glm::ivec3 numDivisionsBChannel;
+    glm::ivec3 numDivisionsAChannel;
+    float persistenceRChannel;
+    float persistenceGChannel;
+    float persistenceBChannel;
+    float persistenceAChannel;
+};
+
+/* Everything the content of one noise volume depends on */
+struct WorleyNoiseDesc
+{
+    glm::ivec3 texDimensions;
+    WorleyNoiseCreateParams params;
+    uint32_t seed;
+};
+
+/* Shape and detail noise volumes sampled by the clouds, shared by the renderer and
+   atmosphere_noise_baker so that the offline baked caches match what the renderer asks for */
+WorleyNoiseDesc getShapeNoiseDesc();
+WorleyNoiseDesc getDetailNoiseDesc();
+
+/**
+ * CPU reference of worley_noise_3D followed by normalize_noise_3D -> same points, same
+ * perlin fbm blend and the same per channel min max normalization of the fp16 values
+ * @param buffer - resized to the texel count * 4 and filled with RGBA16F texels of mip 0,
+ *      x is the fastest changing coordinate
+ * @param threadCount - number of worker threads the z slabs are spread over, 0 means
+ *      hardware concurrency
+ */
+void bakeWorleyNoise(std::vector<uint16_t> &buffer, const WorleyNoiseDesc &desc,
+    uint32_t threadCount = 0);
+
+/**
+ * @return path of the cache file of desc inside of cacheDirectory, the name holds a hash
+ *      of desc so the caches of different volumes can live next to each other
+ */
+std::string getWorleyNoiseCachePath(const std::string &cacheDirectory, const WorleyNoiseDesc &desc);
+
+/**
+ * @return true if cachePath holds the noise described by desc baked by this version of
+ *      the baker, buffer is filled with its RGBA16F texels
+ */
+bool loadWorleyNoiseCache(std::vector<uint16_t> &buffer, const WorleyNoiseDesc &desc,
+    const std::string &cachePath);
+
+/* Store RGBA16F texels of the noise described by desc (baked or generated on the GPU) */
+void writeWorleyNoiseCache(const std::vector<uint16_t> &buffer, const WorleyNoiseDesc &desc,
+    const std::string &cachePath);
+
+/**
+ * Load the noise described by desc from cachePath, when the cache is missing or was
+ * baked from a different desc or by an older baker the noise is baked and the cache is written
+ * @return true if the noise was loaded from cache
+ */
+bool loadOrBakeWorleyNoise(std::vector<uint16_t> &buffer, const WorleyNoiseDesc &desc,
+    const std::string &cachePath);
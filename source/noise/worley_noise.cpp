@@ -1,306 +1,122 @@
 #include "worley_noise.hpp"
 #define MAX_DIV_CNT 50
 #define CHANNEL_CNT 4
+/* Depth in texels of the z slabs the volume is generated in by generateSlabs */
+#define WORLEY_SLAB_DEPTH 16
 
-WorleyNoise3D::WorleyNoise3D(glm::ivec3 texDimensions, WorleyNoiseCreateParams params, 
-    std::shared_ptr<VulkanDevice> device, VkDescriptorPool pool) : 
-    texDimensions{texDimensions}, params{params}, device{device}
+WorleyNoise3D::WorleyNoise3D(const WorleyNoiseDesc &desc, std::shared_ptr<VulkanDevice> device) : 
+    seed{desc.seed}, texDimensions{desc.texDimensions}, params{desc.params}, device{device}
 {
-    /* TODO: replace with randomly generated number after possibly */
-    mt = std::mt19937(123);
-    // mt = std::mt19937(12312341234);
+    mt = std::mt19937(seed);
     distribution = std::uniform_real_distribution<float>(0,1);
 
-    noiseImage = std::make_unique<VulkanImage>(device, texDimensions.x,
-        texDimensions.y, 1, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R16G16B16A16_SFLOAT,
-        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT, texDimensions.z);
-    
-    noiseImage->TransitionImageLayout(VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_GENERAL, 1);
-    /* ====================== Channel independent Buffer Creation ================================ */
-    VkDeviceSize maxBufferSize = MAX_DIV_CNT * MAX_DIV_CNT * MAX_DIV_CNT * sizeof(glm::vec3);
-
-    for(int i = 0; i < CHANNEL_CNT; i++)
+    mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texDimensions.x,
+        std::max(texDimensions.y, texDimensions.z))))) + 1;
+
+    /* The sets have to outlive the renderer's pool which is recreated with the swapchain
+       -> the noise allocates them from its own */
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = 2;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[1].descriptorCount = 1;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[2].descriptorCount = 1 + 2 * (mipLevels - 1);
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    /* generate set and one downsample set per mip besides the last one */
+    poolInfo.maxSets = mipLevels;
+
+    if (vkCreateDescriptorPool(device->device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
     {
-        
-        perChannelData[i].oneChannelNoiseImage = std::make_unique<VulkanImage>(device, texDimensions.x,
-        texDimensions.y, 1, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R16_SFLOAT,
-        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT, texDimensions.z);
-
-        perChannelData[i].oneChannelNoiseImage->TransitionImageLayout(VK_FORMAT_R16_SFLOAT,
-            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 1);
-
-        perChannelData[i].pointsABuffer = std::make_unique<VulkanBuffer> (
-            device, maxBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-        perChannelData[i].pointsBBuffer = std::make_unique<VulkanBuffer> (
-            device, maxBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-        perChannelData[i].pointsCBuffer = std::make_unique<VulkanBuffer> (
-            device, maxBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-        perChannelData[i].minMaxBuffer = std::make_unique<VulkanBuffer> (
-            device, sizeof(MinMaxParamsBufferObject), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT); 
-
-        perChannelData[i].worleyParamsUBO = std::make_unique<VulkanBuffer> (
-            device, sizeof(WorleyParamsBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        throw std::runtime_error("WORLEY_NOISE_3D::Failed to create descriptor pool");
     }
 
     /* ====================== DS and DS Layout Creation ======================================= */
-    #pragma region worleyDSCreation
-    VkDescriptorSetLayoutBinding bufferADSLayoutBinding {};
-    bufferADSLayoutBinding.binding = 0;
-    bufferADSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    bufferADSLayoutBinding.descriptorCount = 1;
-    bufferADSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-    bufferADSLayoutBinding.pImmutableSamplers = nullptr;
-    
-    VkDescriptorSetLayoutBinding bufferBDSLayoutBinding {};
-    bufferBDSLayoutBinding.binding = 1;
-    bufferBDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    bufferBDSLayoutBinding.descriptorCount = 1;
-    bufferBDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-    bufferBDSLayoutBinding.pImmutableSamplers = nullptr;
-
-    VkDescriptorSetLayoutBinding bufferCDSLayoutBinding {};
-    bufferCDSLayoutBinding.binding = 2;
-    bufferCDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    bufferCDSLayoutBinding.descriptorCount = 1;
-    bufferCDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-    bufferCDSLayoutBinding.pImmutableSamplers = nullptr;
-    
-    VkDescriptorSetLayoutBinding bufferMinMaxDSLayoutBinding {};
-    bufferMinMaxDSLayoutBinding.binding = 3;
-    bufferMinMaxDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    bufferMinMaxDSLayoutBinding.descriptorCount = 1;
-    bufferMinMaxDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-    bufferMinMaxDSLayoutBinding.pImmutableSamplers = nullptr;
-
-    VkDescriptorSetLayoutBinding paramsUBODSLayoutBinding {};
-    paramsUBODSLayoutBinding.binding = 4;
-    paramsUBODSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    paramsUBODSLayoutBinding.descriptorCount = 1;
-    paramsUBODSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-    paramsUBODSLayoutBinding.pImmutableSamplers = nullptr;
-
-    VkDescriptorSetLayoutBinding resultImageDSLayoutBinding; 
-    resultImageDSLayoutBinding.binding = 5;
-    resultImageDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    resultImageDSLayoutBinding.descriptorCount = 1;
-    resultImageDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-    std::vector<VkDescriptorSetLayoutBinding> worleyComputeBindings = {
-        bufferADSLayoutBinding, bufferBDSLayoutBinding, bufferCDSLayoutBinding,
-        paramsUBODSLayoutBinding, resultImageDSLayoutBinding, bufferMinMaxDSLayoutBinding 
+    #pragma region generateDSCreation
+    /* binding 0 - points, binding 1 - min max, binding 2 - params, binding 3 - noise mip 0 */
+    std::array<VkDescriptorSetLayoutBinding, 4> generateBindings {};
+    std::array<VkDescriptorType, 4> generateBindingTypes = {
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
     };
-
-    VkDescriptorSetLayoutCreateInfo worleyComputeLayoutCI {};
-    worleyComputeLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    worleyComputeLayoutCI.bindingCount = 6;
-    worleyComputeLayoutCI.pBindings = worleyComputeBindings.data();
-
-    for(int i = 0; i < CHANNEL_CNT; i++)
+    for(uint32_t binding = 0; binding < 4; binding++)
     {
+        generateBindings[binding].binding = binding;
+        generateBindings[binding].descriptorType = generateBindingTypes[binding];
+        generateBindings[binding].descriptorCount = 1;
+        generateBindings[binding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        generateBindings[binding].pImmutableSamplers = nullptr;
+    }
 
-        if (vkCreateDescriptorSetLayout(device->device, &worleyComputeLayoutCI,
-            nullptr, &perChannelData[i].worleyNoiseDSLayout) != VK_SUCCESS)
-        {
-            throw std::runtime_error("WORLEY_NOISE_3D::Failed to create DS Layout");
-        }
-
-        VkDescriptorSetAllocateInfo allocInfo {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocInfo.descriptorPool = pool;
-        allocInfo.descriptorSetCount = 1;
-        allocInfo.pSetLayouts = &perChannelData[i].worleyNoiseDSLayout;
-
-        if (vkAllocateDescriptorSets(device->device, &allocInfo, &perChannelData[i].worleyNoiseDS) != VK_SUCCESS)
-        {
-            throw std::runtime_error("WORLEY_NOISE_3D::Failed to create Descriptor set");
-        }
+    VkDescriptorSetLayoutCreateInfo generateLayoutCI {};
+    generateLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    generateLayoutCI.bindingCount = 4;
+    generateLayoutCI.pBindings = generateBindings.data();
 
-        VkDescriptorBufferInfo bufferADSBufferInfo {};
-        bufferADSBufferInfo.buffer = perChannelData[i].pointsABuffer->buffer;
-        bufferADSBufferInfo.offset = 0;
-        bufferADSBufferInfo.range = maxBufferSize;
-
-        VkDescriptorBufferInfo bufferBDSBufferInfo {};
-        bufferBDSBufferInfo.buffer = perChannelData[i].pointsBBuffer->buffer;
-        bufferBDSBufferInfo.offset = 0;
-        bufferBDSBufferInfo.range = maxBufferSize;
-
-        VkDescriptorBufferInfo bufferCDSBufferInfo {};
-        bufferCDSBufferInfo.buffer = perChannelData[i].pointsCBuffer->buffer;
-        bufferCDSBufferInfo.offset = 0;
-        bufferCDSBufferInfo.range = maxBufferSize;
-
-        VkDescriptorBufferInfo bufferMinMaxDSBufferInfo {};
-        bufferMinMaxDSBufferInfo.buffer = perChannelData[i].minMaxBuffer->buffer;
-        bufferMinMaxDSBufferInfo.offset = 0;
-        bufferMinMaxDSBufferInfo.range = sizeof(MinMaxParamsBufferObject);
-
-        VkDescriptorBufferInfo paramsUBODSBufferInfo {};
-        paramsUBODSBufferInfo.buffer = perChannelData[i].worleyParamsUBO->buffer;
-        paramsUBODSBufferInfo.offset = 0;
-        paramsUBODSBufferInfo.range = sizeof(WorleyParamsBufferObject);
-
-        VkDescriptorImageInfo noiseImageDSInfo {};
-        noiseImageDSInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-        noiseImageDSInfo.imageView = perChannelData[i].oneChannelNoiseImage->imageView;
-
-        std::array<VkWriteDescriptorSet, 6> updateDescriptorWrites{};
-        updateDescriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        updateDescriptorWrites[0].dstSet = perChannelData[i].worleyNoiseDS;
-        updateDescriptorWrites[0].dstBinding = 0;
-        updateDescriptorWrites[0].dstArrayElement = 0;
-        updateDescriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        updateDescriptorWrites[0].descriptorCount = 1;
-        updateDescriptorWrites[0].pBufferInfo = &bufferADSBufferInfo;
-
-        updateDescriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        updateDescriptorWrites[1].dstSet = perChannelData[i].worleyNoiseDS;
-        updateDescriptorWrites[1].dstBinding = 1;
-        updateDescriptorWrites[1].dstArrayElement = 0;
-        updateDescriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        updateDescriptorWrites[1].descriptorCount = 1;
-        updateDescriptorWrites[1].pBufferInfo = &bufferBDSBufferInfo;
-
-        updateDescriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        updateDescriptorWrites[2].dstSet = perChannelData[i].worleyNoiseDS;
-        updateDescriptorWrites[2].dstBinding = 2;
-        updateDescriptorWrites[2].dstArrayElement = 0;
-        updateDescriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        updateDescriptorWrites[2].descriptorCount = 1;
-        updateDescriptorWrites[2].pBufferInfo = &bufferCDSBufferInfo;
-
-        updateDescriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        updateDescriptorWrites[3].dstSet = perChannelData[i].worleyNoiseDS;
-        updateDescriptorWrites[3].dstBinding = 3;
-        updateDescriptorWrites[3].dstArrayElement = 0;
-        updateDescriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        updateDescriptorWrites[3].descriptorCount = 1;
-        updateDescriptorWrites[3].pBufferInfo = &bufferMinMaxDSBufferInfo;
-
-        updateDescriptorWrites[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        updateDescriptorWrites[4].dstSet = perChannelData[i].worleyNoiseDS;
-        updateDescriptorWrites[4].dstBinding = 4;
-        updateDescriptorWrites[4].dstArrayElement = 0;
-        updateDescriptorWrites[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        updateDescriptorWrites[4].descriptorCount = 1;
-        updateDescriptorWrites[4].pBufferInfo = &paramsUBODSBufferInfo;
-
-        updateDescriptorWrites[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        updateDescriptorWrites[5].dstSet = perChannelData[i].worleyNoiseDS;
-        updateDescriptorWrites[5].dstBinding = 5;
-        updateDescriptorWrites[5].dstArrayElement = 0;
-        updateDescriptorWrites[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-        updateDescriptorWrites[5].descriptorCount = 1;
-        updateDescriptorWrites[5].pImageInfo = &noiseImageDSInfo;
-
-        vkUpdateDescriptorSets(device->device, static_cast<uint32_t>(updateDescriptorWrites.size()),
-                               updateDescriptorWrites.data(), 0, nullptr);
-    }
-
-    #pragma endregion DSCreation
-
-    #pragma region noiseDSCreation
-    VkDescriptorSetLayoutBinding normalizeBuffersMinMaxDSLayoutBinding {};
-    normalizeBuffersMinMaxDSLayoutBinding.binding = 0;
-    normalizeBuffersMinMaxDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    normalizeBuffersMinMaxDSLayoutBinding.descriptorCount = 4;
-    normalizeBuffersMinMaxDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-    normalizeBuffersMinMaxDSLayoutBinding.pImmutableSamplers = nullptr;
-
-    VkDescriptorSetLayoutBinding channelResultImageDSLayoutBinding; 
-    channelResultImageDSLayoutBinding.binding = 1;
-    channelResultImageDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    channelResultImageDSLayoutBinding.descriptorCount = 4;
-    channelResultImageDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-    VkDescriptorSetLayoutBinding combinedChannelsNoiseImageDSLayoutBinding {};
-    combinedChannelsNoiseImageDSLayoutBinding.binding = 2;
-    combinedChannelsNoiseImageDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    combinedChannelsNoiseImageDSLayoutBinding.descriptorCount = 1;
-    combinedChannelsNoiseImageDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-    std::vector<VkDescriptorSetLayoutBinding> normalizeWorleyComputeBindings = {
-        normalizeBuffersMinMaxDSLayoutBinding, channelResultImageDSLayoutBinding,
-        combinedChannelsNoiseImageDSLayoutBinding
-    };
+    if (vkCreateDescriptorSetLayout(device->device, &generateLayoutCI,
+        nullptr, &generateNoiseDSLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("WORLEY_NOISE_3D::Failed to create DS Layout");
+    }
 
-    VkDescriptorSetLayoutCreateInfo normalizeWorleyComputeLayoutCI {};
-    normalizeWorleyComputeLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    normalizeWorleyComputeLayoutCI.bindingCount = 3;
-    normalizeWorleyComputeLayoutCI.pBindings = normalizeWorleyComputeBindings.data();
+    VkDescriptorSetAllocateInfo allocInfo {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &generateNoiseDSLayout;
 
-    if (vkCreateDescriptorSetLayout(device->device, &normalizeWorleyComputeLayoutCI,
-        nullptr, &normalizeNoiseDSLayout) != VK_SUCCESS)
+    if (vkAllocateDescriptorSets(device->device, &allocInfo, &generateNoiseDS) != VK_SUCCESS)
     {
-        throw std::runtime_error("WORLEY_NOISE_3D::Failed to create normalize noise DS Layout");
+        throw std::runtime_error("WORLEY_NOISE_3D::Failed to create Descriptor set");
     }
+    /* Buffer bindings are written by generateNoise once the buffers exist, the image
+       binding by createNoiseImage */
+    #pragma endregion generateDSCreation
+
+    #pragma region downsampleDSCreation
+    /* binding 0 - source mip, binding 1 - destination mip */
+    std::array<VkDescriptorSetLayoutBinding, 2> downsampleBindings {};
+    for(uint32_t binding = 0; binding < 2; binding++)
+    {
+        downsampleBindings[binding].binding = binding;
+        downsampleBindings[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        downsampleBindings[binding].descriptorCount = 1;
+        downsampleBindings[binding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        downsampleBindings[binding].pImmutableSamplers = nullptr;
+    }
+
+    VkDescriptorSetLayoutCreateInfo downsampleLayoutCI {};
+    downsampleLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    downsampleLayoutCI.bindingCount = 2;
+    downsampleLayoutCI.pBindings = downsampleBindings.data();
 
-    VkDescriptorSetAllocateInfo normalizeAllocInfo {};
-    normalizeAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    normalizeAllocInfo.descriptorPool = pool;
-    normalizeAllocInfo.descriptorSetCount = 1;
-    normalizeAllocInfo.pSetLayouts = &normalizeNoiseDSLayout;
-    
-    if (vkAllocateDescriptorSets(device->device, &normalizeAllocInfo, &normalizeNoiseDS) != VK_SUCCESS)
+    if (vkCreateDescriptorSetLayout(device->device, &downsampleLayoutCI,
+        nullptr, &downsampleNoiseDSLayout) != VK_SUCCESS)
     {
-        throw std::runtime_error("WORLEY_NOISE_3D::Failed to create normalize noise Descriptor set");
+        throw std::runtime_error("WORLEY_NOISE_3D::Failed to create downsample noise DS Layout");
     }
 
-    std::array<VkDescriptorBufferInfo, 4> perChannelMinMaxBuffersInfo {};
-    std::array<VkDescriptorImageInfo, 4> perChannelResultImagesInfo {};
-    std::array<VkWriteDescriptorSet, 9> normalizeUpdateDS {};
-    for (int i = 0; i < CHANNEL_CNT; i++)
+    uint32_t downsampleCount = mipLevels - 1;
+    downsampleNoiseDS.resize(downsampleCount);
+    if(downsampleCount > 0)
     {
-        perChannelMinMaxBuffersInfo[i].buffer = perChannelData[i].minMaxBuffer->buffer;
-        perChannelMinMaxBuffersInfo[i].offset = 0;
-        perChannelMinMaxBuffersInfo[i].range = sizeof(MinMaxParamsBufferObject);
-
-        perChannelResultImagesInfo[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-        perChannelResultImagesInfo[i].imageView = perChannelData[i].oneChannelNoiseImage->imageView;
-
-        normalizeUpdateDS[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        normalizeUpdateDS[i].dstSet = normalizeNoiseDS;
-        normalizeUpdateDS[i].dstBinding = 0;
-        normalizeUpdateDS[i].dstArrayElement = i;
-        normalizeUpdateDS[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        normalizeUpdateDS[i].descriptorCount = 1;
-        normalizeUpdateDS[i].pBufferInfo = &perChannelMinMaxBuffersInfo[i];
-
-        normalizeUpdateDS[i + CHANNEL_CNT].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        normalizeUpdateDS[i + CHANNEL_CNT].dstSet = normalizeNoiseDS;
-        normalizeUpdateDS[i + CHANNEL_CNT].dstBinding = 1;
-        normalizeUpdateDS[i + CHANNEL_CNT].dstArrayElement = i;
-        normalizeUpdateDS[i + CHANNEL_CNT].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-        normalizeUpdateDS[i + CHANNEL_CNT].descriptorCount = 1;
-        normalizeUpdateDS[i + CHANNEL_CNT].pImageInfo = &perChannelResultImagesInfo[i];
-    }
-
-    VkDescriptorImageInfo finalImageDSInfo {};
-    finalImageDSInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-    finalImageDSInfo.imageView = noiseImage->imageView;
-
-    normalizeUpdateDS[8].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    normalizeUpdateDS[8].dstSet = normalizeNoiseDS;
-    normalizeUpdateDS[8].dstBinding = 2;
-    normalizeUpdateDS[8].dstArrayElement = 0;
-    normalizeUpdateDS[8].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    normalizeUpdateDS[8].descriptorCount = 1;
-    normalizeUpdateDS[8].pImageInfo = &finalImageDSInfo;
-
-    vkUpdateDescriptorSets(device->device, static_cast<uint32_t>(normalizeUpdateDS.size()),
-                           normalizeUpdateDS.data(), 0, nullptr);
-    #pragma end noiseDSCreation
+        std::vector<VkDescriptorSetLayout> downsampleLayouts(downsampleCount, downsampleNoiseDSLayout);
+        VkDescriptorSetAllocateInfo downsampleAllocInfo {};
+        downsampleAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        downsampleAllocInfo.descriptorPool = descriptorPool;
+        downsampleAllocInfo.descriptorSetCount = downsampleCount;
+        downsampleAllocInfo.pSetLayouts = downsampleLayouts.data();
+
+        if (vkAllocateDescriptorSets(device->device, &downsampleAllocInfo, downsampleNoiseDS.data()) != VK_SUCCESS)
+        {
+            throw std::runtime_error("WORLEY_NOISE_3D::Failed to create downsample noise Descriptor sets");
+        }
+    }
+    #pragma endregion downsampleDSCreation
 
     /* ===================== Create Vulkan pipelines ========================================== */
     auto worleyNoiseComputeShaderCode = readFile("shaders/build/worley_noise_3D.glsl.spv");
@@ -309,7 +125,7 @@ WorleyNoise3D::WorleyNoise3D(glm::ivec3 texDimensions, WorleyNoiseCreateParams p
 
     worleyNoisePipeline = std::make_unique<VulkanPipeline>(
         device,
-        VulkanPipeline::initPiplineLayoutCI(perChannelData[0].worleyNoiseDSLayout),
+        VulkanPipeline::initPiplineLayoutCI(generateNoiseDSLayout),
         VulkanPipeline::initComputeShaderStageCI(worleyNoiseComputeShaderModule)
     );
      
@@ -321,60 +137,229 @@ WorleyNoise3D::WorleyNoise3D(glm::ivec3 texDimensions, WorleyNoiseCreateParams p
         createShaderModule(device, normalizeNoiseComputeShaderCode);
     normalizeNoisePipeline = std::make_unique<VulkanPipeline>(
         device,
-        VulkanPipeline::initPiplineLayoutCI(normalizeNoiseDSLayout),
+        VulkanPipeline::initPiplineLayoutCI(generateNoiseDSLayout),
         VulkanPipeline::initComputeShaderStageCI(normalizeNoiseComputeShaderModule)
     );
-    worleyNoiseCommadBuffer = device->createComputeCommandBuffer();
     vkDestroyShaderModule(device->device, normalizeNoiseComputeShaderModule, nullptr);
 
-    /* ===================== Create and record command buffer ==================================== */
-    VkCommandBufferBeginInfo beginWorleyCmdBuffer {};
-    beginWorleyCmdBuffer.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    if(vkBeginCommandBuffer(worleyNoiseCommadBuffer, &beginWorleyCmdBuffer) 
-        != VK_SUCCESS)
+    auto downsampleNoiseComputeShaderCode = readFile("shaders/build/downsample_noise_3D.glsl.spv");
+    VkShaderModule downsampleNoiseComputeShaderModule = 
+        createShaderModule(device, downsampleNoiseComputeShaderCode);
+    downsampleNoisePipeline = std::make_unique<VulkanPipeline>(
+        device,
+        VulkanPipeline::initPiplineLayoutCI(downsampleNoiseDSLayout),
+        VulkanPipeline::initComputeShaderStageCI(downsampleNoiseComputeShaderModule)
+    );
+    vkDestroyShaderModule(device->device, downsampleNoiseComputeShaderModule, nullptr);
+
+    /* ===================== Slab batch synchronization ======================================= */
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(device->device, &fenceInfo, nullptr, &batchFence) != VK_SUCCESS)
     {
-        throw std::runtime_error("WORLEY NOISE 3D::Failed to begin command buffer");
+        throw std::runtime_error("WORLEY_NOISE_3D::Failed to create slab batch fence");
     }
 
-    vkCmdBindPipeline(worleyNoiseCommadBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, 
-        worleyNoisePipeline->pipeline);
-    for (int i = 0; i < CHANNEL_CNT; i++)
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = 2;
+    if (vkCreateQueryPool(device->device, &queryPoolInfo, nullptr, &batchQueryPool) != VK_SUCCESS)
     {
-        vkCmdBindDescriptorSets(worleyNoiseCommadBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, 
-            worleyNoisePipeline->layout, 0, 1, &perChannelData[i].worleyNoiseDS, 0, nullptr);
-        vkCmdDispatch(worleyNoiseCommadBuffer, texDimensions.x / 4, texDimensions.y /4 , texDimensions.z / 4);
+        throw std::runtime_error("WORLEY_NOISE_3D::Failed to create slab batch query pool");
     }
 
-    VkMemoryBarrier prevComputeWorkFinished = {};
-    prevComputeWorkFinished.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-    prevComputeWorkFinished.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-    prevComputeWorkFinished.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(device->physicalDevice, &properties);
+    /* Zero when timestamps are not supported -> every batch holds a single slab */
+    timestampPeriod = properties.limits.timestampComputeAndGraphics ?
+        properties.limits.timestampPeriod : 0.0f;
+}
 
-    vkCmdPipelineBarrier(
-        worleyNoiseCommadBuffer,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        0, 1,
-        &prevComputeWorkFinished, 
-        0, nullptr,
-        0, nullptr
-    );
+void WorleyNoise3D::createNoiseImage()
+{
+    compressedNoiseImage.reset();
+    if(noiseImage) { return; }
 
-    vkCmdBindPipeline(worleyNoiseCommadBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
-        normalizeNoisePipeline->pipeline);
-    vkCmdBindDescriptorSets(worleyNoiseCommadBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, 
-        normalizeNoisePipeline->layout, 0, 1, &normalizeNoiseDS, 0, nullptr);
-    vkCmdDispatch(worleyNoiseCommadBuffer, texDimensions.x / 4, texDimensions.y /4 , texDimensions.z / 4);
-    vkEndCommandBuffer(worleyNoiseCommadBuffer);
+    noiseImage = std::make_unique<VulkanImage>(device, texDimensions.x,
+        texDimensions.y, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R16G16B16A16_SFLOAT,
+        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
+        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        VK_IMAGE_ASPECT_COLOR_BIT, texDimensions.z);
+    /* Moved to the general layout by the first batch writing it, see recordNoiseImageInit */
+    noiseImageUndefined = true;
+
+    for(uint32_t mip = 0; mip < mipLevels; mip++)
+    {
+        mipViews.push_back(createImageView(device->device, noiseImage->image,
+            VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1, texDimensions.z, mip));
+    }
 
-    /* ====================== Filling buffers with points ======================================= */
+    /* generate binding 3 is mip 0, downsample set i reads mip i and writes mip i + 1 */
+    std::vector<VkDescriptorImageInfo> mipImagesInfo(mipLevels);
+    std::vector<VkWriteDescriptorSet> updateDS;
+    for(uint32_t mip = 0; mip < mipLevels; mip++)
+    {
+        mipImagesInfo[mip].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        mipImagesInfo[mip].imageView = mipViews[mip];
+    }
+
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstArrayElement = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    write.descriptorCount = 1;
+
+    write.dstSet = generateNoiseDS;
+    write.dstBinding = 3;
+    write.pImageInfo = &mipImagesInfo[0];
+    updateDS.push_back(write);
+    for(uint32_t mip = 0; mip < downsampleNoiseDS.size(); mip++)
+    {
+        write.dstSet = downsampleNoiseDS[mip];
+        write.dstBinding = 0;
+        write.pImageInfo = &mipImagesInfo[mip];
+        updateDS.push_back(write);
+        write.dstBinding = 1;
+        write.pImageInfo = &mipImagesInfo[mip + 1];
+        updateDS.push_back(write);
+    }
+    vkUpdateDescriptorSets(device->device, static_cast<uint32_t>(updateDS.size()),
+                           updateDS.data(), 0, nullptr);
+}
+
+void WorleyNoise3D::releaseNoiseImage()
+{
+    for(auto &mipView : mipViews)
+    {
+        vkDestroyImageView(device->device, mipView, nullptr);
+    }
+    mipViews.clear();
+    noiseImage.reset();
+}
+
+void WorleyNoise3D::recordNoiseImageInit(VkCommandBuffer commandBuffer)
+{
+    if(!noiseImageUndefined) { return; }
+    noiseImageUndefined = false;
+
+    VkImageMemoryBarrier toGeneral {};
+    toGeneral.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toGeneral.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    toGeneral.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    toGeneral.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toGeneral.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toGeneral.image = noiseImage->image;
+    toGeneral.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    toGeneral.subresourceRange.baseMipLevel = 0;
+    toGeneral.subresourceRange.levelCount = mipLevels;
+    toGeneral.subresourceRange.baseArrayLayer = 0;
+    toGeneral.subresourceRange.layerCount = 1;
+    toGeneral.srcAccessMask = 0;
+    toGeneral.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+        VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &toGeneral);
+}
+
+void WorleyNoise3D::recordGenerationSetup(VkCommandBuffer commandBuffer)
+{
+    recordNoiseImageInit(commandBuffer);
+
+    /* The kernel keeps the texels of the unmasked channels, mip 0 of the previous volume
+       provides them. Its reads by frames in flight don't conflict with the copy */
+    if(glm::any(glm::equal(worleyParams.channelMask, glm::ivec4(0))))
+    {
+        VkImageCopy region {};
+        region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.srcSubresource.mipLevel = 0;
+        region.srcSubresource.baseArrayLayer = 0;
+        region.srcSubresource.layerCount = 1;
+        region.dstSubresource = region.srcSubresource;
+        region.extent = {
+            static_cast<uint32_t>(texDimensions.x),
+            static_cast<uint32_t>(texDimensions.y),
+            static_cast<uint32_t>(texDimensions.z)};
+        vkCmdCopyImage(commandBuffer, previousNoiseImage->image, VK_IMAGE_LAYOUT_GENERAL,
+            noiseImage->image, VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+    }
+
+    VkBufferCopy pointsRegion {0, 0, pointsBufferSize};
+    vkCmdCopyBuffer(commandBuffer, pointsStagingBuffer->buffer, pointsBuffer->buffer, 1, &pointsRegion);
+    /* Extremes are accumulated with atomic min max on their bit patterns */
+    vkCmdFillBuffer(commandBuffer, minMaxBuffer->buffer, offsetof(MinMaxParamsBufferObject, minVal),
+        sizeof(MinMaxParamsBufferObject::minVal), UINT32_MAX);
+    vkCmdFillBuffer(commandBuffer, minMaxBuffer->buffer, offsetof(MinMaxParamsBufferObject, maxVal),
+        sizeof(MinMaxParamsBufferObject::maxVal), 0);
+
+    VkMemoryBarrier buffersFilled = {};
+    buffersFilled.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    buffersFilled.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    buffersFilled.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &buffersFilled, 0, nullptr, 0, nullptr);
+}
+
+const std::vector<glm::vec4> &WorleyNoise3D::getLayerPoints(int channel, int layer, int numDivisions)
+{
+    int index = channel * 3 + layer;
+    if(layerPointsDivisions[index] != numDivisions)
+    {
+        std::vector<glm::vec3> points;
+        mt.seed(getWorleyLayerSeed(seed, channel, layer));
+        generateWorleyPoints(points, numDivisions, mt, distribution);
+        padWorleyPoints(points, numDivisions, layerPoints[index]);
+        layerPointsDivisions[index] = numDivisions;
+    }
+    return layerPoints[index];
+}
 
-    std::array<glm::vec3, 4> numDivisionsChannels = {
+void WorleyNoise3D::beginGeneration(uint32_t channelMask, bool readback)
+{
+    std::array<glm::ivec3, 4> numDivisionsChannels = {
         params.numDivisionsRChannel,
         params.numDivisionsGChannel,
         params.numDivisionsBChannel,
         params.numDivisionsAChannel,
     };
+    for (int i = 0; i < CHANNEL_CNT; i++)
+    {
+        /* The kernel stages the cells around each workgroup in a fixed size shared array
+           which only fits them when there are no more cells than texels along an axis */
+        glm::vec3 divisions = numDivisionsChannels[i];
+        float maxDivisions = std::max(divisions.x, std::max(divisions.y, divisions.z));
+        if(maxDivisions > MAX_DIV_CNT || maxDivisions > std::min(texDimensions.x,
+            std::min(texDimensions.y, texDimensions.z)))
+        {
+            throw std::runtime_error("WORLEY_NOISE_3D::BEGIN_GENERATION::Number of divisions exceeds the supported maximum");
+        }
+    }
+
+    /* ====================== Filling buffers with points ======================================= */
+    /* Everything below besides noiseImage is generation scratch, it is released as soon as
+       the noise is finished -> the object only keeps the final volume alive */
+    bool replacesGeneration = isGenerating();
+    for(int i = 0; i < CHANNEL_CNT && replacesGeneration; i++)
+    {
+        /* Channels of a replaced generation are not in the previous volume either */
+        channelMask |= worleyParams.channelMask[i] != 0 ? 1u << i : 0u;
+    }
+    /* A batch of a replaced generation may still use the scratch */
+    releaseGenerationBuffers();
+    /* The finished volume keeps being sampled while the new one is generated, a partially
+       generated one is dropped */
+    if(!replacesGeneration)
+    {
+        previousNoiseImage = noiseImage ? std::move(noiseImage) : std::move(compressedNoiseImage);
+    }
+    releaseNoiseImage();
+    /* Kept channels are copied from the previous volume, BC7 texels can't be */
+    if(!previousNoiseImage || previousNoiseImage->format != VK_FORMAT_R16G16B16A16_SFLOAT)
+    {
+        channelMask = WORLEY_ALL_CHANNELS;
+    }
+    createNoiseImage();
 
     std::array<float, 4> persistenceChannels = {
         params.persistenceRChannel, 
@@ -383,98 +368,455 @@ WorleyNoise3D::WorleyNoise3D(glm::ivec3 texDimensions, WorleyNoiseCreateParams p
         params.persistenceAChannel
     };
 
+    worleyParams = {};
+    worleyParams.texDimensions = glm::ivec4(glm::ivec3(texDimensions), 0);
+    std::vector<glm::vec4> pointsCPU;
     for (int i = 0; i < CHANNEL_CNT; i++)
     {
-        generateWorleyPointsBuffer(perChannelData[i].pointsABufferCPU, numDivisionsChannels[i].x);
-        generateWorleyPointsBuffer(perChannelData[i].pointsBBufferCPU, numDivisionsChannels[i].y);
-        generateWorleyPointsBuffer(perChannelData[i].pointsCBufferCPU, numDivisionsChannels[i].z);
+        worleyParams.numDivisions[i] = glm::ivec4(numDivisionsChannels[i], 0);
+        worleyParams.persistence[i] = persistenceChannels[i];
+        worleyParams.channelMask[i] = (channelMask >> i) & 1u;
+        for (int layer = 0; layer < 3; layer++)
+        {
+            worleyParams.pointsOffsets[i][layer] = static_cast<int>(pointsCPU.size());
+            const std::vector<glm::vec4> &points = getLayerPoints(i, layer, numDivisionsChannels[i][layer]);
+            pointsCPU.insert(pointsCPU.end(), points.begin(), points.end());
+        }
+    }
 
-        MinMaxParamsBufferObject minMaxCPUBuffer {10000000, 0};
-        copyCPUBufferIntoGPUBuffer(perChannelData[i].pointsABufferCPU.data(), perChannelData[i].pointsABuffer, 
-            glm::pow(numDivisionsChannels[i].x, 3) * sizeof(glm::vec3));
-        copyCPUBufferIntoGPUBuffer(perChannelData[i].pointsBBufferCPU.data(), perChannelData[i].pointsBBuffer,
-            glm::pow(numDivisionsChannels[i].y, 3) * sizeof(glm::vec3));
-        copyCPUBufferIntoGPUBuffer(perChannelData[i].pointsCBufferCPU.data(), perChannelData[i].pointsCBuffer,
-            glm::pow(numDivisionsChannels[i].z, 3) * sizeof(glm::vec3));
-        copyCPUBufferIntoGPUBuffer(&minMaxCPUBuffer, perChannelData[i].minMaxBuffer, sizeof(MinMaxParamsBufferObject));
+    /* Copied and cleared by the first batch, see recordGenerationSetup -> nothing here
+       waits for the queue */
+    pointsBufferSize = pointsCPU.size() * sizeof(glm::vec4);
+    pointsStagingBuffer = std::make_unique<VulkanBuffer>(device, pointsBufferSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    void* data;
+    vkMapMemory(device->device, pointsStagingBuffer->bufferMemory, 0, pointsBufferSize, 0, &data);
+    memcpy(data, pointsCPU.data(), (size_t)pointsBufferSize);
+    vkUnmapMemory(device->device, pointsStagingBuffer->bufferMemory);
+    pointsBuffer = std::make_unique<VulkanBuffer>(device, pointsBufferSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    minMaxBuffer = std::make_unique<VulkanBuffer>(device, sizeof(MinMaxParamsBufferObject),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    worleyParamsUBO = std::make_unique<VulkanBuffer>(device, sizeof(WorleyParamsBufferObject),
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    std::array<VkDescriptorBufferInfo, 3> generateBuffersInfo {};
+    generateBuffersInfo[0] = {pointsBuffer->buffer, 0, pointsBufferSize};
+    generateBuffersInfo[1] = {minMaxBuffer->buffer, 0, sizeof(MinMaxParamsBufferObject)};
+    generateBuffersInfo[2] = {worleyParamsUBO->buffer, 0, sizeof(WorleyParamsBufferObject)};
+
+    std::array<VkWriteDescriptorSet, 3> generateUpdateDS {};
+    for(uint32_t binding = 0; binding < 3; binding++)
+    {
+        generateUpdateDS[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        generateUpdateDS[binding].dstSet = generateNoiseDS;
+        generateUpdateDS[binding].dstBinding = binding;
+        generateUpdateDS[binding].dstArrayElement = 0;
+        generateUpdateDS[binding].descriptorType = binding == 2 ?
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        generateUpdateDS[binding].descriptorCount = 1;
+        generateUpdateDS[binding].pBufferInfo = &generateBuffersInfo[binding];
+    }
+    vkUpdateDescriptorSets(device->device, static_cast<uint32_t>(generateUpdateDS.size()),
+                           generateUpdateDS.data(), 0, nullptr);
 
-        perChannelData[i].worleyParams.numDivisions = numDivisionsChannels[i];
-        perChannelData[i].worleyParams.texDimensions = texDimensions;
-        perChannelData[i].worleyParams.targetChannels = glm::vec4(1.0, 0.0, 0.0, 0.0);
-        perChannelData[i].worleyParams.persistence = persistenceChannels[i];
+    nextSlab = 0;
+    slabsPerBatch = 1;
+    readbackRequested = readback;
+    readbackBuffer.reset();
+}
 
-        void* data;
-        vkMapMemory(device->device, perChannelData[i].worleyParamsUBO->bufferMemory, 0, sizeof(WorleyParamsBufferObject), 0, &data);
-        memcpy(data, &perChannelData[i].worleyParams, sizeof(WorleyParamsBufferObject));
-        vkUnmapMemory(device->device, perChannelData[i].worleyParamsUBO->bufferMemory);
+void WorleyNoise3D::recordWorleySlabs(VkCommandBuffer commandBuffer, uint32_t firstSlab,
+    uint32_t slabCount)
+{
+    /* The slab offset lives in the UBO -> only one dispatch per submission */
+    worleyParams.texDimensions.w = static_cast<int>(firstSlab * WORLEY_SLAB_DEPTH);
+    void* data;
+    vkMapMemory(device->device, worleyParamsUBO->bufferMemory, 0, sizeof(WorleyParamsBufferObject), 0, &data);
+    memcpy(data, &worleyParams, sizeof(WorleyParamsBufferObject));
+    vkUnmapMemory(device->device, worleyParamsUBO->bufferMemory);
+
+    uint32_t slabDepth = std::min(slabCount * WORLEY_SLAB_DEPTH,
+        static_cast<uint32_t>(texDimensions.z) - firstSlab * WORLEY_SLAB_DEPTH);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, 
+        worleyNoisePipeline->layout, 0, 1, &generateNoiseDS, 0, nullptr);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, 
+        worleyNoisePipeline->pipeline);
+    vkCmdDispatch(commandBuffer, texDimensions.x / 4, texDimensions.y / 4, slabDepth / 4);
+}
+
+void WorleyNoise3D::recordFinishGeneration(VkCommandBuffer commandBuffer)
+{
+    /* Normalize rewrites the texels it reads and needs the final min max, the barrier
+       also covers slabs submitted earlier */
+    VkMemoryBarrier worleyFinished = {};
+    worleyFinished.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    worleyFinished.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    worleyFinished.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1,
+        &worleyFinished, 
+        0, nullptr,
+        0, nullptr
+    );
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, 
+        normalizeNoisePipeline->layout, 0, 1, &generateNoiseDS, 0, nullptr);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        normalizeNoisePipeline->pipeline);
+    vkCmdDispatch(commandBuffer, texDimensions.x / 4, texDimensions.y / 4, texDimensions.z / 4);
+
+    recordDownsample(commandBuffer);
+}
+
+void WorleyNoise3D::recordReadback(VkCommandBuffer commandBuffer)
+{
+    glm::ivec3 dimensions = glm::ivec3(texDimensions);
+    VkDeviceSize bufferSize = static_cast<VkDeviceSize>(dimensions.x) * dimensions.y *
+        dimensions.z * 4 * sizeof(uint16_t);
+    readbackBuffer = std::make_unique<VulkanBuffer>(device, bufferSize,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    /* Mip 0 is final once the normalize pass wrote it */
+    VkMemoryBarrier normalizeFinished = {};
+    normalizeFinished.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    normalizeFinished.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    normalizeFinished.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &normalizeFinished, 0, nullptr, 0, nullptr);
+
+    VkBufferImageCopy region {};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {
+        static_cast<uint32_t>(dimensions.x),
+        static_cast<uint32_t>(dimensions.y),
+        static_cast<uint32_t>(dimensions.z)};
+    vkCmdCopyImageToBuffer(commandBuffer, noiseImage->image, VK_IMAGE_LAYOUT_GENERAL,
+        readbackBuffer->buffer, 1, &region);
+
+    VkMemoryBarrier copyFinished = {};
+    copyFinished.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    copyFinished.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    copyFinished.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &copyFinished, 0, nullptr, 0, nullptr);
+}
+
+void WorleyNoise3D::submitBatch(VkCommandBuffer commandBuffer)
+{
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    vkResetFences(device->device, 1, &batchFence);
+    if (vkQueueSubmit(device->graphicsQueue, 1, &submitInfo, batchFence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("WORLEY_NOISE_3D::SUBMIT_BATCH::Failed to submit slab batch");
     }
+    batchCommandBuffer = commandBuffer;
+}
 
+void WorleyNoise3D::releaseGenerationBuffers()
+{
+    /* Buffers may still be read by a batch in flight */
+    if(batchCommandBuffer != VK_NULL_HANDLE)
+    {
+        vkWaitForFences(device->device, 1, &batchFence, VK_TRUE, UINT64_MAX);
+        vkFreeCommandBuffers(device->device, device->graphicsCommandPool, 1, &batchCommandBuffer);
+        batchCommandBuffer = VK_NULL_HANDLE;
+        finishSubmitted = false;
+    }
+    pointsStagingBuffer.reset();
+    pointsBuffer.reset();
+    minMaxBuffer.reset();
+    worleyParamsUBO.reset();
+    uploadBuffer.reset();
 }
 
-void WorleyNoise3D::copyCPUBufferIntoGPUBuffer(void* cpuData,
-    std::unique_ptr<VulkanBuffer> &GPUBuffer, VkDeviceSize bufferSize)
+void WorleyNoise3D::generateNoise(uint32_t channelMask)
 {
-    VulkanBuffer stagingBuffer = VulkanBuffer(device, bufferSize,
+    beginGeneration(channelMask);
+    uint32_t slabCount = getSlabCount();
+
+    VkCommandBuffer commandBuffer = device->BeginSingleTimeCommands();
+    recordGenerationSetup(commandBuffer);
+    recordWorleySlabs(commandBuffer, 0, slabCount);
+    recordFinishGeneration(commandBuffer);
+    /* Waits for the queue to be idle -> the scratch buffers and the previous volume can be
+       destroyed on return */
+    device->EndSingleTimeCommands(commandBuffer);
+
+    nextSlab = slabCount;
+    releaseGenerationBuffers();
+    previousNoiseImage.reset();
+}
+
+bool WorleyNoise3D::generateSlabs(float timeBudgetMs)
+{
+    if(!isGenerating())
+    {
+        throw std::runtime_error("WORLEY_NOISE_3D::GENERATE_SLABS::beginGeneration was not called");
+    }
+    uint32_t slabCount = getSlabCount();
+    /* The batch in flight is polled, never waited for -> the caller keeps rendering */
+    if(batchCommandBuffer != VK_NULL_HANDLE)
+    {
+        if(vkGetFenceStatus(device->device, batchFence) != VK_SUCCESS) { return false; }
+        vkFreeCommandBuffers(device->device, device->graphicsCommandPool, 1, &batchCommandBuffer);
+        batchCommandBuffer = VK_NULL_HANDLE;
+        if(finishSubmitted)
+        {
+            finishSubmitted = false;
+            releaseGenerationBuffers();
+            previousNoiseImage.reset();
+            return true;
+        }
+
+        std::array<uint64_t, 2> timestamps{};
+        if(timestampPeriod > 0.0f && vkGetQueryPoolResults(device->device, batchQueryPool, 0, 2,
+            sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+        {
+            float batchMs = static_cast<float>(timestamps[1] - timestamps[0]) * timestampPeriod / 1.0e6f;
+            float slabMs = std::max(batchMs / static_cast<float>(batchSlabCount), 0.001f);
+            slabsPerBatch = std::clamp(static_cast<uint32_t>(timeBudgetMs / slabMs), 1u, slabCount);
+        }
+    }
+
+    VkCommandBuffer commandBuffer = device->BeginSingleTimeCommands();
+    if(nextSlab < slabCount)
+    {
+        batchSlabCount = std::min(slabsPerBatch, slabCount - nextSlab);
+        if(nextSlab == 0) { recordGenerationSetup(commandBuffer); }
+        if(timestampPeriod > 0.0f)
+        {
+            vkCmdResetQueryPool(commandBuffer, batchQueryPool, 0, 2);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, batchQueryPool, 0);
+        }
+        recordWorleySlabs(commandBuffer, nextSlab, batchSlabCount);
+        if(timestampPeriod > 0.0f)
+        {
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, batchQueryPool, 1);
+        }
+        nextSlab += batchSlabCount;
+    }
+    else
+    {
+        recordFinishGeneration(commandBuffer);
+        if(readbackRequested) { recordReadback(commandBuffer); }
+        finishSubmitted = true;
+    }
+    submitBatch(commandBuffer);
+    return false;
+}
+
+bool WorleyNoise3D::isGenerating() { return worleyParamsUBO != nullptr; }
+
+std::unique_ptr<VulkanBuffer> WorleyNoise3D::takeReadbackBuffer()
+{
+    if(isGenerating()) { return nullptr; }
+    return std::move(readbackBuffer);
+}
+
+uint32_t WorleyNoise3D::getSlabCount()
+{
+    return (static_cast<uint32_t>(texDimensions.z) + WORLEY_SLAB_DEPTH - 1) / WORLEY_SLAB_DEPTH;
+}
+
+void WorleyNoise3D::uploadNoise(const std::vector<uint16_t> &texels)
+{
+    VkDeviceSize bufferSize = texels.size() * sizeof(uint16_t);
+    glm::ivec3 dimensions = glm::ivec3(texDimensions);
+    if(texels.size() != static_cast<size_t>(dimensions.x) * dimensions.y * dimensions.z * 4)
+    {
+        throw std::runtime_error("WORLEY_NOISE_3D::UPLOAD_NOISE::Texel count does not match the volume");
+    }
+    /* Replaces a generation in progress and the volume it would replace */
+    releaseGenerationBuffers();
+    previousNoiseImage.reset();
+    createNoiseImage();
+
+    uploadBuffer = std::make_unique<VulkanBuffer>(device, bufferSize,
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT); 
-
     void* data;
-    std::vector<float> data__;
-    vkMapMemory(device->device, stagingBuffer.bufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, cpuData, (size_t)bufferSize);
-    vkUnmapMemory(device->device, stagingBuffer.bufferMemory);
+    vkMapMemory(device->device, uploadBuffer->bufferMemory, 0, bufferSize, 0, &data);
+    memcpy(data, texels.data(), (size_t)bufferSize);
+    vkUnmapMemory(device->device, uploadBuffer->bufferMemory);
+
+    VkCommandBuffer commandBuffer = device->BeginSingleTimeCommands();
+    recordNoiseImageInit(commandBuffer);
+
+    VkBufferImageCopy region {};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {
+        static_cast<uint32_t>(dimensions.x),
+        static_cast<uint32_t>(dimensions.y),
+        static_cast<uint32_t>(dimensions.z)};
+    /* noiseImage stays in general layout for its whole lifetime */
+    vkCmdCopyBufferToImage(commandBuffer, uploadBuffer->buffer, noiseImage->image,
+        VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+
+    recordDownsample(commandBuffer);
+    /* Later submissions on the queue see the texels, the staging buffer is released once
+       the batch finished, see isUploading */
+    submitBatch(commandBuffer);
+}
+
+void WorleyNoise3D::uploadCompressedNoise(const BC7Volume &volume)
+{
+    if(volume.dimensions != glm::ivec3(texDimensions) || volume.mipOffsets.size() != mipLevels)
+    {
+        throw std::runtime_error("WORLEY_NOISE_3D::UPLOAD_COMPRESSED_NOISE::Volume does not match the noise");
+    }
+    /* Nothing samples the fp16 volume anymore -> only the compressed one is kept alive */
+    releaseGenerationBuffers();
+    previousNoiseImage.reset();
+    releaseNoiseImage();
 
-    GPUBuffer->CopyIntoBuffer(stagingBuffer, bufferSize);
+    uploadBuffer = std::make_unique<VulkanBuffer>(device, volume.blocks.size(),
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    void* data;
+    vkMapMemory(device->device, uploadBuffer->bufferMemory, 0, volume.blocks.size(), 0, &data);
+    memcpy(data, volume.blocks.data(), volume.blocks.size());
+    vkUnmapMemory(device->device, uploadBuffer->bufferMemory);
+
+    VkCommandBuffer commandBuffer = device->BeginSingleTimeCommands();
+    compressedNoiseImage = std::make_unique<VulkanImage>(device, volume.dimensions.x,
+        volume.dimensions.y, volume.dimensions.z, VK_FORMAT_BC7_UNORM_BLOCK, commandBuffer,
+        *uploadBuffer, volume.mipOffsets);
+    submitBatch(commandBuffer);
 }
 
-void WorleyNoise3D::generateWorleyPointsBuffer(std::vector<glm::vec3> &buffer, int numDivisions)
+bool WorleyNoise3D::isUploading()
 {
-    buffer.resize(numDivisions * numDivisions * numDivisions);
-    float cellSize = 1.0f / numDivisions;
+    if(!uploadBuffer) { return false; }
+    if(vkGetFenceStatus(device->device, batchFence) != VK_SUCCESS) { return true; }
+    vkFreeCommandBuffers(device->device, device->graphicsCommandPool, 1, &batchCommandBuffer);
+    batchCommandBuffer = VK_NULL_HANDLE;
+    uploadBuffer.reset();
+    return false;
+}
 
-    for (int x = 0; x < numDivisions; x++)
+VulkanImage &WorleyNoise3D::getSampledImage()
+{
+    if(previousNoiseImage) { return *previousNoiseImage; }
+    if(compressedNoiseImage) { return *compressedNoiseImage; }
+    if(!noiseImage)
     {
-        for (int y = 0; y < numDivisions; y++)
-        {
-            for (int z = 0; z < numDivisions; z++)
-            {
-                glm::vec3 randomOffset = glm::vec3(getRandNum(), getRandNum(), getRandNum()) * cellSize;
-                glm::vec3 cellCorner = glm::vec3(x, y, z) * cellSize;
-
-                int index = x + numDivisions * ( y + z * numDivisions );
-                buffer[index] = cellCorner + randomOffset;
-            }
-        }
+        throw std::runtime_error("WORLEY_NOISE_3D::GET_SAMPLED_IMAGE::Noise was not generated nor uploaded");
     }
+    return *noiseImage;
 }
 
-void WorleyNoise3D::generateNoise()
+VkImageView WorleyNoise3D::getSampledImageView() { return getSampledImage().imageView; }
+
+VkImageLayout WorleyNoise3D::getSampledImageLayout()
 {
-    VkPipelineStageFlags waitFlags[] = { VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &worleyNoiseCommadBuffer;
-    submitInfo.waitSemaphoreCount = 0;
-    submitInfo.pWaitSemaphores = nullptr;
-    submitInfo.pWaitDstStageMask = waitFlags;
-    submitInfo.signalSemaphoreCount = 0;
-    submitInfo.pSignalSemaphores = nullptr;
+    return getSampledImage().format == VK_FORMAT_BC7_UNORM_BLOCK ?
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+}
+
+void WorleyNoise3D::recordDownsample(VkCommandBuffer commandBuffer)
+{
+    /* Mip 0 is either written by the normalize pass or by the upload copy */
+    VkMemoryBarrier prevComputeWorkFinished = {};
+    prevComputeWorkFinished.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    prevComputeWorkFinished.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    prevComputeWorkFinished.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-    if (vkQueueSubmit(device->computeQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    /* Each mip is the box filtered previous one */
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        downsampleNoisePipeline->pipeline);
+    for(uint32_t mip = 0; mip < downsampleNoiseDS.size(); mip++)
     {
-        throw std::runtime_error("RENDERER::DRAW_FRAME::Failed to submit draw command buffer");
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1,
+            &prevComputeWorkFinished, 
+            0, nullptr,
+            0, nullptr
+        );
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, 
+            downsampleNoisePipeline->layout, 0, 1, &downsampleNoiseDS[mip], 0, nullptr);
+        glm::ivec3 mipDimensions = glm::max(glm::ivec3(texDimensions) >> glm::ivec3(mip + 1),
+            glm::ivec3(1));
+        vkCmdDispatch(commandBuffer, (mipDimensions.x + 3) / 4, (mipDimensions.y + 3) / 4,
+            (mipDimensions.z + 3) / 4);
     }
+
+    /* Sampled by the clouds passes of later submissions */
+    VkMemoryBarrier mipsFinished = {};
+    mipsFinished.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    mipsFinished.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    mipsFinished.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+        1, &mipsFinished, 0, nullptr, 0, nullptr);
 }
 
 float WorleyNoise3D::getRandNum() { return distribution(mt); }
 
-WorleyNoise3D::~WorleyNoise3D()
+glm::ivec3 WorleyNoise3D::getTexDimensions() { return glm::ivec3(texDimensions); }
+
+WorleyNoiseDesc WorleyNoise3D::getDesc() { return {glm::ivec3(texDimensions), params, seed}; }
+
+uint32_t WorleyNoise3D::setParams(const WorleyNoiseCreateParams &newParams)
 {
-    for(auto& perChannel : perChannelData)
+    std::array<std::pair<glm::ivec3, float>, 4> oldChannels = {
+        std::make_pair(params.numDivisionsRChannel, params.persistenceRChannel),
+        std::make_pair(params.numDivisionsGChannel, params.persistenceGChannel),
+        std::make_pair(params.numDivisionsBChannel, params.persistenceBChannel),
+        std::make_pair(params.numDivisionsAChannel, params.persistenceAChannel)
+    };
+    std::array<std::pair<glm::ivec3, float>, 4> newChannels = {
+        std::make_pair(newParams.numDivisionsRChannel, newParams.persistenceRChannel),
+        std::make_pair(newParams.numDivisionsGChannel, newParams.persistenceGChannel),
+        std::make_pair(newParams.numDivisionsBChannel, newParams.persistenceBChannel),
+        std::make_pair(newParams.numDivisionsAChannel, newParams.persistenceAChannel)
+    };
+    uint32_t changedChannels = 0;
+    for(int i = 0; i < CHANNEL_CNT; i++)
     {
-        vkDestroyDescriptorSetLayout(device->device, perChannel.worleyNoiseDSLayout, nullptr);
+        if(oldChannels[i] != newChannels[i]) { changedChannels |= 1u << i; }
     }
-    vkDestroyDescriptorSetLayout(device->device, normalizeNoiseDSLayout, nullptr);
+    params = newParams;
+    return changedChannels;
+}
+
+WorleyNoise3D::~WorleyNoise3D()
+{
+    /* Waits for a batch in flight before anything it uses is destroyed */
+    releaseGenerationBuffers();
+    vkDestroyFence(device->device, batchFence, nullptr);
+    vkDestroyQueryPool(device->device, batchQueryPool, nullptr);
+    vkDestroyDescriptorSetLayout(device->device, generateNoiseDSLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device->device, downsampleNoiseDSLayout, nullptr);
+    vkDestroyDescriptorPool(device->device, descriptorPool, nullptr);
+    readbackBuffer.reset();
+    previousNoiseImage.reset();
+    releaseNoiseImage();
 }
 
@@ -6,6 +6,7 @@
 #include <random>
 #include <vector>
 #include <array>
+#include <algorithm>
 
 /* Force alignment of glm data types to respect the alignment required
    by Vulkan NOTE: this does not cover nested data structures in that case
@@ -24,88 +25,187 @@
 #include "vulkan/vulkan_device.hpp"
 #include "vulkan/vulkan_buffer.hpp"
 #include "vulkan/vulkan_pipeline.hpp"
+#include "worley_points.hpp"
+#include "worley_bake.hpp"
+#include "bc7_volume.hpp"
 
 #include <vulkan/vulkan.h>
 
+/* Parameters of all four channels, the fused kernel evaluates them in one pass */
 struct WorleyParamsBufferObject
 {
-    alignas(16) glm::ivec3 numDivisions;
-    alignas(16) glm::ivec3 texDimensions;
-    alignas(16) glm::vec4 targetChannels;
-    alignas(4) float persistence;
+    alignas(16) glm::ivec4 texDimensions;
+    /* xyz - divisions of the three layers of each channel */
+    alignas(16) glm::ivec4 numDivisions[4];
+    /* xyz - index of the first padded point of each layer in the points buffer */
+    alignas(16) glm::ivec4 pointsOffsets[4];
+    alignas(16) glm::vec4 persistence;
+    /* Non zero for the channels being regenerated */
+    alignas(16) glm::ivec4 channelMask;
 };
 
-struct MinMaxParamsBufferObject
-{
-    alignas(4) int minVal;
-    alignas(4) int maxVal;
-};
-
-struct WorleyNoiseCreateParams
-{
-    glm::ivec3 numDivisionsRChannel;
-    glm::ivec3 numDivisionsGChannel;
-    glm::ivec3 numDivisionsBChannel;
-    glm::ivec3 numDivisionsAChannel;
-    float persistenceRChannel;
-    float persistenceGChannel;
-    float persistenceBChannel;
-    float persistenceAChannel;
-};
+/* Channel masks of generateNoise and beginGeneration, bit i stands for channel i */
+#define WORLEY_ALL_CHANNELS 0xFu
 
-struct PerChannelData
+/* Bit patterns of the non negative per channel extremes -> they order as uints */
+struct MinMaxParamsBufferObject
 {
-    std::unique_ptr<VulkanImage> oneChannelNoiseImage;
-    std::unique_ptr<VulkanBuffer> pointsABuffer;
-    std::unique_ptr<VulkanBuffer> pointsBBuffer;
-    std::unique_ptr<VulkanBuffer> pointsCBuffer;
-    std::unique_ptr<VulkanBuffer> minMaxBuffer;
-    std::unique_ptr<VulkanBuffer> worleyParamsUBO;
-
-    std::vector<glm::vec3> pointsABufferCPU;
-    std::vector<glm::vec3> pointsBBufferCPU;
-    std::vector<glm::vec3> pointsCBufferCPU;
-
-    VkDescriptorSetLayout worleyNoiseDSLayout;
-    VkDescriptorSet worleyNoiseDS;
-
-    WorleyParamsBufferObject worleyParams;
+    alignas(4) uint32_t minVal[4];
+    alignas(4) uint32_t maxVal[4];
 };
 
 class WorleyNoise3D
 {
     public:
+        /* Full mip chain, rebuilt from mip 0 every time the noise is generated. Only
+           exists between generateNoise / uploadNoise and uploadCompressedNoise */
         std::unique_ptr<VulkanImage> noiseImage; 
+        /* BC7 volume with the mip chain encoded on the CPU, replaces noiseImage */
+        std::unique_ptr<VulkanImage> compressedNoiseImage;
+        /* Finished fp16 or BC7 volume, sampled while noiseImage is regenerated by
+           beginGeneration / generateSlabs and destroyed once the generation finished */
+        std::unique_ptr<VulkanImage> previousNoiseImage;
 
-        WorleyNoise3D(glm::ivec3 texDimensions, WorleyNoiseCreateParams params, 
-            std::shared_ptr<VulkanDevice> device, VkDescriptorPool pool);
+        WorleyNoise3D(const WorleyNoiseDesc &desc, std::shared_ptr<VulkanDevice> device);
 
         ~WorleyNoise3D();
 
-        void generateNoise();
+        /**
+         * Generate the volume on the GPU in one submission
+         * @param channelMask - channels to (re)generate, the rest keeps its texels. All of
+         *      them are generated when there is no fp16 volume to keep them from
+         * The volume sampled before is destroyed on return
+         */
+        void generateNoise(uint32_t channelMask = WORLEY_ALL_CHANNELS);
+        /**
+         * Time sliced alternative to generateNoise, beginGeneration prepares the points and
+         * every generateSlabs call then submits a batch of z slabs of the volume once the
+         * previous batch finished, it never waits for the GPU. Batches are sized so that
+         * their GPU time stays within timeBudgetMs. The last batch normalizes the volume
+         * and builds its mips. The volume is generated into a new image, the finished
+         * one stays the sampled one until generateSlabs returns true and is destroyed
+         * then -> the caller points its sets at getSampledImageView before submitting
+         * again. beginGeneration during a generation restarts it with the channels of
+         * both
+         * @param readback - the last batch also copies mip 0 into a host visible buffer,
+         *      see takeReadbackBuffer
+         * @return true once the volume is finished
+         */
+        void beginGeneration(uint32_t channelMask = WORLEY_ALL_CHANNELS, bool readback = false);
+        bool generateSlabs(float timeBudgetMs);
+        bool isGenerating();
+        /**
+         * Host visible, host coherent buffer holding the RGBA16F texels of mip 0 once a
+         * generation begun with readback finished, nullptr otherwise. Ownership moves to
+         * the caller -> it can be read on another thread while the noise is in use
+         */
+        std::unique_ptr<VulkanBuffer> takeReadbackBuffer();
+        /**
+         * Copy texels baked by bakeWorleyNoise into mip 0 and rebuild the rest of the mips,
+         * replaces generateNoise when the noise comes from the cache. The upload is
+         * submitted as a batch without waiting for it, submissions after it see the texels
+         */
+        void uploadNoise(const std::vector<uint16_t> &texels);
+        /**
+         * Replace the fp16 volume with the BC7 encoded one, the device has to support
+         * VK_FORMAT_BC7_UNORM_BLOCK 3D images (see VulkanDevice::isCompressed3DFormatSupported).
+         * Submitted without waiting the same way as uploadNoise
+         */
+        void uploadCompressedNoise(const BC7Volume &volume);
+        /* Polls the batch of the last upload, its staging buffer is released once it finished */
+        bool isUploading();
+        /* View and layout the clouds passes sample the noise with, the finished volume
+           while a new one is generated */
+        VkImageView getSampledImageView();
+        VkImageLayout getSampledImageLayout();
+        glm::ivec3 getTexDimensions();
+        /* Parameters the current texels were generated with */
+        WorleyNoiseDesc getDesc();
+        /**
+         * Replace the parameters, the volume is not regenerated
+         * @return mask of the channels whose divisions or persistence changed
+         */
+        uint32_t setParams(const WorleyNoiseCreateParams &newParams);
 
     private:
-        std::array<PerChannelData, 4> perChannelData;
         /* ==================== Random number generator ====================*/
+        /* Reseeded for every layer, see getWorleyLayerSeed */
+        uint32_t seed;
         std::mt19937 mt;
         std::uniform_real_distribution<float> distribution;
 
         /* ==================== Texture parameters =========================*/
         glm::vec3 texDimensions;
+        uint32_t mipLevels;
         WorleyNoiseCreateParams params;
+        /* Padded points of the 12 layers (3 per channel) and the divisions they were
+           generated for, only layers whose divisions change are regenerated */
+        std::array<std::vector<glm::vec4>, 12> layerPoints;
+        std::array<int, 12> layerPointsDivisions {};
+
+        /* ==================== Generation scratch =========================*/
+        /* Alive only between beginGeneration and the end of the generation */
+        std::unique_ptr<VulkanBuffer> pointsStagingBuffer;
+        std::unique_ptr<VulkanBuffer> pointsBuffer;
+        VkDeviceSize pointsBufferSize = 0;
+        std::unique_ptr<VulkanBuffer> minMaxBuffer;
+        std::unique_ptr<VulkanBuffer> worleyParamsUBO;
+        WorleyParamsBufferObject worleyParams;
+        uint32_t nextSlab = 0;
+        bool readbackRequested = false;
+        std::unique_ptr<VulkanBuffer> readbackBuffer;
+        /* Staging buffer of the upload batch in flight, see isUploading */
+        std::unique_ptr<VulkanBuffer> uploadBuffer;
+
+        /* ==================== Slab batches =============================*/
+        /* Batch submitted by generateSlabs, VK_NULL_HANDLE when none is in flight */
+        VkCommandBuffer batchCommandBuffer = VK_NULL_HANDLE;
+        VkFence batchFence;
+        /* Timestamps around the slabs of a batch, their GPU time sizes the next one */
+        VkQueryPool batchQueryPool;
+        float timestampPeriod;
+        uint32_t batchSlabCount = 0;
+        uint32_t slabsPerBatch = 1;
+        bool finishSubmitted = false;
 
         /* ==================== Shared Vulkan Resources ====================*/
-        VkDescriptorSetLayout normalizeNoiseDSLayout;
-        VkDescriptorSet normalizeNoiseDS;
+        VkDescriptorPool descriptorPool;
+        /* Used by both the worley and the normalize pass, the buffers it points to only
+           live for the duration of the generation, see beginGeneration */
+        VkDescriptorSetLayout generateNoiseDSLayout;
+        VkDescriptorSet generateNoiseDS;
+        /* One single mip view of noiseImage per mip, storage images can't use the
+           full chain view, set i of the downsample sets reads mip i and writes mip i + 1 */
+        std::vector<VkImageView> mipViews;
+        /* noiseImage was just created, the first batch writing it moves it to the general
+           layout -> creating it never waits for the queue */
+        bool noiseImageUndefined = false;
+        VkDescriptorSetLayout downsampleNoiseDSLayout;
+        std::vector<VkDescriptorSet> downsampleNoiseDS;
         std::shared_ptr<VulkanDevice> device;
         std::unique_ptr<VulkanPipeline> worleyNoisePipeline;
         std::unique_ptr<VulkanPipeline> normalizeNoisePipeline;
-        VkCommandBuffer worleyNoiseCommadBuffer;
-
-        VkSemaphore channelFinishedSemaphore;
+        std::unique_ptr<VulkanPipeline> downsampleNoisePipeline;
 
         float getRandNum();
-        void generateWorleyPointsBuffer(std::vector<glm::vec3> &buffer, int numDivisions);
-        void copyCPUBufferIntoGPUBuffer(void *cpuData, std::unique_ptr<VulkanBuffer> &GPUBuffer,
-            VkDeviceSize bufferSize);
+        /* Create noiseImage with its mip views and point the generate and downsample sets
+           to them if it does not exist yet, drops compressedNoiseImage */
+        void createNoiseImage();
+        void releaseNoiseImage();
+        VulkanImage &getSampledImage();
+        void recordNoiseImageInit(VkCommandBuffer commandBuffer);
+        /* Points copy and min max clear of the first batch of a generation */
+        void recordGenerationSetup(VkCommandBuffer commandBuffer);
+        void recordDownsample(VkCommandBuffer commandBuffer);
+        /* Single dispatch of slabCount slabs starting at firstSlab */
+        void recordWorleySlabs(VkCommandBuffer commandBuffer, uint32_t firstSlab, uint32_t slabCount);
+        /* Normalize and downsample once all slabs were generated */
+        void recordFinishGeneration(VkCommandBuffer commandBuffer);
+        void recordReadback(VkCommandBuffer commandBuffer);
+        /* Submit a batch of generateSlabs signaling batchFence */
+        void submitBatch(VkCommandBuffer commandBuffer);
+        void releaseGenerationBuffers();
+        uint32_t getSlabCount();
+        /* Padded points of one layer, generated when its divisions changed */
+        const std::vector<glm::vec4> &getLayerPoints(int channel, int layer, int numDivisions);
 };
\ No newline at end of file
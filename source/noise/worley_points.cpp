@@ -0,0 +1,53 @@
+#include "worley_points.hpp"
+
+void generateWorleyPoints(std::vector<glm::vec3> &buffer, int numDivisions, std::mt19937 &mt,
+    std::uniform_real_distribution<float> &distribution)
+{
+    buffer.resize(numDivisions * numDivisions * numDivisions);
+    float cellSize = 1.0f / numDivisions;
+
+    for (int x = 0; x < numDivisions; x++)
+    {
+        for (int y = 0; y < numDivisions; y++)
+        {
+            for (int z = 0; z < numDivisions; z++)
+            {
+                glm::vec3 randomOffset = glm::vec3(distribution(mt), distribution(mt), distribution(mt)) * cellSize;
+                glm::vec3 cellCorner = glm::vec3(x, y, z) * cellSize;
+
+                int index = x + numDivisions * ( y + z * numDivisions );
+                buffer[index] = cellCorner + randomOffset;
+            }
+        }
+    }
+}
+
+void padWorleyPoints(const std::vector<glm::vec3> &points, int numDivisions,
+    std::vector<glm::vec4> &padded)
+{
+    int paddedDivisions = numDivisions + 2;
+    padded.resize(paddedDivisions * paddedDivisions * paddedDivisions);
+
+    for (int z = -1; z <= numDivisions; z++)
+    {
+        for (int y = -1; y <= numDivisions; y++)
+        {
+            for (int x = -1; x <= numDivisions; x++)
+            {
+                glm::ivec3 cell = glm::ivec3(x, y, z);
+                glm::ivec3 wrapped = (cell + numDivisions) % numDivisions;
+                /* -1, 0 or 1 tiles along each axis */
+                glm::vec3 tileShift = glm::vec3(cell - wrapped) / float(numDivisions);
+
+                int index = wrapped.x + numDivisions * ( wrapped.y + wrapped.z * numDivisions );
+                int paddedIndex = (x + 1) + paddedDivisions * ( (y + 1) + (z + 1) * paddedDivisions );
+                padded[paddedIndex] = glm::vec4(points[index] + tileShift, 0.0f);
+            }
+        }
+    }
+}
+
+uint32_t getWorleyLayerSeed(uint32_t seed, int channel, int layer)
+{
+    return seed * 12u + static_cast<uint32_t>(channel * 3 + layer);
+}
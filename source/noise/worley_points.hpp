@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <random>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+/**
+ * Fill buffer with one random feature point per cell of numDivisions^3 grid spanning
+ * the unit cube, points are indexed by x + numDivisions * (y + z * numDivisions)
+ * @param buffer - resized to numDivisions^3 and filled with the points
+ * @param numDivisions - number of cells along each axis
+ * @param mt - random engine, points are deterministic for the same engine state
+ * @param distribution - uniform [0,1) distribution used to offset points inside of cells
+ */
+void generateWorleyPoints(std::vector<glm::vec3> &buffer, int numDivisions, std::mt19937 &mt,
+    std::uniform_real_distribution<float> &distribution);
+
+/**
+ * Surround the numDivisions^3 grid of points with one layer of ghost cells holding the
+ * periodic copies of the points on the opposite border, shifted by one tile -> the
+ * noise kernel searches the 27 neighbours of any cell without wrapping. Cell (x, y, z)
+ * in [-1, numDivisions] is stored at (x + 1) + (numDivisions + 2) * ((y + 1) + (z + 1) * (numDivisions + 2))
+ * @param points - points generated by generateWorleyPoints
+ * @param numDivisions - number of cells along each axis of points
+ * @param padded - resized to (numDivisions + 2)^3, w is unused
+ */
+void padWorleyPoints(const std::vector<glm::vec3> &points, int numDivisions,
+    std::vector<glm::vec4> &padded);
+
+/**
+ * @return seed of the engine the points of one layer of one channel are generated with
+ *      -> the points of a layer do not depend on the division counts of the other layers
+ *      and a changed layer can be regenerated alone
+ */
+uint32_t getWorleyLayerSeed(uint32_t seed, int channel, int layer);
@@ -0,0 +1,43 @@
+/* Bake the shape and detail worley noise caches and their BC7 encodings the renderer
+   loads at startup, prints the PSNR of the BC7 volumes against the fp16 noise. None of
+   it touches Vulkan -> can run on build machines without a GPU. Run from the repository
+   root or pass the cache directory, f.e.:
+        atmosphere_noise_baker assets/cache */
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "noise/worley_bake.hpp"
+#include "noise/bc7_volume.hpp"
+
+int main(int argc, char **argv)
+{
+    std::string cacheDirectory = argc > 1 ? argv[1] : "assets/cache";
+
+    for(const WorleyNoiseDesc &desc : {getShapeNoiseDesc(), getDetailNoiseDesc()})
+    {
+        std::string cachePath = getWorleyNoiseCachePath(cacheDirectory, desc);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint16_t> texels;
+        bool cached = loadOrBakeWorleyNoise(texels, desc, cachePath);
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << cachePath << (cached ? " up to date" : " baked in ");
+        if(!cached) { std::cout << seconds << " s"; }
+        std::cout << std::endl;
+
+        /* Same cache path as Renderer::streamNoiseVolumes */
+        start = std::chrono::steady_clock::now();
+        BC7Volume compressed;
+        cached = loadOrEncodeBC7Volume(texels, desc.texDimensions, compressed, cachePath + ".bc7");
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        glm::vec4 psnr = compressed.psnr;
+        std::cout << cachePath << ".bc7" << (cached ? " up to date" : " encoded in ");
+        if(!cached) { std::cout << seconds << " s"; }
+        std::cout << ", " << compressed.blocks.size() / (1024 * 1024) << " MB, PSNR RGBA " <<
+            psnr.r << " " << psnr.g << " " << psnr.b << " " << psnr.a << " dB" << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -19,6 +19,18 @@ struct UniformBufferObject
     alignas(16) glm::mat4 proj;
     alignas(4) float time;
     alignas(16) glm::mat4 lHviewProj;
+    /* view projection of the previous frame, used to reproject clouds history */
+    alignas(16) glm::mat4 prevViewProj;
+    alignas(4) int frameIndex;
+    /* world space -> clouds shadow map uv in xy, see packCloudsShadowMatrix */
+    alignas(16) glm::mat4 cloudsShadowMatrix;
+    /* clip space -> world space, saves the per pixel inverse in the screen space passes */
+    alignas(16) glm::mat4 invViewProj;
+    /* xyz - position the distant clouds panorama is marched from, w is 1 in frames
+       which march the whole panorama instead of one slice of it */
+    alignas(16) glm::vec4 cloudsPanoramaCenter;
+    /* xyz - world space camera position, drives the terrain LOD morphing */
+    alignas(16) glm::vec4 cameraPosition;
 };
 
 struct PostProcessParamsBuffer
@@ -48,6 +60,20 @@ struct PostProcessParamsBuffer
 
     alignas(4) int tonemapCurve;
     alignas(8) glm::vec2 texDimensions;
+    /* Non zero weighs the centre of the screen more when metering the exposure */
+    alignas(4) int meteringMask;
+};
+
+/* Start of the clouds tile list written by clouds_classify, dispatchX/Y/Z is the
+   VkDispatchIndirectCommand of the clouds trace pass */
+struct CloudsTileListHeader
+{
+    uint32_t dispatchX = 0;
+    uint32_t dispatchY = 1;
+    uint32_t dispatchZ = 1;
+    uint32_t emptyTileCount = 0;
+    uint32_t visibleTileCount = 0;
+    uint32_t occludedTileCount = 0;
 };
 
 struct CloudsParametersBuffer
@@ -68,4 +94,62 @@ struct CloudsParametersBuffer
     alignas(4)  float darknessThreshold;
     alignas(4)  int debug;
     alignas(16) glm::vec4 phaseParams;
+    /* clouds are rendered at (swapchain resolution / resolutionDivisor) and only one
+       pixel in each reprojectionBlockSize x reprojectionBlockSize block is traced
+       each frame, the rest is reprojected from the previous frame */
+    alignas(4)  int resolutionDivisor = 2;
+    alignas(4)  int reprojectionBlockSize = 2;
+    /* half of the edge length in world units of the area around the camera
+       covered by the clouds shadow map */
+    alignas(4)  float shadowMapExtent = 1200.0f;
+    /* coverage map repeats every 1000 / (coverageScale) world units, coverage map
+       values below coverageThreshold are clear sky */
+    alignas(4)  float coverageScale = 0.5f;
+    alignas(4)  float coverageThreshold = 0.3f;
+    /* added to the noise mip selected from the sample footprint, the light march
+       footprint grows by lightConeSpread per unit of distance towards the sun */
+    alignas(4)  float noiseLodBias = 0.0f;
+    alignas(4)  float lightConeSpread = 0.25f;
+    /* primary march takes coarseStepMultiplier times longer steps outside of clouds,
+       both step lengths grow by stepDistanceScale per world unit of distance from
+       the camera, sampleCount is the per ray budget of density samples */
+    alignas(4)  float fineStepLength = 0.75f;
+    alignas(4)  float coarseStepMultiplier = 4.0f;
+    alignas(4)  float stepDistanceScale = 0.01f;
+    alignas(4)  int emptyStepsToCoarse = 4;
+    /* 1 replaces the clouds with the number of density samples taken per ray */
+    alignas(4)  int sampleHeatmap = 0;
+    /* rays are raymarched up to panoramaDistance world units from the camera, clouds
+       further away are looked up from the distant clouds panorama. One column out of
+       panoramaSliceCount is marched again each frame with panoramaSampleCount samples,
+       the whole panorama once the camera moves panoramaRefreshDistance from its centre */
+    alignas(4)  float panoramaDistance = 400.0f;
+    alignas(4)  float panoramaRefreshDistance = 50.0f;
+    alignas(4)  int panoramaSliceCount = 16;
+    alignas(4)  int panoramaSampleCount = 64;
+    /* clouds entered further than farFadeStart world units from the camera fade out
+       over farFadeLength */
+    alignas(4)  float farFadeStart = 2000.0f;
+    alignas(4)  float farFadeLength = 4000.0f;
+    /* distance level of detail ramps from 0 at lodStartDistance to 1 at lodEndDistance
+       world units from the ray origin, at 1 steps are lodStepMultiplier times longer,
+       the noise is sampled lodNoiseBias mips coarser and lodDensityOffset is passed
+       as the distFactor of sampleDensity. The detail erosion fades out from
+       lodStartDistance to detailCutoffDistance, samples beyond it skip the detail noise */
+    alignas(4)  float lodStartDistance = 200.0f;
+    alignas(4)  float lodEndDistance = 1500.0f;
+    alignas(4)  float lodStepMultiplier = 2.0f;
+    alignas(4)  float lodNoiseBias = 1.0f;
+    alignas(4)  float lodDensityOffset = 0.02f;
+    alignas(4)  float detailCutoffDistance = 1000.0f;
+    /* sampleCount of a clouds tile is scaled by tileBudgetMaxScale when the transmittance
+       of its rays differed by more than tileContrastThreshold last frame, and by
+       tileBudgetMinScale when all of them were clear or opaque. Other tiles get the samples
+       their rays took last frame with some headroom, between tileBudgetMinScale and 1 */
+    alignas(4)  float tileBudgetMinScale = 0.5f;
+    alignas(4)  float tileBudgetMaxScale = 1.5f;
+    alignas(4)  float tileContrastThreshold = 0.2f;
+    /* shape density volume is baked at (shape noise resolution / densityBakeDivisor),
+       changing it recreates the volume */
+    alignas(4)  int densityBakeDivisor = 1;
 };
\ No newline at end of file
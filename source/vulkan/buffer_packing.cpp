@@ -0,0 +1,58 @@
+#include "buffer_packing.hpp"
+
+UniformBufferObject packCommonParams(Camera &camera, float aspectRatio, float time)
+{
+    UniformBufferObject ubo{};
+    ubo.model = glm::mat4(1.0f);
+    ubo.model = glm::scale(ubo.model, glm::vec3(1000, 1000, 1000.0));
+    ubo.model = glm::translate(ubo.model, glm::vec3(-0.5f, -0.5f, -0.0f));
+
+    ubo.proj = glm::perspective(glm::radians(50.0f), aspectRatio, 0.1f, 20000.0f);
+    /* GLM is using OpenGL standard where Y coordinate of the clip coordinates is inverted */
+    ubo.proj[1][1] *= -1;
+
+    ubo.view = camera.getViewMatrix();
+    ubo.lHviewProj = ubo.proj * camera.getViewMatrix(true);
+    ubo.invViewProj = glm::inverse(ubo.proj * ubo.view);
+    ubo.cameraPosition = glm::vec4(camera.getPos(), 1.0f);
+    ubo.time = time;
+    return ubo;
+}
+
+glm::mat4 packCloudsShadowMatrix(glm::vec3 sunDirection, glm::vec3 cameraPosition, float extent,
+    uint32_t resolution)
+{
+    /* World up is +z, pick different reference axis when the sun is close to the zenith */
+    glm::vec3 reference = glm::abs(sunDirection.z) > 0.999f ? glm::vec3(1.0f, 0.0f, 0.0f) :
+        glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::vec3 right = glm::normalize(glm::cross(reference, sunDirection));
+    glm::vec3 up = glm::cross(sunDirection, right);
+
+    float texelSize = 2.0f * extent / float(resolution);
+    glm::vec2 center = glm::vec2(glm::dot(cameraPosition, right), glm::dot(cameraPosition, up));
+    center = glm::floor(center / texelSize) * texelSize;
+
+    /* glm matrices are column major -> matrix[column][row] */
+    float scale = 1.0f / (2.0f * extent);
+    glm::mat4 matrix = glm::mat4(1.0f);
+    for(int column = 0; column < 3; column++)
+    {
+        matrix[column][0] = right[column] * scale;
+        matrix[column][1] = up[column] * scale;
+        matrix[column][2] = sunDirection[column];
+    }
+    matrix[3][0] = 0.5f - center.x * scale;
+    matrix[3][1] = 0.5f - center.y * scale;
+    matrix[3][2] = 0.0f;
+    return matrix;
+}
+
+void packAtmosphereFrameParams(AtmosphereParametersBuffer &atmoParams, glm::vec3 cameraPosition)
+{
+    atmoParams.cameraPosition = cameraPosition;
+    atmoParams.sunDirection = glm::vec3(
+        glm::cos(glm::radians(atmoParams.sunPhiAngle)) * glm::sin(glm::radians(atmoParams.sunThetaAngle)),
+        glm::sin(glm::radians(atmoParams.sunPhiAngle)) * glm::sin(glm::radians(atmoParams.sunThetaAngle)),
+        glm::cos(glm::radians(atmoParams.sunThetaAngle))
+    );
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "buffer_defines.hpp"
+#include "model/sky_model.hpp"
+#include "camera.hpp"
+
+/**
+ * Fill the per frame common parameters (model, view and projection matrices)
+ * @param camera - camera the view matrices are taken from
+ * @param aspectRatio - swapchain width / height
+ * @param time - seconds since the start of the application
+ */
+UniformBufferObject packCommonParams(Camera &camera, float aspectRatio, float time);
+
+/**
+ * Update the per frame part of the atmosphere parameters
+ * -> camera position and sun direction computed from sun phi and theta angles
+ */
+void packAtmosphereFrameParams(AtmosphereParametersBuffer &atmoParams, glm::vec3 cameraPosition);
+
+/**
+ * Orthographic sun space matrix of the clouds shadow map, maps world space position to
+ * shadow map uv in xy and to distance along the sun direction in z
+ * @param sunDirection - normalized direction towards the sun
+ * @param cameraPosition - center of the covered area, snapped to the shadow map texels
+ *      so the map does not shimmer when the camera moves
+ * @param extent - half of the edge length of the covered area in world units
+ * @param resolution - width and height of the shadow map in texels
+ */
+glm::mat4 packCloudsShadowMatrix(glm::vec3 sunDirection, glm::vec3 cameraPosition, float extent,
+    uint32_t resolution);
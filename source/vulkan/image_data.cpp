@@ -0,0 +1,44 @@
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+
+#include "image_data.hpp"
+#include "stb_image.h"
+#include "tinyexr.h"
+
+ImageData::ImageData(const std::string &texturePath, bool isEXR) : isEXR{isEXR}
+{
+    if(isEXR)
+    {
+        float *rgba;
+        const char* err;
+        int ret = LoadEXR(&rgba, &width, &height, texturePath.c_str(), &err);
+        if (ret != 0) 
+        {
+            std::cout << "err: " << std::string(err) << std::endl;
+            throw std::runtime_error("IMAGE_DATA::CONSTRUCTOR::Failed to load exr image");
+        }
+        size = width * height * sizeof(float) * 4;
+        pixels = rgba;
+    } else {
+        int texChannels;
+        stbi_uc *rgba = stbi_load(texturePath.c_str(), &width, &height,
+                                    &texChannels, STBI_rgb_alpha);
+        if (!rgba)
+        {
+            throw std::runtime_error("IMAGE_DATA::CONSTRUCTOR::Failed to load texture image");
+        }
+        size = width * height * 4;
+        pixels = rgba;
+    }
+}
+
+ImageData::~ImageData()
+{
+    if(isEXR)
+    {
+        free(pixels);
+    }else{
+        stbi_image_free(pixels);
+    }
+}
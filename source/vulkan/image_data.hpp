@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+/* Decoded texture file, owns the decoded pixels
+   -> EXR images are decoded into RGBA float, other formats into RGBA 8bit */
+class ImageData
+{
+    public:
+        int width;
+        int height;
+        size_t size;
+        bool isEXR;
+        void *pixels;
+
+        ImageData(const std::string &texturePath, bool isEXR = false);
+        ~ImageData();
+
+        ImageData(const ImageData &) = delete;
+        ImageData &operator=(const ImageData &) = delete;
+};
@@ -123,9 +123,36 @@ ImGuiImpl::ImGuiImpl(VkInstance instance, std::shared_ptr<VulkanDevice> &device,
     }
 }
 
+/* Divisions and persistence of the four channels of one noise volume. The sliders edit
+   a copy which is only written to params once an edit finished -> the renderer does not
+   start a regeneration for every value a slider is dragged over */
+static void noiseParamsWidgets(WorleyNoiseCreateParams &params, WorleyNoiseCreateParams &edited)
+{
+    if(!ImGui::IsAnyItemActive()) { edited = params; }
+    const char *channelNames[] = {"R", "G", "B", "A"};
+    std::array<glm::ivec3 *, 4> divisions = {&edited.numDivisionsRChannel,
+        &edited.numDivisionsGChannel, &edited.numDivisionsBChannel, &edited.numDivisionsAChannel};
+    std::array<float *, 4> persistence = {&edited.persistenceRChannel,
+        &edited.persistenceGChannel, &edited.persistenceBChannel, &edited.persistenceAChannel};
+    for(int channel = 0; channel < 4; channel++)
+    {
+        ImGui::PushID(channel);
+        /* 50 is the most divisions the noise generation kernel supports */
+        ImGui::SliderInt3((std::string(channelNames[channel]) + " divisions").c_str(),
+            glm::value_ptr(*divisions[channel]), 1, 50);
+        if(ImGui::IsItemDeactivatedAfterEdit()) { params = edited; }
+        ImGui::SliderFloat((std::string(channelNames[channel]) + " persistence").c_str(),
+            persistence[channel], 0.0f, 1.0f);
+        if(ImGui::IsItemDeactivatedAfterEdit()) { params = edited; }
+        ImGui::PopID();
+    }
+}
+
 VkCommandBuffer ImGuiImpl::PrepareNewFrame(uint32_t imageIndex, VkFramebuffer framebuffer,
     Camera *camera, PostProcessParamsBuffer &postParams, AtmosphereParametersBuffer &atmoParams,
-    CloudsParametersBuffer &cloudParams, std::array<uint64_t, 60> &measurements ,glm::vec2 extent)
+    CloudsParametersBuffer &cloudParams, WorleyNoiseCreateParams &shapeNoiseParams,
+    WorleyNoiseCreateParams &detailNoiseParams, std::array<uint64_t, 60> &measurements,
+    glm::vec2 extent)
 {
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -177,16 +204,82 @@ VkCommandBuffer ImGuiImpl::PrepareNewFrame(uint32_t imageIndex, VkFramebuffer fr
             ImGui::TreePop();
         }
 
+        /* Only the edited channels are regenerated by the renderer */
+        if(ImGui::TreeNode("Noise generation"))
+        {
+            if(ImGui::TreeNode("Base shape"))
+            {
+                noiseParamsWidgets(shapeNoiseParams, editedShapeNoiseParams);
+                ImGui::TreePop();
+            }
+            if(ImGui::TreeNode("Detail"))
+            {
+                noiseParamsWidgets(detailNoiseParams, editedDetailNoiseParams);
+                ImGui::TreePop();
+            }
+            ImGui::TreePop();
+        }
+
         ImGui::SliderFloat("Density offset", &cloudParams.densityOffset, 0.0, 3.0);
         ImGui::SliderFloat("Density multiplier", &cloudParams.densityMultiplier, 0.0, 3.0);
         ImGui::SliderFloat("Detail Noise multiplier", &cloudParams.detailNoiseMultiplier, 0.0, 3.0);
-        ImGui::SliderInt("Clouds sample count", &cloudParams.sampleCount, 1, 200); 
+        ImGui::SliderInt("Clouds sample budget", &cloudParams.sampleCount, 1, 200); 
+        ImGui::SliderFloat("Fine step length", &cloudParams.fineStepLength, 0.05, 5.0); 
+        ImGui::SliderFloat("Coarse step multiplier", &cloudParams.coarseStepMultiplier, 1.0, 8.0); 
+        ImGui::SliderFloat("Step distance scale", &cloudParams.stepDistanceScale, 0.0, 0.1); 
+        ImGui::SliderInt("Empty steps to coarse", &cloudParams.emptyStepsToCoarse, 1, 16); 
+        ImGui::SliderInt("Sample count heatmap", &cloudParams.sampleHeatmap, 0, 1); 
+        ImGui::SliderFloat("Panorama distance", &cloudParams.panoramaDistance, 50.0, 2000.0); 
+        ImGui::SliderFloat("Panorama refresh distance", &cloudParams.panoramaRefreshDistance, 1.0, 500.0); 
+        ImGui::SliderInt("Panorama slice count", &cloudParams.panoramaSliceCount, 1, 64); 
+        ImGui::SliderInt("Panorama sample budget", &cloudParams.panoramaSampleCount, 1, 256); 
+        ImGui::SliderFloat("Far fade start", &cloudParams.farFadeStart, 100.0, 10000.0); 
+        ImGui::SliderFloat("Far fade length", &cloudParams.farFadeLength, 100.0, 10000.0); 
+        ImGui::SliderFloat("LOD start distance", &cloudParams.lodStartDistance, 0.0, 5000.0); 
+        ImGui::SliderFloat("LOD end distance", &cloudParams.lodEndDistance, 0.0, 5000.0); 
+        ImGui::SliderFloat("Detail cutoff distance", &cloudParams.detailCutoffDistance, 0.0, 5000.0); 
+        ImGui::SliderFloat("LOD step multiplier", &cloudParams.lodStepMultiplier, 1.0, 8.0); 
+        ImGui::SliderFloat("LOD noise bias", &cloudParams.lodNoiseBias, 0.0, 4.0); 
+        ImGui::SliderFloat("LOD density offset", &cloudParams.lodDensityOffset, 0.0, 0.5); 
+        ImGui::SliderFloat("Tile budget min scale", &cloudParams.tileBudgetMinScale, 0.1, 1.0); 
+        ImGui::SliderFloat("Tile budget max scale", &cloudParams.tileBudgetMaxScale, 1.0, 4.0); 
+        ImGui::SliderFloat("Tile contrast threshold", &cloudParams.tileContrastThreshold, 0.0, 1.0); 
         ImGui::SliderInt("To Sun sample count", &cloudParams.sampleCountToSun, 1, 100); 
         ImGui::SliderFloat("Abs to sun", &cloudParams.lightAbsTowardsSun, 0.0, 10.0); 
         ImGui::SliderFloat("Abs through cloud", &cloudParams.lightAbsThroughCloud, 0.0, 10.0); 
         ImGui::SliderFloat("Darkness threshold", &cloudParams.darknessThreshold, 0.0, 1.0); 
+        ImGui::SliderFloat("Shadow map extent", &cloudParams.shadowMapExtent, 100.0, 5000.0); 
+        ImGui::SliderFloat("Coverage scale", &cloudParams.coverageScale, 0.01, 5.0); 
+        ImGui::SliderFloat("Coverage threshold", &cloudParams.coverageThreshold, 0.0, 1.0); 
+        ImGui::SliderFloat("Noise LOD bias", &cloudParams.noiseLodBias, -2.0, 4.0); 
+        ImGui::SliderFloat("Light cone spread", &cloudParams.lightConeSpread, 0.0, 1.0); 
+        /* 1 - height gradient, 2 - per tile sample budget scale */
         ImGui::SliderInt("Debug", &cloudParams.debug, 0, 10); 
         ImGui::SliderFloat4("Phase parameters", glm::value_ptr(cloudParams.phaseParams), 0.0, 2.0);
+
+        /* Changing either of these recreates the clouds render targets */
+        if(ImGui::TreeNode("Reconstruction"))
+        {
+            const int sizes[] = {1, 2, 4};
+            int resolutionIdx = cloudParams.resolutionDivisor == 4 ? 2 : cloudParams.resolutionDivisor - 1;
+            if(ImGui::Combo("Clouds resolution", &resolutionIdx, "Full\0Half\0Quarter\0"))
+            {
+                cloudParams.resolutionDivisor = sizes[resolutionIdx];
+            }
+            int blockIdx = cloudParams.reprojectionBlockSize == 4 ? 2 : cloudParams.reprojectionBlockSize - 1;
+            if(ImGui::Combo("Reprojection block", &blockIdx, "1x1\0" "2x2\0" "4x4\0"))
+            {
+                cloudParams.reprojectionBlockSize = sizes[blockIdx];
+            }
+            ImGui::TreePop();
+        }
+        /* Recreates and rebakes the shape density volume */
+        const int densityDivisors[] = {1, 2, 4};
+        int densityIdx = cloudParams.densityBakeDivisor == 4 ? 2 : cloudParams.densityBakeDivisor - 1;
+        if(ImGui::Combo("Density bake resolution", &densityIdx, "Full\0Half\0Quarter\0"))
+        {
+            cloudParams.densityBakeDivisor = densityDivisors[densityIdx];
+        }
     }
     if(ImGui::CollapsingHeader("Atmosphere Parameters"))
     {
@@ -221,6 +314,9 @@ VkCommandBuffer ImGuiImpl::PrepareNewFrame(uint32_t imageIndex, VkFramebuffer fr
         ImGui::SliderFloat("minimum luminance", &postParams.minimumLuminance, 1.0f, 20000.0f); 
         ImGui::SliderFloat("maximum luminance", &postParams.maximumLuminance, 1.0f, 20000.0f); 
         ImGui::SliderFloat("Luminance adaptation rate", &postParams.lumAdaptTau, 1.0f, 2.0f, "%.3f"); 
+        bool centreWeighted = postParams.meteringMask != 0;
+        ImGui::Checkbox("Centre weighted metering", &centreWeighted);
+        postParams.meteringMask = centreWeighted ? 1 : 0;
         ImGui::SliderInt("Tonemap curve", &postParams.tonemapCurve, 1.0, 4.0); 
         switch(postParams.tonemapCurve)
         {
@@ -262,11 +358,14 @@ VkCommandBuffer ImGuiImpl::PrepareNewFrame(uint32_t imageIndex, VkFramebuffer fr
     ImGui::Text("Aerial Perspective LUT     : %f ms", measurements_computed[3] );
     ImGui::Text("Terrain                    : %f ms", measurements_computed[4] );
     ImGui::Text("Far Sky Pass               : %f ms", measurements_computed[5] );
-    ImGui::Text("Clouds Pass                : %f ms", measurements_computed[6] );
+    ImGui::Text("Clouds Classify + Trace    : %f ms", measurements_computed[6] );
     ImGui::Text("Aerial perspective Pass    : %f ms", measurements_computed[7] );
     ImGui::Text("Histogram construction     : %f ms", measurements_computed[8] );
     ImGui::Text("Histogram sum              : %f ms", measurements_computed[9] );
     ImGui::Text("Tone map                   : %f ms", measurements_computed[10] );
+    ImGui::Text("Clouds Upsample            : %f ms", measurements_computed[11] );
+    ImGui::Text("Clouds Shadow Map          : %f ms", measurements_computed[12] );
+    ImGui::Text("Clouds Distant Panorama    : %f ms", measurements_computed[13] );
     ImGui::End();
 
     /* Command buffer preparation */
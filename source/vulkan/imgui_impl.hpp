@@ -31,6 +31,7 @@
 #include "camera.hpp"
 #include "buffer_defines.hpp"
 #include "model/sky_model.hpp"
+#include "noise/worley_bake.hpp"
 
 
 class ImGuiImpl
@@ -45,12 +46,17 @@ class ImGuiImpl
     
     VkCommandBuffer PrepareNewFrame(uint32_t imageIndex, VkFramebuffer framebuffer,
         Camera *camera, PostProcessParamsBuffer &postParams, AtmosphereParametersBuffer &atmoParams,
-        CloudsParametersBuffer &cloudParams, std::array<uint64_t, 60> &measurements, glm::vec2 extent);
+        CloudsParametersBuffer &cloudParams, WorleyNoiseCreateParams &shapeNoiseParams,
+        WorleyNoiseCreateParams &detailNoiseParams, std::array<uint64_t, 60> &measurements,
+        glm::vec2 extent);
 
     private:
         bool showPostProcessWindow;
         bool showAtmosphereParamsWindow;
         bool showCloudParamsWindow;
+        /* Noise parameters while their sliders are dragged, see noiseParamsWidgets */
+        WorleyNoiseCreateParams editedShapeNoiseParams;
+        WorleyNoiseCreateParams editedDetailNoiseParams;
 
         uint32_t imageCount;
         VkDescriptorPool imguiDSPool;
@@ -1,6 +1,8 @@
 #include <cstring>
 #include <iostream>
+#include <fstream>
 #include <iomanip>
+#include <algorithm>
 
 #include "renderer.hpp"
 
@@ -31,7 +33,7 @@ void Renderer::createPreset(int presetNum)
         cloudsParamsBuffer.densityOffset = 0.817;
         cloudsParamsBuffer.densityMultiplier = 1.069;
         cloudsParamsBuffer.detailNoiseMultiplier = 0.329;
-        cloudsParamsBuffer.sampleCount = 60;
+        cloudsParamsBuffer.sampleCount = 30;
         cloudsParamsBuffer.sampleCountToSun = 5;
         cloudsParamsBuffer.lightAbsTowardsSun = 0.248;
         cloudsParamsBuffer.lightAbsThroughCloud = 0.446;
@@ -71,7 +73,7 @@ void Renderer::createPreset(int presetNum)
         cloudsParamsBuffer.densityOffset = 0.831;
         cloudsParamsBuffer.densityMultiplier = 0.639;
         cloudsParamsBuffer.detailNoiseMultiplier = 0.329;
-        cloudsParamsBuffer.sampleCount = 120;
+        cloudsParamsBuffer.sampleCount = 60;
         cloudsParamsBuffer.sampleCountToSun = 4;
         cloudsParamsBuffer.lightAbsTowardsSun = 0.574;
         cloudsParamsBuffer.lightAbsThroughCloud = 0.101;
@@ -115,7 +117,8 @@ Renderer::Renderer(GLFWwindow *window, bool enableValidation) : framebufferResiz
         4.0,                             // Reinhard
         1.0, 1.0, 0.22, 0.4, 1.33, 0.0,  // Uchimura
         1.6, 0.977, 8.0, 0.18, 0.267,    // Lottes
-        4, glm::vec2(0.0, 0.0)
+        4, glm::vec2(0.0, 0.0),
+        0                                // Uniform metering
     };
 
     cloudsParamsBuffer = CloudsParametersBuffer{
@@ -125,9 +128,10 @@ Renderer::Renderer(GLFWwindow *window, bool enableValidation) : framebufferResiz
         0.329, 
         4.0, 8.306, 0.3, 6.645,
         0.688, 0.269,
-        100, 4,
+        50, 4,
         3.123, 0.100, 0.093, 1,
-        glm::vec4(0.52, 0.52, 0.700, 0.100)
+        glm::vec4(0.52, 0.52, 0.700, 0.100),
+        2, 2
     };
     SetupAtmosphereParametersBuffer(atmoParamsBuffer);
     /* TODO: Renderer shouldn't own camera */
@@ -170,29 +174,11 @@ Renderer::Renderer(GLFWwindow *window, bool enableValidation) : framebufferResiz
     createUniformBuffers();
     createDescriptorPool();
 
-    WorleyNoiseCreateParams worleyParams {};
-    worleyParams.numDivisionsRChannel = glm::vec3(3, 8, 18);
-    worleyParams.numDivisionsGChannel = glm::vec3(7, 15, 28);
-    worleyParams.numDivisionsBChannel = glm::vec3(9, 18, 31);
-    worleyParams.numDivisionsAChannel = glm::vec3(14, 22, 43);
-    worleyParams.persistenceRChannel = 0.75f;
-    worleyParams.persistenceGChannel = 0.95f;
-    worleyParams.persistenceBChannel = 0.85f;
-    worleyParams.persistenceAChannel = 0.85f;
-    noise = std::make_unique<WorleyNoise3D>(glm::vec3(256, 256, 256), worleyParams,
-        vDevice, descriptorPool);
-
-    WorleyNoiseCreateParams detailWorleyParams {};
-    detailWorleyParams.numDivisionsRChannel = glm::vec3(7, 15, 22);
-    detailWorleyParams.numDivisionsGChannel = glm::vec3(14, 21, 34);
-    detailWorleyParams.numDivisionsBChannel = glm::vec3(19, 29, 37);
-    detailWorleyParams.numDivisionsAChannel = glm::vec3(33, 45, 49);
-    detailWorleyParams.persistenceRChannel = 0.82f;
-    detailWorleyParams.persistenceGChannel = 0.73f;
-    detailWorleyParams.persistenceBChannel = 0.82f;
-    detailWorleyParams.persistenceAChannel = 0.85f;
-    detailNoise = std::make_unique<WorleyNoise3D>(glm::vec3(128, 128, 128), detailWorleyParams,
-        vDevice, descriptorPool);
+    createNoiseVolumes();
+    createCloudsOccupancy();
+    createCloudsDensity();
+    createCloudsShadowMap();
+    createCloudsPanorama();
 
     createDescriptorSets();
     createCommandBuffers();
@@ -233,10 +219,27 @@ Renderer::~Renderer()
         }
         vkDestroyQueryPool(vDevice->device, perFrameData[i].querryPool, nullptr);
     }
+    /* Workers may still read the readback buffers */
+    for(NoiseStreamJob &job : noiseStreamJobs)
+    {
+        if(job.result.valid()) { job.result.wait(); }
+        job.readbackBuffer.reset();
+    }
     noise.reset();
     detailNoise.reset();
+    noiseFallback.reset();
+    detailNoiseFallback.reset();
     imguiImpl.reset();
 
+    for(auto &mipView : cloudsDensityMipViews)
+    {
+        vkDestroyImageView(vDevice->device, mipView, nullptr);
+    }
+    for(auto &mipView : cloudsOccupancyMipViews)
+    {
+        vkDestroyImageView(vDevice->device, mipView, nullptr);
+    }
+
     for(auto& dsLayout : descriptorLayouts)
     {
         vkDestroyDescriptorSetLayout(vDevice->device, dsLayout.second, nullptr);
@@ -246,8 +249,9 @@ Renderer::~Renderer()
         image.second.reset();
     }
 
-    vertexBuffer.reset();
     indexBuffer.reset();
+    /* Joins the uploader thread before the device goes away */
+    terrainTileCache.reset();
     cleanupSwapchain();
 
     for(auto & perFrame : perFrameData)
@@ -267,6 +271,7 @@ Renderer::~Renderer()
     }
     vkDestroySampler(vDevice->device, AEPerspectiveSampler, nullptr);
     vkDestroySampler(vDevice->device, cloudsSampler, nullptr);
+    vkDestroySampler(vDevice->device, cloudsPanoramaSampler, nullptr);
     vkDestroySampler(vDevice->device, skyViewLUTSampler, nullptr);
     vkDestroySampler(vDevice->device, terrainTexturesSampler, nullptr);
     vkDestroySampler(vDevice->device, depthTextureSampler, nullptr);
@@ -376,18 +381,121 @@ void checkExtensionSupport(std::vector<const char *> extensions)
 
 void Renderer::loadAssets()
 {
-    frameSharedImages["TerrainEXRHeightMap"] = std::make_unique<VulkanImage>
-        (vDevice, "assets/textures/terrain_heightmap.exr", true);
+    #pragma region terrainHeightMap
+    /* Only the first run decodes the whole EXR, later runs map the tiles and read just the
+       coarse pyramid levels -> startup does not grow with the size of the terrain */
+    if(!checkTerrainTiles(TERRAIN_TILES_PATH, TERRAIN_TILE_SIZE))
+    {
+        /* terrain.vert reads only the first channel of the EXR -> keep just that one */
+        ImageData heightMapData(TERRAIN_HEIGHTMAP_PATH, true);
+        uint32_t width = static_cast<uint32_t>(heightMapData.width);
+        uint32_t height = static_cast<uint32_t>(heightMapData.height);
+        const float *pixels = static_cast<const float *>(heightMapData.pixels);
+        std::vector<float> heightMipChain(size_t(width) * height);
+        for(size_t i = 0; i < heightMipChain.size(); i++) { heightMipChain[i] = pixels[4 * i]; }
+
+        HeightPyramid heightPyramid(heightMipChain.data(), width, height);
+        buildHeightMips(heightMipChain, width, height);
+        writeTerrainTiles(TERRAIN_TILES_PATH, heightMipChain, width, height, heightPyramid,
+            TERRAIN_TILE_SIZE);
+    }
 
-    frameSharedImages["TerrainEXRHeightMap"]->TransitionImageLayout(
-        frameSharedImages["TerrainEXRHeightMap"]->format, 
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+    std::shared_ptr<TerrainTileFile> terrainTiles = std::make_shared<TerrainTileFile>(TERRAIN_TILES_PATH);
+    terrainQuadtree = std::make_unique<TerrainQuadtree>(terrainTiles->loadPyramid(),
+        TERRAIN_HEIGHT_SCALE, TERRAIN_LOD_COUNT);
+    terrainTileCache = std::make_unique<TerrainTileCache>(vDevice, terrainTiles,
+        TERRAIN_TILE_CACHE_LAYERS, TERRAIN_TILE_STAGING_SLOTS, TERRAIN_TILE_STREAMING_RADIUS,
+        vSwapChain->imageCount);
+    #pragma endregion terrainHeightMap
 
     frameSharedImages["TerrainDiffuseImage"] = std::make_unique<VulkanImage>
         (vDevice, "assets/textures/terrain_colormask.png");
 
     frameSharedImages["TerrainNormalImage"] = std::make_unique<VulkanImage>
         (vDevice, "assets/textures/terrain_normalmap.png");
+
+    #pragma region blueNoise
+    std::vector<uint8_t> blueNoise;
+    loadOrGenerateBlueNoise(blueNoise, BLUE_NOISE_SIZE, BLUE_NOISE_SEED, BLUE_NOISE_CACHE_PATH);
+
+    frameSharedImages["BlueNoise"] = std::make_unique<VulkanImage>(vDevice, BLUE_NOISE_SIZE,
+        BLUE_NOISE_SIZE, 1, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    VulkanBuffer blueNoiseStagingBuffer = VulkanBuffer(vDevice, blueNoise.size(),
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    void *data;
+    vkMapMemory(vDevice->device, blueNoiseStagingBuffer.bufferMemory, 0, blueNoise.size(), 0, &data);
+    memcpy(data, blueNoise.data(), blueNoise.size());
+    vkUnmapMemory(vDevice->device, blueNoiseStagingBuffer.bufferMemory);
+
+    VulkanImage &blueNoiseImage = *findInMap(frameSharedImages, "BlueNoise");
+    blueNoiseImage.TransitionImageLayout(VK_FORMAT_R8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1);
+    blueNoiseImage.CopyBufferToImage(blueNoiseStagingBuffer, BLUE_NOISE_SIZE, BLUE_NOISE_SIZE);
+    blueNoiseImage.TransitionImageLayout(VK_FORMAT_R8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+    #pragma endregion blueNoise
+
+    #pragma region coverageMap
+    coverageMap.clear();
+    if(std::ifstream(COVERAGE_MAP_PATH).good())
+    {
+        ImageData coverageImage(COVERAGE_MAP_PATH);
+        if(coverageImage.width == COVERAGE_MAP_SIZE && coverageImage.height == COVERAGE_MAP_SIZE)
+        {
+            const uint8_t *pixels = static_cast<const uint8_t *>(coverageImage.pixels);
+            coverageMap.resize(COVERAGE_MAP_SIZE * COVERAGE_MAP_SIZE);
+            for(size_t i = 0; i < coverageMap.size(); i++) { coverageMap[i] = pixels[4 * i]; }
+        }
+        else
+        {
+            std::cout << "RENDERER::LOAD_ASSETS::Coverage map " << COVERAGE_MAP_PATH <<
+                " has to be " << COVERAGE_MAP_SIZE << "x" << COVERAGE_MAP_SIZE <<
+                ", using generated one" << std::endl;
+        }
+    }
+    if(coverageMap.empty())
+    {
+        generateCoverageMap(coverageMap, COVERAGE_MAP_SIZE, COVERAGE_MAP_SEED);
+    }
+
+    std::vector<uint8_t> coverageMipChain = coverageMap;
+    buildCoverageMaxMips(coverageMipChain, COVERAGE_MAP_SIZE);
+    uint32_t coverageMipLevels = static_cast<uint32_t>(std::log2(COVERAGE_MAP_SIZE)) + 1;
+
+    frameSharedImages["CoverageMap"] = std::make_unique<VulkanImage>(vDevice, COVERAGE_MAP_SIZE,
+        COVERAGE_MAP_SIZE, coverageMipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8_UNORM,
+        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    VulkanBuffer coverageStagingBuffer = VulkanBuffer(vDevice, coverageMipChain.size(),
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    vkMapMemory(vDevice->device, coverageStagingBuffer.bufferMemory, 0, coverageMipChain.size(), 0, &data);
+    memcpy(data, coverageMipChain.data(), coverageMipChain.size());
+    vkUnmapMemory(vDevice->device, coverageStagingBuffer.bufferMemory);
+
+    /* Mips are max reductions, not averages -> upload every level instead of blitting */
+    VulkanImage &coverageImage = *findInMap(frameSharedImages, "CoverageMap");
+    coverageImage.TransitionImageLayout(VK_FORMAT_R8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, coverageMipLevels);
+    VkDeviceSize mipOffset = 0;
+    for(uint32_t mip = 0; mip < coverageMipLevels; mip++)
+    {
+        uint32_t mipSize = COVERAGE_MAP_SIZE >> mip;
+        coverageImage.CopyBufferToImage(coverageStagingBuffer, mipSize, mipSize, mip, mipOffset);
+        mipOffset += mipSize * mipSize;
+    }
+    coverageImage.TransitionImageLayout(VK_FORMAT_R8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, coverageMipLevels);
+    #pragma endregion coverageMap
 }
 
 void Renderer::createInstance(bool enableValidation)
@@ -406,7 +514,8 @@ void Renderer::createInstance(bool enableValidation)
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    /* 1.1 for the subgroup operations of the noise generation */
+    appInfo.apiVersion = VK_API_VERSION_1_1;
 
     /* Specify which vulkan extensions and validation layers we want
         to use -> these are GLOBAL for entire program */
@@ -454,6 +563,9 @@ void Renderer::createSurface()
 void Renderer::createRenderPass()
 {
     #pragma region hdrBackbufferPass
+    /* Color and first depth buffer are kept in attachment layouts after this pass,
+       clouds compute passes read the depth and clouds composite pass continues
+       rendering into the color buffer */
     VkAttachmentDescription hdrBackbufferColorImageAttDesc {};
     hdrBackbufferColorImageAttDesc.format = findInMap(perFrameData[0].images,"HDRColor")->format;
     hdrBackbufferColorImageAttDesc.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -462,29 +574,19 @@ void Renderer::createRenderPass()
     hdrBackbufferColorImageAttDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     hdrBackbufferColorImageAttDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     hdrBackbufferColorImageAttDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    hdrBackbufferColorImageAttDesc.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    hdrBackbufferColorImageAttDesc.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
     VkAttachmentDescription hdrBackbufferDepthOneAttachment{};
     hdrBackbufferDepthOneAttachment.format = findInMap(perFrameData[0].images,"HDRDepthOne")->format;
     hdrBackbufferDepthOneAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     hdrBackbufferDepthOneAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    hdrBackbufferDepthOneAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    hdrBackbufferDepthOneAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     hdrBackbufferDepthOneAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     hdrBackbufferDepthOneAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     hdrBackbufferDepthOneAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    hdrBackbufferDepthOneAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    VkAttachmentDescription hdrBackbufferDepthTwoAttachment{};
-    hdrBackbufferDepthTwoAttachment.format = findInMap(perFrameData[0].images,"HDRDepthTwo")->format;
-    hdrBackbufferDepthTwoAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    hdrBackbufferDepthTwoAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    hdrBackbufferDepthTwoAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    hdrBackbufferDepthTwoAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    hdrBackbufferDepthTwoAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    hdrBackbufferDepthTwoAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    hdrBackbufferDepthTwoAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    std::array<VkSubpassDescription, 4> subpassDescriptions{};
+    hdrBackbufferDepthOneAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    std::array<VkSubpassDescription, 2> subpassDescriptions{};
     VkAttachmentReference hdrColorReference {};
     hdrColorReference.attachment = 0;
     hdrColorReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
@@ -493,18 +595,10 @@ void Renderer::createRenderPass()
     hdrDepthOneWriteReference.attachment = 1;
     hdrDepthOneWriteReference.layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
 
-    VkAttachmentReference hdrDepthTwoWriteReference{};
-    hdrDepthTwoWriteReference.attachment = 2;
-    hdrDepthTwoWriteReference.layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
-
     VkAttachmentReference hdrDepthOneReadReference{};
     hdrDepthOneReadReference.attachment = 1;
     hdrDepthOneReadReference.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-    VkAttachmentReference hdrDepthTwoReadReference{};
-    hdrDepthTwoReadReference.attachment = 2;
-    hdrDepthTwoReadReference.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
     /* Write into buffer first depth buffer */
     subpassDescriptions[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpassDescriptions[0].colorAttachmentCount = 1;
@@ -518,22 +612,7 @@ void Renderer::createRenderPass()
     subpassDescriptions[1].inputAttachmentCount = 1;
     subpassDescriptions[1].pInputAttachments = &hdrDepthOneReadReference;
 
-    /* Subpass 3 needs to write into second depth buffer and read from first one */
-    subpassDescriptions[2].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpassDescriptions[2].colorAttachmentCount = 1;
-    subpassDescriptions[2].inputAttachmentCount = 1;
-    subpassDescriptions[2].pInputAttachments = &hdrDepthOneReadReference;
-    subpassDescriptions[2].pColorAttachments = &hdrColorReference;
-    subpassDescriptions[2].pDepthStencilAttachment = &hdrDepthTwoWriteReference;
-
-    /* Subpass 4 needs to read depth buffer written by subpass 2 */
-    subpassDescriptions[3].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpassDescriptions[3].colorAttachmentCount = 1;
-    subpassDescriptions[3].inputAttachmentCount = 1;
-    subpassDescriptions[3].pColorAttachments = &hdrColorReference;
-    subpassDescriptions[3].pInputAttachments = &hdrDepthTwoReadReference;
-
-    std::array<VkSubpassDependency, 5> subpassDependencies{};
+    std::array<VkSubpassDependency, 3> subpassDependencies{};
 
     /* Make sure the transition from initialLayout in Attachment Description
        to layout in subpass attachment reference happens before we write or 
@@ -562,42 +641,24 @@ void Renderer::createRenderPass()
                                            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
     subpassDependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
-    /* Wait for subpass 1 to finish wirte into color map (WAW Hazard) */
+    /* Depth is sampled by the clouds compute passes -> not by region, color is
+       continued in the clouds composite pass */
     subpassDependencies[2].srcSubpass = 1;
-    subpassDependencies[2].dstSubpass = 2;
-    subpassDependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependencies[2].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    subpassDependencies[2].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    subpassDependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-    /* Wait for subpass 2 to finish write into depth map two */
-    subpassDependencies[3].srcSubpass = 2;
-    subpassDependencies[3].dstSubpass = 3;
-    subpassDependencies[3].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
-                                          VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+    subpassDependencies[2].dstSubpass = VK_SUBPASS_EXTERNAL;
+    subpassDependencies[2].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
                                           VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependencies[3].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+    subpassDependencies[2].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                                          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
                                           VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependencies[3].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    subpassDependencies[2].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
                                            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    subpassDependencies[3].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT |
+    subpassDependencies[2].dstAccessMask = VK_ACCESS_SHADER_READ_BIT |
+                                           VK_ACCESS_INPUT_ATTACHMENT_READ_BIT |
+                                           VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
                                            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    subpassDependencies[3].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
-    /* The same as first dependency, but transfer from layout to final layout */
-    subpassDependencies[4].srcSubpass = 3;
-    subpassDependencies[4].dstSubpass = VK_SUBPASS_EXTERNAL;
-    subpassDependencies[4].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependencies[4].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-    subpassDependencies[4].srcAccessMask = 
-        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    subpassDependencies[4].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-    /*NOTE: Not sure if this should be dependency by region  */
-    subpassDependencies[4].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-    std::array<VkAttachmentDescription, 3> hdrBackbufferAttachments =
-        { hdrBackbufferColorImageAttDesc, hdrBackbufferDepthOneAttachment, hdrBackbufferDepthTwoAttachment};
+    std::array<VkAttachmentDescription, 2> hdrBackbufferAttachments =
+        { hdrBackbufferColorImageAttDesc, hdrBackbufferDepthOneAttachment};
     
     VkRenderPassCreateInfo hdrBackbufferRenderPassInfo{};
     hdrBackbufferRenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -616,6 +677,113 @@ void Renderer::createRenderPass()
 
     #pragma endregion hdrBackbufferPass
 
+    #pragma region cloudsCompositePass
+    VkAttachmentDescription compositeColorAttDesc = hdrBackbufferColorImageAttDesc;
+    compositeColorAttDesc.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    compositeColorAttDesc.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    compositeColorAttDesc.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    /* First depth buffer is only read as input attachment in this pass */
+    VkAttachmentDescription compositeDepthOneAttDesc = hdrBackbufferDepthOneAttachment;
+    compositeDepthOneAttDesc.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    compositeDepthOneAttDesc.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    compositeDepthOneAttDesc.initialLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    compositeDepthOneAttDesc.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkAttachmentDescription compositeDepthTwoAttDesc{};
+    compositeDepthTwoAttDesc.format = findInMap(perFrameData[0].images,"HDRDepthTwo")->format;
+    compositeDepthTwoAttDesc.samples = VK_SAMPLE_COUNT_1_BIT;
+    compositeDepthTwoAttDesc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    compositeDepthTwoAttDesc.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    compositeDepthTwoAttDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    compositeDepthTwoAttDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    compositeDepthTwoAttDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    compositeDepthTwoAttDesc.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    std::array<VkSubpassDescription, 2> compositeSubpassDescriptions{};
+    VkAttachmentReference hdrDepthTwoWriteReference{};
+    hdrDepthTwoWriteReference.attachment = 2;
+    hdrDepthTwoWriteReference.layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference hdrDepthTwoReadReference{};
+    hdrDepthTwoReadReference.attachment = 2;
+    hdrDepthTwoReadReference.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    /* Upsample clouds, write into second depth buffer and read from first one */
+    compositeSubpassDescriptions[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    compositeSubpassDescriptions[0].colorAttachmentCount = 1;
+    compositeSubpassDescriptions[0].inputAttachmentCount = 1;
+    compositeSubpassDescriptions[0].pInputAttachments = &hdrDepthOneReadReference;
+    compositeSubpassDescriptions[0].pColorAttachments = &hdrColorReference;
+    compositeSubpassDescriptions[0].pDepthStencilAttachment = &hdrDepthTwoWriteReference;
+
+    /* Aerial perspective needs to read depth buffer written by subpass 0 */
+    compositeSubpassDescriptions[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    compositeSubpassDescriptions[1].colorAttachmentCount = 1;
+    compositeSubpassDescriptions[1].inputAttachmentCount = 1;
+    compositeSubpassDescriptions[1].pColorAttachments = &hdrColorReference;
+    compositeSubpassDescriptions[1].pInputAttachments = &hdrDepthTwoReadReference;
+
+    std::array<VkSubpassDependency, 3> compositeSubpassDependencies{};
+
+    /* Wait for clouds reconstruction compute pass and the history copy */
+    compositeSubpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    compositeSubpassDependencies[0].dstSubpass = 0;
+    compositeSubpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                                                   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    compositeSubpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                                   VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                                   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    compositeSubpassDependencies[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT |
+                                                    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    compositeSubpassDependencies[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT |
+                                                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                                    VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                                                    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    /* Wait for subpass 0 to finish write into depth map two */
+    compositeSubpassDependencies[1].srcSubpass = 0;
+    compositeSubpassDependencies[1].dstSubpass = 1;
+    compositeSubpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                                   VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+                                                   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    compositeSubpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                                   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    compositeSubpassDependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                                    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    compositeSubpassDependencies[1].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT |
+                                                    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    compositeSubpassDependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+    /* The same as first dependency, but transfer from layout to final layout */
+    compositeSubpassDependencies[2].srcSubpass = 1;
+    compositeSubpassDependencies[2].dstSubpass = VK_SUBPASS_EXTERNAL;
+    compositeSubpassDependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    compositeSubpassDependencies[2].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    compositeSubpassDependencies[2].srcAccessMask = 
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    compositeSubpassDependencies[2].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    compositeSubpassDependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+    std::array<VkAttachmentDescription, 3> compositeAttachments =
+        { compositeColorAttDesc, compositeDepthOneAttDesc, compositeDepthTwoAttDesc};
+
+    VkRenderPassCreateInfo compositeRenderPassInfo{};
+    compositeRenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    compositeRenderPassInfo.attachmentCount = static_cast<uint32_t>(compositeAttachments.size());
+    compositeRenderPassInfo.pAttachments = compositeAttachments.data();
+    compositeRenderPassInfo.subpassCount = static_cast<uint32_t>(compositeSubpassDescriptions.size());
+    compositeRenderPassInfo.pSubpasses = compositeSubpassDescriptions.data();
+    compositeRenderPassInfo.dependencyCount = static_cast<uint32_t>(compositeSubpassDependencies.size());
+    compositeRenderPassInfo.pDependencies = compositeSubpassDependencies.data();
+
+    if (vkCreateRenderPass(vDevice->device, &compositeRenderPassInfo, 
+        nullptr, &cloudsCompositePass) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RENDERER::CREATE_RENDER_PASS::Failed to create clouds composite render pass");
+    }
+    #pragma endregion cloudsCompositePass
+
     #pragma region finalRenderPass
     VkAttachmentDescription colorAttachment{};
     colorAttachment.format = vSwapChain->swapChainImageFormat;
@@ -711,12 +879,19 @@ void Renderer::createDescriptorSetLayout()
     normalDSLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     normalDSLayoutBinding.pImmutableSamplers = nullptr;
 
+    VkDescriptorSetLayoutBinding tileTableDSLayoutBinding;
+    tileTableDSLayoutBinding.binding = 3;
+    tileTableDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    tileTableDSLayoutBinding.descriptorCount = 1;
+    tileTableDSLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    tileTableDSLayoutBinding.pImmutableSamplers = nullptr;
+
     std::vector<VkDescriptorSetLayoutBinding> terrainTexturesBindings = {
-        heightDSLayoutBinding, diffuseDSLayoutBinding, normalDSLayoutBinding
+        heightDSLayoutBinding, diffuseDSLayoutBinding, normalDSLayoutBinding, tileTableDSLayoutBinding
     };
     VkDescriptorSetLayoutCreateInfo terrainLayoutCI{};
     terrainLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    terrainLayoutCI.bindingCount = 3;
+    terrainLayoutCI.bindingCount = 4;
     terrainLayoutCI.pBindings = terrainTexturesBindings.data();
 
     if (vkCreateDescriptorSetLayout(vDevice->device, &terrainLayoutCI,
@@ -820,7 +995,7 @@ void Renderer::createDescriptorSetLayout()
     transmittanceLUTDSLayoutBinding_.binding = 0;
     transmittanceLUTDSLayoutBinding_.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
     transmittanceLUTDSLayoutBinding_.descriptorCount = 1;
-    transmittanceLUTDSLayoutBinding_.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    transmittanceLUTDSLayoutBinding_.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
 
     VkDescriptorSetLayoutCreateInfo transmittanceLUTDSLayoutCI{};
     transmittanceLUTDSLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -861,22 +1036,59 @@ void Renderer::createDescriptorSetLayout()
     worleyNoiseImageDSLayoutBinding.binding = 0;
     worleyNoiseImageDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     worleyNoiseImageDSLayoutBinding.descriptorCount = 1;
-    worleyNoiseImageDSLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    worleyNoiseImageDSLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
     worleyNoiseImageDSLayoutBinding.pImmutableSamplers = nullptr;
 
     VkDescriptorSetLayoutBinding worleyNoiseImageDetailDSLayoutBinding{};
     worleyNoiseImageDetailDSLayoutBinding.binding = 1;
     worleyNoiseImageDetailDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     worleyNoiseImageDetailDSLayoutBinding.descriptorCount = 1;
-    worleyNoiseImageDetailDSLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    worleyNoiseImageDetailDSLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
     worleyNoiseImageDetailDSLayoutBinding.pImmutableSamplers = nullptr;
 
-    std::array<VkDescriptorSetLayoutBinding, 2> worleyNoiseBindings = {
-        worleyNoiseImageDSLayoutBinding, worleyNoiseImageDetailDSLayoutBinding};
+    VkDescriptorSetLayoutBinding cloudsOccupancyDSLayoutBinding{};
+    cloudsOccupancyDSLayoutBinding.binding = 2;
+    cloudsOccupancyDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    cloudsOccupancyDSLayoutBinding.descriptorCount = 1;
+    cloudsOccupancyDSLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    cloudsOccupancyDSLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding cloudsShadowDSLayoutBinding{};
+    cloudsShadowDSLayoutBinding.binding = 3;
+    cloudsShadowDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    cloudsShadowDSLayoutBinding.descriptorCount = 1;
+    cloudsShadowDSLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    cloudsShadowDSLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding coverageMapDSLayoutBinding{};
+    coverageMapDSLayoutBinding.binding = 4;
+    coverageMapDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    coverageMapDSLayoutBinding.descriptorCount = 1;
+    coverageMapDSLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    coverageMapDSLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding cloudsDensityDSLayoutBinding{};
+    cloudsDensityDSLayoutBinding.binding = 5;
+    cloudsDensityDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    cloudsDensityDSLayoutBinding.descriptorCount = 1;
+    cloudsDensityDSLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    cloudsDensityDSLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding cloudsPanoramaDSLayoutBinding{};
+    cloudsPanoramaDSLayoutBinding.binding = 6;
+    cloudsPanoramaDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    cloudsPanoramaDSLayoutBinding.descriptorCount = 1;
+    cloudsPanoramaDSLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    cloudsPanoramaDSLayoutBinding.pImmutableSamplers = nullptr;
+
+    std::array<VkDescriptorSetLayoutBinding, 7> worleyNoiseBindings = {
+        worleyNoiseImageDSLayoutBinding, worleyNoiseImageDetailDSLayoutBinding,
+        cloudsOccupancyDSLayoutBinding, cloudsShadowDSLayoutBinding, coverageMapDSLayoutBinding,
+        cloudsDensityDSLayoutBinding, cloudsPanoramaDSLayoutBinding};
 
     VkDescriptorSetLayoutCreateInfo worleyNoiseImageDSLayoutCI{};
     worleyNoiseImageDSLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    worleyNoiseImageDSLayoutCI.bindingCount = 2;
+    worleyNoiseImageDSLayoutCI.bindingCount = 7;
     worleyNoiseImageDSLayoutCI.pBindings = worleyNoiseBindings.data();
 
     if (vkCreateDescriptorSetLayout(vDevice->device, &worleyNoiseImageDSLayoutCI,
@@ -887,6 +1099,141 @@ void Renderer::createDescriptorSetLayout()
     }
     #pragma endregion worleyNoiseImageDS
 
+    #pragma region blueNoiseDS
+    VkDescriptorSetLayoutBinding blueNoiseDSLayoutBinding{};
+    blueNoiseDSLayoutBinding.binding = 0;
+    blueNoiseDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    blueNoiseDSLayoutBinding.descriptorCount = 1;
+    blueNoiseDSLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    blueNoiseDSLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo blueNoiseDSLayoutCI{};
+    blueNoiseDSLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    blueNoiseDSLayoutCI.bindingCount = 1;
+    blueNoiseDSLayoutCI.pBindings = &blueNoiseDSLayoutBinding;
+
+    if (vkCreateDescriptorSetLayout(vDevice->device, &blueNoiseDSLayoutCI,
+        nullptr, &descriptorLayouts["BlueNoise"]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RENDERER::CREATE_DESCRIPTOR_SET_LAYOUT::\
+            Failed to create blue noise descriptor set layout");
+    }
+    #pragma endregion blueNoiseDS
+
+    #pragma region cloudsOccupancyDS
+    /* binding 0 - occupancy mip 0, binding 1 - baked clouds density volume */
+    std::array<VkDescriptorSetLayoutBinding, 2> occupancyBuildBindings{};
+    occupancyBuildBindings[0].binding = 0;
+    occupancyBuildBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    occupancyBuildBindings[0].descriptorCount = 1;
+    occupancyBuildBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    occupancyBuildBindings[0].pImmutableSamplers = nullptr;
+
+    occupancyBuildBindings[1].binding = 1;
+    occupancyBuildBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    occupancyBuildBindings[1].descriptorCount = 1;
+    occupancyBuildBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    occupancyBuildBindings[1].pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo occupancyBuildDSLayoutCI{};
+    occupancyBuildDSLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    occupancyBuildDSLayoutCI.bindingCount = static_cast<uint32_t>(occupancyBuildBindings.size());
+    occupancyBuildDSLayoutCI.pBindings = occupancyBuildBindings.data();
+
+    if (vkCreateDescriptorSetLayout(vDevice->device, &occupancyBuildDSLayoutCI,
+        nullptr, &descriptorLayouts["CloudsOccupancyBuild"]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RENDERER::CREATE_DESCRIPTOR_SET_LAYOUT::\
+            Failed to create clouds occupancy build descriptor set layout");
+    }
+
+    /* binding 0 - source mip, binding 1 - destination mip */
+    std::array<VkDescriptorSetLayoutBinding, 2> occupancyDownsampleBindings{};
+    for(uint32_t binding = 0; binding < 2; binding++)
+    {
+        occupancyDownsampleBindings[binding].binding = binding;
+        occupancyDownsampleBindings[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        occupancyDownsampleBindings[binding].descriptorCount = 1;
+        occupancyDownsampleBindings[binding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        occupancyDownsampleBindings[binding].pImmutableSamplers = nullptr;
+    }
+
+    VkDescriptorSetLayoutCreateInfo occupancyDownsampleDSLayoutCI{};
+    occupancyDownsampleDSLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    occupancyDownsampleDSLayoutCI.bindingCount = 2;
+    occupancyDownsampleDSLayoutCI.pBindings = occupancyDownsampleBindings.data();
+
+    if (vkCreateDescriptorSetLayout(vDevice->device, &occupancyDownsampleDSLayoutCI,
+        nullptr, &descriptorLayouts["CloudsOccupancyDownsample"]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RENDERER::CREATE_DESCRIPTOR_SET_LAYOUT::\
+            Failed to create clouds occupancy downsample descriptor set layout");
+    }
+    #pragma endregion cloudsOccupancyDS
+
+    #pragma region cloudsDensityBakeDS
+    VkDescriptorSetLayoutBinding densityBakeDSLayoutBinding{};
+    densityBakeDSLayoutBinding.binding = 0;
+    densityBakeDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    densityBakeDSLayoutBinding.descriptorCount = 1;
+    densityBakeDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    densityBakeDSLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo densityBakeDSLayoutCI{};
+    densityBakeDSLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    densityBakeDSLayoutCI.bindingCount = 1;
+    densityBakeDSLayoutCI.pBindings = &densityBakeDSLayoutBinding;
+
+    if (vkCreateDescriptorSetLayout(vDevice->device, &densityBakeDSLayoutCI,
+        nullptr, &descriptorLayouts["CloudsDensityBake"]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RENDERER::CREATE_DESCRIPTOR_SET_LAYOUT::\
+            Failed to create clouds density bake descriptor set layout");
+    }
+    #pragma endregion cloudsDensityBakeDS
+
+    #pragma region cloudsShadowBuildDS
+    VkDescriptorSetLayoutBinding cloudsShadowBuildDSLayoutBinding{};
+    cloudsShadowBuildDSLayoutBinding.binding = 0;
+    cloudsShadowBuildDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    cloudsShadowBuildDSLayoutBinding.descriptorCount = 1;
+    cloudsShadowBuildDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    cloudsShadowBuildDSLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo cloudsShadowBuildDSLayoutCI{};
+    cloudsShadowBuildDSLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    cloudsShadowBuildDSLayoutCI.bindingCount = 1;
+    cloudsShadowBuildDSLayoutCI.pBindings = &cloudsShadowBuildDSLayoutBinding;
+
+    if (vkCreateDescriptorSetLayout(vDevice->device, &cloudsShadowBuildDSLayoutCI,
+        nullptr, &descriptorLayouts["CloudsShadowBuild"]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RENDERER::CREATE_DESCRIPTOR_SET_LAYOUT::\
+            Failed to create clouds shadow build descriptor set layout");
+    }
+    #pragma endregion cloudsShadowBuildDS
+
+    #pragma region cloudsPanoramaBuildDS
+    VkDescriptorSetLayoutBinding cloudsPanoramaBuildDSLayoutBinding{};
+    cloudsPanoramaBuildDSLayoutBinding.binding = 0;
+    cloudsPanoramaBuildDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    cloudsPanoramaBuildDSLayoutBinding.descriptorCount = 1;
+    cloudsPanoramaBuildDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    cloudsPanoramaBuildDSLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo cloudsPanoramaBuildDSLayoutCI{};
+    cloudsPanoramaBuildDSLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    cloudsPanoramaBuildDSLayoutCI.bindingCount = 1;
+    cloudsPanoramaBuildDSLayoutCI.pBindings = &cloudsPanoramaBuildDSLayoutBinding;
+
+    if (vkCreateDescriptorSetLayout(vDevice->device, &cloudsPanoramaBuildDSLayoutCI,
+        nullptr, &descriptorLayouts["CloudsPanoramaBuild"]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RENDERER::CREATE_DESCRIPTOR_SET_LAYOUT::\
+            Failed to create clouds panorama build descriptor set layout");
+    }
+    #pragma endregion cloudsPanoramaBuildDS
+
     #pragma region skyViewLUTIn
     VkDescriptorSetLayoutBinding skyViewLutInDsLayoutBinding{};
     skyViewLutInDsLayoutBinding.binding = 0;
@@ -950,6 +1297,150 @@ void Renderer::createDescriptorSetLayout()
     }
     #pragma endregion depthReadTwo
 
+    #pragma region sceneDepth
+    VkDescriptorSetLayoutBinding sceneDepthDsLayoutBinding{};
+    sceneDepthDsLayoutBinding.binding = 0;
+    sceneDepthDsLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    sceneDepthDsLayoutBinding.descriptorCount = 1;
+    sceneDepthDsLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    sceneDepthDsLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo sceneDepthDSLayoutCI{};
+    sceneDepthDSLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    sceneDepthDSLayoutCI.bindingCount = 1;
+    sceneDepthDSLayoutCI.pBindings = &sceneDepthDsLayoutBinding;
+
+    if (vkCreateDescriptorSetLayout(vDevice->device, &sceneDepthDSLayoutCI,
+        nullptr, &descriptorLayouts["SceneDepth"]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RENDERER::CREATE_DESCRIPTOR_SET_LAYOUT::\
+            Failed to create scene depth descriptor set layout");
+    }
+    #pragma endregion sceneDepth
+
+    #pragma region cloudsTrace
+    VkDescriptorSetLayoutBinding cloudsTraceColorDSLayoutBinding{};
+    cloudsTraceColorDSLayoutBinding.binding = 0;
+    cloudsTraceColorDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    cloudsTraceColorDSLayoutBinding.descriptorCount = 1;
+    cloudsTraceColorDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutBinding cloudsTraceDepthDSLayoutBinding{};
+    cloudsTraceDepthDSLayoutBinding.binding = 1;
+    cloudsTraceDepthDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    cloudsTraceDepthDSLayoutBinding.descriptorCount = 1;
+    cloudsTraceDepthDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutBinding cloudsTileStatsDSLayoutBinding{};
+    cloudsTileStatsDSLayoutBinding.binding = 2;
+    cloudsTileStatsDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    cloudsTileStatsDSLayoutBinding.descriptorCount = 1;
+    cloudsTileStatsDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    std::array<VkDescriptorSetLayoutBinding, 3> cloudsTraceBindings = {
+        cloudsTraceColorDSLayoutBinding, cloudsTraceDepthDSLayoutBinding, cloudsTileStatsDSLayoutBinding};
+
+    VkDescriptorSetLayoutCreateInfo cloudsTraceDSLayoutCI{};
+    cloudsTraceDSLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    cloudsTraceDSLayoutCI.bindingCount = static_cast<uint32_t>(cloudsTraceBindings.size());
+    cloudsTraceDSLayoutCI.pBindings = cloudsTraceBindings.data();
+
+    if (vkCreateDescriptorSetLayout(vDevice->device, &cloudsTraceDSLayoutCI,
+        nullptr, &descriptorLayouts["CloudsTrace"]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RENDERER::CREATE_DESCRIPTOR_SET_LAYOUT::\
+            Failed to create clouds trace descriptor set layout");
+    }
+    #pragma endregion cloudsTrace
+
+    #pragma region cloudsTiles
+    VkDescriptorSetLayoutBinding cloudsTilesDSLayoutBinding{};
+    cloudsTilesDSLayoutBinding.binding = 0;
+    cloudsTilesDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    cloudsTilesDSLayoutBinding.descriptorCount = 1;
+    cloudsTilesDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    cloudsTilesDSLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo cloudsTilesDSLayoutCI{};
+    cloudsTilesDSLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    cloudsTilesDSLayoutCI.bindingCount = 1;
+    cloudsTilesDSLayoutCI.pBindings = &cloudsTilesDSLayoutBinding;
+
+    if (vkCreateDescriptorSetLayout(vDevice->device, &cloudsTilesDSLayoutCI,
+        nullptr, &descriptorLayouts["CloudsTiles"]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RENDERER::CREATE_DESCRIPTOR_SET_LAYOUT::\
+            Failed to create clouds tiles descriptor set layout");
+    }
+    #pragma endregion cloudsTiles
+
+    #pragma region cloudsReconstruct
+    VkDescriptorSetLayoutBinding cloudsHistoryDSLayoutBinding{};
+    cloudsHistoryDSLayoutBinding.binding = 0;
+    cloudsHistoryDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    cloudsHistoryDSLayoutBinding.descriptorCount = 1;
+    cloudsHistoryDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    cloudsHistoryDSLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding cloudsColorOutDSLayoutBinding{};
+    cloudsColorOutDSLayoutBinding.binding = 1;
+    cloudsColorOutDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    cloudsColorOutDSLayoutBinding.descriptorCount = 1;
+    cloudsColorOutDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutBinding cloudsDepthOutDSLayoutBinding{};
+    cloudsDepthOutDSLayoutBinding.binding = 2;
+    cloudsDepthOutDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    cloudsDepthOutDSLayoutBinding.descriptorCount = 1;
+    cloudsDepthOutDSLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    std::array<VkDescriptorSetLayoutBinding, 3> cloudsReconstructBindings = {
+        cloudsHistoryDSLayoutBinding, cloudsColorOutDSLayoutBinding, cloudsDepthOutDSLayoutBinding};
+
+    VkDescriptorSetLayoutCreateInfo cloudsReconstructDSLayoutCI{};
+    cloudsReconstructDSLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    cloudsReconstructDSLayoutCI.bindingCount = static_cast<uint32_t>(cloudsReconstructBindings.size());
+    cloudsReconstructDSLayoutCI.pBindings = cloudsReconstructBindings.data();
+
+    if (vkCreateDescriptorSetLayout(vDevice->device, &cloudsReconstructDSLayoutCI,
+        nullptr, &descriptorLayouts["CloudsReconstruct"]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RENDERER::CREATE_DESCRIPTOR_SET_LAYOUT::\
+            Failed to create clouds reconstruct descriptor set layout");
+    }
+    #pragma endregion cloudsReconstruct
+
+    #pragma region cloudsUpsample
+    VkDescriptorSetLayoutBinding cloudsColorInDSLayoutBinding{};
+    cloudsColorInDSLayoutBinding.binding = 0;
+    cloudsColorInDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    cloudsColorInDSLayoutBinding.descriptorCount = 1;
+    cloudsColorInDSLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    cloudsColorInDSLayoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding cloudsDepthInDSLayoutBinding{};
+    cloudsDepthInDSLayoutBinding.binding = 1;
+    cloudsDepthInDSLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    cloudsDepthInDSLayoutBinding.descriptorCount = 1;
+    cloudsDepthInDSLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    cloudsDepthInDSLayoutBinding.pImmutableSamplers = nullptr;
+
+    std::array<VkDescriptorSetLayoutBinding, 2> cloudsUpsampleBindings = {
+        cloudsColorInDSLayoutBinding, cloudsDepthInDSLayoutBinding};
+
+    VkDescriptorSetLayoutCreateInfo cloudsUpsampleDSLayoutCI{};
+    cloudsUpsampleDSLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    cloudsUpsampleDSLayoutCI.bindingCount = static_cast<uint32_t>(cloudsUpsampleBindings.size());
+    cloudsUpsampleDSLayoutCI.pBindings = cloudsUpsampleBindings.data();
+
+    if (vkCreateDescriptorSetLayout(vDevice->device, &cloudsUpsampleDSLayoutCI,
+        nullptr, &descriptorLayouts["CloudsUpsample"]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RENDERER::CREATE_DESCRIPTOR_SET_LAYOUT::\
+            Failed to create clouds upsample descriptor set layout");
+    }
+    #pragma endregion cloudsUpsample
+
     #pragma region hdrBackbufferIn
     VkDescriptorSetLayoutBinding hdrBackbufferInDsLayoutBinding{};
     hdrBackbufferInDsLayoutBinding.binding = 0;
@@ -1063,7 +1554,8 @@ void Renderer::createPipelines()
             findInMap(descriptorLayouts,"CommonUBO"),
             findInMap(descriptorLayouts,"SkyConstantUBO"),
             findInMap(descriptorLayouts,"TerrainTextures"), 
-            findInMap(descriptorLayouts,"TransmittanceLUT")
+            findInMap(descriptorLayouts,"TransmittanceLUT"),
+            findInMap(descriptorLayouts,"WorleyNoise")
     };
     auto terrainVertShaderCode = readFile("shaders/build/terrain.vert.spv");
     auto terrainFragShaderCode = readFile("shaders/build/terrain.frag.spv");
@@ -1085,10 +1577,29 @@ void Renderer::createPipelines()
     terrainScissor.offset = {0, 0};
     terrainScissor.extent = vSwapChain->swapChainExtent;
 
+    /* Patch vertices come from gl_VertexIndex, the only binding holds the selected
+       quadtree nodes and advances per instance */
+    std::vector<VkVertexInputBindingDescription> terrainBindings(1);
+    terrainBindings[0].binding = 0;
+    terrainBindings[0].stride = sizeof(TerrainNodeInstance);
+    terrainBindings[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    std::vector<VkVertexInputAttributeDescription> terrainAttributes;
+    VkVertexInputAttributeDescription nodeAttribute{};
+    nodeAttribute.binding = 0;
+    nodeAttribute.location = 0;
+    nodeAttribute.format = VK_FORMAT_R32G32B32_SFLOAT;
+    nodeAttribute.offset = offsetof(TerrainNodeInstance, node);
+    terrainAttributes.push_back(nodeAttribute);
+    nodeAttribute.location = 1;
+    nodeAttribute.format = VK_FORMAT_R32G32_SFLOAT;
+    nodeAttribute.offset = offsetof(TerrainNodeInstance, morphRange);
+    terrainAttributes.push_back(nodeAttribute);
+
     terrainPassPipeline = std::make_unique<VulkanPipeline>(
         vDevice,
         2, terrainShaderStages,
-        VulkanPipeline::initVertexStageInputStateCI( Vertex::getBindingDescription(),Vertex::getAttributeDescriptions()),
+        VulkanPipeline::initVertexStageInputStateCI(terrainBindings, terrainAttributes),
         VulkanPipeline::initInputAssemblyStateCI(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE),
         VulkanPipeline::initViewportStateCI(false, terrainViewport, terrainScissor),
         VulkanPipeline::initRaserizationStateCI(VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, 
@@ -1100,7 +1611,7 @@ void Renderer::createPipelines()
                 VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
                 VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
                 VK_FALSE)),              
-        VulkanPipeline::initPiplineLayoutCI(4, terrainDescriptorSetLayouts),
+        VulkanPipeline::initPiplineLayoutCI(5, terrainDescriptorSetLayouts),
         hdrBackbufferPass,
         0);
         vkDestroyShaderModule(vDevice->device, terrainVertShaderModule, nullptr);
@@ -1225,6 +1736,169 @@ void Renderer::createPipelines()
     vkDestroyShaderModule(vDevice->device, sumHistogramComputeShaderModule, nullptr);
     #pragma endregion computeHistogramSumPipeline
 
+    #pragma region cloudsClassifyPipeline
+    auto cloudsClassifyComputeShaderCode = readFile("shaders/build/clouds_classify.glsl.spv");
+    VkShaderModule cloudsClassifyComputeShaderModule = 
+        createShaderModule(vDevice, cloudsClassifyComputeShaderCode);
+
+    std::vector<VkDescriptorSetLayout> cloudsClassifyDSLayouts = {
+        findInMap(descriptorLayouts,"CommonUBO"),
+        findInMap(descriptorLayouts,"SkyConstantUBO"),
+        findInMap(descriptorLayouts,"CloudsParamsUBO"),
+        findInMap(descriptorLayouts,"SceneDepth"),
+        findInMap(descriptorLayouts,"CloudsTrace"),
+        findInMap(descriptorLayouts,"CloudsTiles")
+    };
+
+    cloudsClassifyPipeline = std::make_unique<VulkanPipeline>(
+        vDevice,
+        VulkanPipeline::initPiplineLayoutCI(6, cloudsClassifyDSLayouts),
+        VulkanPipeline::initComputeShaderStageCI(cloudsClassifyComputeShaderModule)
+    );
+    vkDestroyShaderModule(vDevice->device, cloudsClassifyComputeShaderModule, nullptr);
+    #pragma endregion cloudsClassifyPipeline
+
+    #pragma region cloudsTracePipeline
+    auto cloudsTraceComputeShaderCode = readFile("shaders/build/clouds_trace.glsl.spv");
+    VkShaderModule cloudsTraceComputeShaderModule = 
+        createShaderModule(vDevice, cloudsTraceComputeShaderCode);
+
+    std::vector<VkDescriptorSetLayout> cloudsTraceDSLayouts = {
+        findInMap(descriptorLayouts,"CommonUBO"),
+        findInMap(descriptorLayouts,"SkyConstantUBO"),
+        findInMap(descriptorLayouts,"CloudsParamsUBO"),
+        findInMap(descriptorLayouts,"SceneDepth"),
+        findInMap(descriptorLayouts,"WorleyNoise"),
+        findInMap(descriptorLayouts,"TransmittanceLUT"),
+        findInMap(descriptorLayouts,"CloudsTrace"),
+        findInMap(descriptorLayouts,"BlueNoise"),
+        findInMap(descriptorLayouts,"CloudsTiles")
+    };
+
+    cloudsTracePipeline = std::make_unique<VulkanPipeline>(
+        vDevice,
+        VulkanPipeline::initPiplineLayoutCI(9, cloudsTraceDSLayouts),
+        VulkanPipeline::initComputeShaderStageCI(cloudsTraceComputeShaderModule)
+    );
+    vkDestroyShaderModule(vDevice->device, cloudsTraceComputeShaderModule, nullptr);
+    #pragma endregion cloudsTracePipeline
+
+    #pragma region cloudsReconstructPipeline
+    auto cloudsReconstructComputeShaderCode = readFile("shaders/build/clouds_reconstruct.glsl.spv");
+    VkShaderModule cloudsReconstructComputeShaderModule = 
+        createShaderModule(vDevice, cloudsReconstructComputeShaderCode);
+
+    std::vector<VkDescriptorSetLayout> cloudsReconstructDSLayouts = {
+        findInMap(descriptorLayouts,"CommonUBO"),
+        findInMap(descriptorLayouts,"SceneDepth"),
+        findInMap(descriptorLayouts,"CloudsParamsUBO"),
+        findInMap(descriptorLayouts,"CloudsTrace"),
+        findInMap(descriptorLayouts,"CloudsReconstruct")
+    };
+
+    cloudsReconstructPipeline = std::make_unique<VulkanPipeline>(
+        vDevice,
+        VulkanPipeline::initPiplineLayoutCI(5, cloudsReconstructDSLayouts),
+        VulkanPipeline::initComputeShaderStageCI(cloudsReconstructComputeShaderModule)
+    );
+    vkDestroyShaderModule(vDevice->device, cloudsReconstructComputeShaderModule, nullptr);
+    #pragma endregion cloudsReconstructPipeline
+
+    #pragma region cloudsDensityBakePipeline
+    auto densityBakeComputeShaderCode = readFile("shaders/build/clouds_density_bake.glsl.spv");
+    VkShaderModule densityBakeComputeShaderModule = 
+        createShaderModule(vDevice, densityBakeComputeShaderCode);
+
+    std::vector<VkDescriptorSetLayout> densityBakeDSLayouts = {
+        findInMap(descriptorLayouts,"WorleyNoise"),
+        findInMap(descriptorLayouts,"CloudsDensityBake"),
+        findInMap(descriptorLayouts,"CloudsParamsUBO")
+    };
+
+    cloudsDensityBakePipeline = std::make_unique<VulkanPipeline>(
+        vDevice,
+        VulkanPipeline::initPiplineLayoutCI(3, densityBakeDSLayouts),
+        VulkanPipeline::initComputeShaderStageCI(densityBakeComputeShaderModule)
+    );
+    vkDestroyShaderModule(vDevice->device, densityBakeComputeShaderModule, nullptr);
+    #pragma endregion cloudsDensityBakePipeline
+
+    #pragma region cloudsOccupancyPipelines
+    auto occupancyBuildComputeShaderCode = readFile("shaders/build/clouds_occupancy_build.glsl.spv");
+    VkShaderModule occupancyBuildComputeShaderModule = 
+        createShaderModule(vDevice, occupancyBuildComputeShaderCode);
+
+    std::vector<VkDescriptorSetLayout> occupancyBuildDSLayouts = {
+        findInMap(descriptorLayouts,"CloudsOccupancyBuild")
+    };
+
+    cloudsOccupancyBuildPipeline = std::make_unique<VulkanPipeline>(
+        vDevice,
+        VulkanPipeline::initPiplineLayoutCI(1, occupancyBuildDSLayouts),
+        VulkanPipeline::initComputeShaderStageCI(occupancyBuildComputeShaderModule)
+    );
+    vkDestroyShaderModule(vDevice->device, occupancyBuildComputeShaderModule, nullptr);
+
+    auto occupancyDownsampleComputeShaderCode = readFile("shaders/build/clouds_occupancy_downsample.glsl.spv");
+    VkShaderModule occupancyDownsampleComputeShaderModule = 
+        createShaderModule(vDevice, occupancyDownsampleComputeShaderCode);
+
+    std::vector<VkDescriptorSetLayout> occupancyDownsampleDSLayouts = {
+        findInMap(descriptorLayouts,"CloudsOccupancyDownsample")
+    };
+
+    cloudsOccupancyDownsamplePipeline = std::make_unique<VulkanPipeline>(
+        vDevice,
+        VulkanPipeline::initPiplineLayoutCI(1, occupancyDownsampleDSLayouts),
+        VulkanPipeline::initComputeShaderStageCI(occupancyDownsampleComputeShaderModule)
+    );
+    vkDestroyShaderModule(vDevice->device, occupancyDownsampleComputeShaderModule, nullptr);
+    #pragma endregion cloudsOccupancyPipelines
+
+    #pragma region cloudsShadowBuildPipeline
+    auto cloudsShadowBuildComputeShaderCode = readFile("shaders/build/clouds_shadow_build.glsl.spv");
+    VkShaderModule cloudsShadowBuildComputeShaderModule = 
+        createShaderModule(vDevice, cloudsShadowBuildComputeShaderCode);
+
+    std::vector<VkDescriptorSetLayout> cloudsShadowBuildDSLayouts = {
+        findInMap(descriptorLayouts,"CommonUBO"),
+        findInMap(descriptorLayouts,"SkyConstantUBO"),
+        findInMap(descriptorLayouts,"CloudsParamsUBO"),
+        findInMap(descriptorLayouts,"WorleyNoise"),
+        findInMap(descriptorLayouts,"TransmittanceLUT"),
+        findInMap(descriptorLayouts,"CloudsShadowBuild")
+    };
+
+    cloudsShadowBuildPipeline = std::make_unique<VulkanPipeline>(
+        vDevice,
+        VulkanPipeline::initPiplineLayoutCI(6, cloudsShadowBuildDSLayouts),
+        VulkanPipeline::initComputeShaderStageCI(cloudsShadowBuildComputeShaderModule)
+    );
+    vkDestroyShaderModule(vDevice->device, cloudsShadowBuildComputeShaderModule, nullptr);
+    #pragma endregion cloudsShadowBuildPipeline
+
+    #pragma region cloudsPanoramaBuildPipeline
+    auto cloudsPanoramaBuildComputeShaderCode = readFile("shaders/build/clouds_panorama_build.glsl.spv");
+    VkShaderModule cloudsPanoramaBuildComputeShaderModule = 
+        createShaderModule(vDevice, cloudsPanoramaBuildComputeShaderCode);
+
+    std::vector<VkDescriptorSetLayout> cloudsPanoramaBuildDSLayouts = {
+        findInMap(descriptorLayouts,"CommonUBO"),
+        findInMap(descriptorLayouts,"SkyConstantUBO"),
+        findInMap(descriptorLayouts,"CloudsParamsUBO"),
+        findInMap(descriptorLayouts,"WorleyNoise"),
+        findInMap(descriptorLayouts,"TransmittanceLUT"),
+        findInMap(descriptorLayouts,"CloudsPanoramaBuild")
+    };
+
+    cloudsPanoramaBuildPipeline = std::make_unique<VulkanPipeline>(
+        vDevice,
+        VulkanPipeline::initPiplineLayoutCI(6, cloudsPanoramaBuildDSLayouts),
+        VulkanPipeline::initComputeShaderStageCI(cloudsPanoramaBuildComputeShaderModule)
+    );
+    vkDestroyShaderModule(vDevice->device, cloudsPanoramaBuildComputeShaderModule, nullptr);
+    #pragma endregion cloudsPanoramaBuildPipeline
+
     #pragma endregion compute_pipelines
 
     #pragma region drawCloudsPipeline
@@ -1250,11 +1924,9 @@ void Renderer::createPipelines()
 
     std::vector<VkDescriptorSetLayout> cloudsDescriptorSetLayouts = { 
         findInMap(descriptorLayouts,"CommonUBO"), 
-        findInMap(descriptorLayouts,"SkyConstantUBO"), 
+        findInMap(descriptorLayouts,"CloudsUpsample"), 
         findInMap(descriptorLayouts,"CloudsParamsUBO"), 
         findInMap(descriptorLayouts,"DepthOne"), 
-        findInMap(descriptorLayouts,"WorleyNoise"), 
-        findInMap(descriptorLayouts,"TransmittanceLUT"), 
     };
 
     cloudsPassPipeline = std::make_unique<VulkanPipeline>(  
@@ -1274,9 +1946,9 @@ void Renderer::createPipelines()
                 VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
                 VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
                 VK_TRUE)),
-        VulkanPipeline::initPiplineLayoutCI(6, cloudsDescriptorSetLayouts),
-        hdrBackbufferPass,
-        2);
+        VulkanPipeline::initPiplineLayoutCI(4, cloudsDescriptorSetLayouts),
+        cloudsCompositePass,
+        0);
         vkDestroyShaderModule(vDevice->device, cloudsVertexShaderModule, nullptr);
         vkDestroyShaderModule(vDevice->device, cloudsFragmentShaderModule, nullptr);
     #pragma endregion drawCloudsPipeline
@@ -1359,6 +2031,7 @@ void Renderer::createPipelines()
         findInMap(descriptorLayouts,"SkyConstantUBO"), 
         findInMap(descriptorLayouts,"DepthTwo"), 
         findInMap(descriptorLayouts,"AEPerspectiveLUT"), 
+        findInMap(descriptorLayouts,"BlueNoise"), 
     };
 
     aePerspectivePassPipeline = std::make_unique<VulkanPipeline>(  
@@ -1378,9 +2051,9 @@ void Renderer::createPipelines()
                 VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
                 VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
                 VK_TRUE)),
-        VulkanPipeline::initPiplineLayoutCI(4, aePerspectiveDescriptorSetLayouts),
-        hdrBackbufferPass,
-        3);
+        VulkanPipeline::initPiplineLayoutCI(5, aePerspectiveDescriptorSetLayouts),
+        cloudsCompositePass,
+        1);
         vkDestroyShaderModule(vDevice->device, aePerspectiveVertexShaderModule, nullptr);
         vkDestroyShaderModule(vDevice->device, aePerspectiveFragmentShaderModule, nullptr);
     #pragma endregion drawAEPerspective
@@ -1472,6 +2145,83 @@ void Renderer::createAttachments()
         VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT |
         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    #pragma region cloudsTargets
+    cloudsResolutionDivisor = std::max(cloudsParamsBuffer.resolutionDivisor, 1);
+    cloudsReprojectionBlockSize = std::max(cloudsParamsBuffer.reprojectionBlockSize, 1);
+    cloudsParamsBuffer.resolutionDivisor = cloudsResolutionDivisor;
+    cloudsParamsBuffer.reprojectionBlockSize = cloudsReprojectionBlockSize;
+
+    /* Clouds are reconstructed in reduced resolution, only one pixel out of each
+       reprojection block is raymarched each frame into the trace targets */
+    cloudsExtent.width = (vSwapChain->swapChainExtent.width + cloudsResolutionDivisor - 1) /
+        cloudsResolutionDivisor;
+    cloudsExtent.height = (vSwapChain->swapChainExtent.height + cloudsResolutionDivisor - 1) /
+        cloudsResolutionDivisor;
+    cloudsTraceExtent.width = (cloudsExtent.width + cloudsReprojectionBlockSize - 1) /
+        cloudsReprojectionBlockSize;
+    cloudsTraceExtent.height = (cloudsExtent.height + cloudsReprojectionBlockSize - 1) /
+        cloudsReprojectionBlockSize;
+
+    VkImageUsageFlags cloudsUsage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    frameSharedImages["CloudsTrace"] = std::make_unique<VulkanImage>(vDevice, cloudsTraceExtent.width, cloudsTraceExtent.height,
+        1, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+        cloudsUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    frameSharedImages["CloudsTraceDepth"] = std::make_unique<VulkanImage>(vDevice, cloudsTraceExtent.width, cloudsTraceExtent.height,
+        1, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R32G32_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+        cloudsUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    frameSharedImages["CloudsColor"] = std::make_unique<VulkanImage>(vDevice, cloudsExtent.width, cloudsExtent.height,
+        1, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+        cloudsUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    frameSharedImages["CloudsColorHistory"] = std::make_unique<VulkanImage>(vDevice, cloudsExtent.width, cloudsExtent.height,
+        1, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+        cloudsUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    /* r - scene depth the clouds were reconstructed against, g - clouds depth */
+    frameSharedImages["CloudsDepth"] = std::make_unique<VulkanImage>(vDevice, cloudsExtent.width, cloudsExtent.height,
+        1, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R32G32_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+        cloudsUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    /* One texel per 8x8 tile of the trace targets, statistics of the last frame the tile
+       was traced in which the sample budget of the tile is derived from, see clouds_trace */
+    frameSharedImages["CloudsTileStats"] = std::make_unique<VulkanImage>(vDevice,
+        (cloudsTraceExtent.width + 7) / 8, (cloudsTraceExtent.height + 7) / 8,
+        1, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+        cloudsUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    for(const std::string &name : {"CloudsTrace", "CloudsTraceDepth", "CloudsColor",
+        "CloudsColorHistory", "CloudsDepth", "CloudsTileStats"})
+    {
+        auto image = findInMap(frameSharedImages, name);
+        image->TransitionImageLayout(image->format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 1);
+    }
+    /* Negative alpha marks the history as invalid -> first frame after creation
+       uses only the freshly traced pixels */
+    VkClearColorValue invalidHistory = {{0.0f, 0.0f, 0.0f, -1.0f}};
+    findInMap(frameSharedImages, "CloudsColorHistory")->ClearColorImage(invalidHistory,
+        VK_IMAGE_LAYOUT_GENERAL);
+    /* Negative red -> tiles without statistics get the default budget */
+    VkClearColorValue invalidTileStats = {{-1.0f, 0.0f, 0.0f, 0.0f}};
+    findInMap(frameSharedImages, "CloudsTileStats")->ClearColorImage(invalidTileStats,
+        VK_IMAGE_LAYOUT_GENERAL);
+
+    /* Header followed by one entry per 8x8 tile of the trace targets, the header is
+       reset at the start of each frame by the clouds trace commands */
+    uint32_t cloudsTileCount = ((cloudsTraceExtent.width + 7) / 8) * ((cloudsTraceExtent.height + 7) / 8);
+    VkDeviceSize tileListSize = sizeof(CloudsTileListHeader) + sizeof(uint32_t) * cloudsTileCount;
+    for(int i = 0; i < vSwapChain->imageCount; i++)
+    {
+        perFrameData[i].buffers["CloudsTiles"] = std::make_unique<VulkanBuffer>(vDevice, tileListSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+    #pragma endregion cloudsTargets
 }
 
 void Renderer::createFramebuffers()
@@ -1479,11 +2229,10 @@ void Renderer::createFramebuffers()
     for(int i = 0; i < vSwapChain->imageCount; i++)
     {
         #pragma region offscreenFramebuffer
-        std::array<VkImageView, 3> offscreenAttachments =
+        std::array<VkImageView, 2> offscreenAttachments =
         {
             findInMap(perFrameData[i].images,"HDRColor")->imageView,
-            findInMap(perFrameData[i].images,"HDRDepthOne")->imageView,
-            findInMap(perFrameData[i].images,"HDRDepthTwo")->imageView
+            findInMap(perFrameData[i].images,"HDRDepthOne")->imageView
         };
 
         VkFramebufferCreateInfo offscreenFramebufferCreateInfo {};
@@ -1503,6 +2252,31 @@ void Renderer::createFramebuffers()
         }
         #pragma endregion offscreenFramebuffer
 
+        #pragma region cloudsCompositeFramebuffer
+        std::array<VkImageView, 3> cloudsCompositeAttachments =
+        {
+            findInMap(perFrameData[i].images,"HDRColor")->imageView,
+            findInMap(perFrameData[i].images,"HDRDepthOne")->imageView,
+            findInMap(perFrameData[i].images,"HDRDepthTwo")->imageView
+        };
+
+        VkFramebufferCreateInfo cloudsCompositeFramebufferCreateInfo {};
+        cloudsCompositeFramebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        cloudsCompositeFramebufferCreateInfo.renderPass = cloudsCompositePass;
+        cloudsCompositeFramebufferCreateInfo.attachmentCount = static_cast<uint32_t>(cloudsCompositeAttachments.size());
+        cloudsCompositeFramebufferCreateInfo.pAttachments = cloudsCompositeAttachments.data();
+        cloudsCompositeFramebufferCreateInfo.width = vSwapChain->swapChainExtent.width;
+        cloudsCompositeFramebufferCreateInfo.height = vSwapChain->swapChainExtent.height;
+        cloudsCompositeFramebufferCreateInfo.layers = 1;
+
+        if (vkCreateFramebuffer(vDevice->device, &cloudsCompositeFramebufferCreateInfo,
+            nullptr, &perFrameData[i].framebuffers["CloudsComposite"]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("RENDERER::CREATE_FRAMEBUFFERS::\
+                Failed to create clouds composite framebuffer");
+        }
+        #pragma endregion cloudsCompositeFramebuffer
+
         #pragma region imguiPassFramebuffer
         std::array<VkImageView, 1> attachments =
         {   
@@ -1554,73 +2328,15 @@ void Renderer::createFramebuffers()
 
 void Renderer::createPrimitivesBuffers()
 {
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-
-    const unsigned int terrainRes = 3000;
+    /* Terrain patch vertices are derived from gl_VertexIndex -> only the indices are stored */
+    std::vector<uint16_t> indices;
 
     #pragma region primitivesGeneration
-    /* Generate uniform plane filled with vertices */
-    for (unsigned int i = 0; i < terrainRes; i++) {
-        for (unsigned int j = 0; j < terrainRes; j++) {
-            Vertex vertex;
-            glm::vec3 position = glm::vec3((float(i) / (terrainRes - 1)),
-                                           (float(j) / (terrainRes - 1)),
-                                           (0));
-            /* Texture coords are the same as position, since the generated plane is always unit len*/
-            glm::vec2 textureCoords = glm::vec2(position.x, position.y);
-            vertex.pos = position;
-            vertex.texCoord = textureCoords;
-            vertices.push_back(vertex);
-        }
-    }
-
-    /* Generate indices for above generated uniform plane */
-    for (unsigned int i = 0; i < terrainRes - 1; i++) {
-        for (unsigned int j = 0; j < terrainRes - 1; j++) {
-            int i0 = j + i * terrainRes;
-            int i1 = i0 + 1;
-            int i2 = i0 + terrainRes;
-            int i3 = i2 + 1;
-            indices.push_back(i0);
-            indices.push_back(i2);
-            indices.push_back(i1);
-            indices.push_back(i1);
-            indices.push_back(i2);
-            indices.push_back(i3);
-        }
-    }
-
+    generateTerrainPatchIndices(TERRAIN_PATCH_RES, indices);
     #pragma endregion primitivesGeneration
 
-    #pragma region vertexBuffer
-    VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-    VulkanBuffer stagingBuffer = VulkanBuffer(vDevice, bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    /* Filling staging buffer */
-    void *data;
-    /* Allows access to a region of the specified memory resource defined by an offset and size*/
-    /* TODO: Make this function of buffer */
-    vkMapMemory(vDevice->device, stagingBuffer.bufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, vertices.data(), (size_t)bufferSize);
-    vkUnmapMemory(vDevice->device, stagingBuffer.bufferMemory);
-
-    vertexBuffer = std::make_unique<VulkanBuffer>(vDevice,bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    /* copy staging buffer into vertex buffer on GPU*/
-    vertexBuffer->CopyIntoBuffer(stagingBuffer, bufferSize);
-    #pragma endregion vertexBuffer
-
     #pragma region indexBuffer
-    std::cout << "index buffer size is: " << indices.size() << std::endl;
-    bufferSize = sizeof(indices[0]) * indices.size();
+    VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
 
     VulkanBuffer stagingIndexBuffer = VulkanBuffer(vDevice, bufferSize,
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
@@ -1628,6 +2344,7 @@ void Renderer::createPrimitivesBuffers()
         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
     
     /* Allows access to a region of the specified memory resource defined by an offset and size*/
+    void *data;
     vkMapMemory(vDevice->device, stagingIndexBuffer.bufferMemory, 0, bufferSize, 0, &data);
     memcpy(data, indices.data(), (size_t)bufferSize);
     vkUnmapMemory(vDevice->device, stagingIndexBuffer.bufferMemory);
@@ -1672,6 +2389,24 @@ void Renderer::createUniformBuffers()
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
+        bufferSize = 4 * terrainQuadtree->getMaxSelectedNodes() * sizeof(TerrainNodeInstance);
+        perFrameData[i].buffers["TerrainNodes"] = std::make_unique<VulkanBuffer>(vDevice, bufferSize,
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        bufferSize = 4 * sizeof(VkDrawIndexedIndirectCommand);
+        perFrameData[i].buffers["TerrainDraws"] = std::make_unique<VulkanBuffer>(vDevice, bufferSize,
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        bufferSize = sizeof(VkDispatchIndirectCommand);
+        perFrameData[i].buffers["CloudsPanoramaDispatch"] = std::make_unique<VulkanBuffer>(vDevice, bufferSize,
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
         bufferSize = sizeof(uint32_t) * 256;
         perFrameData[i].buffers["HistogramSSBO"] = std::make_unique<VulkanBuffer>(vDevice, bufferSize,
             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
@@ -1718,11 +2453,11 @@ void Renderer::createDescriptorPool()
     poolSizes[0].descriptorCount = 50;
     // Graphics pipeline sampler for displaying compute output image -> SkyViewLUTIn
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = 50;
+    poolSizes[1].descriptorCount = 100;
     // Compute pipeline storage image for reads and writes -> 
     // Transmittance, Multiscattering and SkyView LUTs
     poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    poolSizes[2].descriptorCount = 50;
+    poolSizes[2].descriptorCount = 150;
     poolSizes[3].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     poolSizes[3].descriptorCount = 50;
     poolSizes[4].type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
@@ -1733,7 +2468,8 @@ void Renderer::createDescriptorPool()
     poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     poolInfo.pPoolSizes = poolSizes.data();
     /* maximum number of descriptor sets that may be allocated */
-    poolInfo.maxSets = 70;
+    /* noise volume mip chains take one set per mip */
+    poolInfo.maxSets = 150;
 
     if (vkCreateDescriptorPool(vDevice->device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
     {
@@ -1745,29 +2481,33 @@ void Renderer::createDescriptorSets()
 {
     #pragma region frameIndependentResources
     std::vector<VkDescriptorSetLayout> layoutsToBeAllocated = {
-        findInMap(descriptorLayouts, "TerrainTextures"),
-        findInMap(descriptorLayouts, "WorleyNoise")
+        findInMap(descriptorLayouts, "WorleyNoise"),
+        findInMap(descriptorLayouts, "BlueNoise"),
+        findInMap(descriptorLayouts, "CloudsShadowBuild"),
+        findInMap(descriptorLayouts, "CloudsPanoramaBuild")
     };
 
-    std::array<VkDescriptorSet,2> targetDescriptorSets;
+    std::array<VkDescriptorSet,4> targetDescriptorSets;
 
     VkDescriptorSetAllocateInfo allocateInfo{};
     allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocateInfo.descriptorPool = descriptorPool;
-    allocateInfo.descriptorSetCount = 2;
+    allocateInfo.descriptorSetCount = 4;
     allocateInfo.pSetLayouts = layoutsToBeAllocated.data();
 
     if (vkAllocateDescriptorSets(vDevice->device, &allocateInfo, targetDescriptorSets.data()) != VK_SUCCESS)
     {
         throw std::runtime_error("RENDERER::CREATE_DESCRIPTOR_SETS::Failed to allocate frame independent sets");
     }
-    frameSharedDS["TerrainTextures"]          = targetDescriptorSets[0];
-    frameSharedDS["WorleyNoise"]              = targetDescriptorSets[1];
+    frameSharedDS["WorleyNoise"]              = targetDescriptorSets[0];
+    frameSharedDS["BlueNoise"]                = targetDescriptorSets[1];
+    frameSharedDS["CloudsShadowBuild"]        = targetDescriptorSets[2];
+    frameSharedDS["CloudsPanoramaBuild"]      = targetDescriptorSets[3];
 
+    /* Terrain textures are written per frame, each frame has its own tile table */
     VkDescriptorImageInfo heightMapImageInfo{};
     heightMapImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    // heightMapImageInfo.imageView = terrainHeightImage->imageView;
-    heightMapImageInfo.imageView = findInMap(frameSharedImages,"TerrainEXRHeightMap")->imageView;
+    heightMapImageInfo.imageView = terrainTileCache->tileArray->imageView;
     heightMapImageInfo.sampler = terrainTexturesSampler;
 
     VkDescriptorImageInfo diffuseMapImageInfo{};
@@ -1780,61 +2520,211 @@ void Renderer::createDescriptorSets()
     normalMapImageInfo.imageView = findInMap(frameSharedImages,"TerrainNormalImage")->imageView;
     normalMapImageInfo.sampler = terrainTexturesSampler;
 
-    VkDescriptorImageInfo worleyNoiseDetailImageInfo{};
-    worleyNoiseDetailImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-    worleyNoiseDetailImageInfo.imageView = detailNoise->noiseImage->imageView;
-    worleyNoiseDetailImageInfo.sampler = cloudsSampler;
-
-    VkDescriptorImageInfo worleyNoiseImageInfo{};
-    worleyNoiseImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-    worleyNoiseImageInfo.imageView = noise->noiseImage->imageView;
-    worleyNoiseImageInfo.sampler = cloudsSampler;
-
-    std::array<VkWriteDescriptorSet, 5> updateDescriptorWrites{};
+    /* Blue noise is only accessed with texelFetch -> sampler state is ignored */
+    VkDescriptorImageInfo blueNoiseImageInfo{};
+    blueNoiseImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    blueNoiseImageInfo.imageView = findInMap(frameSharedImages,"BlueNoise")->imageView;
+    blueNoiseImageInfo.sampler = cloudsSampler;
+
+    VkDescriptorImageInfo cloudsOccupancyImageInfo{};
+    cloudsOccupancyImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    cloudsOccupancyImageInfo.imageView = findInMap(frameSharedImages,"CloudsOccupancy")->imageView;
+    cloudsOccupancyImageInfo.sampler = cloudsSampler;
+
+    /* Shadow map is filtered linearly and must not repeat -> clamped sampler */
+    VkDescriptorImageInfo cloudsShadowImageInfo{};
+    cloudsShadowImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    cloudsShadowImageInfo.imageView = findInMap(frameSharedImages,"CloudsShadowMap")->imageView;
+    cloudsShadowImageInfo.sampler = skyViewLUTSampler;
+
+    VkDescriptorImageInfo coverageMapImageInfo{};
+    coverageMapImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    coverageMapImageInfo.imageView = findInMap(frameSharedImages,"CoverageMap")->imageView;
+    coverageMapImageInfo.sampler = cloudsSampler;
+
+    VkDescriptorImageInfo cloudsDensityImageInfo{};
+    cloudsDensityImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    cloudsDensityImageInfo.imageView = findInMap(frameSharedImages,"CloudsDensity")->imageView;
+    cloudsDensityImageInfo.sampler = cloudsSampler;
+
+    /* Repeating sampler -> linear filtering wraps around the azimuth seam of the panorama */
+    VkDescriptorImageInfo cloudsPanoramaImageInfo{};
+    cloudsPanoramaImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    cloudsPanoramaImageInfo.imageView = findInMap(frameSharedImages,"CloudsPanorama")->imageView;
+    cloudsPanoramaImageInfo.sampler = cloudsPanoramaSampler;
+
+    std::array<VkWriteDescriptorSet, 8> updateDescriptorWrites{};
     updateDescriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    updateDescriptorWrites[0].dstSet = findInMap(frameSharedDS, "TerrainTextures");
+    updateDescriptorWrites[0].dstSet = findInMap(frameSharedDS, "BlueNoise");
     updateDescriptorWrites[0].dstBinding = 0;
     updateDescriptorWrites[0].dstArrayElement = 0;
     updateDescriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     updateDescriptorWrites[0].descriptorCount = 1;
-    updateDescriptorWrites[0].pImageInfo = &heightMapImageInfo;
+    updateDescriptorWrites[0].pImageInfo = &blueNoiseImageInfo;
 
     updateDescriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    updateDescriptorWrites[1].dstSet = findInMap(frameSharedDS, "TerrainTextures");
-    updateDescriptorWrites[1].dstBinding = 1;
+    updateDescriptorWrites[1].dstSet = findInMap(frameSharedDS, "WorleyNoise");
+    updateDescriptorWrites[1].dstBinding = 2;
     updateDescriptorWrites[1].dstArrayElement = 0;
     updateDescriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     updateDescriptorWrites[1].descriptorCount = 1;
-    updateDescriptorWrites[1].pImageInfo = &diffuseMapImageInfo;
+    updateDescriptorWrites[1].pImageInfo = &cloudsOccupancyImageInfo;
 
     updateDescriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    updateDescriptorWrites[2].dstSet = findInMap(frameSharedDS, "TerrainTextures");
-    updateDescriptorWrites[2].dstBinding = 2;
+    updateDescriptorWrites[2].dstSet = findInMap(frameSharedDS, "WorleyNoise");
+    updateDescriptorWrites[2].dstBinding = 3;
     updateDescriptorWrites[2].dstArrayElement = 0;
     updateDescriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     updateDescriptorWrites[2].descriptorCount = 1;
-    updateDescriptorWrites[2].pImageInfo = &normalMapImageInfo;
+    updateDescriptorWrites[2].pImageInfo = &cloudsShadowImageInfo;
 
     updateDescriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    updateDescriptorWrites[3].dstSet = findInMap(frameSharedDS, "WorleyNoise");
+    updateDescriptorWrites[3].dstSet = findInMap(frameSharedDS, "CloudsShadowBuild");
     updateDescriptorWrites[3].dstBinding = 0;
     updateDescriptorWrites[3].dstArrayElement = 0;
-    updateDescriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    updateDescriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
     updateDescriptorWrites[3].descriptorCount = 1;
-    updateDescriptorWrites[3].pImageInfo = &worleyNoiseImageInfo;
+    updateDescriptorWrites[3].pImageInfo = &cloudsShadowImageInfo;
 
     updateDescriptorWrites[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     updateDescriptorWrites[4].dstSet = findInMap(frameSharedDS, "WorleyNoise");
-    updateDescriptorWrites[4].dstBinding = 1;
+    updateDescriptorWrites[4].dstBinding = 4;
     updateDescriptorWrites[4].dstArrayElement = 0;
     updateDescriptorWrites[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     updateDescriptorWrites[4].descriptorCount = 1;
-    updateDescriptorWrites[4].pImageInfo = &worleyNoiseDetailImageInfo;
+    updateDescriptorWrites[4].pImageInfo = &coverageMapImageInfo;
+
+    updateDescriptorWrites[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    updateDescriptorWrites[5].dstSet = findInMap(frameSharedDS, "WorleyNoise");
+    updateDescriptorWrites[5].dstBinding = 5;
+    updateDescriptorWrites[5].dstArrayElement = 0;
+    updateDescriptorWrites[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    updateDescriptorWrites[5].descriptorCount = 1;
+    updateDescriptorWrites[5].pImageInfo = &cloudsDensityImageInfo;
+
+    updateDescriptorWrites[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    updateDescriptorWrites[6].dstSet = findInMap(frameSharedDS, "WorleyNoise");
+    updateDescriptorWrites[6].dstBinding = 6;
+    updateDescriptorWrites[6].dstArrayElement = 0;
+    updateDescriptorWrites[6].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    updateDescriptorWrites[6].descriptorCount = 1;
+    updateDescriptorWrites[6].pImageInfo = &cloudsPanoramaImageInfo;
+
+    updateDescriptorWrites[7].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    updateDescriptorWrites[7].dstSet = findInMap(frameSharedDS, "CloudsPanoramaBuild");
+    updateDescriptorWrites[7].dstBinding = 0;
+    updateDescriptorWrites[7].dstArrayElement = 0;
+    updateDescriptorWrites[7].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    updateDescriptorWrites[7].descriptorCount = 1;
+    updateDescriptorWrites[7].pImageInfo = &cloudsPanoramaImageInfo;
 
     vkUpdateDescriptorSets(vDevice->device, static_cast<uint32_t>(updateDescriptorWrites.size()),
                             updateDescriptorWrites.data(), 0, nullptr);
+    writeNoiseDescriptorSets();
     #pragma endregion frameIndependentResources
 
+    #pragma region cloudsOccupancy
+    /* Set 0 writes mip 0 in the build pass, set i reads mip i-1 and writes mip i */
+    uint32_t occupancyMipCount = static_cast<uint32_t>(cloudsOccupancyMipViews.size());
+    std::vector<VkDescriptorSetLayout> occupancyLayouts(occupancyMipCount,
+        findInMap(descriptorLayouts, "CloudsOccupancyDownsample"));
+    occupancyLayouts[0] = findInMap(descriptorLayouts, "CloudsOccupancyBuild");
+    std::vector<VkDescriptorSet> occupancySets(occupancyMipCount);
+
+    VkDescriptorSetAllocateInfo occupancyAllocateInfo{};
+    occupancyAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    occupancyAllocateInfo.descriptorPool = descriptorPool;
+    occupancyAllocateInfo.descriptorSetCount = occupancyMipCount;
+    occupancyAllocateInfo.pSetLayouts = occupancyLayouts.data();
+
+    if (vkAllocateDescriptorSets(vDevice->device, &occupancyAllocateInfo, occupancySets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RENDERER::CREATE_DESCRIPTOR_SETS::Failed to allocate clouds occupancy sets");
+    }
+    frameSharedDS["CloudsOccupancyBuild"] = occupancySets[0];
+
+    std::vector<VkDescriptorImageInfo> occupancyMipInfos(occupancyMipCount);
+    std::vector<VkWriteDescriptorSet> occupancyWrites;
+
+    VkDescriptorImageInfo occupancySourceInfo{};
+    occupancySourceInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    occupancySourceInfo.imageView = findInMap(frameSharedImages, "CloudsDensity")->imageView;
+    occupancySourceInfo.sampler = cloudsSampler;
+    for(uint32_t mip = 0; mip < occupancyMipCount; mip++)
+    {
+        occupancyMipInfos[mip].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        occupancyMipInfos[mip].imageView = cloudsOccupancyMipViews[mip];
+        occupancyMipInfos[mip].sampler = VK_NULL_HANDLE;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstArrayElement = 0;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        write.descriptorCount = 1;
+        if(mip == 0)
+        {
+            write.dstSet = occupancySets[0];
+            write.dstBinding = 0;
+            write.pImageInfo = &occupancyMipInfos[0];
+            occupancyWrites.push_back(write);
+            write.dstBinding = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write.pImageInfo = &occupancySourceInfo;
+            occupancyWrites.push_back(write);
+            continue;
+        }
+        frameSharedDS["CloudsOccupancyDownsample" + std::to_string(mip)] = occupancySets[mip];
+        write.dstSet = occupancySets[mip];
+        write.dstBinding = 0;
+        write.pImageInfo = &occupancyMipInfos[mip - 1];
+        occupancyWrites.push_back(write);
+        write.dstBinding = 1;
+        write.pImageInfo = &occupancyMipInfos[mip];
+        occupancyWrites.push_back(write);
+    }
+    vkUpdateDescriptorSets(vDevice->device, static_cast<uint32_t>(occupancyWrites.size()),
+                            occupancyWrites.data(), 0, nullptr);
+    #pragma endregion cloudsOccupancy
+
+    #pragma region cloudsDensityBake
+    /* Set i writes mip i of the baked density volume */
+    uint32_t densityMipCount = static_cast<uint32_t>(cloudsDensityMipViews.size());
+    std::vector<VkDescriptorSetLayout> densityLayouts(densityMipCount,
+        findInMap(descriptorLayouts, "CloudsDensityBake"));
+    std::vector<VkDescriptorSet> densitySets(densityMipCount);
+
+    VkDescriptorSetAllocateInfo densityAllocateInfo{};
+    densityAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    densityAllocateInfo.descriptorPool = descriptorPool;
+    densityAllocateInfo.descriptorSetCount = densityMipCount;
+    densityAllocateInfo.pSetLayouts = densityLayouts.data();
+
+    if (vkAllocateDescriptorSets(vDevice->device, &densityAllocateInfo, densitySets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("RENDERER::CREATE_DESCRIPTOR_SETS::Failed to allocate clouds density bake sets");
+    }
+
+    std::vector<VkDescriptorImageInfo> densityMipInfos(densityMipCount);
+    std::vector<VkWriteDescriptorSet> densityWrites(densityMipCount);
+    for(uint32_t mip = 0; mip < densityMipCount; mip++)
+    {
+        frameSharedDS["CloudsDensityBake" + std::to_string(mip)] = densitySets[mip];
+        densityMipInfos[mip].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        densityMipInfos[mip].imageView = cloudsDensityMipViews[mip];
+        densityMipInfos[mip].sampler = VK_NULL_HANDLE;
+
+        densityWrites[mip].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        densityWrites[mip].dstSet = densitySets[mip];
+        densityWrites[mip].dstBinding = 0;
+        densityWrites[mip].dstArrayElement = 0;
+        densityWrites[mip].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        densityWrites[mip].descriptorCount = 1;
+        densityWrites[mip].pImageInfo = &densityMipInfos[mip];
+    }
+    vkUpdateDescriptorSets(vDevice->device, static_cast<uint32_t>(densityWrites.size()),
+                            densityWrites.data(), 0, nullptr);
+    #pragma endregion cloudsDensityBake
+
     for(int i = 0; i < vSwapChain->imageCount; i++)
     {
         std::vector<VkDescriptorSetLayout> layoutsToBeAllocated = {
@@ -1850,15 +2740,21 @@ void Renderer::createDescriptorSets()
             findInMap(descriptorLayouts, "ComputeLUTTextures"),
             findInMap(descriptorLayouts, "HDRBackbuffer"),
             findInMap(descriptorLayouts, "DepthOne"),
-            findInMap(descriptorLayouts, "DepthTwo")
+            findInMap(descriptorLayouts, "DepthTwo"),
+            findInMap(descriptorLayouts, "SceneDepth"),
+            findInMap(descriptorLayouts, "CloudsTrace"),
+            findInMap(descriptorLayouts, "CloudsReconstruct"),
+            findInMap(descriptorLayouts, "CloudsUpsample"),
+            findInMap(descriptorLayouts, "CloudsTiles"),
+            findInMap(descriptorLayouts, "TerrainTextures")
         };
 
-        std::array<VkDescriptorSet,13> targetDescriptorSets;
+        std::array<VkDescriptorSet,19> targetDescriptorSets;
 
         VkDescriptorSetAllocateInfo allocateInfo{};
         allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
         allocateInfo.descriptorPool = descriptorPool;
-        allocateInfo.descriptorSetCount = 13;
+        allocateInfo.descriptorSetCount = 19;
         allocateInfo.pSetLayouts = layoutsToBeAllocated.data();
 
         if (vkAllocateDescriptorSets(vDevice->device, &allocateInfo, targetDescriptorSets.data()) != VK_SUCCESS)
@@ -1879,6 +2775,12 @@ void Renderer::createDescriptorSets()
         perFrameData[i].descriptorSets["HDRBackbuffer"]      = targetDescriptorSets[10];
         perFrameData[i].descriptorSets["DepthOne"]           = targetDescriptorSets[11];
         perFrameData[i].descriptorSets["DepthTwo"]           = targetDescriptorSets[12];
+        perFrameData[i].descriptorSets["SceneDepth"]         = targetDescriptorSets[13];
+        perFrameData[i].descriptorSets["CloudsTrace"]        = targetDescriptorSets[14];
+        perFrameData[i].descriptorSets["CloudsReconstruct"]  = targetDescriptorSets[15];
+        perFrameData[i].descriptorSets["CloudsUpsample"]     = targetDescriptorSets[16];
+        perFrameData[i].descriptorSets["CloudsTiles"]        = targetDescriptorSets[17];
+        perFrameData[i].descriptorSets["TerrainTextures"]    = targetDescriptorSets[18];
 
         VkDescriptorBufferInfo uboCommonBufferInfo{};
         uboCommonBufferInfo.buffer = findInMap(perFrameData[i].buffers,"CommonUBO")->buffer;
@@ -1910,6 +2812,11 @@ void Renderer::createDescriptorSets()
         avgLumSSBOInfo.offset = 0;
         avgLumSSBOInfo.range = sizeof(float);
 
+        VkDescriptorBufferInfo cloudsTilesSSBOInfo{};
+        cloudsTilesSSBOInfo.buffer = findInMap(perFrameData[i].buffers,"CloudsTiles")->buffer;
+        cloudsTilesSSBOInfo.offset = 0;
+        cloudsTilesSSBOInfo.range = VK_WHOLE_SIZE;
+
         VkDescriptorImageInfo transmittanceLUTImageInfo{};
         transmittanceLUTImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
         transmittanceLUTImageInfo.imageView = 
@@ -1953,7 +2860,48 @@ void Renderer::createDescriptorSets()
         depthTwoImageInfo.imageView = findInMap(perFrameData[i].images,"HDRDepthTwo")->imageView;
         depthTwoImageInfo.sampler = VK_NULL_HANDLE;
 
-        std::array<VkWriteDescriptorSet, 16> updateDescriptorWrites{};
+        VkDescriptorImageInfo sceneDepthImageInfo{};
+        sceneDepthImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        sceneDepthImageInfo.imageView = findInMap(perFrameData[i].images,"HDRDepthOne")->imageView;
+        sceneDepthImageInfo.sampler = depthTextureSampler;
+
+        VkDescriptorImageInfo cloudsTraceImageInfo{};
+        cloudsTraceImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        cloudsTraceImageInfo.imageView = findInMap(frameSharedImages,"CloudsTrace")->imageView;
+
+        VkDescriptorImageInfo cloudsTraceDepthImageInfo{};
+        cloudsTraceDepthImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        cloudsTraceDepthImageInfo.imageView = findInMap(frameSharedImages,"CloudsTraceDepth")->imageView;
+
+        VkDescriptorImageInfo cloudsTileStatsImageInfo{};
+        cloudsTileStatsImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        cloudsTileStatsImageInfo.imageView = findInMap(frameSharedImages,"CloudsTileStats")->imageView;
+
+        VkDescriptorImageInfo cloudsHistoryImageInfo{};
+        cloudsHistoryImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        cloudsHistoryImageInfo.imageView = findInMap(frameSharedImages,"CloudsColorHistory")->imageView;
+        cloudsHistoryImageInfo.sampler = skyViewLUTSampler;
+
+        VkDescriptorImageInfo cloudsColorOutImageInfo{};
+        cloudsColorOutImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        cloudsColorOutImageInfo.imageView = findInMap(frameSharedImages,"CloudsColor")->imageView;
+
+        VkDescriptorImageInfo cloudsDepthOutImageInfo{};
+        cloudsDepthOutImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        cloudsDepthOutImageInfo.imageView = findInMap(frameSharedImages,"CloudsDepth")->imageView;
+
+        VkDescriptorImageInfo cloudsColorInImageInfo = cloudsColorOutImageInfo;
+        cloudsColorInImageInfo.sampler = skyViewLUTSampler;
+
+        VkDescriptorImageInfo cloudsDepthInImageInfo = cloudsDepthOutImageInfo;
+        cloudsDepthInImageInfo.sampler = skyViewLUTSampler;
+
+        VkDescriptorBufferInfo tileTableBufferInfo{};
+        tileTableBufferInfo.buffer = terrainTileCache->tileTables[i]->buffer;
+        tileTableBufferInfo.offset = 0;
+        tileTableBufferInfo.range = terrainTileCache->getTableSize();
+
+        std::array<VkWriteDescriptorSet, 30> updateDescriptorWrites{};
         updateDescriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         updateDescriptorWrites[0].dstSet = findInMap(perFrameData[i].descriptorSets, "CommonUBO");
         updateDescriptorWrites[0].dstBinding = 0;
@@ -2081,15 +3029,162 @@ void Renderer::createDescriptorSets()
         updateDescriptorWrites[15].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
         updateDescriptorWrites[15].descriptorCount = 1;
         updateDescriptorWrites[15].pImageInfo = &depthTwoImageInfo;
+
+        updateDescriptorWrites[16].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        updateDescriptorWrites[16].dstSet = findInMap(perFrameData[i].descriptorSets, "SceneDepth");
+        updateDescriptorWrites[16].dstBinding = 0;
+        updateDescriptorWrites[16].dstArrayElement = 0;
+        updateDescriptorWrites[16].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        updateDescriptorWrites[16].descriptorCount = 1;
+        updateDescriptorWrites[16].pImageInfo = &sceneDepthImageInfo;
+
+        updateDescriptorWrites[17].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        updateDescriptorWrites[17].dstSet = findInMap(perFrameData[i].descriptorSets, "CloudsTrace");
+        updateDescriptorWrites[17].dstBinding = 0;
+        updateDescriptorWrites[17].dstArrayElement = 0;
+        updateDescriptorWrites[17].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        updateDescriptorWrites[17].descriptorCount = 1;
+        updateDescriptorWrites[17].pImageInfo = &cloudsTraceImageInfo;
+
+        updateDescriptorWrites[18].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        updateDescriptorWrites[18].dstSet = findInMap(perFrameData[i].descriptorSets, "CloudsTrace");
+        updateDescriptorWrites[18].dstBinding = 1;
+        updateDescriptorWrites[18].dstArrayElement = 0;
+        updateDescriptorWrites[18].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        updateDescriptorWrites[18].descriptorCount = 1;
+        updateDescriptorWrites[18].pImageInfo = &cloudsTraceDepthImageInfo;
+
+        updateDescriptorWrites[19].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        updateDescriptorWrites[19].dstSet = findInMap(perFrameData[i].descriptorSets, "CloudsReconstruct");
+        updateDescriptorWrites[19].dstBinding = 0;
+        updateDescriptorWrites[19].dstArrayElement = 0;
+        updateDescriptorWrites[19].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        updateDescriptorWrites[19].descriptorCount = 1;
+        updateDescriptorWrites[19].pImageInfo = &cloudsHistoryImageInfo;
+
+        updateDescriptorWrites[20].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        updateDescriptorWrites[20].dstSet = findInMap(perFrameData[i].descriptorSets, "CloudsReconstruct");
+        updateDescriptorWrites[20].dstBinding = 1;
+        updateDescriptorWrites[20].dstArrayElement = 0;
+        updateDescriptorWrites[20].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        updateDescriptorWrites[20].descriptorCount = 1;
+        updateDescriptorWrites[20].pImageInfo = &cloudsColorOutImageInfo;
+
+        updateDescriptorWrites[21].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        updateDescriptorWrites[21].dstSet = findInMap(perFrameData[i].descriptorSets, "CloudsReconstruct");
+        updateDescriptorWrites[21].dstBinding = 2;
+        updateDescriptorWrites[21].dstArrayElement = 0;
+        updateDescriptorWrites[21].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        updateDescriptorWrites[21].descriptorCount = 1;
+        updateDescriptorWrites[21].pImageInfo = &cloudsDepthOutImageInfo;
+
+        updateDescriptorWrites[22].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        updateDescriptorWrites[22].dstSet = findInMap(perFrameData[i].descriptorSets, "CloudsUpsample");
+        updateDescriptorWrites[22].dstBinding = 0;
+        updateDescriptorWrites[22].dstArrayElement = 0;
+        updateDescriptorWrites[22].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        updateDescriptorWrites[22].descriptorCount = 1;
+        updateDescriptorWrites[22].pImageInfo = &cloudsColorInImageInfo;
+
+        updateDescriptorWrites[23].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        updateDescriptorWrites[23].dstSet = findInMap(perFrameData[i].descriptorSets, "CloudsUpsample");
+        updateDescriptorWrites[23].dstBinding = 1;
+        updateDescriptorWrites[23].dstArrayElement = 0;
+        updateDescriptorWrites[23].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        updateDescriptorWrites[23].descriptorCount = 1;
+        updateDescriptorWrites[23].pImageInfo = &cloudsDepthInImageInfo;
+
+        updateDescriptorWrites[24].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        updateDescriptorWrites[24].dstSet = findInMap(perFrameData[i].descriptorSets, "CloudsTiles");
+        updateDescriptorWrites[24].dstBinding = 0;
+        updateDescriptorWrites[24].dstArrayElement = 0;
+        updateDescriptorWrites[24].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        updateDescriptorWrites[24].descriptorCount = 1;
+        updateDescriptorWrites[24].pBufferInfo = &cloudsTilesSSBOInfo;
+
+        updateDescriptorWrites[25].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        updateDescriptorWrites[25].dstSet = findInMap(perFrameData[i].descriptorSets, "CloudsTrace");
+        updateDescriptorWrites[25].dstBinding = 2;
+        updateDescriptorWrites[25].dstArrayElement = 0;
+        updateDescriptorWrites[25].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        updateDescriptorWrites[25].descriptorCount = 1;
+        updateDescriptorWrites[25].pImageInfo = &cloudsTileStatsImageInfo;
+
+        updateDescriptorWrites[26].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        updateDescriptorWrites[26].dstSet = findInMap(perFrameData[i].descriptorSets, "TerrainTextures");
+        updateDescriptorWrites[26].dstBinding = 0;
+        updateDescriptorWrites[26].dstArrayElement = 0;
+        updateDescriptorWrites[26].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        updateDescriptorWrites[26].descriptorCount = 1;
+        updateDescriptorWrites[26].pImageInfo = &heightMapImageInfo;
+
+        updateDescriptorWrites[27].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        updateDescriptorWrites[27].dstSet = findInMap(perFrameData[i].descriptorSets, "TerrainTextures");
+        updateDescriptorWrites[27].dstBinding = 1;
+        updateDescriptorWrites[27].dstArrayElement = 0;
+        updateDescriptorWrites[27].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        updateDescriptorWrites[27].descriptorCount = 1;
+        updateDescriptorWrites[27].pImageInfo = &diffuseMapImageInfo;
+
+        updateDescriptorWrites[28].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        updateDescriptorWrites[28].dstSet = findInMap(perFrameData[i].descriptorSets, "TerrainTextures");
+        updateDescriptorWrites[28].dstBinding = 2;
+        updateDescriptorWrites[28].dstArrayElement = 0;
+        updateDescriptorWrites[28].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        updateDescriptorWrites[28].descriptorCount = 1;
+        updateDescriptorWrites[28].pImageInfo = &normalMapImageInfo;
+
+        updateDescriptorWrites[29].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        updateDescriptorWrites[29].dstSet = findInMap(perFrameData[i].descriptorSets, "TerrainTextures");
+        updateDescriptorWrites[29].dstBinding = 3;
+        updateDescriptorWrites[29].dstArrayElement = 0;
+        updateDescriptorWrites[29].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        updateDescriptorWrites[29].descriptorCount = 1;
+        updateDescriptorWrites[29].pBufferInfo = &tileTableBufferInfo;
         vkUpdateDescriptorSets(vDevice->device, static_cast<uint32_t>(updateDescriptorWrites.size()),
                                updateDescriptorWrites.data(), 0, nullptr);
     }
 }
 
-/* TODO: This should be done more consistently with device design 
-         Think about better solution */ 
-void Renderer::createCommandBuffers() {
-
+void Renderer::writeNoiseDescriptorSets()
+{
+    VkDescriptorImageInfo worleyNoiseImageInfo{};
+    WorleyNoise3D &sampledNoise = noiseStreamed ? *noise : *noiseFallback;
+    worleyNoiseImageInfo.imageLayout = sampledNoise.getSampledImageLayout();
+    worleyNoiseImageInfo.imageView = sampledNoise.getSampledImageView();
+    worleyNoiseImageInfo.sampler = cloudsSampler;
+
+    VkDescriptorImageInfo worleyNoiseDetailImageInfo{};
+    WorleyNoise3D &sampledDetailNoise = noiseStreamed ? *detailNoise : *detailNoiseFallback;
+    worleyNoiseDetailImageInfo.imageLayout = sampledDetailNoise.getSampledImageLayout();
+    worleyNoiseDetailImageInfo.imageView = sampledDetailNoise.getSampledImageView();
+    worleyNoiseDetailImageInfo.sampler = cloudsSampler;
+
+    std::array<VkWriteDescriptorSet, 2> updateDescriptorWrites{};
+    updateDescriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    updateDescriptorWrites[0].dstSet = findInMap(frameSharedDS, "WorleyNoise");
+    updateDescriptorWrites[0].dstBinding = 0;
+    updateDescriptorWrites[0].dstArrayElement = 0;
+    updateDescriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    updateDescriptorWrites[0].descriptorCount = 1;
+    updateDescriptorWrites[0].pImageInfo = &worleyNoiseImageInfo;
+
+    updateDescriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    updateDescriptorWrites[1].dstSet = findInMap(frameSharedDS, "WorleyNoise");
+    updateDescriptorWrites[1].dstBinding = 1;
+    updateDescriptorWrites[1].dstArrayElement = 0;
+    updateDescriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    updateDescriptorWrites[1].descriptorCount = 1;
+    updateDescriptorWrites[1].pImageInfo = &worleyNoiseDetailImageInfo;
+
+    vkUpdateDescriptorSets(vDevice->device, static_cast<uint32_t>(updateDescriptorWrites.size()),
+                            updateDescriptorWrites.data(), 0, nullptr);
+}
+
+/* TODO: This should be done more consistently with device design 
+         Think about better solution */ 
+void Renderer::createCommandBuffers() {
+
     for(int i = 0; i < vSwapChain->imageCount; i++)
     {
         perFrameData[i].commandBuffers["ComputeLUTs"] = vDevice->createGraphicsCommandBuffer();
@@ -2211,6 +3306,96 @@ void Renderer::createCommandBuffers() {
                 Failed begin Render Sky graphics command buffer");
         }
 
+        /* ============================================ CLOUDS SHADOW MAP ============================================ */
+        /* Previous frame terrain and clouds passes have to be done reading the shadow map */
+        VkMemoryBarrier cloudsShadowReadFinished = {};
+        cloudsShadowReadFinished.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cloudsShadowReadFinished.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        cloudsShadowReadFinished.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(
+            renderSkyCommandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1,
+            &cloudsShadowReadFinished, 
+            0, nullptr,
+            0, nullptr
+        );
+
+        vkCmdBindPipeline(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            cloudsShadowBuildPipeline->pipeline);
+
+        std::vector<VkDescriptorSet> cloudsShadowBuildDescriptorSets = { 
+            findInMap(perFrameData[i].descriptorSets,"CommonUBO"),
+            findInMap(perFrameData[i].descriptorSets,"SkyConstantUBO"),
+            findInMap(perFrameData[i].descriptorSets,"CloudsParamsUBO"),
+            findInMap(frameSharedDS,"WorleyNoise"),
+            findInMap(perFrameData[i].descriptorSets,"TransmittanceLUT"),
+            findInMap(frameSharedDS,"CloudsShadowBuild")
+        };
+        vkCmdBindDescriptorSets(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            cloudsShadowBuildPipeline->layout, 0, 6, cloudsShadowBuildDescriptorSets.data(), 0, nullptr);
+        vkCmdWriteTimestamp(renderSkyCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            perFrameData[i].querryPool, 24);
+        vkCmdDispatch(renderSkyCommandBuffer, (CLOUDS_SHADOW_MAP_SIZE + 7) / 8,
+            (CLOUDS_SHADOW_MAP_SIZE + 7) / 8, 1);
+        vkCmdWriteTimestamp(renderSkyCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            perFrameData[i].querryPool, 25);
+
+        VkMemoryBarrier cloudsShadowFinished = {};
+        cloudsShadowFinished.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cloudsShadowFinished.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        cloudsShadowFinished.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(
+            renderSkyCommandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0, 1,
+            &cloudsShadowFinished, 
+            0, nullptr,
+            0, nullptr
+        );
+
+        /* ========================================== CLOUDS DISTANT PANORAMA ========================================= */
+        /* Reads of the panorama by the previous frame are ordered by cloudsShadowReadFinished */
+        vkCmdBindPipeline(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            cloudsPanoramaBuildPipeline->pipeline);
+
+        std::vector<VkDescriptorSet> cloudsPanoramaBuildDescriptorSets = { 
+            findInMap(perFrameData[i].descriptorSets,"CommonUBO"),
+            findInMap(perFrameData[i].descriptorSets,"SkyConstantUBO"),
+            findInMap(perFrameData[i].descriptorSets,"CloudsParamsUBO"),
+            findInMap(frameSharedDS,"WorleyNoise"),
+            findInMap(perFrameData[i].descriptorSets,"TransmittanceLUT"),
+            findInMap(frameSharedDS,"CloudsPanoramaBuild")
+        };
+        vkCmdBindDescriptorSets(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            cloudsPanoramaBuildPipeline->layout, 0, 6, cloudsPanoramaBuildDescriptorSets.data(), 0, nullptr);
+        vkCmdWriteTimestamp(renderSkyCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            perFrameData[i].querryPool, 26);
+        /* Sized every frame to the columns of the slice, see updateUniformBuffer */
+        vkCmdDispatchIndirect(renderSkyCommandBuffer,
+            findInMap(perFrameData[i].buffers, "CloudsPanoramaDispatch")->buffer, 0);
+        vkCmdWriteTimestamp(renderSkyCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            perFrameData[i].querryPool, 27);
+
+        VkMemoryBarrier cloudsPanoramaFinished = {};
+        cloudsPanoramaFinished.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cloudsPanoramaFinished.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        cloudsPanoramaFinished.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(
+            renderSkyCommandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1,
+            &cloudsPanoramaFinished, 
+            0, nullptr,
+            0, nullptr
+        );
+
         /* Terrain render into backbuffer */
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -2225,7 +3410,9 @@ void Renderer::createCommandBuffers() {
         clearValues[1].depthStencil = {1.0f, 0};
         clearValues[2].depthStencil = {1.0f, 0};
 
-        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        /* Offscreen pass only has the color and first depth buffer, third clear value
+           is used by the clouds composite pass for the second depth buffer */
+        renderPassInfo.clearValueCount = 2;
         renderPassInfo.pClearValues = clearValues.data();
 
         /* =============================================== FIRST SUBPASS =============================================== */
@@ -2236,20 +3423,29 @@ void Renderer::createCommandBuffers() {
         std::vector<VkDescriptorSet> terrainDescriptorSets = {
             findInMap(perFrameData[i].descriptorSets,"CommonUBO"),
             findInMap(perFrameData[i].descriptorSets,"SkyConstantUBO"),
-            findInMap(frameSharedDS,"TerrainTextures"),
+            findInMap(perFrameData[i].descriptorSets,"TerrainTextures"),
             findInMap(perFrameData[i].descriptorSets,"TransmittanceLUT"),
+            findInMap(frameSharedDS,"WorleyNoise"),
         };
         vkCmdBindDescriptorSets(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-            terrainPassPipeline->layout, 0, 4, terrainDescriptorSets.data(), 0, 0);
+            terrainPassPipeline->layout, 0, 5, terrainDescriptorSets.data(), 0, 0);
 
-        VkDeviceSize offsets [] = {0};
-        vkCmdBindVertexBuffers(renderSkyCommandBuffer, 0, 1, &(vertexBuffer.get()->buffer), offsets);
-        vkCmdBindIndexBuffer(renderSkyCommandBuffer,indexBuffer->buffer, 0, VK_INDEX_TYPE_UINT32);
+        vkCmdBindIndexBuffer(renderSkyCommandBuffer,indexBuffer->buffer, 0, VK_INDEX_TYPE_UINT16);
 
-        /* TODO: Replace hardcoded num of indices */
         vkCmdWriteTimestamp(renderSkyCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
             perFrameData[i].querryPool, 8);
-        vkCmdDrawIndexed(renderSkyCommandBuffer, 2999 * 2999 * 6, 1, 0, 0, 0);
+        /* One indirect draw per patch quadrant, counts are written by updateTerrainNodes. Each
+           quadrant has its own range of the node buffer -> no need for non zero firstInstance */
+        VkBuffer terrainNodes = findInMap(perFrameData[i].buffers, "TerrainNodes")->buffer;
+        VkBuffer terrainDraws = findInMap(perFrameData[i].buffers, "TerrainDraws")->buffer;
+        for(uint32_t quadrant = 0; quadrant < 4; quadrant++)
+        {
+            VkDeviceSize nodesOffset = VkDeviceSize(quadrant) *
+                terrainQuadtree->getMaxSelectedNodes() * sizeof(TerrainNodeInstance);
+            vkCmdBindVertexBuffers(renderSkyCommandBuffer, 0, 1, &terrainNodes, &nodesOffset);
+            vkCmdDrawIndexedIndirect(renderSkyCommandBuffer, terrainDraws,
+                quadrant * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+        }
         vkCmdWriteTimestamp(renderSkyCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
             perFrameData[i].querryPool, 9);
 
@@ -2272,28 +3468,192 @@ void Renderer::createCommandBuffers() {
         vkCmdWriteTimestamp(renderSkyCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
             perFrameData[i].querryPool, 11);
 
-        /* =============================================== THIRD SUBPASS =============================================== */
-        vkCmdNextSubpass(renderSkyCommandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdEndRenderPass(renderSkyCommandBuffer);
+
+        /* =============================================== CLOUDS TRACE =============================================== */
+        /* Previous frame history copy has to finish before the history is sampled
+           and the trace targets are overwritten, its tile statistics have to be visible */
+        VkMemoryBarrier cloudsTargetsReady = {};
+        cloudsTargetsReady.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cloudsTargetsReady.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+            VK_ACCESS_TRANSFER_WRITE_BIT;
+        cloudsTargetsReady.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(
+            renderSkyCommandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1,
+            &cloudsTargetsReady, 
+            0, nullptr,
+            0, nullptr
+        );
+
+        /* ============================================= CLOUDS CLASSIFY ============================================= */
+        vkCmdWriteTimestamp(renderSkyCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            perFrameData[i].querryPool, 12);
+        VkBuffer cloudsTilesBuffer = findInMap(perFrameData[i].buffers, "CloudsTiles")->buffer;
+        CloudsTileListHeader tileListHeader{};
+        vkCmdUpdateBuffer(renderSkyCommandBuffer, cloudsTilesBuffer, 0, sizeof(CloudsTileListHeader),
+            &tileListHeader);
+
+        VkMemoryBarrier tileListReset = {};
+        tileListReset.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        tileListReset.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        tileListReset.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(
+            renderSkyCommandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1,
+            &tileListReset, 
+            0, nullptr,
+            0, nullptr
+        );
+
+        vkCmdBindPipeline(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            cloudsClassifyPipeline->pipeline);
+
+        std::vector<VkDescriptorSet> cloudsClassifyDescriptorSets = { 
+            findInMap(perFrameData[i].descriptorSets,"CommonUBO"),
+            findInMap(perFrameData[i].descriptorSets,"SkyConstantUBO"),
+            findInMap(perFrameData[i].descriptorSets,"CloudsParamsUBO"),
+            findInMap(perFrameData[i].descriptorSets,"SceneDepth"),
+            findInMap(perFrameData[i].descriptorSets,"CloudsTrace"),
+            findInMap(perFrameData[i].descriptorSets,"CloudsTiles")
+        };
+        vkCmdBindDescriptorSets(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            cloudsClassifyPipeline->layout, 0, 6, cloudsClassifyDescriptorSets.data(), 0, nullptr);
+        vkCmdDispatch(renderSkyCommandBuffer, (cloudsTraceExtent.width + 7) / 8,
+            (cloudsTraceExtent.height + 7) / 8, 1);
+
+        /* Tile count written by the classification is the indirect dispatch of the trace */
+        VkMemoryBarrier cloudsClassifyFinished = {};
+        cloudsClassifyFinished.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cloudsClassifyFinished.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        cloudsClassifyFinished.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(
+            renderSkyCommandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1,
+            &cloudsClassifyFinished, 
+            0, nullptr,
+            0, nullptr
+        );
+
+        vkCmdBindPipeline(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            cloudsTracePipeline->pipeline);
+
+        std::vector<VkDescriptorSet> cloudsTraceDescriptorSets = { 
+            findInMap(perFrameData[i].descriptorSets,"CommonUBO"),
+            findInMap(perFrameData[i].descriptorSets,"SkyConstantUBO"),
+            findInMap(perFrameData[i].descriptorSets,"CloudsParamsUBO"),
+            findInMap(perFrameData[i].descriptorSets,"SceneDepth"),
+            findInMap(frameSharedDS,"WorleyNoise"),
+            findInMap(perFrameData[i].descriptorSets,"TransmittanceLUT"),
+            findInMap(perFrameData[i].descriptorSets,"CloudsTrace"),
+            findInMap(frameSharedDS,"BlueNoise"),
+            findInMap(perFrameData[i].descriptorSets,"CloudsTiles")
+        };
+        vkCmdBindDescriptorSets(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            cloudsTracePipeline->layout, 0, 9, cloudsTraceDescriptorSets.data(), 0, nullptr);
+        vkCmdDispatchIndirect(renderSkyCommandBuffer, cloudsTilesBuffer, 0);
+        vkCmdWriteTimestamp(renderSkyCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            perFrameData[i].querryPool, 13);
+
+        VkMemoryBarrier cloudsTraceFinished = {};
+        cloudsTraceFinished.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cloudsTraceFinished.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        cloudsTraceFinished.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(
+            renderSkyCommandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1,
+            &cloudsTraceFinished, 
+            0, nullptr,
+            0, nullptr
+        );
+
+        /* ============================================ CLOUDS RECONSTRUCT ============================================ */
+        vkCmdBindPipeline(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            cloudsReconstructPipeline->pipeline);
+
+        std::vector<VkDescriptorSet> cloudsReconstructDescriptorSets = { 
+            findInMap(perFrameData[i].descriptorSets,"CommonUBO"),
+            findInMap(perFrameData[i].descriptorSets,"SceneDepth"),
+            findInMap(perFrameData[i].descriptorSets,"CloudsParamsUBO"),
+            findInMap(perFrameData[i].descriptorSets,"CloudsTrace"),
+            findInMap(perFrameData[i].descriptorSets,"CloudsReconstruct")
+        };
+        vkCmdBindDescriptorSets(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            cloudsReconstructPipeline->layout, 0, 5, cloudsReconstructDescriptorSets.data(), 0, nullptr);
+        vkCmdDispatch(renderSkyCommandBuffer, (cloudsExtent.width + 7) / 8,
+            (cloudsExtent.height + 7) / 8, 1);
+
+        /* Reconstructed clouds are read by the upsample pass and copied into history */
+        VkMemoryBarrier cloudsReconstructFinished = {};
+        cloudsReconstructFinished.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cloudsReconstructFinished.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
+        cloudsReconstructFinished.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(
+            renderSkyCommandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 1,
+            &cloudsReconstructFinished, 
+            0, nullptr,
+            0, nullptr
+        );
+
+        VkImageCopy historyCopyRegion{};
+        historyCopyRegion.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        historyCopyRegion.srcSubresource.mipLevel = 0;
+        historyCopyRegion.srcSubresource.baseArrayLayer = 0;
+        historyCopyRegion.srcSubresource.layerCount = 1;
+        historyCopyRegion.dstSubresource = historyCopyRegion.srcSubresource;
+        historyCopyRegion.extent = {cloudsExtent.width, cloudsExtent.height, 1};
+
+        vkCmdCopyImage(renderSkyCommandBuffer,
+            findInMap(frameSharedImages,"CloudsColor")->image, VK_IMAGE_LAYOUT_GENERAL,
+            findInMap(frameSharedImages,"CloudsColorHistory")->image, VK_IMAGE_LAYOUT_GENERAL,
+            1, &historyCopyRegion);
+
+        /* ============================================== CLOUDS COMPOSITE ============================================== */
+        VkRenderPassBeginInfo compositeRenderPassInfo{};
+        compositeRenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        compositeRenderPassInfo.renderPass = cloudsCompositePass;
+        compositeRenderPassInfo.framebuffer = findInMap(perFrameData[i].framebuffers, "CloudsComposite");
+        compositeRenderPassInfo.renderArea.offset = {0, 0};
+        compositeRenderPassInfo.renderArea.extent = vSwapChain->swapChainExtent;
+        compositeRenderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        compositeRenderPassInfo.pClearValues = clearValues.data();
+
+        vkCmdBeginRenderPass(renderSkyCommandBuffer, &compositeRenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
         vkCmdBindPipeline(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
             cloudsPassPipeline->pipeline);
 
         std::vector<VkDescriptorSet> cloudsDescriptorSets = { 
             findInMap(perFrameData[i].descriptorSets,"CommonUBO"),
-            findInMap(perFrameData[i].descriptorSets,"SkyConstantUBO"),
+            findInMap(perFrameData[i].descriptorSets,"CloudsUpsample"),
             findInMap(perFrameData[i].descriptorSets,"CloudsParamsUBO"),
             findInMap(perFrameData[i].descriptorSets,"DepthOne"),
-            findInMap(frameSharedDS,"WorleyNoise"),
-            findInMap(perFrameData[i].descriptorSets,"TransmittanceLUT"),
         };
         vkCmdBindDescriptorSets(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-            cloudsPassPipeline->layout, 0, 6, cloudsDescriptorSets.data(), 0, 0);
+            cloudsPassPipeline->layout, 0, 4, cloudsDescriptorSets.data(), 0, 0);
         vkCmdWriteTimestamp(renderSkyCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-            perFrameData[i].querryPool, 12);
+            perFrameData[i].querryPool, 22);
         vkCmdDraw(renderSkyCommandBuffer, 3, 1, 0, 0);
         vkCmdWriteTimestamp(renderSkyCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-            perFrameData[i].querryPool, 13);
+            perFrameData[i].querryPool, 23);
 
-        /* =============================================== FOURTH SUBPASS =============================================== */
+        /* ============================================= AERIAL PERSPECTIVE ============================================= */
         vkCmdNextSubpass(renderSkyCommandBuffer, VK_SUBPASS_CONTENTS_INLINE);
         vkCmdBindPipeline(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
             aePerspectivePassPipeline->pipeline);
@@ -2303,9 +3663,10 @@ void Renderer::createCommandBuffers() {
             findInMap(perFrameData[i].descriptorSets,"SkyConstantUBO"),
             findInMap(perFrameData[i].descriptorSets,"DepthTwo"),
             findInMap(perFrameData[i].descriptorSets,"AEPerspectiveLUT"),
+            findInMap(frameSharedDS,"BlueNoise"),
         };
         vkCmdBindDescriptorSets(renderSkyCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-            aePerspectivePassPipeline->layout, 0, 4, aePerspectiveDescriptorSets.data(), 0, 0);
+            aePerspectivePassPipeline->layout, 0, 5, aePerspectiveDescriptorSets.data(), 0, 0);
         vkCmdWriteTimestamp(renderSkyCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
             perFrameData[i].querryPool, 14);
         vkCmdDraw(renderSkyCommandBuffer, 3, 1, 0, 0);
@@ -2344,7 +3705,12 @@ void Renderer::createCommandBuffers() {
 
         vkCmdWriteTimestamp(postProcessCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
             perFrameData[i].querryPool, 16);
-        vkCmdDispatch(postProcessCommandBuffer, vSwapChain->swapChainExtent.width/16, vSwapChain->swapChainExtent.height/16, 1);
+        /* One invocation per HISTOGRAM_DOWNSAMPLE^2 block of the HDR target */
+        uint32_t meteringWidth = (vSwapChain->swapChainExtent.width + HISTOGRAM_DOWNSAMPLE - 1) /
+            HISTOGRAM_DOWNSAMPLE;
+        uint32_t meteringHeight = (vSwapChain->swapChainExtent.height + HISTOGRAM_DOWNSAMPLE - 1) /
+            HISTOGRAM_DOWNSAMPLE;
+        vkCmdDispatch(postProcessCommandBuffer, (meteringWidth + 15) / 16, (meteringHeight + 15) / 16, 1);
         vkCmdWriteTimestamp(postProcessCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
             perFrameData[i].querryPool, 17);
         #pragma endregion histogramComputation
@@ -2471,33 +3837,34 @@ void Renderer::updateUniformBuffer(uint32_t currentImage)
     float time = std::chrono::duration<float,std::chrono::seconds::period>
         (currentTime - startTime).count();
 
-    UniformBufferObject ubo{};
-    ubo.model = glm::mat4(1.0f);
-    ubo.model = glm::scale(ubo.model, glm::vec3(1000, 1000, 1000.0));
-    ubo.model = glm::translate(ubo.model, glm::vec3(-0.5f, -0.5f, -0.0f));
-
     float aspectRatio = float(vSwapChain->swapChainExtent.width) / 
         float(vSwapChain->swapChainExtent.height);
-    ubo.proj = glm::perspective(glm::radians(50.0f), aspectRatio, 0.1f, 20000.0f);
-    /* GLM is using OpenGL standard where Y coordinate of the clip coordinates is inverted */
-    ubo.proj[1][1] *= -1;
-
-    ubo.view = camera->getViewMatrix();
-    ubo.lHviewProj = ubo.proj * camera->getViewMatrix(true);
-    ubo.time = time;
+    UniformBufferObject ubo = packCommonParams(*camera, aspectRatio, time);
+    packAtmosphereFrameParams(atmoParamsBuffer, camera->getPos());
+    ubo.cloudsShadowMatrix = packCloudsShadowMatrix(atmoParamsBuffer.sunDirection,
+        camera->getPos(), cloudsParamsBuffer.shadowMapExtent, CLOUDS_SHADOW_MAP_SIZE);
+    /* commonParamsBuffer still holds the matrices of the last frame, first frame
+       has no history so it reprojects onto itself */
+    ubo.prevViewProj = frameIndex == 0 ? ubo.proj * ubo.view :
+        commonParamsBuffer.proj * commonParamsBuffer.view;
+    ubo.frameIndex = static_cast<int>(frameIndex);
+    /* Move the distant clouds panorama with the camera, the parallax of the far
+       clouds is small enough to reuse it until the camera gets too far */
+    ubo.cloudsPanoramaCenter = glm::vec4(cloudsPanoramaCenter, 0.0f);
+    if(cloudsPanoramaDirty || glm::distance(camera->getPos(), cloudsPanoramaCenter) >
+        cloudsParamsBuffer.panoramaRefreshDistance)
+    {
+        cloudsPanoramaCenter = camera->getPos();
+        ubo.cloudsPanoramaCenter = glm::vec4(cloudsPanoramaCenter, 1.0f);
+        cloudsPanoramaDirty = false;
+    }
+    commonParamsBuffer = ubo;
+    frameIndex++;
     void *data;
     vkMapMemory(vDevice->device, findInMap(perFrameData[currentImage].buffers, "CommonUBO")->bufferMemory, 0, sizeof(ubo), 0, &data);
     memcpy(data, &ubo, sizeof(ubo));
     vkUnmapMemory(vDevice->device, findInMap(perFrameData[currentImage].buffers, "CommonUBO")->bufferMemory);
 
-
-    atmoParamsBuffer.cameraPosition = camera->getPos();
-    atmoParamsBuffer.sunDirection = glm::vec3(
-        glm::cos(glm::radians(atmoParamsBuffer.sunPhiAngle)) * glm::sin(glm::radians(atmoParamsBuffer.sunThetaAngle)),
-        glm::sin(glm::radians(atmoParamsBuffer.sunPhiAngle)) * glm::sin(glm::radians(atmoParamsBuffer.sunThetaAngle)),
-        glm::cos(glm::radians(atmoParamsBuffer.sunThetaAngle))
-    );
-
     vkMapMemory(vDevice->device, 
         findInMap(perFrameData[currentImage].buffers, "SkyConstantUBO")->bufferMemory, 0, 
         sizeof(AtmosphereParametersBuffer), 0, &data);
@@ -2512,6 +3879,22 @@ void Renderer::updateUniformBuffer(uint32_t currentImage)
     vkUnmapMemory(vDevice->device,
         findInMap(perFrameData[currentImage].buffers, "CloudsParamsUBO")->bufferMemory);
 
+    /* Panorama build marches one column out of every panoramaSliceCount, the whole
+       panorama when its centre moved, see clouds_panorama_build */
+    uint32_t panoramaColumns = CLOUDS_PANORAMA_WIDTH;
+    if(ubo.cloudsPanoramaCenter.w == 0.0f)
+    {
+        uint32_t sliceCount = static_cast<uint32_t>(std::max(cloudsParamsBuffer.panoramaSliceCount, 1));
+        panoramaColumns = (CLOUDS_PANORAMA_WIDTH + sliceCount - 1) / sliceCount;
+    }
+    VkDispatchIndirectCommand panoramaDispatch{(panoramaColumns + 7) / 8, (CLOUDS_PANORAMA_HEIGHT + 7) / 8, 1};
+    vkMapMemory(vDevice->device,
+        findInMap(perFrameData[currentImage].buffers, "CloudsPanoramaDispatch")->bufferMemory, 0,
+        sizeof(VkDispatchIndirectCommand), 0, &data);
+    memcpy(data, &panoramaDispatch, sizeof(VkDispatchIndirectCommand));
+    vkUnmapMemory(vDevice->device,
+        findInMap(perFrameData[currentImage].buffers, "CloudsPanoramaDispatch")->bufferMemory);
+
     float timeThisFrame = glfwGetTime();
     /* Cap this to 0.2 to not cause issues due to long render times of first frames */
     postProcessParamsBuffer.timeDelta = glm::min(timeThisFrame - timeLastFrame, 0.020); 
@@ -2528,6 +3911,50 @@ void Renderer::updateUniformBuffer(uint32_t currentImage)
         findInMap(perFrameData[currentImage].buffers, "PostProcessUBO")->bufferMemory);
 }
 
+VkCommandBuffer Renderer::updateTerrainNodes(uint32_t currentImage)
+{
+    terrainQuadtree->select(commonParamsBuffer.model, commonParamsBuffer.proj * commonParamsBuffer.view,
+        camera->getPos(), TERRAIN_LOD_BASE_RANGE, terrainSelection);
+
+    uint32_t quadrantIndexCount = TERRAIN_PATCH_RES * TERRAIN_PATCH_RES * 6 / 4;
+    VkDeviceSize quadrantSize = VkDeviceSize(terrainQuadtree->getMaxSelectedNodes()) *
+        sizeof(TerrainNodeInstance);
+    std::array<VkDrawIndexedIndirectCommand, 4> draws{};
+
+    void *data;
+    VulkanBuffer &nodesBuffer = *findInMap(perFrameData[currentImage].buffers, "TerrainNodes");
+    vkMapMemory(vDevice->device, nodesBuffer.bufferMemory, 0, 4 * quadrantSize, 0, &data);
+    for(uint32_t quadrant = 0; quadrant < 4; quadrant++)
+    {
+        const std::vector<TerrainNodeInstance> &nodes = terrainSelection[quadrant];
+        memcpy(static_cast<char *>(data) + quadrant * quadrantSize, nodes.data(),
+            nodes.size() * sizeof(TerrainNodeInstance));
+        draws[quadrant].indexCount = quadrantIndexCount;
+        draws[quadrant].instanceCount = static_cast<uint32_t>(nodes.size());
+        draws[quadrant].firstIndex = quadrant * quadrantIndexCount;
+    }
+    vkUnmapMemory(vDevice->device, nodesBuffer.bufferMemory);
+
+    VulkanBuffer &drawsBuffer = *findInMap(perFrameData[currentImage].buffers, "TerrainDraws");
+    vkMapMemory(vDevice->device, drawsBuffer.bufferMemory, 0, sizeof(draws), 0, &data);
+    memcpy(data, draws.data(), sizeof(draws));
+    vkUnmapMemory(vDevice->device, drawsBuffer.bufferMemory);
+
+    glm::vec4 planeCamera = glm::inverse(commonParamsBuffer.model) * glm::vec4(camera->getPos(), 1.0f);
+    return terrainTileCache->update(glm::vec2(planeCamera), currentImage);
+}
+
+void Renderer::freeCommandBuffers()
+{
+    for(int i = 0; i < vSwapChain->imageCount; i++)
+    {
+        for(auto& commandBuffer : perFrameData[i].commandBuffers)
+        {
+            vkFreeCommandBuffers(vDevice->device, vDevice->graphicsCommandPool, 1, &commandBuffer.second);
+        }
+    }
+}
+
 void Renderer::cleanupSwapchain()
 {
     for(int i = 0; i < vSwapChain->imageCount; i++)
@@ -2540,11 +3967,8 @@ void Renderer::cleanupSwapchain()
         {
             vkDestroyFramebuffer(vDevice->device, framebuffer.second, nullptr);
         }
-        for(auto& commandBuffer : perFrameData[i].commandBuffers)
-        {
-            vkFreeCommandBuffers(vDevice->device, vDevice->graphicsCommandPool, 1, &commandBuffer.second);
-        }
     }
+    freeCommandBuffers();
 
     finalPassPipeline.reset();
     terrainPassPipeline.reset();
@@ -2555,11 +3979,20 @@ void Renderer::cleanupSwapchain()
     multiscatteringLUTPipeline.reset();
     skyViewLUTPipeline.reset();
     AEPerspectiveLUTPipeline.reset();
+    cloudsClassifyPipeline.reset();
+    cloudsTracePipeline.reset();
+    cloudsReconstructPipeline.reset();
+    cloudsOccupancyBuildPipeline.reset();
+    cloudsOccupancyDownsamplePipeline.reset();
+    cloudsDensityBakePipeline.reset();
+    cloudsShadowBuildPipeline.reset();
+    cloudsPanoramaBuildPipeline.reset();
     histogramPipeline.reset();
     sumHistogramPipeline.reset();
 
     vkDestroyRenderPass(vDevice->device, renderPass, nullptr); 
     vkDestroyRenderPass(vDevice->device, hdrBackbufferPass, nullptr); 
+    vkDestroyRenderPass(vDevice->device, cloudsCompositePass, nullptr); 
     vkDestroyDescriptorPool(vDevice->device, descriptorPool, nullptr);
 
     vSwapChain.reset();
@@ -2600,7 +4033,8 @@ void Renderer::prepareTextureTargets(uint32_t width, uint32_t height, VkFormat f
         /* Transmittance LUT */
         perFrameData[i].images["TransmittanceLUT"] = std::make_unique<VulkanImage>(vDevice, width, height, 1,
             VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT |
-            VK_IMAGE_USAGE_STORAGE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
 
         findInMap(perFrameData[i].images,"TransmittanceLUT")->TransitionImageLayout(format, VK_IMAGE_LAYOUT_UNDEFINED,
             VK_IMAGE_LAYOUT_GENERAL, 1);
@@ -2704,13 +4138,27 @@ void Renderer::prepareTextureTargets(uint32_t width, uint32_t height, VkFormat f
     cloudsSamplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     cloudsSamplerInfo.mipLodBias = 0.0f;
     cloudsSamplerInfo.minLod = 0.0f;
-    cloudsSamplerInfo.maxLod = 1.0f;
+    /* Noise volumes are sampled with explicit lods over their whole mip chain */
+    cloudsSamplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
     if (vkCreateSampler(vDevice->device, &cloudsSamplerInfo, nullptr, &cloudsSampler) != VK_SUCCESS)
     {
         throw std::runtime_error("APP::CREATE_TEXTURE_SAMPLER::Failed to create skyView texture sampler");
     }
 
+    /* Lat-long panorama wraps around in azimuth but not over the poles */
+    VkSamplerCreateInfo cloudsPanoramaSamplerInfo = cloudsSamplerInfo;
+    cloudsPanoramaSamplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    cloudsPanoramaSamplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    cloudsPanoramaSamplerInfo.anisotropyEnable = VK_FALSE;
+    cloudsPanoramaSamplerInfo.maxAnisotropy = 1.0f;
+    cloudsPanoramaSamplerInfo.maxLod = 1.0f;
+
+    if (vkCreateSampler(vDevice->device, &cloudsPanoramaSamplerInfo, nullptr, &cloudsPanoramaSampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("APP::CREATE_TEXTURE_SAMPLER::Failed to create clouds panorama sampler");
+    }
+
     VkSamplerCreateInfo depthSamplerInfo{};
     depthSamplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     depthSamplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -2762,6 +4210,337 @@ void Renderer::prepareTextureTargets(uint32_t width, uint32_t height, VkFormat f
     }
 }
 
+void Renderer::createNoiseVolumes()
+{
+    noise = std::make_unique<WorleyNoise3D>(getShapeNoiseDesc(), vDevice);
+    detailNoise = std::make_unique<WorleyNoise3D>(getDetailNoiseDesc(), vDevice);
+    shapeNoiseParams = getShapeNoiseDesc().params;
+    detailNoiseParams = getDetailNoiseDesc().params;
+
+    /* Same points and params at a fraction of the texels, a few ms to bake -> the first
+       frame is not held back by the full volumes */
+    std::vector<uint16_t> noiseTexels;
+    WorleyNoiseDesc fallbackDesc = getShapeNoiseDesc();
+    fallbackDesc.texDimensions = glm::ivec3(NOISE_FALLBACK_SIZE);
+    bakeWorleyNoise(noiseTexels, fallbackDesc);
+    noiseFallback = std::make_unique<WorleyNoise3D>(fallbackDesc, vDevice);
+    noiseFallback->uploadNoise(noiseTexels);
+
+    fallbackDesc = getDetailNoiseDesc();
+    fallbackDesc.texDimensions = glm::ivec3(NOISE_FALLBACK_SIZE);
+    bakeWorleyNoise(noiseTexels, fallbackDesc);
+    detailNoiseFallback = std::make_unique<WorleyNoise3D>(fallbackDesc, vDevice);
+    detailNoiseFallback->uploadNoise(noiseTexels);
+}
+
+bool Renderer::updateNoiseParams()
+{
+    bool regenerated = false;
+    /* Only one volume generates at a time, same as when streaming */
+    bool slabsSubmitted = false;
+    for(const auto &[volume, params] : {std::make_pair(noise.get(), shapeNoiseParams),
+                                        std::make_pair(detailNoise.get(), detailNoiseParams)})
+    {
+        uint32_t changedChannels = volume->setParams(params);
+        /* Restarts a generation in progress, the volume before it keeps being sampled */
+        if(changedChannels != 0) { volume->beginGeneration(changedChannels); }
+        if(!volume->isGenerating() || slabsSubmitted) { continue; }
+        slabsSubmitted = true;
+        regenerated |= volume->generateSlabs(NOISE_STREAMING_BUDGET_MS);
+    }
+    if(regenerated)
+    {
+        densityBakeDirty = true;
+        cloudsPanoramaDirty = true;
+    }
+    return regenerated;
+}
+
+/* Worker thread part of streaming a noise volume, BC7 volume is loaded from its cache or
+   encoded, the PSNR comes with it */
+static void prepareNoiseStreamResult(NoiseStreamResult &result, const std::string &cachePath,
+    glm::ivec3 dimensions, bool bc7Supported)
+{
+    if(!bc7Supported || result.texels.empty()) { return; }
+    loadOrEncodeBC7Volume(result.texels, dimensions, result.compressed, cachePath + ".bc7");
+    glm::vec4 psnr = result.compressed.psnr;
+    float minPSNR = glm::min(glm::min(psnr.r, psnr.g), glm::min(psnr.b, psnr.a));
+    std::cout << "RENDERER::STREAM_NOISE_VOLUMES::BC7 PSNR of " << cachePath << " " << psnr.r <<
+        " " << psnr.g << " " << psnr.b << " " << psnr.a << " dB" << std::endl;
+    result.useBC7 = minPSNR >= NOISE_BC7_MIN_PSNR;
+}
+
+bool Renderer::streamNoiseVolumes()
+{
+    bool bc7Supported = vDevice->isCompressed3DFormatSupported(VK_FORMAT_BC7_UNORM_BLOCK);
+    std::array<WorleyNoise3D *, 2> volumes = {noise.get(), detailNoise.get()};
+    bool streamed = true;
+    /* Only one volume generates at a time -> the GPU time stays within the budget */
+    bool slabsSubmitted = false;
+    for(size_t i = 0; i < volumes.size(); i++)
+    {
+        WorleyNoise3D *volume = volumes[i];
+        NoiseStreamJob &job = noiseStreamJobs[i];
+        WorleyNoiseDesc desc = volume->getDesc();
+        std::string cachePath = getWorleyNoiseCachePath(WORLEY_NOISE_CACHE_DIRECTORY, desc);
+
+        if(job.result.valid())
+        {
+            if(job.result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                streamed = false;
+                continue;
+            }
+            NoiseStreamResult result = job.result.get();
+            if(job.readbackBuffer)
+            {
+                vkUnmapMemory(vDevice->device, job.readbackBuffer->bufferMemory);
+                job.readbackBuffer.reset();
+            }
+            if(result.useBC7)
+            {
+                volume->uploadCompressedNoise(result.compressed);
+            }
+            else if(result.fromCache && !result.texels.empty())
+            {
+                volume->uploadNoise(result.texels);
+            }
+            else if(result.fromCache)
+            {
+                /* Cache missed -> the readback of the generated texels feeds the cache */
+                volume->beginGeneration(WORLEY_ALL_CHANNELS, true);
+            }
+            /* Generated texels without BC7 are already in the fp16 volume */
+        }
+
+        if(volume->isUploading())
+        {
+            streamed = false;
+            continue;
+        }
+
+        if(volume->isGenerating())
+        {
+            streamed = false;
+            if(slabsSubmitted) { continue; }
+            slabsSubmitted = true;
+            if(volume->generateSlabs(NOISE_STREAMING_BUDGET_MS))
+            {
+                glm::ivec3 dimensions = volume->getTexDimensions();
+                size_t texelCount = static_cast<size_t>(dimensions.x) * dimensions.y * dimensions.z * 4;
+                job.readbackBuffer = volume->takeReadbackBuffer();
+                void *data;
+                vkMapMemory(vDevice->device, job.readbackBuffer->bufferMemory, 0,
+                    texelCount * sizeof(uint16_t), 0, &data);
+                /* Cache it for the next run, the texels are also the source of the BC7 volume */
+                job.result = std::async(std::launch::async,
+                    [data, texelCount, desc, cachePath, bc7Supported]()
+                {
+                    NoiseStreamResult result;
+                    result.texels.resize(texelCount);
+                    memcpy(result.texels.data(), data, texelCount * sizeof(uint16_t));
+                    writeWorleyNoiseCache(result.texels, desc, cachePath);
+                    prepareNoiseStreamResult(result, cachePath, desc.texDimensions, bc7Supported);
+                    return result;
+                });
+            }
+            continue;
+        }
+
+        if(!volume->noiseImage && !volume->compressedNoiseImage)
+        {
+            streamed = false;
+            job.result = std::async(std::launch::async, [desc, cachePath, bc7Supported]()
+            {
+                NoiseStreamResult result;
+                result.fromCache = true;
+                if(!loadWorleyNoiseCache(result.texels, desc, cachePath))
+                {
+                    result.texels.clear();
+                }
+                prepareNoiseStreamResult(result, cachePath, desc.texDimensions, bc7Supported);
+                return result;
+            });
+        }
+    }
+    return streamed;
+}
+
+void Renderer::createCloudsOccupancy()
+{
+    /* One occupancy texel covers a brick of CLOUDS_OCCUPANCY_BRICK_SIZE^3 shape noise texels */
+    glm::ivec3 noiseDimensions = noise->getTexDimensions();
+    glm::ivec3 occupancyDimensions = glm::max(noiseDimensions / CLOUDS_OCCUPANCY_BRICK_SIZE, glm::ivec3(1));
+    uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(occupancyDimensions.x,
+        std::max(occupancyDimensions.y, occupancyDimensions.z))))) + 1;
+
+    frameSharedImages["CloudsOccupancy"] = std::make_unique<VulkanImage>(vDevice,
+        occupancyDimensions.x, occupancyDimensions.y, mipLevels, VK_SAMPLE_COUNT_1_BIT,
+        VK_FORMAT_R32_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT, occupancyDimensions.z);
+
+    VulkanImage &occupancyImage = *findInMap(frameSharedImages, "CloudsOccupancy");
+    occupancyImage.TransitionImageLayout(VK_FORMAT_R32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_GENERAL, mipLevels);
+
+    for(uint32_t mip = 0; mip < mipLevels; mip++)
+    {
+        cloudsOccupancyMipViews.push_back(createImageView(vDevice->device, occupancyImage.image,
+            VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1, occupancyDimensions.z, mip));
+    }
+}
+
+void Renderer::createCloudsDensity()
+{
+    for(auto &mipView : cloudsDensityMipViews)
+    {
+        vkDestroyImageView(vDevice->device, mipView, nullptr);
+    }
+    cloudsDensityMipViews.clear();
+
+    /* Full resolution keeps every shape noise texel, the divisor trades it for memory */
+    cloudsDensityDivisor = std::max(cloudsParamsBuffer.densityBakeDivisor, 1);
+    cloudsParamsBuffer.densityBakeDivisor = cloudsDensityDivisor;
+    glm::ivec3 densityDimensions = glm::max(noise->getTexDimensions() / cloudsDensityDivisor,
+        glm::ivec3(1));
+    uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(densityDimensions.x,
+        std::max(densityDimensions.y, densityDimensions.z))))) + 1;
+
+    frameSharedImages["CloudsDensity"] = std::make_unique<VulkanImage>(vDevice,
+        densityDimensions.x, densityDimensions.y, mipLevels, VK_SAMPLE_COUNT_1_BIT,
+        VK_FORMAT_R16_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT, densityDimensions.z);
+
+    VulkanImage &densityImage = *findInMap(frameSharedImages, "CloudsDensity");
+    densityImage.TransitionImageLayout(VK_FORMAT_R16_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_GENERAL, mipLevels);
+
+    for(uint32_t mip = 0; mip < mipLevels; mip++)
+    {
+        cloudsDensityMipViews.push_back(createImageView(vDevice->device, densityImage.image,
+            VK_FORMAT_R16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1, densityDimensions.z, mip));
+    }
+    densityBakeDirty = true;
+}
+
+void Renderer::createCloudsShadowMap()
+{
+    /* Rebuilt every frame in the RenderSky command buffer -> one image is shared by all frames */
+    frameSharedImages["CloudsShadowMap"] = std::make_unique<VulkanImage>(vDevice,
+        CLOUDS_SHADOW_MAP_SIZE, CLOUDS_SHADOW_MAP_SIZE, 1, VK_SAMPLE_COUNT_1_BIT,
+        VK_FORMAT_R16_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT, CLOUDS_SHADOW_MAP_SLICES);
+
+    findInMap(frameSharedImages, "CloudsShadowMap")->TransitionImageLayout(VK_FORMAT_R16_SFLOAT,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 1);
+}
+
+void Renderer::createCloudsPanorama()
+{
+    /* Marched a slice at a time in the RenderSky command buffer, slices written in
+       earlier frames are reused -> one image is shared by all frames */
+    frameSharedImages["CloudsPanorama"] = std::make_unique<VulkanImage>(vDevice,
+        CLOUDS_PANORAMA_WIDTH, CLOUDS_PANORAMA_HEIGHT, 1, VK_SAMPLE_COUNT_1_BIT,
+        VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    findInMap(frameSharedImages, "CloudsPanorama")->TransitionImageLayout(VK_FORMAT_R16G16B16A16_SFLOAT,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 1);
+}
+
+void Renderer::buildCloudsOccupancy()
+{
+    VulkanImage &occupancyImage = *findInMap(frameSharedImages, "CloudsOccupancy");
+    glm::ivec3 occupancyDimensions = glm::max(noise->getTexDimensions() / CLOUDS_OCCUPANCY_BRICK_SIZE,
+        glm::ivec3(1));
+
+    VkCommandBuffer commandBuffer = vDevice->BeginSingleTimeCommands();
+
+    VkMemoryBarrier mipFinished = {};
+    mipFinished.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    mipFinished.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    mipFinished.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    /* ============================== BUILD MIP 0 ============================== */
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        cloudsOccupancyBuildPipeline->pipeline);
+    VkDescriptorSet buildSet = findInMap(frameSharedDS, "CloudsOccupancyBuild");
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        cloudsOccupancyBuildPipeline->layout, 0, 1, &buildSet, 0, nullptr);
+    vkCmdDispatch(commandBuffer, (occupancyDimensions.x + 3) / 4, (occupancyDimensions.y + 3) / 4,
+        (occupancyDimensions.z + 3) / 4);
+
+    /* ============================ DOWNSAMPLE MIPS ============================ */
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        cloudsOccupancyDownsamplePipeline->pipeline);
+    for(uint32_t mip = 1; mip < occupancyImage.mipLevels; mip++)
+    {
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &mipFinished, 0, nullptr, 0, nullptr);
+
+        VkDescriptorSet downsampleSet = findInMap(frameSharedDS,
+            "CloudsOccupancyDownsample" + std::to_string(mip));
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            cloudsOccupancyDownsamplePipeline->layout, 0, 1, &downsampleSet, 0, nullptr);
+
+        glm::ivec3 mipDimensions = glm::max(occupancyDimensions >> glm::ivec3(mip), glm::ivec3(1));
+        vkCmdDispatch(commandBuffer, (mipDimensions.x + 3) / 4, (mipDimensions.y + 3) / 4,
+            (mipDimensions.z + 3) / 4);
+    }
+    /* EndSingleTimeCommands waits for the queue to become idle -> no barrier
+       towards the clouds trace pass is needed */
+    vDevice->EndSingleTimeCommands(commandBuffer);
+
+    occupancyDirty = false;
+}
+
+void Renderer::bakeCloudsDensity(uint32_t currentImage)
+{
+    VulkanImage &densityImage = *findInMap(frameSharedImages, "CloudsDensity");
+    glm::ivec3 densityDimensions = glm::max(noise->getTexDimensions() / cloudsDensityDivisor,
+        glm::ivec3(1));
+
+    VkCommandBuffer commandBuffer = vDevice->BeginSingleTimeCommands();
+
+    /* Mips are baked independently from the noise mips, no barriers between them are needed */
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+        cloudsDensityBakePipeline->pipeline);
+    for(uint32_t mip = 0; mip < densityImage.mipLevels; mip++)
+    {
+        std::vector<VkDescriptorSet> bakeDescriptorSets = {
+            findInMap(frameSharedDS, "WorleyNoise"),
+            findInMap(frameSharedDS, "CloudsDensityBake" + std::to_string(mip)),
+            findInMap(perFrameData[currentImage].descriptorSets, "CloudsParamsUBO")
+        };
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            cloudsDensityBakePipeline->layout, 0, 3, bakeDescriptorSets.data(), 0, nullptr);
+
+        glm::ivec3 mipDimensions = glm::max(densityDimensions >> glm::ivec3(mip), glm::ivec3(1));
+        vkCmdDispatch(commandBuffer, (mipDimensions.x + 3) / 4, (mipDimensions.y + 3) / 4,
+            (mipDimensions.z + 3) / 4);
+    }
+    /* EndSingleTimeCommands waits for the queue to become idle -> no barrier
+       towards the clouds passes is needed */
+    vDevice->EndSingleTimeCommands(commandBuffer);
+
+    bakedDensityParams = cloudsParamsBuffer;
+    densityBakeDirty = false;
+    occupancyDirty = true;
+}
+
+bool Renderer::cloudsDensityBakeOutdated() const
+{
+    const CloudsParametersBuffer &baked = bakedDensityParams;
+    const CloudsParametersBuffer &current = cloudsParamsBuffer;
+    return densityBakeDirty || baked.shapeNoiseWeights != current.shapeNoiseWeights;
+}
+
 void Renderer::createComputeSyncObjects()
 {
 
@@ -2779,7 +4558,6 @@ void Renderer::createComputeSyncObjects()
     }
 }
 
-bool redrawNoise = true;
 void Renderer::drawFrame()
 {
     uint32_t imageIndex;
@@ -2788,6 +4566,47 @@ void Renderer::drawFrame()
     vkWaitForFences(vDevice->device, 1, &inFlightFences[currentFrame],
         VK_TRUE, UINT64_MAX);
 
+    /* The frame is done -> noise slabs and uploads can be submitted without waiting on it.
+       Once both volumes are in, only the noise set is pointed at them and the pre-recorded
+       command buffers using it are recorded again, the swapchain and the clouds history
+       are kept */
+    if(!noiseStreamed && streamNoiseVolumes())
+    {
+        noiseStreamed = true;
+        densityBakeDirty = true;
+        cloudsPanoramaDirty = true;
+        writeNoiseDescriptorSets();
+        freeCommandBuffers();
+        createCommandBuffers();
+        /* Every submission sampling the fallbacks finished with the frame */
+        noiseFallback.reset();
+        detailNoiseFallback.reset();
+    }
+    /* Regenerated volume replaced the one the noise set sampled, rebound the same way */
+    if(noiseStreamed && updateNoiseParams())
+    {
+        writeNoiseDescriptorSets();
+        freeCommandBuffers();
+        createCommandBuffers();
+    }
+
+    /* Clouds targets are sized by the clouds resolution settings -> recreate them
+       before acquiring the image so no semaphore is left signaled */
+    if(cloudsParamsBuffer.resolutionDivisor != cloudsResolutionDivisor ||
+       cloudsParamsBuffer.reprojectionBlockSize != cloudsReprojectionBlockSize)
+    {
+        recreateSwapChain();
+        return;
+    }
+    /* Density volume is sampled by the sets the swapchain recreation writes */
+    if(std::max(cloudsParamsBuffer.densityBakeDivisor, 1) != cloudsDensityDivisor)
+    {
+        vkDeviceWaitIdle(vDevice->device);
+        createCloudsDensity();
+        recreateSwapChain();
+        return;
+    }
+
     VkResult result = vkAcquireNextImageKHR(vDevice->device, vSwapChain->swapChain, UINT64_MAX,
         imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
 
@@ -2813,26 +4632,34 @@ void Renderer::drawFrame()
     // Query timestamp results of the current image since they are guaranteed to already
     // have been written here
     vkGetQueryPoolResults(vDevice->device, perFrameData[imageIndex].querryPool,
-        0, 22, 22*sizeof(uint64_t), perFrameData[imageIndex].timestamps.data(),
+        0, 28, 28*sizeof(uint64_t), perFrameData[imageIndex].timestamps.data(),
         0, VK_QUERY_RESULT_WITH_AVAILABILITY_BIT | VK_QUERY_RESULT_64_BIT);
 
 
     updateUniformBuffer(imageIndex);
-    if(redrawNoise)
+    VkCommandBuffer terrainTileCopies = updateTerrainNodes(imageIndex);
+    if(cloudsDensityBakeOutdated())
+    {
+        bakeCloudsDensity(imageIndex);
+    }
+    if(occupancyDirty)
     {
-        noise->generateNoise();
-        detailNoise->generateNoise();
-        redrawNoise = false;
+        buildCloudsOccupancy();
     }
 
     VkSubmitInfo ComputeLUTsSI{};
-    std::array<VkCommandBuffer, 2> commandBuffers = {
+    std::vector<VkCommandBuffer> commandBuffers = {
         findInMap(perFrameData[imageIndex].commandBuffers,"ComputeLUTs"), 
         findInMap(perFrameData[imageIndex].commandBuffers,"RenderSky"), 
     };
+    /* Tiles the terrain of this frame already samples are copied in first */
+    if(terrainTileCopies != VK_NULL_HANDLE)
+    {
+        commandBuffers.insert(commandBuffers.begin(), terrainTileCopies);
+    }
 
     ComputeLUTsSI.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    ComputeLUTsSI.commandBufferCount = 2;
+    ComputeLUTsSI.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
     ComputeLUTsSI.pCommandBuffers = commandBuffers.data();
     ComputeLUTsSI.waitSemaphoreCount = 0;
     ComputeLUTsSI.pWaitSemaphores = nullptr;
@@ -2861,8 +4688,8 @@ void Renderer::drawFrame()
         imguiImpl->PrepareNewFrame(
             imageIndex,
             findInMap(perFrameData[imageIndex].framebuffers, "ImGui"), camera, 
-            postProcessParamsBuffer, atmoParamsBuffer, cloudsParamsBuffer,
-            perFrameData[imageIndex].timestamps, extent)
+            postProcessParamsBuffer, atmoParamsBuffer, cloudsParamsBuffer, shapeNoiseParams,
+            detailNoiseParams, perFrameData[imageIndex].timestamps, extent)
     };
 
     //submit graphics commands
@@ -2897,6 +4724,77 @@ void Renderer::drawFrame()
     currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
+static std::vector<glm::vec4> readbackRGBA16FImage(std::shared_ptr<VulkanDevice> device,
+    VulkanImage &image, glm::ivec3 dimensions)
+{
+    size_t texelCount = dimensions.x * dimensions.y * dimensions.z;
+    VkDeviceSize bufferSize = texelCount * 4 * sizeof(uint16_t);
+    VulkanBuffer stagingBuffer = VulkanBuffer(device, bufferSize,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    image.CopyImageToBuffer(stagingBuffer, VK_IMAGE_LAYOUT_GENERAL, dimensions.x,
+        dimensions.y, dimensions.z);
+
+    void *data;
+    vkMapMemory(device->device, stagingBuffer.bufferMemory, 0, bufferSize, 0, &data);
+    std::vector<glm::vec4> texels = unpackHalfTexels(static_cast<uint16_t*>(data), texelCount);
+    vkUnmapMemory(device->device, stagingBuffer.bufferMemory);
+    return texels;
+}
+
+void Renderer::renderCloudsReference(const std::string &outputPath, bool offline)
+{
+    /* Noise generation and LUT computation need to be finished before reading them back */
+    vkDeviceWaitIdle(vDevice->device);
+
+    /* The GPU volumes may be BC7 -> the reference uses the fp16 source they were uploaded from */
+    std::vector<uint16_t> noiseTexels;
+    CPUNoiseVolume shapeNoise{noise->getTexDimensions()};
+    loadOrBakeWorleyNoise(noiseTexels, noise->getDesc(),
+        getWorleyNoiseCachePath(WORLEY_NOISE_CACHE_DIRECTORY, noise->getDesc()));
+    shapeNoise.texels = unpackHalfTexels(noiseTexels.data(), noiseTexels.size() / 4);
+    CPUNoiseVolume detailNoiseVolume{detailNoise->getTexDimensions()};
+    loadOrBakeWorleyNoise(noiseTexels, detailNoise->getDesc(),
+        getWorleyNoiseCachePath(WORLEY_NOISE_CACHE_DIRECTORY, detailNoise->getDesc()));
+    detailNoiseVolume.texels = unpackHalfTexels(noiseTexels.data(), noiseTexels.size() / 4);
+
+    CPUCloudRaymarcherInputs inputs{};
+    inputs.extent = glm::uvec2(vSwapChain->swapChainExtent.width, vSwapChain->swapChainExtent.height);
+    inputs.view = commonParamsBuffer.view;
+    inputs.proj = commonParamsBuffer.proj;
+    inputs.cloudsParams = cloudsParamsBuffer;
+    inputs.atmoParams = atmoParamsBuffer;
+    inputs.shapeNoise = &shapeNoise;
+    inputs.detailNoise = &detailNoiseVolume;
+    /* NOTE: LUTs of all swapchain images are computed from the same parameters */
+    inputs.transmittanceLUT = readbackRGBA16FImage(vDevice,
+        *findInMap(perFrameData[0].images, "TransmittanceLUT"),
+        glm::ivec3(atmoParamsBuffer.TransmittanceTexDimensions, 1));
+    loadOrGenerateBlueNoise(inputs.blueNoise, BLUE_NOISE_SIZE, BLUE_NOISE_SEED, BLUE_NOISE_CACHE_PATH);
+    inputs.blueNoiseSize = BLUE_NOISE_SIZE;
+    inputs.coverageMap = coverageMap;
+    inputs.coverageMapSize = COVERAGE_MAP_SIZE;
+    inputs.frameIndex = frameIndex;
+
+    CPUCloudRaymarcherSettings settings{};
+    if(offline)
+    {
+        settings.sampleCountMultiplier = 8;
+        settings.samplesPerPixel = 16;
+    }
+    CPUCloudRaymarcher raymarcher(settings);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<glm::vec4> image = raymarcher.render(inputs);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Cloud reference render took " <<
+        std::chrono::duration<float, std::chrono::seconds::period>(end - start).count() <<
+        " s" << std::endl;
+
+    CPUCloudRaymarcher::saveEXR(outputPath, image, inputs.extent);
+}
+
 // Timestamps
 void Renderer::createQuerryPool()
 {
@@ -5,6 +5,7 @@
 #include <memory>
 #include <chrono>
 #include <array>
+#include <future>
 #include <unordered_map>
 
 #define GLFW_INCLUDE_VULKAN
@@ -14,16 +15,71 @@
 #include "vulkan_debug.hpp"
 #include "vulkan_swapchain.hpp"
 #include "vulkan_pipeline.hpp"
+#include "terrain_tile_cache.hpp"
 #include "primitives.hpp"
 #include "model/sky_model.hpp"
+#include "model/terrain_grid.hpp"
+#include "model/terrain_quadtree.hpp"
+#include "model/height_pyramid.hpp"
 #include "camera.hpp"
 #include "imgui_impl.hpp"
 #include "buffer_defines.hpp"
+#include "buffer_packing.hpp"
 #include "noise/worley_noise.hpp"
+#include "noise/blue_noise.hpp"
+#include "noise/coverage_map.hpp"
+#include "clouds/cpu_cloud_raymarcher.hpp"
 
 #include "imgui.h"
 
 #define MAX_FRAMES_IN_FLIGHT 1
+/* Blue noise used to jitter the clouds and AE perspective passes */
+#define BLUE_NOISE_SIZE 64
+#define BLUE_NOISE_SEED 1234u
+#define BLUE_NOISE_CACHE_PATH "assets/cache/blue_noise_64.bin"
+/* Shape and detail worley noise caches, see getWorleyNoiseCachePath */
+#define WORLEY_NOISE_CACHE_DIRECTORY "assets/cache"
+/* Noise volumes are sampled as BC7 when every channel keeps at least this PSNR in dB,
+   fp16 otherwise */
+#define NOISE_BC7_MIN_PSNR 32.0f
+/* Edge length of the coarse noise volumes the clouds use until the full ones are streamed in */
+#define NOISE_FALLBACK_SIZE 32
+/* GPU time per frame spent generating noise volumes missing from the cache */
+#define NOISE_STREAMING_BUDGET_MS 4.0f
+/* Edge length in shape noise texels of the bricks of the clouds occupancy volume */
+#define CLOUDS_OCCUPANCY_BRICK_SIZE 8
+/* Resolution of the sun space clouds shadow map, slices are spread along the sun direction */
+#define CLOUDS_SHADOW_MAP_SIZE 256
+#define CLOUDS_SHADOW_MAP_SLICES 32
+/* Resolution of the lat-long panorama of the distant clouds */
+#define CLOUDS_PANORAMA_WIDTH 512
+#define CLOUDS_PANORAMA_HEIGHT 256
+/* Clouds coverage map, loaded from COVERAGE_MAP_PATH when the file exists (red channel
+   of a COVERAGE_MAP_SIZE^2 image) otherwise generated */
+#define COVERAGE_MAP_SIZE 512
+#define COVERAGE_MAP_SEED 4321u
+#define COVERAGE_MAP_PATH "assets/textures/clouds_coverage.png"
+/* Exposure is metered on the HDR target downsampled by this factor along each axis, has to
+   match histogram_generate.glsl */
+#define HISTOGRAM_DOWNSAMPLE 4
+
+/* Terrain is a CDLOD quadtree over the heightmap, every selected node is drawn with one
+   TERRAIN_PATCH_RES^2 quads patch -> leaves are 2^(TERRAIN_LOD_COUNT - 1) patches across */
+#define TERRAIN_PATCH_RES 32
+#define TERRAIN_LOD_COUNT 8
+/* World space distance up to which the leaves are drawn, doubles with every level */
+#define TERRAIN_LOD_BASE_RANGE 20.0f
+/* Heightmap value to unit plane z scale, has to match terrain.vert */
+#define TERRAIN_HEIGHT_SCALE 0.07f
+/* Heightmap is converted into TERRAIN_TILES_PATH on the first run, delete the file to
+   convert it again. Tiles are streamed in around the camera, mip 0 tiles are wanted within
+   TERRAIN_TILE_STREAMING_RADIUS texels, the radius doubles with every mip */
+#define TERRAIN_HEIGHTMAP_PATH "assets/textures/terrain_heightmap.exr"
+#define TERRAIN_TILES_PATH "assets/cache/terrain_heightmap.tiles"
+#define TERRAIN_TILE_SIZE 128
+#define TERRAIN_TILE_CACHE_LAYERS 256
+#define TERRAIN_TILE_STAGING_SLOTS 32
+#define TERRAIN_TILE_STREAMING_RADIUS 256.0f
 
 /* Validation layers */
 const std::vector<const char *> validationLayers = {
@@ -42,6 +98,24 @@ struct FrameData{
     VkFence inFlightFence;
 };
 
+/* Output of the worker thread streaming one full noise volume, see streamNoiseVolumes */
+struct NoiseStreamResult{
+    /* Texels were read from the noise cache, false for texels generated on the GPU */
+    bool fromCache = false;
+    /* Empty when the noise cache missed */
+    std::vector<uint16_t> texels;
+    /* compressed holds the volume to sample, see NOISE_BC7_MIN_PSNR */
+    bool useBC7 = false;
+    BC7Volume compressed;
+};
+
+struct NoiseStreamJob{
+    /* Cache I/O, BC7 encoding and PSNR running on a worker thread */
+    std::future<NoiseStreamResult> result;
+    /* Mapped readback of generated texels, read by the worker until result is ready */
+    std::unique_ptr<VulkanBuffer> readbackBuffer;
+};
+
 class Renderer
 {
 public:
@@ -52,17 +126,60 @@ public:
     ~Renderer();
 
     void drawFrame();
+    /**
+     * Render the clouds with the CPU reference raymarcher using the current
+     * camera and parameters and save the result as an EXR image
+     * @param offline if TRUE use the high sample count offline mode
+     */
+    void renderCloudsReference(const std::string &outputPath, bool offline);
 
 private:
     bool validationEnabled;
     size_t currentFrame = 0;
+    /* Number of rendered frames, drives the temporal clouds update pattern */
+    uint32_t frameIndex = 0;
+    /* Clouds settings the clouds targets were created with, change in
+       cloudsParamsBuffer triggers recreation of the targets */
+    int cloudsResolutionDivisor;
+    int cloudsReprojectionBlockSize;
+    /* Divisor the clouds density volume was created with, see densityBakeDivisor */
+    int cloudsDensityDivisor;
+    VkExtent2D cloudsExtent;
+    VkExtent2D cloudsTraceExtent;
     std::array<FrameData, 3> perFrameData;
     /*========================== Frame independent data ===============================*/
+    UniformBufferObject commonParamsBuffer;
     AtmosphereParametersBuffer atmoParamsBuffer;
     PostProcessParamsBuffer postProcessParamsBuffer;
     CloudsParametersBuffer cloudsParamsBuffer;
     std::unique_ptr<WorleyNoise3D> noise;
     std::unique_ptr<WorleyNoise3D> detailNoise;
+    /* Coarse CPU baked versions of noise and detailNoise, sampled until both of the full
+       volumes are streamed in, see streamNoiseVolumes */
+    std::unique_ptr<WorleyNoise3D> noiseFallback;
+    std::unique_ptr<WorleyNoise3D> detailNoiseFallback;
+    bool noiseStreamed = false;
+    /* Jobs of noise and detailNoise */
+    std::array<NoiseStreamJob, 2> noiseStreamJobs;
+    /* Edited in the UI, compared against the parameters of the volumes every frame */
+    WorleyNoiseCreateParams shapeNoiseParams;
+    WorleyNoiseCreateParams detailNoiseParams;
+    /* One view per mip of the clouds occupancy volume, used as storage image
+       targets when building the mip chain */
+    std::vector<VkImageView> cloudsOccupancyMipViews;
+    /* Level 0 of the clouds coverage map, kept for the CPU reference raymarcher */
+    std::vector<uint8_t> coverageMap;
+    /* Occupancy volume is rebuilt from the density volume after every bake */
+    bool occupancyDirty = true;
+    /* One view per mip of the baked clouds shape density volume, each mip is a bake target */
+    std::vector<VkImageView> cloudsDensityMipViews;
+    /* Parameters the density volume was baked with, see cloudsDensityBakeOutdated */
+    CloudsParametersBuffer bakedDensityParams;
+    bool densityBakeDirty = true;
+    /* Position the distant clouds panorama is centred on, when the camera moves too
+       far from it or the panorama is dirty the whole panorama is marched again */
+    glm::vec3 cloudsPanoramaCenter = glm::vec3(0.0f);
+    bool cloudsPanoramaDirty = true;
 
     std::unique_ptr<ImGuiImpl> imguiImpl;
     
@@ -83,12 +200,25 @@ private:
     std::unique_ptr<VulkanPipeline> multiscatteringLUTPipeline;
     std::unique_ptr<VulkanPipeline> skyViewLUTPipeline;
     std::unique_ptr<VulkanPipeline> AEPerspectiveLUTPipeline;
+    std::unique_ptr<VulkanPipeline> cloudsClassifyPipeline;
+    std::unique_ptr<VulkanPipeline> cloudsTracePipeline;
+    std::unique_ptr<VulkanPipeline> cloudsReconstructPipeline;
+    std::unique_ptr<VulkanPipeline> cloudsOccupancyBuildPipeline;
+    std::unique_ptr<VulkanPipeline> cloudsOccupancyDownsamplePipeline;
+    std::unique_ptr<VulkanPipeline> cloudsDensityBakePipeline;
+    std::unique_ptr<VulkanPipeline> cloudsShadowBuildPipeline;
+    std::unique_ptr<VulkanPipeline> cloudsPanoramaBuildPipeline;
 
     std::unique_ptr<VulkanPipeline> histogramPipeline;
     std::unique_ptr<VulkanPipeline> sumHistogramPipeline;
 
-    std::unique_ptr<VulkanBuffer> vertexBuffer;
+    /* Terrain patch indices ordered by patch quadrant, see generateTerrainPatchIndices */
     std::unique_ptr<VulkanBuffer> indexBuffer;
+    /* Per node min max heights of the heightmap, selects the terrain nodes every frame */
+    std::unique_ptr<TerrainQuadtree> terrainQuadtree;
+    TerrainSelection terrainSelection;
+    /* Heightmap tiles resident on the GPU, sampled by terrain.vert */
+    std::unique_ptr<TerrainTileCache> terrainTileCache;
 
     GLFWwindow *window;
     VkDebugUtilsMessengerEXT debugMessenger;
@@ -97,10 +227,13 @@ private:
     VkSurfaceKHR surface;
     VkRenderPass renderPass;
     VkRenderPass hdrBackbufferPass;
+    VkRenderPass cloudsCompositePass;
 
     VkSemaphore postProcessReadySemaphore;
     VkSampler AEPerspectiveSampler;
     VkSampler cloudsSampler;
+    /* Repeats along the azimuth (u), clamps along the elevation (v) */
+    VkSampler cloudsPanoramaSampler;
     VkSampler skyViewLUTSampler;
     VkSampler terrainTexturesSampler;
     VkSampler depthTextureSampler;
@@ -132,20 +265,61 @@ private:
     void createAttachments();
     void createSampler();
     void createPrimitivesBuffers();
-    void createVertexBuffer();
-    void createIndexBuffer();
     void createUniformBuffers();
     void createDescriptorPool();
     void createDescriptorSets();
+    /* Point the noise bindings of the WorleyNoise set at the volumes sampled now, the
+       command buffers using the set have to be recorded again afterwards */
+    void writeNoiseDescriptorSets();
     void createCommandBuffers();
+    void freeCommandBuffers();
     void createSyncObjects();
 
     void updateUniformBuffer(uint32_t currentImage);
+    /* Select the visible terrain nodes with the matrices of this frame and write them
+       together with the indirect draws of the patch quadrants for currentImage, streams
+       in the heightmap tiles around the camera. Returns the tile copies of currentImage
+       to submit before the frame, VK_NULL_HANDLE when there are none */
+    VkCommandBuffer updateTerrainNodes(uint32_t currentImage);
     void recreateSwapChain();
     void cleanupSwapchain();
     
     // Compute
     void prepareTextureTargets(uint32_t width, uint32_t height, VkFormat format);
+    /* Create the shape and detail noise and upload their coarse fallbacks */
+    void createNoiseVolumes();
+    /**
+     * Bring in the full noise volumes over several frames without blocking the frame.
+     * Reading the noise cache, BC7 encoding and its PSNR run on worker threads, cached
+     * volumes are uploaded once their worker finished, without waiting for the queue. Missing ones are generated on the
+     * GPU in slabs within NOISE_STREAMING_BUDGET_MS per frame, one volume at a time, read
+     * back and cached by a worker. BC7 is sampled when the device supports it and the
+     * encoding is good enough, see NOISE_BC7_MIN_PSNR
+     * @return true once both volumes are ready
+     */
+    bool streamNoiseVolumes();
+    /**
+     * Regenerate the channels of the noise volumes whose parameters were edited, in slabs
+     * within NOISE_STREAMING_BUDGET_MS per frame like streamNoiseVolumes. The edited
+     * volume is sampled until its regenerated replacement is finished
+     * @return true once a volume was replaced and the sets sampling it have to be rebuilt
+     */
+    bool updateNoiseParams();
+    void createCloudsOccupancy();
+    /* Rebuild the clouds occupancy mip chain from the baked clouds density volume,
+       blocks until the build is finished */
+    void buildCloudsOccupancy();
+    /* Create the clouds shape density volume sized by densityBakeDivisor, destroys the
+       previous one -> device has to be idle */
+    void createCloudsDensity();
+    /* Bake every mip of the clouds shape density volume with the clouds parameters
+       of currentImage, blocks until the bake is finished */
+    void bakeCloudsDensity(uint32_t currentImage);
+    /* True when the noise was regenerated or the shape weights baked into the density
+       volume changed since the last bake */
+    bool cloudsDensityBakeOutdated() const;
+    void createCloudsShadowMap();
+    void createCloudsPanorama();
     void prepareComputeUniformBuffers();
     void createComputePipelines();
     void createComputeCommandBuffer();
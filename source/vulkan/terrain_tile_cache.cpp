@@ -0,0 +1,384 @@
+#include "terrain_tile_cache.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+/* uvec4 per mip plus the params uvec4 in front of the entries */
+static const uint32_t tableHeaderSize = 4 * (TERRAIN_TILE_TABLE_MIPS + 1);
+static const uint32_t noLayer = UINT32_MAX;
+
+TerrainTileCache::TerrainTileCache(std::shared_ptr<VulkanDevice> device,
+    std::shared_ptr<TerrainTileFile> tiles, uint32_t layerCount, uint32_t stagingSlots,
+    float streamingRadius, uint32_t frameCount) : device{device}, tiles{tiles},
+    streamingRadius{streamingRadius}
+{
+    uint32_t mipCount = tiles->getMipCount();
+    if(mipCount > TERRAIN_TILE_TABLE_MIPS)
+    {
+        throw std::runtime_error("TERRAIN_TILE_CACHE::TERRAIN_TILE_CACHE::Too many mips for the tile table");
+    }
+    pinnedMip = mipCount - 1;
+    while(pinnedMip > 0 && tiles->getTileCount(pinnedMip - 1) == glm::uvec2(1))
+    {
+        pinnedMip--;
+    }
+    uint32_t pinnedCount = mipCount - pinnedMip;
+    if(layerCount <= pinnedCount || stagingSlots < pinnedCount)
+    {
+        throw std::runtime_error("TERRAIN_TILE_CACHE::TERRAIN_TILE_CACHE::Not enough layers or staging slots");
+    }
+
+    #pragma region tileTable
+    tableData.assign(tableHeaderSize, 0);
+    uint32_t entryCount = 0;
+    for(uint32_t mip = 0; mip < mipCount; mip++)
+    {
+        glm::uvec2 tileCount = tiles->getTileCount(mip);
+        tableData[4 * mip + 0] = tileCount.x;
+        tableData[4 * mip + 1] = tileCount.y;
+        tableData[4 * mip + 2] = entryCount;
+        entryCount += tileCount.x * tileCount.y;
+    }
+    tableData[4 * TERRAIN_TILE_TABLE_MIPS + 0] = mipCount;
+    tableData[4 * TERRAIN_TILE_TABLE_MIPS + 1] = tiles->getTileSize();
+    tableData[4 * TERRAIN_TILE_TABLE_MIPS + 2] = tiles->getWidth();
+    tableData[4 * TERRAIN_TILE_TABLE_MIPS + 3] = tiles->getHeight();
+    tableData.resize(tableHeaderSize + entryCount, 0);
+    entryStates.assign(entryCount, TileState::NONE);
+    entryLayers.assign(entryCount, noLayer);
+
+    /* A frame in flight keeps reading its own table while the next one is written */
+    for(uint32_t i = 0; i < frameCount; i++)
+    {
+        tileTables.push_back(std::make_unique<VulkanBuffer>(device, getTableSize(),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    }
+    tablesDirty.assign(frameCount, true);
+    #pragma endregion tileTable
+
+    #pragma region tileArray
+    uint32_t storedTileSize = tiles->getStoredTileSize();
+    tileArray = std::make_unique<VulkanImage>(device, storedTileSize, storedTileSize, 1,
+        VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R32_SFLOAT, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT, 1, layerCount);
+    /* Layers are only sampled once the table points at them -> contents can stay undefined */
+    tileArray->TransitionImageLayout(VK_FORMAT_R32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1);
+    tileArray->TransitionImageLayout(VK_FORMAT_R32_SFLOAT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+    layerEntries.assign(layerCount, noLayer);
+    layerLastUse.assign(layerCount, 0);
+    #pragma endregion tileArray
+
+    #pragma region staging
+    tileBytes = VkDeviceSize(storedTileSize) * storedTileSize * sizeof(float);
+    stagingBuffer = std::make_unique<VulkanBuffer>(device, tileBytes * stagingSlots,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    void *mappedStaging;
+    vkMapMemory(device->device, stagingBuffer->bufferMemory, 0, VK_WHOLE_SIZE, 0, &mappedStaging);
+    stagingData = static_cast<uint8_t *>(mappedStaging);
+    #pragma endregion staging
+
+    #pragma region transferCommandBuffers
+    /* Re-recorded every frame with finished tiles -> resettable */
+    VkCommandPoolCreateInfo commandPoolCI = {};
+    commandPoolCI.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCI.queueFamilyIndex = device->familyIndices.graphicsFamily.value();
+    commandPoolCI.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    if (vkCreateCommandPool(device->device, &commandPoolCI, nullptr, &commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("TERRAIN_TILE_CACHE::TERRAIN_TILE_CACHE::Failed to create command pool");
+    }
+
+    transferCommandBuffers.resize(frameCount);
+    VkCommandBufferAllocateInfo commandBufferAI = {};
+    commandBufferAI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAI.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAI.commandPool = commandPool;
+    commandBufferAI.commandBufferCount = frameCount;
+    if (vkAllocateCommandBuffers(device->device, &commandBufferAI, transferCommandBuffers.data())
+        != VK_SUCCESS)
+    {
+        throw std::runtime_error("TERRAIN_TILE_CACHE::TERRAIN_TILE_CACHE::Failed to allocate transfer command buffers");
+    }
+    frameSlots.resize(frameCount);
+    #pragma endregion transferCommandBuffers
+
+    #pragma region pinnedTiles
+    std::vector<TileCopy> copies;
+    for(uint32_t mip = pinnedMip; mip < mipCount; mip++)
+    {
+        uint32_t slot = mip - pinnedMip;
+        memcpy(stagingData + slot * tileBytes, tiles->getTile(mip, glm::uvec2(0)), tileBytes);
+        makeResident(getEntry(mip, glm::uvec2(0)), slot);
+        layerLastUse[slot] = UINT64_MAX;
+        copies.push_back({slot, slot});
+    }
+    /* Waits for the queue once at startup -> the pinned slots go straight to the uploader */
+    VkCommandBuffer commandBuffer = device->BeginSingleTimeCommands();
+    recordCopies(commandBuffer, copies);
+    device->EndSingleTimeCommands(commandBuffer);
+    #pragma endregion pinnedTiles
+
+    for(uint32_t slot = 0; slot < stagingSlots; slot++)
+    {
+        freeSlots.push_back(slot);
+    }
+    uploader = std::thread(&TerrainTileCache::uploadTiles, this);
+}
+
+TerrainTileCache::~TerrainTileCache()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+    }
+    wake.notify_all();
+    uploader.join();
+    vkUnmapMemory(device->device, stagingBuffer->bufferMemory);
+    vkDestroyCommandPool(device->device, commandPool, nullptr);
+}
+
+VkDeviceSize TerrainTileCache::getTableSize() const
+{
+    return tableData.size() * sizeof(uint32_t);
+}
+
+uint32_t TerrainTileCache::getEntry(uint32_t mip, glm::uvec2 tile) const
+{
+    return tableData[4 * mip + 2] + tile.y * tableData[4 * mip] + tile.x;
+}
+
+uint32_t TerrainTileCache::findVictimLayer() const
+{
+    uint32_t victim = noLayer;
+    for(uint32_t layer = 0; layer < layerEntries.size(); layer++)
+    {
+        if(layerEntries[layer] == noLayer) { return layer; }
+        if(layerLastUse[layer] < frame &&
+           (victim == noLayer || layerLastUse[layer] < layerLastUse[victim]))
+        {
+            victim = layer;
+        }
+    }
+    return victim;
+}
+
+void TerrainTileCache::makeResident(uint32_t entry, uint32_t layer)
+{
+    uint32_t evicted = layerEntries[layer];
+    if(evicted != noLayer)
+    {
+        entryStates[evicted] = TileState::NONE;
+        entryLayers[evicted] = noLayer;
+        tableData[tableHeaderSize + evicted] = 0;
+    }
+    entryStates[entry] = TileState::RESIDENT;
+    entryLayers[entry] = layer;
+    layerEntries[layer] = entry;
+    layerLastUse[layer] = frame;
+    tableData[tableHeaderSize + entry] = layer + 1;
+    std::fill(tablesDirty.begin(), tablesDirty.end(), true);
+}
+
+void TerrainTileCache::writeTable(uint32_t frameIndex)
+{
+    VulkanBuffer &tileTable = *tileTables[frameIndex];
+    void *data;
+    vkMapMemory(device->device, tileTable.bufferMemory, 0, getTableSize(), 0, &data);
+    memcpy(data, tableData.data(), getTableSize());
+    vkUnmapMemory(device->device, tileTable.bufferMemory);
+    tablesDirty[frameIndex] = false;
+}
+
+VkCommandBuffer TerrainTileCache::update(glm::vec2 planePosition, uint32_t frameIndex)
+{
+    frame++;
+
+    #pragma region wantedTiles
+    /* Coarse mips first -> when the cache runs full the coarse tiles still make it in */
+    std::vector<TileRequest> wanted;
+    size_t budget = layerEntries.size() - (tiles->getMipCount() - pinnedMip);
+    glm::vec2 position = planePosition * glm::vec2(tiles->getWidth(), tiles->getHeight());
+    for(uint32_t mip = pinnedMip; mip-- > 0 && wanted.size() < budget;)
+    {
+        /* Tile and radius in mip 0 texels */
+        float tileExtent = float(tiles->getTileSize() << mip);
+        float radius = streamingRadius * float(1u << mip);
+        glm::ivec2 lastTile = glm::ivec2(tiles->getTileCount(mip)) - glm::ivec2(1);
+        glm::ivec2 begin = glm::clamp(glm::ivec2(glm::floor((position - radius) / tileExtent)),
+            glm::ivec2(0), lastTile);
+        glm::ivec2 end = glm::clamp(glm::ivec2(glm::floor((position + radius) / tileExtent)),
+            glm::ivec2(0), lastTile);
+        for(int y = begin.y; y <= end.y && wanted.size() < budget; y++)
+        {
+            for(int x = begin.x; x <= end.x && wanted.size() < budget; x++)
+            {
+                glm::vec2 closest = glm::clamp(position, glm::vec2(x, y) * tileExtent,
+                    glm::vec2(x + 1, y + 1) * tileExtent);
+                if(glm::distance(closest, position) > radius) { continue; }
+
+                glm::uvec2 tile = glm::uvec2(x, y);
+                wanted.push_back({getEntry(mip, tile), mip, tile});
+            }
+        }
+    }
+    #pragma endregion wantedTiles
+
+    #pragma region queueTiles
+    std::vector<TileCopy> copies;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        /* Copies of the last submission of this frame finished reading their slots */
+        freeSlots.insert(freeSlots.end(), frameSlots[frameIndex].begin(), frameSlots[frameIndex].end());
+        frameSlots[frameIndex].clear();
+        /* Requests the uploader did not get to yet are replaced by the ones of this frame */
+        for(const TileRequest &request : requests)
+        {
+            entryStates[request.entry] = TileState::NONE;
+        }
+        requests.clear();
+        for(const TileRequest &request : wanted)
+        {
+            TileState &state = entryStates[request.entry];
+            if(state == TileState::RESIDENT)
+            {
+                layerLastUse[entryLayers[request.entry]] = frame;
+            }
+            else if(state == TileState::NONE)
+            {
+                state = TileState::QUEUED;
+                requests.push_back(request);
+            }
+        }
+
+        for(const CompletedTile &tile : completed)
+        {
+            uint32_t layer = findVictimLayer();
+            /* Every layer holds a tile wanted this frame -> drop the tile, it gets requested
+               again once some of them are not wanted anymore */
+            if(layer == noLayer)
+            {
+                entryStates[tile.entry] = TileState::NONE;
+                freeSlots.push_back(tile.slot);
+                continue;
+            }
+            makeResident(tile.entry, layer);
+            copies.push_back({tile.slot, layer});
+        }
+        completed.clear();
+    }
+    wake.notify_one();
+    #pragma endregion queueTiles
+
+    if(tablesDirty[frameIndex])
+    {
+        writeTable(frameIndex);
+    }
+    if(copies.empty())
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    /* Slots stay taken until the copies of this frame were executed, see the next update
+       of frameIndex */
+    VkCommandBuffer commandBuffer = transferCommandBuffers[frameIndex];
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("TERRAIN_TILE_CACHE::UPDATE::Failed to begin transfer command buffer");
+    }
+    recordCopies(commandBuffer, copies);
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("TERRAIN_TILE_CACHE::UPDATE::Failed to record transfer command buffer");
+    }
+    for(const TileCopy &copy : copies)
+    {
+        frameSlots[frameIndex].push_back(copy.slot);
+    }
+    return commandBuffer;
+}
+
+void TerrainTileCache::recordCopies(VkCommandBuffer commandBuffer, const std::vector<TileCopy> &copies)
+{
+    uint32_t storedTileSize = tiles->getStoredTileSize();
+    std::vector<VkImageMemoryBarrier> barriers(copies.size());
+    std::vector<VkBufferImageCopy> regions(copies.size());
+    for(size_t i = 0; i < copies.size(); i++)
+    {
+        barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[i].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barriers[i].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].image = tileArray->image;
+        barriers[i].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barriers[i].subresourceRange.baseMipLevel = 0;
+        barriers[i].subresourceRange.levelCount = 1;
+        barriers[i].subresourceRange.baseArrayLayer = copies[i].layer;
+        barriers[i].subresourceRange.layerCount = 1;
+        barriers[i].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barriers[i].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        regions[i].bufferOffset = copies[i].slot * tileBytes;
+        regions[i].bufferRowLength = 0;
+        regions[i].bufferImageHeight = 0;
+        regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        regions[i].imageSubresource.mipLevel = 0;
+        regions[i].imageSubresource.baseArrayLayer = copies[i].layer;
+        regions[i].imageSubresource.layerCount = 1;
+        regions[i].imageOffset = {0, 0, 0};
+        regions[i].imageExtent = {storedTileSize, storedTileSize, 1};
+    }
+
+    /* Only the layers being replaced change layout, the rest stays readable. Reads of earlier
+       submissions are covered by the barrier -> the layer of an evicted tile can be reused */
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+        static_cast<uint32_t>(barriers.size()), barriers.data());
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer->buffer, tileArray->image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+    for(VkImageMemoryBarrier &barrier : barriers)
+    {
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    }
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, nullptr, 0, nullptr,
+        static_cast<uint32_t>(barriers.size()), barriers.data());
+}
+
+void TerrainTileCache::uploadTiles()
+{
+    while(true)
+    {
+        TileRequest request;
+        uint32_t slot;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this] { return stop || (!requests.empty() && !freeSlots.empty()); });
+            if(stop) { return; }
+
+            request = requests.front();
+            requests.pop_front();
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            entryStates[request.entry] = TileState::LOADING;
+        }
+
+        /* Page faults of the mapped file are taken here instead of on the main thread */
+        memcpy(stagingData + slot * tileBytes, tiles->getTile(request.mip, request.tile), tileBytes);
+
+        std::lock_guard<std::mutex> guard(lock);
+        completed.push_back({request.entry, slot});
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <condition_variable>
+
+#include <vulkan/vulkan.h>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include "vulkan_device.hpp"
+#include "vulkan_buffer.hpp"
+#include "vulkan_image.hpp"
+#include "model/terrain_tiles.hpp"
+
+/* Mips the tile table has room for, has to match terrain.vert */
+#define TERRAIN_TILE_TABLE_MIPS 16
+
+/**
+ * GPU cache of the tiles of a terrain tile file. Resident tiles live in the layers of
+ * tileArray, each frame's tile table maps every tile of every mip to its layer:
+ *      uvec4 mips[TERRAIN_TILE_TABLE_MIPS] - tiles along x, tiles along y, first entry
+ *      uvec4 params - mip count, tile size, heightmap width, heightmap height
+ *      uint entries[] - layer + 1 of the tile, 0 while the tile is not resident
+ * The mips covered by a single tile are resident all the time -> every point of the
+ * terrain has some height to fall back to. Finer tiles are copied from the mapped file
+ * into staging memory by a background thread, the main thread only records the copies
+ * into the transfer command buffer of the frame
+ */
+class TerrainTileCache
+{
+    public:
+        std::unique_ptr<VulkanImage> tileArray;
+        /* Host visible storage buffer per frame, see the class description for its layout */
+        std::vector<std::unique_ptr<VulkanBuffer>> tileTables;
+
+        /**
+         * @param layerCount - tiles the cache holds at once
+         * @param stagingSlots - tiles that can be in flight between the uploader thread
+         *      and the GPU at once
+         * @param streamingRadius - distance in mip 0 texels within which the tiles of mip 0
+         *      are wanted, doubles with every mip
+         * @param frameCount - frames with their own tile table and transfer command buffer
+         */
+        TerrainTileCache(std::shared_ptr<VulkanDevice> device, std::shared_ptr<TerrainTileFile> tiles,
+            uint32_t layerCount, uint32_t stagingSlots, float streamingRadius, uint32_t frameCount);
+        ~TerrainTileCache();
+
+        TerrainTileCache(const TerrainTileCache &) = delete;
+        TerrainTileCache &operator=(const TerrainTileCache &) = delete;
+
+        /**
+         * Request the tiles around the camera, record the copies of the tiles the uploader
+         * thread finished since the last call and write the tile table of frameIndex. The
+         * last submission of frameIndex has to be finished, its staging slots are handed
+         * back to the uploader here
+         * @param planePosition - camera position on the unit terrain plane
+         * @return transfer command buffer of frameIndex, to be submitted before anything
+         *      sampling the cache in that frame, VK_NULL_HANDLE when no tile finished
+         */
+        VkCommandBuffer update(glm::vec2 planePosition, uint32_t frameIndex);
+
+        VkDeviceSize getTableSize() const;
+
+    private:
+        enum class TileState : uint8_t { NONE, QUEUED, LOADING, RESIDENT };
+
+        struct TileRequest
+        {
+            uint32_t entry;
+            uint32_t mip;
+            glm::uvec2 tile;
+        };
+
+        struct CompletedTile
+        {
+            uint32_t entry;
+            uint32_t slot;
+        };
+
+        struct TileCopy
+        {
+            uint32_t slot;
+            uint32_t layer;
+        };
+
+        std::shared_ptr<VulkanDevice> device;
+        std::shared_ptr<TerrainTileFile> tiles;
+        float streamingRadius;
+        /* First mip covered by a single tile, it and all coarser mips are never evicted */
+        uint32_t pinnedMip;
+
+        std::unique_ptr<VulkanBuffer> stagingBuffer;
+        /* Persistently mapped stagingBuffer, slot i starts at i * tile bytes */
+        uint8_t *stagingData;
+        VkDeviceSize tileBytes;
+
+        /* Main thread only */
+        std::vector<uint32_t> tableData;
+        /* Per frame, set for every frame whenever tableData changes */
+        std::vector<bool> tablesDirty;
+        VkCommandPool commandPool;
+        std::vector<VkCommandBuffer> transferCommandBuffers;
+        /* Staging slots read by the last submitted copies of each frame */
+        std::vector<std::vector<uint32_t>> frameSlots;
+        uint64_t frame = 0;
+        std::vector<uint32_t> entryLayers;
+        std::vector<uint32_t> layerEntries;
+        std::vector<uint64_t> layerLastUse;
+
+        /* Shared with the uploader thread */
+        std::mutex lock;
+        std::condition_variable wake;
+        bool stop = false;
+        std::deque<TileRequest> requests;
+        std::vector<uint32_t> freeSlots;
+        std::vector<CompletedTile> completed;
+        std::vector<TileState> entryStates;
+
+        std::thread uploader;
+
+        void uploadTiles();
+        void recordCopies(VkCommandBuffer commandBuffer, const std::vector<TileCopy> &copies);
+        uint32_t getEntry(uint32_t mip, glm::uvec2 tile) const;
+        /* Free layer or the least recently used one not wanted this frame, UINT32_MAX if none */
+        uint32_t findVictimLayer() const;
+        void makeResident(uint32_t entry, uint32_t layer);
+        void writeTable(uint32_t frameIndex);
+};
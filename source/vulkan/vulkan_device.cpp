@@ -75,7 +75,29 @@ bool VulkanDevice::isDeviceSuitable(const VkPhysicalDevice device, const VkSurfa
     VkPhysicalDeviceFeatures supportedFeatures;
     vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-    return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+    /* rg32f clouds depth targets are written as storage images -> extended storage formats are required */
+    return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy &&
+        supportedFeatures.shaderStorageImageExtendedFormats && checkSubgroupSupport(device);
+}
+
+bool VulkanDevice::checkSubgroupSupport(const VkPhysicalDevice device)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_1) { return false; }
+
+    /* Noise generation reduces its min max with subgroup arithmetic in compute shaders, the
+       luminance histogram merges equal bins with ballots */
+    VkPhysicalDeviceSubgroupProperties subgroupProperties {};
+    subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties2 {};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &subgroupProperties;
+    vkGetPhysicalDeviceProperties2(device, &properties2);
+
+    return (subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) &&
+           (subgroupProperties.supportedOperations & VK_SUBGROUP_FEATURE_ARITHMETIC_BIT) &&
+           (subgroupProperties.supportedOperations & VK_SUBGROUP_FEATURE_BALLOT_BIT);
 }
 
 QueueFamilyIndices VulkanDevice::findQueueFamilies(const VkPhysicalDevice device,
@@ -211,6 +233,13 @@ void VulkanDevice::createLogicalDevice(const VkSurfaceKHR surface)
     deviceFeatures.samplerAnisotropy = VK_TRUE;
     /* Enable sample shading feature for the device */
     deviceFeatures.sampleRateShading = VK_TRUE;
+    /* Enable storage images with formats outside of the base set (rg32f) */
+    deviceFeatures.shaderStorageImageExtendedFormats = VK_TRUE;
+    /* Optional, noise volumes fall back to uncompressed formats without it */
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    textureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -345,6 +374,16 @@ uint32_t VulkanDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags
     throw std::runtime_error("VULKAN_DEVICE::FIND_MEMORY_TYPE::Failed to find suitable memory type");
 }
 
+bool VulkanDevice::isCompressed3DFormatSupported(VkFormat format)
+{
+    if(!textureCompressionBC) { return false; }
+    /* Block compressed 3D images are optional even with textureCompressionBC */
+    VkImageFormatProperties properties;
+    return vkGetPhysicalDeviceImageFormatProperties(physicalDevice, format, VK_IMAGE_TYPE_3D,
+        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 0,
+        &properties) == VK_SUCCESS;
+}
+
 VkCommandBuffer VulkanDevice::BeginSingleTimeCommands()
 {
     VkCommandBufferAllocateInfo allocInfo{};
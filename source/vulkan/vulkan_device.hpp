@@ -39,6 +39,8 @@ public:
     VkDevice device;
     VkPhysicalDevice physicalDevice;
     VkSampleCountFlagBits msaaSamples;
+    /* Enabled when supported by the physical device */
+    bool textureCompressionBC = false;
 
     QueueFamilyIndices familyIndices;
     VkCommandPool graphicsCommandPool;
@@ -61,6 +63,8 @@ public:
         VkImageTiling tiling, VkFormatFeatureFlags features);
 
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+    /* Sampled 3D images of the block compressed format can be created */
+    bool isCompressed3DFormatSupported(VkFormat format);
     SwapChainSupportDetails querySwapChainSupport(const VkPhysicalDevice device, const VkSurfaceKHR surface);
 
 
@@ -71,6 +75,7 @@ private:
 
     bool isDeviceSuitable(const VkPhysicalDevice device, const VkSurfaceKHR surface);
     bool checkDeviceExtensionSupport(const VkPhysicalDevice device);
+    bool checkSubgroupSupport(const VkPhysicalDevice device);
     VkSampleCountFlagBits getMaxUsableSampleCount();
     QueueFamilyIndices findQueueFamilies(const VkPhysicalDevice device, const VkSurfaceKHR surface);
 };
\ No newline at end of file
@@ -1,7 +1,8 @@
 #include "vulkan_image.hpp"
 
 VkImageView createImageView(VkDevice device, VkImage image, VkFormat format,
-    VkImageAspectFlags aspectFlags, uint32_t mipLevels, uint32_t depth)
+    VkImageAspectFlags aspectFlags, uint32_t mipLevels, uint32_t depth, uint32_t baseMipLevel,
+    uint32_t layerCount)
 {
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -9,6 +10,8 @@ VkImageView createImageView(VkDevice device, VkImage image, VkFormat format,
     if(depth > 1)
     {
         viewInfo.viewType = VK_IMAGE_VIEW_TYPE_3D;
+    } else if(layerCount > 1) {
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
     } else {
         viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
     }
@@ -17,10 +20,10 @@ VkImageView createImageView(VkDevice device, VkImage image, VkFormat format,
     /* subresourceRnage describes what the image's purpose is and which part of the image
     should be accessed*/
     viewInfo.subresourceRange.aspectMask = aspectFlags;
-    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.baseMipLevel = baseMipLevel;
     viewInfo.subresourceRange.levelCount = mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
-    viewInfo.subresourceRange.layerCount = 1;
+    viewInfo.subresourceRange.layerCount = layerCount;
 
     VkImageView imageView;
     if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS)
@@ -33,11 +36,12 @@ VkImageView createImageView(VkDevice device, VkImage image, VkFormat format,
 void VulkanImage::CreateImage(uint32_t width, uint32_t height, uint32_t depth,
     uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, 
     VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-    VkImageAspectFlags aspectFlags)
+    VkImageAspectFlags aspectFlags, uint32_t arrayLayers)
 {
     VkImageType imageType = depth == 1 ? VK_IMAGE_TYPE_2D : VK_IMAGE_TYPE_3D;
     this->format = format;
     this->mipLevels = mipLevels;
+    this->arrayLayers = arrayLayers;
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = imageType;
@@ -45,7 +49,7 @@ void VulkanImage::CreateImage(uint32_t width, uint32_t height, uint32_t depth,
     imageInfo.extent.height = height;
     imageInfo.extent.depth = depth;
     imageInfo.mipLevels = mipLevels;
-    imageInfo.arrayLayers = 1;
+    imageInfo.arrayLayers = arrayLayers;
     imageInfo.format = format;
     imageInfo.tiling = tiling;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -71,48 +75,30 @@ void VulkanImage::CreateImage(uint32_t width, uint32_t height, uint32_t depth,
     }
     vkBindImageMemory(device->device, image, imageMemory, 0);
     
-    imageView = createImageView(device->device, image, format, aspectFlags, mipLevels, depth);
+    imageView = createImageView(device->device, image, format, aspectFlags, mipLevels, depth, 0,
+        arrayLayers);
 }
 
 VulkanImage::VulkanImage(std::shared_ptr<VulkanDevice> device, uint32_t width, uint32_t height,
     uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, 
     VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-    VkImageAspectFlags aspectFlags, uint32_t depth) : device{device}
+    VkImageAspectFlags aspectFlags, uint32_t depth, uint32_t arrayLayers) : device{device}
 {
     CreateImage(width, height, depth, mipLevels, numSamples, format,
-        tiling, usage, properties, aspectFlags);
+        tiling, usage, properties, aspectFlags, arrayLayers);
 }
 
 
 VulkanImage::VulkanImage(std::shared_ptr<VulkanDevice> device, const std::string &texturePath, bool isEXR) :
-    device{device}  
-{
-    int texWidth, texHeight, texChannels;
-    VkDeviceSize imageSize;
-    void *imageData;
-    if(isEXR)
-    {
-        float *rgba;
-        const char* err;
-        int ret = LoadEXR(&rgba, &texWidth, &texHeight, texturePath.c_str(), &err);
-        imageSize = texWidth * texHeight * sizeof(float) * 4;
-        if (ret != 0) 
-        {
-            std::cout << "err: " << std::string(err) << std::endl;
-            throw std::runtime_error("VULKAN_IMAGE::CREATE_TEXTURE_IMAGE::Failed to load exr image");
-        }
-        imageData = rgba;
-    } else {
-        stbi_uc *rgba = stbi_load(texturePath.c_str(), &texWidth, &texHeight,
-                                    &texChannels, STBI_rgb_alpha);
+    VulkanImage(device, ImageData(texturePath, isEXR)) {}
 
-        imageSize = texWidth * texHeight * 4;
-        if (!rgba)
-        {
-            throw std::runtime_error("VULKAN_IMAGE::CREATE_TEXTURE_IMAGE::Failed to load texture image");
-        }
-        imageData = rgba;
-    }
+VulkanImage::VulkanImage(std::shared_ptr<VulkanDevice> device, const ImageData &imageData) :
+    device{device}
+{
+    bool isEXR = imageData.isEXR;
+    int texWidth = imageData.width;
+    int texHeight = imageData.height;
+    VkDeviceSize imageSize = imageData.size;
 
     uint32_t mipLevels;
     /* Calculate the number of levels in the mip chain */
@@ -133,14 +119,8 @@ VulkanImage::VulkanImage(std::shared_ptr<VulkanDevice> device, const std::string
     void *data;
 
     vkMapMemory(device->device, stagingBuffer.bufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, imageData, static_cast<size_t>(imageSize));
+    memcpy(data, imageData.pixels, static_cast<size_t>(imageSize));
     vkUnmapMemory(device->device, stagingBuffer.bufferMemory);
-    if(isEXR)
-    {
-        free(imageData);
-    }else{
-        stbi_image_free(imageData);
-    }
 
     VkFormat imageFormat;
     if(isEXR)
@@ -170,6 +150,59 @@ VulkanImage::VulkanImage(std::shared_ptr<VulkanDevice> device, const std::string
     }
 }
 
+VulkanImage::VulkanImage(std::shared_ptr<VulkanDevice> device, uint32_t width, uint32_t height,
+    uint32_t depth, VkFormat compressedFormat, VkCommandBuffer commandBuffer,
+    const VulkanBuffer &blocks, const std::vector<size_t> &mipOffsets) : device{device}
+{
+    uint32_t mipCount = static_cast<uint32_t>(mipOffsets.size());
+    CreateImage(width, height, depth, mipCount, VK_SAMPLE_COUNT_1_BIT, compressedFormat,
+        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipCount;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    /* Extents are in texels, mips smaller than a block still take whole blocks */
+    std::vector<VkBufferImageCopy> regions(mipCount);
+    for(uint32_t mip = 0; mip < mipCount; mip++)
+    {
+        regions[mip].bufferOffset = mipOffsets[mip];
+        regions[mip].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        regions[mip].imageSubresource.mipLevel = mip;
+        regions[mip].imageSubresource.baseArrayLayer = 0;
+        regions[mip].imageSubresource.layerCount = 1;
+        regions[mip].imageExtent = {
+            std::max(width >> mip, 1u),
+            std::max(height >> mip, 1u),
+            std::max(depth >> mip, 1u)};
+    }
+    vkCmdCopyBufferToImage(commandBuffer, blocks.buffer, image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipCount, regions.data());
+
+    /* Sampled by the compute and fragment passes of later submissions */
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &barrier);
+}
+
 VulkanImage::~VulkanImage()
 {
     vkDestroyImage(device->device, image, nullptr);
@@ -209,7 +242,7 @@ void VulkanImage::TransitionImageLayout( VkFormat format,VkImageLayout oldLayout
     barrier.subresourceRange.baseMipLevel = 0;
     barrier.subresourceRange.levelCount = mipLevels;
     barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
+    barrier.subresourceRange.layerCount = arrayLayers;
 
     VkPipelineStageFlags sourceStage;
     VkPipelineStageFlags destinationStage;
@@ -281,17 +314,18 @@ bool VulkanImage::HasStencilComponent(VkFormat format)
            format == VK_FORMAT_D24_UNORM_S8_UINT;
 }
 
-void VulkanImage::CopyBufferToImage(VulkanBuffer &buffer, uint32_t width, uint32_t height)
+void VulkanImage::CopyBufferToImage(VulkanBuffer &buffer, uint32_t width, uint32_t height,
+    uint32_t mipLevel, VkDeviceSize bufferOffset)
 {
     VkCommandBuffer commandBuffer = device->BeginSingleTimeCommands();
 
     VkBufferImageCopy region{};
-    region.bufferOffset = 0;
+    region.bufferOffset = bufferOffset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
 
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.mipLevel = mipLevel;
     region.imageSubresource.baseArrayLayer = 0;
     region.imageSubresource.layerCount = 1;
     region.imageOffset = {0, 0, 0};
@@ -314,6 +348,53 @@ void VulkanImage::CopyBufferToImage(VulkanBuffer &buffer, uint32_t width, uint32
     device->EndSingleTimeCommands(commandBuffer);
 }
 
+void VulkanImage::CopyImageToBuffer(VulkanBuffer &buffer, VkImageLayout layout, uint32_t width,
+    uint32_t height, uint32_t depth)
+{
+    VkCommandBuffer commandBuffer = device->BeginSingleTimeCommands();
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {
+        width,
+        height,
+        depth};
+
+    vkCmdCopyImageToBuffer(
+        commandBuffer,
+        image,
+        layout,
+        buffer.buffer,
+        1,
+        &region);
+
+    device->EndSingleTimeCommands(commandBuffer);
+}
+
+void VulkanImage::ClearColorImage(VkClearColorValue clearValue, VkImageLayout layout)
+{
+    VkCommandBuffer commandBuffer = device->BeginSingleTimeCommands();
+
+    VkImageSubresourceRange range{};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.baseMipLevel = 0;
+    range.levelCount = mipLevels;
+    range.baseArrayLayer = 0;
+    range.layerCount = 1;
+
+    vkCmdClearColorImage(commandBuffer, image, layout, &clearValue, 1, &range);
+
+    device->EndSingleTimeCommands(commandBuffer);
+}
+
 void VulkanImage::GenerateMipmaps( VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels)
 {
     /* Check if image format supports linear blitting */
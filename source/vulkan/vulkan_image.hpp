@@ -9,12 +9,15 @@
 
 #include "vulkan_device.hpp"
 #include "vulkan_buffer.hpp"
+#include "image_data.hpp"
 
 #include "stb_image.h"
 #include "tinyexr.h"
 
+/* layerCount > 1 creates 2D array view over all layers */
 VkImageView createImageView(VkDevice device, VkImage image, VkFormat format,
-    VkImageAspectFlags aspectFlags, uint32_t mipLevels, uint32_t depth);
+    VkImageAspectFlags aspectFlags, uint32_t mipLevels, uint32_t depth, uint32_t baseMipLevel = 0,
+    uint32_t layerCount = 1);
     
 class VulkanImage
 {
@@ -25,20 +28,43 @@ class VulkanImage
         VkFormat format;
 
         uint32_t mipLevels;
+        uint32_t arrayLayers = 1;
 
         VulkanImage(std::shared_ptr<VulkanDevice> device,uint32_t width, uint32_t height, uint32_t mipLevels, 
             VkSampleCountFlagBits numSamples, VkFormat format,VkImageTiling tiling,
             VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-            VkImageAspectFlags aspectFlags, uint32_t depth = 1);
+            VkImageAspectFlags aspectFlags, uint32_t depth = 1, uint32_t arrayLayers = 1);
 
         VulkanImage(std::shared_ptr<VulkanDevice>, const std::string &texturePath, bool isEXR = false);
+        /* Upload already decoded image, lets the caller keep using the pixels on the CPU */
+        VulkanImage(std::shared_ptr<VulkanDevice> device, const ImageData &imageData);
+
+        /* Block compressed 3D texture with the full mip chain, its upload from blocks is
+           recorded into commandBuffer -> blocks has to outlive its execution. Mip i starts
+           at mipOffsets[i] and its slices are tightly packed rows of blocks. Ends up in
+           VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL */
+        VulkanImage(std::shared_ptr<VulkanDevice> device, uint32_t width, uint32_t height,
+            uint32_t depth, VkFormat compressedFormat, VkCommandBuffer commandBuffer,
+            const VulkanBuffer &blocks, const std::vector<size_t> &mipOffsets);
 
         ~VulkanImage();
 
         void TransitionImageLayout(VkFormat format,VkImageLayout oldLayout, 
             VkImageLayout newLayout, uint32_t mipLevels);
 
-        void CopyBufferToImage( VulkanBuffer &buffer, uint32_t width, uint32_t height);
+        /* width and height are the dimensions of the copied mip level, its texels
+           start at bufferOffset */
+        void CopyBufferToImage( VulkanBuffer &buffer, uint32_t width, uint32_t height,
+            uint32_t mipLevel = 0, VkDeviceSize bufferOffset = 0);
+
+        /* Copy mip 0 of the image into buffer, image has to be in layout that
+           allows transfer reads (TRANSFER_SRC_OPTIMAL or GENERAL) */
+        void CopyImageToBuffer(VulkanBuffer &buffer, VkImageLayout layout, uint32_t width,
+            uint32_t height, uint32_t depth = 1);
+
+        /* Fill all mips of the color image with clearValue, image has to be in layout
+           that allows transfer writes (TRANSFER_DST_OPTIMAL or GENERAL) */
+        void ClearColorImage(VkClearColorValue clearValue, VkImageLayout layout);
     
     private:
         std::shared_ptr<VulkanDevice> device;
@@ -46,7 +72,7 @@ class VulkanImage
         void CreateImage(uint32_t width, uint32_t height, uint32_t depth, uint32_t mipLevels, 
             VkSampleCountFlagBits numSamples, VkFormat format,VkImageTiling tiling,
             VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-            VkImageAspectFlags aspectFlags);
+            VkImageAspectFlags aspectFlags, uint32_t arrayLayers = 1);
 
         bool HasStencilComponent(VkFormat format);
 